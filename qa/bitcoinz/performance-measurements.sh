@@ -215,6 +215,12 @@ case "$1" in
             incnotewitnesses)
                 bitcoinz_rpc zcbenchmark incnotewitnesses 100 "${@:3}"
                 ;;
+            sprouttreeappend)
+                bitcoinz_rpc zcbenchmark sprouttreeappend 10 "${@:3}"
+                ;;
+            saplingtreeappend)
+                bitcoinz_rpc zcbenchmark saplingtreeappend 10 "${@:3}"
+                ;;
             connectblockslow)
                 extract_benchmark_data
                 bitcoinz_rpc zcbenchmark connectblockslow 10
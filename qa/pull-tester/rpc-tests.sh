@@ -41,6 +41,7 @@ testScripts=(
     'rawtransactions.py'
     'getrawtransaction_insight.py'
     'rest.py'
+    'rest_compactblocks.py'
     'mempool_limit.py'
     'mempool_spendcoinbase.py'
     'mempool_coinbase_spends.py'
@@ -61,6 +62,7 @@ testScripts=(
     'timestampindex.py'
     'decodescript.py'
     'blockchain.py'
+    'utxo_snapshot.py'
     'disablewallet.py'
     'sendheaders.py',
     'zcjoinsplit.py'
@@ -74,6 +76,11 @@ testScripts=(
     'p2p_txexpiry_dos.py'
     'p2p_txexpiringsoon.py'
     'p2p_node_bloom.py'
+    'p2p_txreconciliation.py'
+    'rpc_batch.py'
+    'mempool_snapshot.py'
+    'perfstats.py'
+    'lockprofile.py'
     'regtest_signrawtransaction.py'
     'finalsaplingroot.py'
     'shorter_block_times.py'
@@ -0,0 +1,77 @@
+#!/usr/bin/env python
+# Copyright (c) 2026 The BitcoinZ Community
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Profile the locks taken while mining blocks on a regtest node, and check
+# that getlockprofile reports them, and that setlockprofiling stops and
+# clears the profile.
+#
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.authproxy import JSONRPCException
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_greater_than, \
+    assert_raises, initialize_chain_clean, start_node
+
+class LockProfileTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print "Initializing test directory " + self.options.tmpdir
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self):
+        self.nodes = [start_node(0, self.options.tmpdir, ['-lockprofile=1'])]
+        self.is_network_split = False
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(10)
+
+        profile = node.getlockprofile()
+        assert_equal(profile['samplerate'], 1)
+        sites = profile['sites']
+        cs_main = [site for site in sites if site['lock'] == 'cs_main']
+        assert_greater_than(len(cs_main), 0)
+        for site in sites:
+            # Every acquisition is timed at rate 1
+            assert_equal(site['acquisitions'], site['samples'])
+            assert(site['contended'] <= site['samples'])
+            assert(site['max_wait_us'] <= site['wait_us'])
+            assert(site['max_hold_us'] <= site['hold_us'])
+        waits = [site['wait_us'] for site in sites]
+        assert_equal(waits, sorted(waits, reverse=True))
+        holds = [site['hold_us'] for site in node.getlockprofile('json', 'hold')['sites']]
+        assert_equal(holds, sorted(holds, reverse=True))
+
+        # One "lock;file:line micros" line per site held for a microsecond or more
+        folded = node.getlockprofile('folded', 'hold')
+        for line in folded.splitlines():
+            stack, micros = line.rsplit(' ', 1)
+            lock, site = stack.split(';')
+            assert_greater_than(int(micros), 0)
+        assert('cs_main;' in folded)
+
+        assert_raises(JSONRPCException, node.getlockprofile, 'xml')
+        assert_raises(JSONRPCException, node.getlockprofile, 'json', 'count')
+        assert_raises(JSONRPCException, node.setlockprofiling, -1)
+
+        # Stopping keeps what was collected; resetting clears it
+        node.setlockprofiling(0)
+        profile = node.getlockprofile()
+        assert_equal(profile['samplerate'], 0)
+        assert_greater_than(len(profile['sites']), 0)
+        node.setlockprofiling(0, True)
+        node.generate(1)
+        assert_equal(node.getlockprofile()['sites'], [])
+
+        node.setlockprofiling(10)
+        node.generate(5)
+        profile = node.getlockprofile()
+        assert_equal(profile['samplerate'], 10)
+        assert_greater_than(len(profile['sites']), 0)
+
+if __name__ == '__main__':
+    LockProfileTest().main()
@@ -0,0 +1,126 @@
+#!/usr/bin/env python
+# Copyright (c) 2026 The BitcoinZ Community
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Submit transactions to a regtest node, once alone and once while another
+# client polls getrawmempool true in a loop, report the latency of accepting
+# them to the mempool, and check that the listings poll sees are consistent.
+#
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import AuthServiceProxy
+from test_framework.util import assert_equal, initialize_chain_clean, \
+    start_node
+
+from decimal import Decimal
+import threading
+import time
+
+FILL_TXS = 300
+TIMED_TXS = 150
+FEE = Decimal('0.0001')
+
+class MempoolPoller(threading.Thread):
+    def __init__(self, node):
+        threading.Thread.__init__(self)
+        # A connection of its own, as one can't be shared between threads
+        self.node = AuthServiceProxy(node.url, timeout=600)
+        self.stop = False
+        self.polls = 0
+        self.error = None
+
+    def run(self):
+        try:
+            while not self.stop:
+                verbose = self.node.getrawmempool(True)
+                for txid, info in verbose.items():
+                    for dep in info['depends']:
+                        assert dep in verbose, "%s depends on %s, not listed" % (txid, dep)
+                self.polls += 1
+        except Exception as e:
+            self.error = e
+
+def percentile(latencies, p):
+    ordered = sorted(latencies)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * p))]
+
+class MempoolSnapshotTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print "Initializing test directory " + self.options.tmpdir
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self):
+        self.nodes = [start_node(0, self.options.tmpdir)]
+        self.is_network_split = False
+
+    def signed_spends(self, node, count):
+        # Fan a coinbase out into count outputs, confirm it, and sign one
+        # transaction spending each output
+        utxo = node.listunspent()[0]
+        value = (utxo['amount'] - FEE) / count
+        value = value.quantize(Decimal('0.00000001'))
+        outputs = {}
+        for i in range(count):
+            outputs[node.getnewaddress()] = value
+        rawtx = node.createrawtransaction([{'txid': utxo['txid'], 'vout': utxo['vout']}], outputs)
+        fanout = node.sendrawtransaction(node.signrawtransaction(rawtx)['hex'])
+        node.generate(1)
+
+        spends = []
+        for vout in range(count):
+            inputs = [{'txid': fanout, 'vout': vout}]
+            rawtx = node.createrawtransaction(inputs, {node.getnewaddress(): value - FEE})
+            spends.append(node.signrawtransaction(rawtx)['hex'])
+        return spends
+
+    def submit(self, node, spends):
+        latencies = []
+        for txhex in spends:
+            start = time.time()
+            node.sendrawtransaction(txhex)
+            latencies.append(time.time() - start)
+        return latencies
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(101)
+        spends = self.signed_spends(node, FILL_TXS + 2 * TIMED_TXS)
+
+        # Give the listings some bulk
+        self.submit(node, spends[:FILL_TXS])
+        spends = spends[FILL_TXS:]
+
+        alone = self.submit(node, spends[:TIMED_TXS])
+        print "Alone: p50 %.2f ms, p99 %.2f ms, max %.2f ms" % (
+            percentile(alone, 0.5) * 1000, percentile(alone, 0.99) * 1000, max(alone) * 1000)
+
+        poller = MempoolPoller(node)
+        poller.start()
+        polled = self.submit(node, spends[TIMED_TXS:])
+        poller.stop = True
+        poller.join()
+        assert poller.error is None, poller.error
+        print "Polled %d times: p50 %.2f ms, p99 %.2f ms, max %.2f ms" % (
+            poller.polls, percentile(polled, 0.5) * 1000, percentile(polled, 0.99) * 1000, max(polled) * 1000)
+
+        # The listings agree with each other and with what was submitted
+        verbose = node.getrawmempool(True)
+        txids = node.getrawmempool()
+        assert_equal(len(txids), FILL_TXS + 2 * TIMED_TXS)
+        assert_equal(sorted(verbose.keys()), sorted(txids))
+        assert_equal(node.getmempoolinfo()['size'], len(txids))
+        for info in verbose.values():
+            assert_equal(info['fee'], FEE)
+            assert_equal(info['descendantcount'], 1)
+
+        node.generate(1)
+        assert_equal(node.getrawmempool(), [])
+        assert_equal(node.getrawmempool(True), {})
+
+if __name__ == '__main__':
+    MempoolSnapshotTest().main()
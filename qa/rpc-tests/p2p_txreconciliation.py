@@ -0,0 +1,174 @@
+#!/usr/bin/env python
+# Copyright (c) 2026 The BitcoinZ Community
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Relay transactions across a fully connected network of regtest nodes, once
+# flooding announcements and once reconciling them (-txreconciliation), and
+# report the announcement bytes each transaction cost. A peer that stops
+# answering a reconciliation round gets the round's transactions flooded.
+#
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.mininode import NodeConn, NetworkThread, mininode_lock
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_greater_than, \
+    connect_nodes, initialize_chain, p2p_port, start_nodes, stop_nodes, \
+    sync_blocks, sync_mempools, wait_bitcoinds
+from tx_expiry_helper import TestNode
+
+import struct
+import time
+
+NUM_NODES = 4
+NUM_TRANSACTIONS = 40
+
+# Messages that announce transactions, as opposed to relaying them
+ANNOUNCEMENT_MESSAGES = ['inv', 'reqrecon', 'sketch', 'reconcildiff']
+# Seconds a peer has to answer a round, RECON_RESPONSE_TIMEOUT
+RECON_RESPONSE_TIMEOUT = 20
+
+class msg_sendtxrcncl(object):
+    command = "sendtxrcncl"
+
+    def __init__(self, version=1, salt=0):
+        self.version = version
+        self.salt = salt
+
+    def serialize(self):
+        return struct.pack("<IQ", self.version, self.salt)
+
+    def __repr__(self):
+        return "msg_sendtxrcncl(version=%d salt=%d)" % (self.version, self.salt)
+
+class msg_reqrecon(object):
+    command = "reqrecon"
+
+    def __init__(self, set_size=0, q=0):
+        self.set_size = set_size
+        self.q = q
+
+    def serialize(self):
+        return struct.pack("<HH", self.set_size, self.q)
+
+    def __repr__(self):
+        return "msg_reqrecon(set_size=%d q=%d)" % (self.set_size, self.q)
+
+class TxReconciliationTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print "Initializing test directory " + self.options.tmpdir
+        initialize_chain(self.options.tmpdir)
+
+    def setup_network(self):
+        self.start_network([])
+
+    def start_network(self, extra_args):
+        self.nodes = start_nodes(NUM_NODES, self.options.tmpdir,
+            [extra_args + ['-debug=net']] * NUM_NODES)
+        for a in range(NUM_NODES):
+            for b in range(a + 1, NUM_NODES):
+                connect_nodes(self.nodes[a], b)
+        self.is_network_split = False
+        sync_blocks(self.nodes)
+
+    def restart_network(self, extra_args):
+        stop_nodes(self.nodes)
+        wait_bitcoinds()
+        self.start_network(extra_args)
+
+    def wait_for_reconciliation(self, enabled):
+        # Peers register after exchanging sendtxrcncl, right after the handshake
+        for i in range(100):
+            peers = [peer for node in self.nodes for peer in node.getpeerinfo()]
+            assert_equal(len(peers), NUM_NODES * (NUM_NODES - 1))
+            if all(peer['txreconciliation'] == enabled for peer in peers):
+                return
+            time.sleep(0.1)
+        assert False, "peers did not agree on reconciliation"
+
+    def announcement_bytes(self):
+        total = 0
+        for node in self.nodes:
+            for peer in node.getpeerinfo():
+                for msg in ANNOUNCEMENT_MESSAGES:
+                    total += peer['bytessent_per_msg'].get(msg, 0)
+        return total
+
+    def relay_transactions(self):
+        before = self.announcement_bytes()
+        txids = []
+        for i in range(NUM_TRANSACTIONS):
+            sender = self.nodes[i % NUM_NODES]
+            receiver = self.nodes[(i + 1) % NUM_NODES]
+            txids.append(sender.sendtoaddress(receiver.getnewaddress(), 0.1))
+        sync_mempools(self.nodes)
+        for node in self.nodes:
+            assert_equal(set(node.getrawmempool()), set(txids))
+        per_tx = (self.announcement_bytes() - before) / float(NUM_TRANSACTIONS)
+
+        # Confirm the transactions so wallets don't rebroadcast them later
+        self.nodes[0].generate(1)
+        sync_blocks(self.nodes)
+        return per_tx
+
+    def run_test(self):
+        self.wait_for_reconciliation(False)
+        flooding = self.relay_transactions()
+        print "Flooding: %.1f announcement bytes per transaction" % flooding
+
+        self.restart_network(['-txreconciliation'])
+        self.wait_for_reconciliation(True)
+        reconciling = self.relay_transactions()
+        print "Reconciliation: %.1f announcement bytes per transaction" % reconciling
+
+        # Announcements went through reconciliation rounds
+        peers = [peer for node in self.nodes for peer in node.getpeerinfo()]
+        assert any('sketch' in peer['bytessent_per_msg'] for peer in peers)
+        assert_greater_than(flooding, 0)
+
+        self.stalled_round()
+
+    def test_peer_info(self):
+        peers = [peer for peer in self.nodes[0].getpeerinfo() if peer['subver'].startswith('/python-mininode')]
+        assert_equal(len(peers), 1)
+        return peers[0]
+
+    def stalled_round(self):
+        # A peer that asks for a round and never finishes it
+        test_node = TestNode()
+        conn = NodeConn('127.0.0.1', p2p_port(0), self.nodes[0], test_node)
+        test_node.add_connection(conn)
+        NetworkThread().start()
+        test_node.wait_for_verack()
+        test_node.send_message(msg_sendtxrcncl(salt=1))
+        test_node.sync_with_ping()
+        assert self.test_peer_info()['txreconciliation']
+
+        txid = self.nodes[0].sendtoaddress(self.nodes[1].getnewaddress(), 0.1)
+        test_node.send_message(msg_reqrecon())
+        test_node.sync_with_ping()
+        with mininode_lock:
+            test_node.last_inv = None
+
+        # Once the round times out its transaction is flooded to the peer
+        for i in range(2 * RECON_RESPONSE_TIMEOUT * 10):
+            with mininode_lock:
+                if test_node.last_inv is not None:
+                    break
+            time.sleep(0.1)
+        with mininode_lock:
+            assert test_node.last_inv is not None, "the stalled round was not flooded"
+            assert_equal([int(txid, 16)], [inv.hash for inv in test_node.last_inv.inv])
+        assert not self.test_peer_info()['txreconciliation']
+
+        # A late request is ignored rather than punished
+        test_node.send_message(msg_reqrecon())
+        test_node.sync_with_ping()
+        assert not self.test_peer_info()['txreconciliation']
+        conn.handle_close()
+
+if __name__ == '__main__':
+    TxReconciliationTest().main()
@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+# Copyright (c) 2026 The BitcoinZ Community
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Exercise a regtest node, check that getperfstats reports the work done,
+# and that /metrics serves the same stats in Prometheus format.
+#
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_greater_than, \
+    initialize_chain_clean, start_node
+
+try:
+    import http.client as httplib
+except ImportError:
+    import httplib
+try:
+    import urllib.parse as urlparse
+except ImportError:
+    import urlparse
+
+class PerfStatsTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print "Initializing test directory " + self.options.tmpdir
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self):
+        self.nodes = [start_node(0, self.options.tmpdir, ['-metricsendpoint'])]
+        self.is_network_split = False
+
+    def metrics(self, method='GET'):
+        url = urlparse.urlparse(self.nodes[0].url)
+        conn = httplib.HTTPConnection(url.hostname, url.port)
+        conn.request(method, '/metrics')
+        return conn.getresponse()
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(101)
+        node.sendtoaddress(node.getnewaddress(), 1)
+        for i in range(5):
+            node.getblockcount()
+
+        stats = node.getperfstats()
+        assert_equal(stats['chain_height'], 101)
+        assert_equal(stats['mempool_transactions'], 1)
+        assert_greater_than(stats['mempool_accept_total']['accepted'], 0)
+        assert_greater_than(stats['rpc_seconds']['getblockcount']['count'], 4)
+
+        # Every block connected to the tip passes through each phase; blocks
+        # checked as mining templates are also verified
+        connect = stats['block_connect_seconds']
+        connected = connect['total']['count']
+        assert_greater_than(connected, 100)
+        for phase in ['load', 'connect', 'flush', 'chainstate', 'postprocess', 'index']:
+            assert_equal(connect[phase]['count'], connected)
+        assert_greater_than(connect['verify']['count'], connected)
+        total = connect['total']
+        assert(total['p50'] <= total['p90'] <= total['p99'] <= total['max'])
+        assert_greater_than(stats['leveldb_write_batch_seconds']['count'], 0)
+        assert_greater_than(stats['coins_cache_lookups_total']['hit'], 0)
+
+        # A prefix limits the reply
+        assert_equal(node.getperfstats('rpc_').keys(), ['rpc_seconds'])
+        assert_equal(node.getperfstats('no_such_metric'), {})
+
+        response = self.metrics()
+        assert_equal(response.status, 200)
+        text = response.read()
+        assert('# TYPE bitcoinz_rpc_seconds histogram\n' in text)
+        assert('bitcoinz_chain_height 101\n' in text)
+        assert('bitcoinz_block_connect_seconds_count{phase="total"} %d\n' % connected in text)
+        assert('bitcoinz_block_connect_seconds_bucket{phase="total",le="+Inf"} %d\n' % connected in text)
+        assert_equal(self.metrics('POST').status, 405)
+
+if __name__ == '__main__':
+    PerfStatsTest().main()
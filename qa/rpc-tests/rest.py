@@ -35,6 +35,48 @@ def deser_uint256(f):
         r += t << (i * 32)
     return r
 
+# decodes the subset of CBOR that REST and RPC replies use
+def cbor_decode(f):
+    initial = ord(f.read(1))
+    major, info = initial >> 5, initial & 0x1f
+    if initial == 0xf4:
+        return False
+    if initial == 0xf5:
+        return True
+    if initial == 0xf6:
+        return None
+    if initial == 0xfb:
+        return struct.unpack(b">d", f.read(8))[0]
+    if info == 31:
+        items = []
+        while f.read(1) != b"\xff":
+            f.seek(-1, 1)
+            items.append(cbor_decode(f))
+        if major == 5:
+            return dict(zip(items[0::2], items[1::2]))
+        return items
+    if info < 24:
+        n = info
+    else:
+        size = 1 << (info - 24)
+        n = 0
+        for c in f.read(size):
+            n = (n << 8) | ord(c)
+    if major == 0:
+        return n
+    if major == 1:
+        return -1 - n
+    if major == 3:
+        return f.read(n).decode('utf-8')
+    if major == 4:
+        return [cbor_decode(f) for i in range(n)]
+    if major == 5:
+        return dict((cbor_decode(f), cbor_decode(f)) for i in range(n))
+    if major == 6 and n == 4:
+        exponent, mantissa = cbor_decode(f)
+        return Decimal(mantissa).scaleb(exponent)
+    raise ValueError("unexpected CBOR item %02x" % initial)
+
 # allows simple http get calls
 def http_get_call(host, port, path, response_object = 0):
     conn = httplib.HTTPConnection(host, port)
@@ -299,6 +341,19 @@ class RESTTest (BitcoinTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['txid'], tx_hash)
 
+        # check cbor format, which carries the same document
+        response_cbor = http_get_call(url.hostname, url.port, '/rest/tx/'+tx_hash+self.FORMAT_SEPARATOR+"cbor", True)
+        assert_equal(response_cbor.status, 200)
+        assert_equal(response_cbor.getheader('content-type'), 'application/cbor')
+        cbor_obj = cbor_decode(StringIO.StringIO(response_cbor.read()))
+        assert_equal(cbor_obj, json.loads(json_string, parse_float=Decimal))
+
+        response_cbor = http_get_call(url.hostname, url.port, '/rest/block/'+bb_hash+self.FORMAT_SEPARATOR+"cbor", True)
+        assert_equal(response_cbor.status, 200)
+        cbor_obj = cbor_decode(StringIO.StringIO(response_cbor.read()))
+        assert_equal(cbor_obj['hash'], bb_hash)
+        assert_equal([tx['txid'] for tx in cbor_obj['tx']], [tx['txid'] for tx in block_json_obj['tx']])
+
         # check hex format response
         hex_string = http_get_call(url.hostname, url.port, '/rest/tx/'+tx_hash+self.FORMAT_SEPARATOR+"hex", True)
         assert_equal(hex_string.status, 200)
@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+# Copyright (c) 2026 The BitcoinZ Community
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Fetch ranges of compact blocks, starting from the genesis block, over
+# REST with -compactblockindex, before and after -reindex-chainstate.
+#
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain_clean, \
+    start_node, stop_node, wait_bitcoinds
+
+import binascii
+import struct
+import time
+import StringIO
+
+try:
+    import http.client as httplib
+except ImportError:
+    import httplib
+try:
+    import urllib.parse as urlparse
+except ImportError:
+    import urlparse
+
+def deser_uint256(f):
+    r = 0
+    for i in range(8):
+        t = struct.unpack("<I", f.read(4))[0]
+        r += t << (i * 32)
+    return "%064x" % r
+
+def deser_compact_size(f):
+    n = struct.unpack("<B", f.read(1))[0]
+    if n == 253:
+        n = struct.unpack("<H", f.read(2))[0]
+    elif n == 254:
+        n = struct.unpack("<I", f.read(4))[0]
+    elif n == 255:
+        n = struct.unpack("<Q", f.read(8))[0]
+    return n
+
+class RESTCompactBlocksTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print "Initializing test directory " + self.options.tmpdir
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self):
+        self.nodes = [start_node(0, self.options.tmpdir, ['-compactblockindex'])]
+        self.is_network_split = False
+
+    def get(self, path):
+        url = urlparse.urlparse(self.nodes[0].url)
+        conn = httplib.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', path)
+        return conn.getresponse()
+
+    # Blocks without Sapling transactions only have their header fields
+    def check_range(self, start, end):
+        node = self.nodes[0]
+        response = self.get('/rest/compactblocks/%d/%d.bin' % (start, end))
+        assert_equal(response.status, 200)
+        f = StringIO.StringIO(response.read())
+        for height in range(start, end + 1):
+            assert_equal(struct.unpack("<i", f.read(4))[0], height)
+            block = node.getblock(node.getblockhash(height))
+            assert_equal(deser_uint256(f), block['hash'])
+            assert_equal(deser_uint256(f), block.get('previousblockhash', '00' * 32))
+            assert_equal(struct.unpack("<I", f.read(4))[0], block['time'])
+            assert_equal(deser_compact_size(f), 0)
+        assert_equal(f.read(), '')
+
+        hex_reply = self.get('/rest/compactblocks/%d/%d.hex' % (start, end)).read()
+        assert_equal(binascii.unhexlify(hex_reply.strip()), f.getvalue())
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(5)
+        self.check_range(0, 0)
+        self.check_range(0, 5)
+        self.check_range(3, 5)
+
+        # Genesis is written again when the chainstate is rebuilt
+        stop_node(node, 0)
+        wait_bitcoinds()
+        self.nodes[0] = start_node(0, self.options.tmpdir, ['-compactblockindex', '-reindex-chainstate'])
+        while self.nodes[0].getblockcount() < 5:
+            time.sleep(0.1)
+        self.check_range(0, 5)
+
+if __name__ == '__main__':
+    RESTCompactBlocksTest().main()
@@ -0,0 +1,80 @@
+#!/usr/bin/env python
+# Copyright (c) 2026 The BitcoinZ Community
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Send JSON-RPC batches to a regtest node, once executed one element after
+# another (-rpcbatchthreads=0) and once in parallel, check that the replies
+# are the same and in order, and report the calls per second of each.
+#
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain_clean, \
+    start_node, stop_node, wait_bitcoinds
+
+import time
+
+REPEATS = 5
+
+class RPCBatchTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print "Initializing test directory " + self.options.tmpdir
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self):
+        self.nodes = [start_node(0, self.options.tmpdir)]
+        self.is_network_split = False
+
+    def restart_node(self, extra_args):
+        stop_node(self.nodes[0], 0)
+        wait_bitcoinds()
+        self.nodes[0] = start_node(0, self.options.tmpdir, extra_args)
+
+    def batch(self):
+        # Runs of read-only calls, separated by calls executed by themselves,
+        # and an element that fails
+        calls = []
+        for h in self.hashes:
+            calls.append({'method': 'getblock', 'params': [h, 2]})
+            calls.append({'method': 'getblockheader', 'params': [h]})
+        calls.insert(100, {'method': 'getchaintips', 'params': []})
+        calls.insert(200, {'method': 'getblock', 'params': ['00' * 32]})
+        for i, call in enumerate(calls):
+            call['id'] = i
+        return calls
+
+    def run_batches(self):
+        calls = self.batch()
+        replies = self.nodes[0]._batch(calls)
+        assert_equal([r['id'] for r in replies], range(len(calls)))
+
+        start = time.time()
+        for i in range(REPEATS):
+            self.nodes[0]._batch(calls)
+        rate = REPEATS * len(calls) / (time.time() - start)
+        return replies, rate
+
+    def run_test(self):
+        self.hashes = self.nodes[0].generate(200)
+
+        self.restart_node(['-rpcbatchthreads=0'])
+        serial, serial_rate = self.run_batches()
+        print "Serial: %.0f calls per second" % serial_rate
+
+        self.restart_node(['-rpcbatchthreads=4', '-rpcbatchconcurrency=4'])
+        parallel, parallel_rate = self.run_batches()
+        print "Parallel: %.0f calls per second" % parallel_rate
+
+        assert_equal(parallel, serial)
+        assert_equal(parallel[200]['error']['message'], 'Block not found')
+        assert_equal(parallel[100]['result'][0]['height'], 200)
+        for call, reply in zip(self.batch(), parallel):
+            if call['method'] == 'getblock' and call['params'][0] in self.hashes:
+                assert_equal(reply['result']['hash'], call['params'][0])
+
+if __name__ == '__main__':
+    RPCBatchTest().main()
@@ -115,6 +115,16 @@ class SpentIndexTest(BitcoinTestFramework):
         except JSONRPCException, e:
             assert_equal(e.error['message'], "Unable to get spent info")
 
+        # an array of outputs is looked up at once, with null for those
+        # that haven't been spent
+        spentinfos = self.nodes[2].getspentinfo([
+            {'txid': txid2, 'index': 0},
+            {'txid': txid1, 'index': n},
+        ])
+        assert_equal(len(spentinfos), 2)
+        assert_equal(spentinfos[0], None)
+        assert_equal(spentinfos[1], spentinfo)
+
         block_hash_next = self.nodes[0].generate(1)
         self.sync_all()
 
@@ -0,0 +1,105 @@
+#!/usr/bin/env python
+# Copyright (c) 2026 The BitcoinZ Community
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Start a node from a UTXO snapshot: dump the chainstate of one node, load it
+# on a node that only has the headers, then restart that node and have it
+# sync the blocks mined on top of the snapshot.
+#
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.authproxy import JSONRPCException
+from test_framework.mininode import NodeConn, NetworkThread, CBlockHeader, \
+    msg_headers
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, connect_nodes_bi, \
+    initialize_chain_clean, p2p_port, start_node, start_nodes, stop_node, \
+    sync_blocks
+from tx_expiry_helper import TestNode
+
+from binascii import unhexlify
+from cStringIO import StringIO
+import os
+
+SNAPSHOT_HEIGHT = 110
+
+class UTXOSnapshotTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print "Initializing test directory " + self.options.tmpdir
+        initialize_chain_clean(self.options.tmpdir, 2)
+
+    def setup_network(self):
+        # The nodes are only connected once node 1 has loaded the snapshot,
+        # otherwise it would download the blocks before it.
+        self.nodes = start_nodes(2, self.options.tmpdir)
+        self.is_network_split = True
+
+    def send_headers(self, count):
+        # Hand node 1 the headers of node 0's chain, but none of the blocks.
+        test_node = TestNode()
+        conn = NodeConn('127.0.0.1', p2p_port(1), self.nodes[1], test_node)
+        test_node.add_connection(conn)
+        NetworkThread().start()
+        test_node.wait_for_verack()
+
+        headers = msg_headers()
+        for height in range(1, count + 1):
+            header = CBlockHeader()
+            header.deserialize(StringIO(unhexlify(
+                self.nodes[0].getblockheader(self.nodes[0].getblockhash(height), False))))
+            headers.headers.append(header)
+        test_node.send_message(headers)
+        test_node.sync_with_ping()
+        conn.handle_close()
+
+    def run_test(self):
+        self.nodes[0].generate(SNAPSHOT_HEIGHT)
+        dumped = self.nodes[0].dumptxoutset(os.path.join(self.options.tmpdir, "txoutset.dat"))
+        assert_equal(dumped['base_height'], SNAPSHOT_HEIGHT)
+        assert_equal(dumped['base_hash'], self.nodes[0].getbestblockhash())
+
+        self.send_headers(SNAPSHOT_HEIGHT)
+        assert_equal(self.nodes[1].getblockcount(), 0)
+
+        # The snapshot must match the hash vouched for by a trusted node.
+        try:
+            self.nodes[1].loadtxoutset(dumped['path'], "11" * 32)
+            assert False, "loadtxoutset accepted a snapshot with the wrong hash"
+        except JSONRPCException as e:
+            assert "does not match" in e.error['message']
+
+        loaded = self.nodes[1].loadtxoutset(dumped['path'], dumped['snapshot_hash'])
+        assert_equal(loaded['base_hash'], dumped['base_hash'])
+        assert_equal(loaded['txouts'], dumped['txouts'])
+        assert_equal(self.nodes[1].getbestblockhash(), dumped['base_hash'])
+        assert_equal(self.nodes[1].getblockchaininfo()['snapshotheight'], SNAPSHOT_HEIGHT)
+        assert_equal(self.nodes[1].gettxoutsetinfo()['hash_serialized'],
+                     self.nodes[0].gettxoutsetinfo()['hash_serialized'])
+
+        # The chainstate and the snapshot base survive a restart.
+        stop_node(self.nodes[1], 1)
+        self.nodes[1] = start_node(1, self.options.tmpdir)
+        assert_equal(self.nodes[1].getbestblockhash(), dumped['base_hash'])
+        assert_equal(self.nodes[1].getblockchaininfo()['snapshotheight'], SNAPSHOT_HEIGHT)
+
+        # Blocks mined on top of the snapshot are downloaded and connected.
+        self.nodes[0].generate(10)
+        connect_nodes_bi(self.nodes, 0, 1)
+        self.is_network_split = False
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[1].getblockcount(), SNAPSHOT_HEIGHT + 10)
+        assert_equal(self.nodes[1].gettxoutsetinfo()['hash_serialized'],
+                     self.nodes[0].gettxoutsetinfo()['hash_serialized'])
+
+        # Blocks mined by the snapshot node reach the other node too.
+        self.nodes[1].generate(5)
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[0].getbestblockhash(), self.nodes[1].getbestblockhash())
+
+
+if __name__ == '__main__':
+    UTXOSnapshotTest().main()
@@ -27,7 +27,7 @@ benchmark::BenchRunner::RunAll(benchmark::duration elapsedTimeForOne)
         std::cerr << "WARNING: Clock precision is worse than microsecond - benchmarks may be less accurate!\n";
     }
     std::cout << "#Benchmark" << "," << "count" << "," << "min(ns)" << "," << "max(ns)" << "," << "average(ns)" << ","
-              << "min_cycles" << "," << "max_cycles" << "," << "average_cycles" << "\n";
+              << "min_cycles" << "," << "max_cycles" << "," << "average_cycles" << "," << "counters" << "\n";
 
     for (const auto &p: benchmarks()) {
         State state(p.first, elapsedTimeForOne);
@@ -98,7 +98,10 @@ bool benchmark::State::KeepRunning()
     int64_t avg_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>((now-beginTime)/count).count();
     int64_t averageCycles = (nowCycles-beginCycles)/count;
     std::cout << std::fixed << std::setprecision(15) << name << "," << count << "," << min_elapsed << "," << max_elapsed << "," << avg_elapsed << ","
-              << minCycles << "," << maxCycles << "," << averageCycles << "\n";
+              << minCycles << "," << maxCycles << "," << averageCycles;
+    for (const auto& counter : counters)
+        std::cout << "," << counter.first << "=" << std::setprecision(1) << counter.second;
+    std::cout << "\n";
     std::cout.copyfmt(std::ios(nullptr));
 
     return false;
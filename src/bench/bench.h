@@ -55,6 +55,7 @@ namespace benchmark {
         uint64_t lastCycles;
         uint64_t minCycles;
         uint64_t maxCycles;
+        std::map<std::string, double> counters;
     public:
         State(std::string _name, duration _maxElapsed) :
             name(_name),
@@ -69,6 +70,8 @@ namespace benchmark {
             maxCycles(std::numeric_limits<uint64_t>::min()) {
         }
         bool KeepRunning();
+        /** Report a figure besides the timings, such as the memory used per item */
+        void SetCounter(const std::string& counterName, double value) { counters[counterName] = value; }
     };
 
     typedef std::function<void(State&)> BenchFunction;
@@ -4,6 +4,7 @@
 
 #include "bench.h"
 
+#include "crypto/sha256.h"
 #include "key.h"
 #include "main.h"
 #include "util.h"
@@ -15,6 +16,7 @@ const std::function<std::string(const char*)> G_TRANSLATION_FUN = nullptr;
 int
 main(int argc, char** argv)
 {
+    SHA256AutoDetect();
     ECC_Start();
     auto globalVerifyHandle = new ECCVerifyHandle();
     SetupEnvironment();
@@ -43,6 +45,8 @@ main(int argc, char** argv)
         "e9b238411bd6c0ec4791e9d04245ec350c9c5744f5610dfcce4365d5ca49dfefd5054e371842b3f88fa1b9d7e8e075249b3ebabd167fa8b0f3161292d36c180a"
     );
 
+    InitSignatureCache();
+
     benchmark::BenchRunner::RunAll();
 
     ECC_Stop();
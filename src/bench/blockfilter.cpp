@@ -0,0 +1,64 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+
+#include "blockfilter.h"
+#include "hash.h"
+#include "script/script.h"
+
+// Transactions in the block, each spending one P2PKH output and creating two
+static const size_t BLOCK_TRANSACTIONS = 1000;
+
+static CScript P2PKHScript(uint32_t i)
+{
+    uint160 hash = Hash160((const unsigned char*)&i, (const unsigned char*)(&i + 1));
+    return CScript() << OP_DUP << OP_HASH160 << ToByteVector(hash) << OP_EQUALVERIFY << OP_CHECKSIG;
+}
+
+// Builds the basic filter of a full block, as the filter index does for
+// every block it connects.
+static void BlockFilterConstruction(benchmark::State& state)
+{
+    CBlock block;
+    CBlockUndo blockundo;
+    for (uint32_t i = 0; i < BLOCK_TRANSACTIONS; i++) {
+        CMutableTransaction tx;
+        tx.vout.emplace_back(1000, P2PKHScript(2 * i));
+        tx.vout.emplace_back(1000, P2PKHScript(2 * i + 1));
+        block.vtx.push_back(tx);
+
+        blockundo.vtxundo.emplace_back();
+        blockundo.vtxundo.back().vprevout.emplace_back(CTxOut(2000, P2PKHScript(BLOCK_TRANSACTIONS * 2 + i)), false, 1);
+    }
+
+    while (state.KeepRunning()) {
+        BlockFilter filter(BlockFilterType::BASIC, block, blockundo);
+        assert(filter.GetFilter().GetN() == BLOCK_TRANSACTIONS * 3);
+    }
+}
+
+// Matches a wallet's scripts against a block's filter, as a light client does.
+static void BlockFilterMatch(benchmark::State& state)
+{
+    GCSFilter::ElementSet elements;
+    for (uint32_t i = 0; i < BLOCK_TRANSACTIONS * 3; i++) {
+        CScript script = P2PKHScript(i);
+        elements.emplace(script.begin(), script.end());
+    }
+    GCSFilter filter({0, 0, BASIC_FILTER_P, BASIC_FILTER_M}, elements);
+
+    GCSFilter::ElementSet wallet;
+    for (uint32_t i = 0; i < 100; i++) {
+        CScript script = P2PKHScript(BLOCK_TRANSACTIONS * 3 + i);
+        wallet.emplace(script.begin(), script.end());
+    }
+
+    while (state.KeepRunning()) {
+        filter.MatchAny(wallet);
+    }
+}
+
+BENCHMARK(BlockFilterConstruction);
+BENCHMARK(BlockFilterMatch);
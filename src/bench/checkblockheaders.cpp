@@ -0,0 +1,55 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "checkqueue.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "test/equihash_test_data.h"
+#include "utilstrencodings.h"
+#include "version.h"
+
+#include <boost/thread/thread.hpp>
+
+// Headers checked per iteration, as received in a run of HEADERS messages of
+// at most MAX_HEADERS_RESULTS each.
+static const size_t HEADER_BATCH_SIZE = 2000;
+
+// Checks a batch of headers with a header check queue of nThreads threads,
+// including the calling thread.
+static void CheckBlockHeaders(benchmark::State& state, int nThreads)
+{
+    const CChainParams& chainparams = Params(CBaseChainParams::REGTEST);
+    CBlockHeader header;
+    CDataStream ss(ParseHex(REGTEST_HEADER_144_5_HEX), SER_NETWORK, PROTOCOL_VERSION);
+    ss >> header;
+    // Verifying the same header repeatedly costs the same as verifying
+    // distinct ones.
+    std::vector<CBlockHeader> headers(HEADER_BATCH_SIZE, header);
+
+    CCheckQueue<CHeaderCheck> queue(16);
+    boost::thread_group tg;
+    for (int i = 0; i < nThreads - 1; i++) {
+        tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        bool fOk = CheckBlockHeaders(headers.begin(), headers.end(), chainparams, nThreads > 1 ? &queue : NULL);
+        assert(fOk);
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void CheckBlockHeaders1Thread(benchmark::State& state) { CheckBlockHeaders(state, 1); }
+static void CheckBlockHeaders2Threads(benchmark::State& state) { CheckBlockHeaders(state, 2); }
+static void CheckBlockHeaders4Threads(benchmark::State& state) { CheckBlockHeaders(state, 4); }
+static void CheckBlockHeaders8Threads(benchmark::State& state) { CheckBlockHeaders(state, 8); }
+
+BENCHMARK(CheckBlockHeaders1Thread);
+BENCHMARK(CheckBlockHeaders2Threads);
+BENCHMARK(CheckBlockHeaders4Threads);
+BENCHMARK(CheckBlockHeaders8Threads);
@@ -0,0 +1,61 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "primitives/transaction.h"
+#include "wallet/wallet.h"
+
+#include <set>
+#include <vector>
+
+// Select coins for a payment from a wallet holding nCoins unspent outputs of
+// assorted values, as an exchange or pool payout wallet accumulates them.
+static void CoinSelection(benchmark::State& state, size_t nCoins)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+
+    CWallet wallet;
+    std::vector<CWalletTx*> vTxs;
+    std::vector<COutput> vCoins;
+    for (size_t i = 0; i < nCoins; i++) {
+        CMutableTransaction mtx;
+        mtx.nLockTime = i;
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = CENT / 10 + (i * 7919) % COIN;
+        vTxs.push_back(new CWalletTx(&wallet, mtx));
+        vCoins.push_back(COutput(vTxs.back(), 0, 6 * 24, true));
+    }
+    const CAmount nCostOfChange = CTxOut(0, GetScriptForDestination(CKeyID())).GetDustThreshold();
+
+    LOCK(wallet.cs_wallet);
+    std::set<std::pair<const CWalletTx*, unsigned int> > setCoinsRet;
+    CAmount nValueRet;
+    while (state.KeepRunning()) {
+        assert(wallet.SelectCoinsMinConf(5 * COIN + 12345, 1, 6, vCoins, setCoinsRet, nValueRet, nCostOfChange));
+    }
+
+    for (CWalletTx* wtx : vTxs)
+        delete wtx;
+}
+
+static void CoinSelection1k(benchmark::State& state)
+{
+    CoinSelection(state, 1000);
+}
+
+static void CoinSelection10k(benchmark::State& state)
+{
+    CoinSelection(state, 10000);
+}
+
+static void CoinSelection200k(benchmark::State& state)
+{
+    CoinSelection(state, 200000);
+}
+
+BENCHMARK(CoinSelection1k);
+BENCHMARK(CoinSelection10k);
+BENCHMARK(CoinSelection200k);
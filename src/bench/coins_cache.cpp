@@ -0,0 +1,43 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+
+#include "coins.h"
+#include "hash.h"
+#include "script/script.h"
+
+// Number of transactions in the cache, each with two P2PKH outputs
+static const size_t CACHE_TRANSACTIONS = 1000000;
+
+static uint256 CacheTxid(uint64_t i)
+{
+    return Hash((const unsigned char*)&i, (const unsigned char*)(&i + 1));
+}
+
+// Looks up coins of a large cache in an order that defeats the CPU caches, as
+// ConnectBlock does, and reports the memory the cache takes per transaction.
+static void CoinsCacheLookup(benchmark::State& state)
+{
+    CCoinsView base;
+    CCoinsViewCache cache(&base);
+    for (size_t i = 0; i < CACHE_TRANSACTIONS; i++) {
+        CCoinsModifier coins = cache.ModifyNewCoins(CacheTxid(i));
+        coins->nHeight = i + 1;
+        coins->vout.resize(2, CTxOut(i + 1, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, i & 0xff) << OP_EQUALVERIFY << OP_CHECKSIG));
+    }
+
+    std::vector<uint256> txids;
+    for (size_t i = 0; i < CACHE_TRANSACTIONS; i++) {
+        txids.push_back(CacheTxid((i * 7919) % CACHE_TRANSACTIONS));
+    }
+    state.SetCounter("bytes_per_tx", (double)cache.DynamicMemoryUsage() / CACHE_TRANSACTIONS);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const CCoins* coins = cache.AccessCoins(txids[i++ % CACHE_TRANSACTIONS]);
+        assert(coins);
+    }
+}
+
+BENCHMARK(CoinsCacheLookup);
@@ -0,0 +1,98 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "arith_uint256.h"
+#include "bench.h"
+#include "rpc/jsonwriter.h"
+#include "uint256.h"
+
+// A verbose getrawmempool reply for a large mempool. Building it as one
+// UniValue before writing delays the first byte until all of it is done,
+// and holds both the UniValue and the text in memory at the peak.
+static const int MEMPOOL_ENTRIES = 20000;
+
+static UniValue MempoolEntry(int i)
+{
+    UniValue info(UniValue::VOBJ);
+    info.pushKV("size", 250 + i % 1000);
+    info.pushKV("fee", 0.0001);
+    info.pushKV("modifiedfee", 0.0001);
+    info.pushKV("time", 1700000000 + i);
+    info.pushKV("height", 1000000);
+    info.pushKV("descendantcount", 1);
+    info.pushKV("descendantsize", 250 + i % 1000);
+    info.pushKV("descendantfees", 10000);
+    UniValue depends(UniValue::VARR);
+    if (i > 0)
+        depends.push_back(ArithToUint256(arith_uint256(i - 1)).ToString());
+    info.pushKV("depends", depends);
+    return info;
+}
+
+static void WriteMempool(JSONWriter& writer)
+{
+    writer.BeginObject();
+    for (int i = 0; i < MEMPOOL_ENTRIES; i++)
+        writer.KV(ArithToUint256(arith_uint256(i)).ToString(), MempoolEntry(i));
+    writer.EndObject();
+}
+
+static void JSONMempoolBuildAndWrite(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        UniValueWriter writer;
+        WriteMempool(writer);
+        std::string strReply = writer.Result().write() + "\n";
+        assert(!strReply.empty());
+    }
+}
+
+static void JSONMempoolStream(benchmark::State& state)
+{
+    size_t nBytes = 0;
+    while (state.KeepRunning()) {
+        JSONTextWriter writer([&nBytes](const std::string& strPart, bool fLast) {
+            nBytes += strPart.size();
+        });
+        WriteMempool(writer);
+        writer.Finish();
+    }
+    assert(nBytes > 0);
+}
+
+// Time until the first part of a streamed reply can be sent
+static void JSONMempoolStreamFirstPart(benchmark::State& state)
+{
+    struct FirstPart {};
+    while (state.KeepRunning()) {
+        JSONTextWriter writer([](const std::string& strPart, bool fLast) {
+            throw FirstPart();
+        });
+        try {
+            WriteMempool(writer);
+            assert(false);
+        } catch (const FirstPart&) {
+        }
+    }
+}
+
+// The same document as CBOR, which needs no text formatting of numbers or
+// escaping of strings
+static void CBORMempoolStream(benchmark::State& state)
+{
+    size_t nBytes = 0;
+    while (state.KeepRunning()) {
+        CBORWriter writer([&nBytes](const std::string& strPart, bool fLast) {
+            nBytes += strPart.size();
+        });
+        WriteMempool(writer);
+        writer.Finish();
+    }
+    assert(nBytes > 0);
+}
+
+BENCHMARK(JSONMempoolBuildAndWrite);
+BENCHMARK(JSONMempoolStream);
+BENCHMARK(JSONMempoolStreamFirstPart);
+BENCHMARK(CBORMempoolStream);
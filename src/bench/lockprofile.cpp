@@ -0,0 +1,43 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+#include "sync.h"
+
+// The cost of an uncontended LOCK with the lock profiler stopped, sampling
+// at a rate suited to a running node, and timing every acquisition
+static const int ACQUISITIONS = 1000;
+
+static void LockAcquisitions(benchmark::State& state, uint32_t nRate)
+{
+    CCriticalSection cs;
+    ResetLockProfile();
+    nLockProfileSampleRate = nRate;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < ACQUISITIONS; i++) {
+            LOCK(cs);
+        }
+    }
+    nLockProfileSampleRate = 0;
+    ResetLockProfile();
+}
+
+static void LockProfileOff(benchmark::State& state)
+{
+    LockAcquisitions(state, 0);
+}
+
+static void LockProfileSampled(benchmark::State& state)
+{
+    LockAcquisitions(state, 100);
+}
+
+static void LockProfileEvery(benchmark::State& state)
+{
+    LockAcquisitions(state, 1);
+}
+
+BENCHMARK(LockProfileOff);
+BENCHMARK(LockProfileSampled);
+BENCHMARK(LockProfileEvery);
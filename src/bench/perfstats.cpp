@@ -0,0 +1,52 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+#include "perfstats.h"
+
+#include <thread>
+
+// The cost instrumentation adds to each operation it times: a histogram
+// update alone, the clock reads around it, and updates racing from several
+// threads, as LevelDB reads and P2P handlers do
+static const int OBSERVATIONS = 1000;
+static const int THREADS = 4;
+
+static void PerfHistogramObserve(benchmark::State& state)
+{
+    PerfHistogram hist;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < OBSERVATIONS; i++)
+            hist.Observe(i * 37);
+    }
+}
+
+static void PerfHistogramTimer(benchmark::State& state)
+{
+    PerfHistogram hist;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < OBSERVATIONS; i++)
+            PerfTimer timer(hist);
+    }
+}
+
+static void PerfHistogramObserveContended(benchmark::State& state)
+{
+    PerfHistogram hist;
+    while (state.KeepRunning()) {
+        std::vector<std::thread> vThreads;
+        for (int t = 0; t < THREADS; t++) {
+            vThreads.emplace_back([&hist] {
+                for (int i = 0; i < OBSERVATIONS; i++)
+                    hist.Observe(i * 37);
+            });
+        }
+        for (std::thread& thread : vThreads)
+            thread.join();
+    }
+}
+
+BENCHMARK(PerfHistogramObserve);
+BENCHMARK(PerfHistogramTimer);
+BENCHMARK(PerfHistogramObserveContended);
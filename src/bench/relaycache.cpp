@@ -0,0 +1,59 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+#include "clientversion.h"
+#include "relaycache.h"
+#include "util.h"
+#include "utiltime.h"
+#include "version.h"
+
+#include <boost/thread/thread.hpp>
+
+// Peers fetching recently announced transactions from several message
+// handling threads at once, which used to serialize on a single lock
+static const int MIN_THREADS = 4;
+static const size_t CACHED_TXS = 1000;
+static const size_t LOOKUPS_PER_THREAD = 10000;
+
+static void RelayCacheLookups(benchmark::State& state, size_t nShards)
+{
+    CRelayCache cache(nShards);
+    std::vector<uint256> vHashes;
+    int64_t nNow = GetTime();
+    for (size_t i = 0; i < CACHED_TXS; i++) {
+        uint256 hash;
+        *(uint64_t*)hash.begin() = i;
+        *(uint64_t*)(hash.begin() + 8) = i * 0x9e3779b97f4a7c15ULL;
+        std::shared_ptr<CDataStream> data = std::make_shared<CDataStream>(SER_NETWORK, PROTOCOL_VERSION);
+        data->resize(400);
+        cache.Insert(hash, data, nNow);
+        vHashes.push_back(hash);
+    }
+
+    int nThreads = std::max(MIN_THREADS, GetNumCores());
+    while (state.KeepRunning()) {
+        boost::thread_group tg;
+        for (int t = 0; t < nThreads; t++) {
+            tg.create_thread([&cache, &vHashes, t] {
+                for (size_t i = 0; i < LOOKUPS_PER_THREAD; i++)
+                    assert(cache.Lookup(vHashes[(i * 7 + t) % vHashes.size()]));
+            });
+        }
+        tg.join_all();
+    }
+}
+
+static void RelayCacheSingleLock(benchmark::State& state)
+{
+    RelayCacheLookups(state, 1);
+}
+
+static void RelayCacheSharded(benchmark::State& state)
+{
+    RelayCacheLookups(state, DEFAULT_RELAY_CACHE_SHARDS);
+}
+
+BENCHMARK(RelayCacheSingleLock);
+BENCHMARK(RelayCacheSharded);
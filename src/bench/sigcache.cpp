@@ -0,0 +1,76 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "consensus/upgrades.h"
+#include "consensus/validation.h"
+#include "key.h"
+#include "keystore.h"
+#include "main.h"
+#include "script/sigcache.h"
+#include "script/standard.h"
+#include "transaction_builder.h"
+#include "zcash/Address.hpp"
+
+// Shielded transactions in the block, each with a transparent input and a
+// Sapling output
+static const size_t BLOCK_TRANSACTIONS = 20;
+
+static bool NotInitialBlockDownload(const CChainParams&) { return false; }
+
+static std::vector<CTransaction> CreateShieldedTransactions()
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_OVERWINTER, Consensus::NetworkUpgrade::ALWAYS_ACTIVE);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_SAPLING, Consensus::NetworkUpgrade::ALWAYS_ACTIVE);
+
+    CBasicKeyStore keystore;
+    CKey key;
+    key.MakeNewKey(true);
+    keystore.AddKey(key);
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+    auto sk = libzcash::SaplingSpendingKey::random();
+
+    std::vector<CTransaction> vtx;
+    for (size_t i = 0; i < BLOCK_TRANSACTIONS; i++) {
+        auto builder = TransactionBuilder(Params().GetConsensus(), 1, &keystore);
+        builder.SetFee(0);
+        builder.AddTransparentInput(COutPoint(uint256(), i), scriptPubKey, 10000);
+        builder.AddSaplingOutput(sk.full_viewing_key().ovk, sk.default_address(), 10000);
+        vtx.push_back(builder.Build().GetTxOrThrow());
+    }
+    return vtx;
+}
+
+// Checks the shielded signatures and proofs of a block's transactions, as
+// AcceptBlock does. If fSeenInMempool, the transactions were checked when
+// they entered the mempool first and the results are in the signature cache.
+static void CheckShieldedBlock(benchmark::State& state, bool fSeenInMempool)
+{
+    std::vector<CTransaction> vtx = CreateShieldedTransactions();
+    if (fSeenInMempool) {
+        for (const CTransaction& tx : vtx) {
+            CValidationState validationState;
+            assert(ContextualCheckTransaction(tx, validationState, Params(), 1, 10, NotInitialBlockDownload, true));
+        }
+    }
+
+    while (state.KeepRunning()) {
+        for (const CTransaction& tx : vtx) {
+            CValidationState validationState;
+            assert(ContextualCheckTransaction(tx, validationState, Params(), 1, 100, NotInitialBlockDownload, false));
+        }
+    }
+
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_SAPLING, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_OVERWINTER, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+}
+
+static void ShieldedBlockUncached(benchmark::State& state) { CheckShieldedBlock(state, false); }
+static void ShieldedBlockSeenInMempool(benchmark::State& state) { CheckShieldedBlock(state, true); }
+
+BENCHMARK(ShieldedBlockUncached);
+BENCHMARK(ShieldedBlockSeenInMempool);
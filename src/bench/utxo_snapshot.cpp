@@ -0,0 +1,60 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+
+#include "clientversion.h"
+#include "coins.h"
+#include "random.h"
+#include "script/script.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+
+// Number of transactions in the snapshot; divide by the time per iteration
+// to get the loader throughput in coins/s.
+static const size_t SNAPSHOT_TRANSACTIONS = 100000;
+
+static void LoadUTXOSnapshot(benchmark::State& state)
+{
+    fs::path pathTemp = fs::temp_directory_path() / strprintf("bench_bitcoinz_%lu", (unsigned long)GetRand(1 << 30));
+    fs::create_directories(pathTemp);
+    ClearDatadirCache();
+    mapArgs["-datadir"] = pathTemp.string();
+
+    fs::path path = pathTemp / "txoutset.dat";
+    {
+        CCoinsViewDB source(1 << 23, true);
+        CCoinsViewCache cache(&source);
+        for (size_t i = 0; i < SNAPSHOT_TRANSACTIONS; i++) {
+            CCoinsModifier coins = cache.ModifyNewCoins(GetRandHash());
+            coins->nHeight = i + 1;
+            coins->vout.resize(1 + i % 3, CTxOut(i + 1, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, i & 0xff) << OP_EQUALVERIFY << OP_CHECKSIG));
+        }
+        cache.SetBestBlock(GetRandHash());
+        assert(cache.Flush());
+
+        CUTXOSnapshotMetadata metadata;
+        metadata.hashBlock = source.GetBestBlock();
+        metadata.hashSproutAnchor = source.GetBestAnchor(SPROUT);
+        metadata.hashSaplingAnchor = source.GetBestAnchor(SAPLING);
+        CUTXOSnapshotStats stats;
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        assert(source.DumpSnapshot(file, metadata, {}, {}, stats));
+    }
+
+    while (state.KeepRunning()) {
+        CCoinsViewDB target(1 << 23, true);
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        CUTXOSnapshotMetadata metadata;
+        CUTXOSnapshotStats stats;
+        assert(target.LoadSnapshot(file, metadata, stats, true));
+    }
+
+    ClearDatadirCache();
+    mapArgs.erase("-datadir");
+    fs::remove_all(pathTemp);
+}
+
+BENCHMARK(LoadUTXOSnapshot);
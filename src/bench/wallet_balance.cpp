@@ -0,0 +1,72 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "key.h"
+#include "main.h"
+#include "script/standard.h"
+#include "wallet/wallet.h"
+
+// Balance of a wallet whose transactions each spend the previous one's output
+// back to the wallet, as a busy hot wallet's history looks: only the newest
+// transaction still has an unspent output, so after the first GetBalance()
+// prunes the others, GetUnsettledTxs() holds just that one.
+static void WalletBalance(benchmark::State& state, size_t nTransactions)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+    CKey key;
+    key.MakeNewKey(true);
+    wallet.AddKey(key);
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+    CBlock block;
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vout.resize(1);
+    mtx.vout[0].scriptPubKey = scriptPubKey;
+    for (size_t i = 0; i < nTransactions; i++) {
+        mtx.vout[0].nValue = COIN + nTransactions - i;
+        block.vtx.push_back(mtx);
+        mtx.vin[0].prevout = COutPoint(block.vtx.back().GetHash(), 0);
+    }
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    uint256 blockHash = block.GetHash();
+    CBlockIndex index(block);
+    index.nHeight = 0;
+    mapBlockIndex.insert(std::make_pair(blockHash, &index));
+    chainActive.SetTip(&index);
+
+    for (const CTransaction& tx : block.vtx) {
+        CWalletTx wtx(&wallet, tx);
+        wtx.hashBlock = blockHash;
+        wtx.nIndex = 0;
+        wallet.AddToWallet(wtx, true, NULL);
+    }
+
+    while (state.KeepRunning()) {
+        assert(wallet.GetBalance() == COIN + 1);
+    }
+
+    chainActive.SetTip(NULL);
+    mapBlockIndex.erase(blockHash);
+}
+
+static void WalletBalance100k(benchmark::State& state)
+{
+    WalletBalance(state, 100000);
+}
+
+static void WalletBalance1M(benchmark::State& state)
+{
+    WalletBalance(state, 1000000);
+}
+
+BENCHMARK(WalletBalance100k);
+BENCHMARK(WalletBalance1M);
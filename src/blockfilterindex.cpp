@@ -0,0 +1,296 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "blockfilterindex.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "hash.h"
+#include "init.h"
+#include "main.h"
+#include "streams.h"
+#include "ui_interface.h"
+#include "undo.h"
+#include "util.h"
+
+#include <algorithm>
+
+#include <boost/thread.hpp>
+
+static const char DB_FILTER = 's';
+static const char DB_BEST_BLOCK = 'B';
+static const char DB_NEXT_POS = 'P';
+
+CBlockFilterIndex* pblockfilterindex = NULL;
+
+CBlockFilterIndex::CBlockFilterIndex(BlockFilterType filter_type, size_t nCacheSize, bool fMemory, bool fWipe)
+    : m_filter_type(filter_type), pindexBest(NULL), posNext(0, 0)
+{
+    const std::string& name = BlockFilterTypeName(filter_type);
+    if (name.empty()) throw std::invalid_argument("unknown filter_type");
+
+    m_dir = GetDataDir() / "indexes" / "blockfilter" / name;
+    fs::create_directories(m_dir);
+    m_db.reset(new CDBWrapper(m_dir / "db", nCacheSize, fMemory, fWipe));
+}
+
+bool CBlockFilterIndex::Init()
+{
+    AssertLockHeld(cs_main);
+
+    uint256 hashBest;
+    if (m_db->Read(DB_BEST_BLOCK, hashBest)) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashBest);
+        if (mi == mapBlockIndex.end()) {
+            return error("%s: best block %s of the %s filter index not found, restart with -reindex to rebuild it",
+                __func__, hashBest.ToString(), BlockFilterTypeName(m_filter_type));
+        }
+        LOCK(cs);
+        pindexBest = mi->second;
+    }
+    if (!m_db->Read(DB_NEXT_POS, posNext)) {
+        posNext = CDiskBlockPos(0, 0);
+    }
+
+    LogPrintf("%s filter index at height %d\n", BlockFilterTypeName(m_filter_type),
+        pindexBest ? pindexBest->nHeight : -1);
+    return true;
+}
+
+fs::path CBlockFilterIndex::GetFilePath(int nFile) const
+{
+    return m_dir / strprintf("fltr%05u.dat", nFile);
+}
+
+FILE* CBlockFilterIndex::OpenFile(const CDiskBlockPos& pos, bool fReadOnly) const
+{
+    if (pos.IsNull())
+        return NULL;
+    fs::path path = GetFilePath(pos.nFile);
+    FILE* file = fsbridge::fopen(path, "rb+");
+    if (!file && !fReadOnly)
+        file = fsbridge::fopen(path, "wb+");
+    if (!file) {
+        LogPrintf("Unable to open file %s\n", path.string());
+        return NULL;
+    }
+    if (pos.nPos && fseek(file, pos.nPos, SEEK_SET)) {
+        LogPrintf("Unable to seek to position %u of %s\n", pos.nPos, path.string());
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+bool CBlockFilterIndex::ReadFilter(const CBlockIndex* pindex, const CBlockFilterDBEntry& entry, BlockFilter& filter) const
+{
+    CAutoFile filein(OpenFile(entry.pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenFile failed", __func__);
+
+    std::vector<unsigned char> encoded;
+    try {
+        filein >> encoded;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    if (Hash(encoded.begin(), encoded.end()) != entry.hashFilter)
+        return error("%s: Checksum mismatch for the filter of block %s", __func__, pindex->GetBlockHash().ToString());
+
+    try {
+        filter = BlockFilter(m_filter_type, pindex->GetBlockHash(), std::move(encoded));
+    } catch (const std::exception& e) {
+        return error("%s: Malformed filter for block %s - %s", __func__, pindex->GetBlockHash().ToString(), e.what());
+    }
+    return true;
+}
+
+bool CBlockFilterIndex::WriteFilter(const BlockFilter& filter, CDiskBlockPos& pos)
+{
+    const std::vector<unsigned char>& encoded = filter.GetEncodedFilter();
+    unsigned int nSize = GetSerializeSize(encoded, SER_DISK, CLIENT_VERSION);
+
+    // Start a new file when the current one would grow past the limit,
+    // committing the old one since Sync() only flushes the file it ends on.
+    if (posNext.nPos > 0 && posNext.nPos + nSize > MAX_FLTR_FILE_SIZE) {
+        FILE* file = OpenFile(posNext, false);
+        if (!file)
+            return error("%s: OpenFile failed", __func__);
+        FileCommit(file);
+        fclose(file);
+        posNext = CDiskBlockPos(posNext.nFile + 1, 0);
+    }
+
+    CAutoFile fileout(OpenFile(posNext, false), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: OpenFile failed", __func__);
+    fileout << encoded;
+
+    pos = posNext;
+    posNext.nPos += nSize;
+    return true;
+}
+
+bool CBlockFilterIndex::LookupEntry(const uint256& hash, CBlockFilterDBEntry& entry) const
+{
+    return m_db->Read(std::make_pair(DB_FILTER, hash), entry);
+}
+
+const CBlockIndex* CBlockFilterIndex::GetBestBlock() const
+{
+    LOCK(cs);
+    return pindexBest;
+}
+
+std::vector<const CBlockIndex*> CBlockFilterIndex::GetBlocksToIndex() const
+{
+    std::vector<const CBlockIndex*> blocks;
+
+    LOCK(cs_main);
+    const CBlockIndex* pindexLast = GetBestBlock();
+    const CBlockIndex* pindex = pindexLast ? chainActive.Next(chainActive.FindFork(pindexLast)) : chainActive.Genesis();
+    while (pindex && blocks.size() < (size_t)BLOCKFILTERINDEX_SYNC_BATCH) {
+        blocks.push_back(pindex);
+        pindex = chainActive.Next(pindex);
+    }
+    return blocks;
+}
+
+bool CBlockFilterIndex::Sync(bool& fCaughtUp)
+{
+    std::vector<const CBlockIndex*> blocks = GetBlocksToIndex();
+    fCaughtUp = blocks.empty();
+    if (fCaughtUp)
+        return true;
+
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    // The blocks are consecutive on the active chain, so each header chains
+    // from the one before it, starting at the fork point's.
+    uint256 prevHeader;
+    if (blocks.front()->pprev) {
+        CBlockFilterDBEntry entry;
+        if (!LookupEntry(blocks.front()->pprev->GetBlockHash(), entry))
+            return error("%s: filter of block %s not found", __func__, blocks.front()->pprev->GetBlockHash().ToString());
+        prevHeader = entry.header;
+    }
+
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex : blocks) {
+        boost::this_thread::interruption_point();
+
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA) || (pindex->pprev && !(pindex->nStatus & BLOCK_HAVE_UNDO)))
+            return error("%s: block %s is not available on disk", __func__, pindex->GetBlockHash().ToString());
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensusParams))
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        // The genesis block has no undo data; its coinbase spends nothing.
+        CBlockUndo blockundo;
+        if (pindex->pprev && !ReadBlockUndoFromDisk(blockundo, pindex))
+            return error("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+
+        BlockFilter filter(m_filter_type, block, blockundo);
+        CBlockFilterDBEntry entry;
+        entry.hashFilter = filter.GetHash();
+        entry.header = filter.ComputeHeader(prevHeader);
+        if (!WriteFilter(filter, entry.pos))
+            return false;
+
+        batch.Write(std::make_pair(DB_FILTER, pindex->GetBlockHash()), entry);
+        prevHeader = entry.header;
+    }
+
+    // Make sure the filters are on disk before the database points at them.
+    FILE* file = OpenFile(posNext, false);
+    if (!file)
+        return error("%s: OpenFile failed", __func__);
+    FileCommit(file);
+    fclose(file);
+
+    batch.Write(DB_BEST_BLOCK, blocks.back()->GetBlockHash());
+    batch.Write(DB_NEXT_POS, posNext);
+    if (!m_db->WriteBatch(batch, true))
+        return error("%s: failed to write to the %s filter index database", __func__, BlockFilterTypeName(m_filter_type));
+
+    LOCK(cs);
+    pindexBest = blocks.back();
+    return true;
+}
+
+bool CBlockFilterIndex::LookupFilter(const CBlockIndex* pindex, BlockFilter& filter) const
+{
+    CBlockFilterDBEntry entry;
+    if (!LookupEntry(pindex->GetBlockHash(), entry))
+        return false;
+    return ReadFilter(pindex, entry, filter);
+}
+
+bool CBlockFilterIndex::LookupFilterHeader(const CBlockIndex* pindex, uint256& header) const
+{
+    CBlockFilterDBEntry entry;
+    if (!LookupEntry(pindex->GetBlockHash(), entry))
+        return false;
+    header = entry.header;
+    return true;
+}
+
+bool CBlockFilterIndex::LookupFilterRange(int nStartHeight, const CBlockIndex* pindexStop, std::vector<BlockFilter>& filters) const
+{
+    if (nStartHeight < 0 || nStartHeight > pindexStop->nHeight)
+        return false;
+
+    filters.resize(pindexStop->nHeight - nStartHeight + 1);
+    for (const CBlockIndex* pindex = pindexStop; pindex && pindex->nHeight >= nStartHeight; pindex = pindex->pprev) {
+        if (!LookupFilter(pindex, filters[pindex->nHeight - nStartHeight]))
+            return false;
+    }
+    return true;
+}
+
+bool CBlockFilterIndex::LookupFilterHashRange(int nStartHeight, const CBlockIndex* pindexStop, std::vector<uint256>& hashes) const
+{
+    if (nStartHeight < 0 || nStartHeight > pindexStop->nHeight)
+        return false;
+
+    hashes.resize(pindexStop->nHeight - nStartHeight + 1);
+    for (const CBlockIndex* pindex = pindexStop; pindex && pindex->nHeight >= nStartHeight; pindex = pindex->pprev) {
+        CBlockFilterDBEntry entry;
+        if (!LookupEntry(pindex->GetBlockHash(), entry))
+            return false;
+        hashes[pindex->nHeight - nStartHeight] = entry.hashFilter;
+    }
+    return true;
+}
+
+void ThreadBlockFilterIndex()
+{
+    bool fLoggedCaughtUp = false;
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        bool fCaughtUp = false;
+        if (!pblockfilterindex->Sync(fCaughtUp)) {
+            LogPrintf("*** Failed to update the %s filter index\n", BlockFilterTypeName(pblockfilterindex->GetFilterType()));
+            uiInterface.ThreadSafeMessageBox(
+                _("Error: A fatal internal error occurred, see debug.log for details"),
+                "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+            return;
+        }
+
+        if (fCaughtUp) {
+            if (!fLoggedCaughtUp) {
+                const CBlockIndex* pindexBest = pblockfilterindex->GetBestBlock();
+                LogPrintf("%s filter index is synced to height %d\n",
+                    BlockFilterTypeName(pblockfilterindex->GetFilterType()), pindexBest ? pindexBest->nHeight : -1);
+                fLoggedCaughtUp = true;
+            }
+            MilliSleep(1000);
+        } else {
+            fLoggedCaughtUp = false;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_BLOCKFILTERINDEX_H
+#define BITCOIN_BLOCKFILTERINDEX_H
+
+#include "blockfilter.h"
+#include "chain.h"
+#include "dbwrapper.h"
+#include "fs.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <memory>
+#include <vector>
+
+/** Default for -blockfilterindex */
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+/** Default for -peerblockfilters */
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
+//! max. -dbcache share of the block filter index database (MiB)
+static const int64_t nMaxFilterIndexCache = 1024;
+/** The maximum size of a fltr?????.dat file */
+static const unsigned int MAX_FLTR_FILE_SIZE = 0x1000000; // 16 MiB
+/** Number of blocks the index processes before committing its progress. */
+static const int BLOCKFILTERINDEX_SYNC_BATCH = 1000;
+
+/** What the index stores per block: where the encoded filter lives in the
+ *  flat files, and the hash and header used to answer cfheaders requests
+ *  without reading the filter itself. */
+struct CBlockFilterDBEntry
+{
+    uint256 hashFilter;
+    uint256 header;
+    CDiskBlockPos pos;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashFilter);
+        READWRITE(header);
+        READWRITE(pos);
+    }
+};
+
+/**
+ * Index of BIP 158 block filters for the blocks of the active chain.
+ *
+ * Filters are appended to flat files (indexes/blockfilter/<type>/fltrNNNNN.dat)
+ * and the database under indexes/blockfilter/<type>/db maps each block hash
+ * to its filter's position, hash and header. Entries are keyed by block hash
+ * so that blocks which are reorganized away do not have to be removed; the
+ * headers of the new branch are chained from the fork point.
+ *
+ * The index is built in the background by ThreadBlockFilterIndex, which
+ * catches up with the active chain in batches and then follows the tip.
+ */
+class CBlockFilterIndex
+{
+private:
+    BlockFilterType m_filter_type;
+    fs::path m_dir;
+    std::unique_ptr<CDBWrapper> m_db;
+
+    /** Guards pindexBest. */
+    mutable CCriticalSection cs;
+    /** The last block whose filter has been committed to the database. */
+    const CBlockIndex* pindexBest;
+
+    /** Position the next filter is written at. Only touched by Sync(). */
+    CDiskBlockPos posNext;
+
+    fs::path GetFilePath(int nFile) const;
+    FILE* OpenFile(const CDiskBlockPos& pos, bool fReadOnly) const;
+
+    bool ReadFilter(const CBlockIndex* pindex, const CBlockFilterDBEntry& entry, BlockFilter& filter) const;
+    bool WriteFilter(const BlockFilter& filter, CDiskBlockPos& pos);
+    bool LookupEntry(const uint256& hash, CBlockFilterDBEntry& entry) const;
+
+    /** Collects the next blocks of the active chain the index has not seen. */
+    std::vector<const CBlockIndex*> GetBlocksToIndex() const;
+
+public:
+    CBlockFilterIndex(BlockFilterType filter_type, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    BlockFilterType GetFilterType() const { return m_filter_type; }
+
+    /** Loads the index's progress. Requires cs_main. */
+    bool Init();
+
+    /** Indexes up to BLOCKFILTERINDEX_SYNC_BATCH blocks that the index is
+     *  behind the active chain by. Returns false on error, and sets
+     *  fCaughtUp if there was nothing left to do. */
+    bool Sync(bool& fCaughtUp);
+
+    /** The last block whose filter is available, or NULL. */
+    const CBlockIndex* GetBestBlock() const;
+
+    /** Gets the filter of a single block. */
+    bool LookupFilter(const CBlockIndex* pindex, BlockFilter& filter) const;
+
+    /** Gets the filter header of a single block. */
+    bool LookupFilterHeader(const CBlockIndex* pindex, uint256& header) const;
+
+    /** Gets the filters of pindexStop and its ancestors down to nStartHeight,
+     *  in chain order. */
+    bool LookupFilterRange(int nStartHeight, const CBlockIndex* pindexStop, std::vector<BlockFilter>& filters) const;
+
+    /** Gets the filter hashes of pindexStop and its ancestors down to
+     *  nStartHeight, in chain order. */
+    bool LookupFilterHashRange(int nStartHeight, const CBlockIndex* pindexStop, std::vector<uint256>& hashes) const;
+};
+
+/** The block filter index, if -blockfilterindex is enabled. */
+extern CBlockFilterIndex* pblockfilterindex;
+
+/** Keeps pblockfilterindex in sync with the active chain. */
+void ThreadBlockFilterIndex();
+
+#endif // BITCOIN_BLOCKFILTERINDEX_H
@@ -0,0 +1,241 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "blockimport.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "consensus/consensus.h"
+#include "streams.h"
+#include "util.h"
+#include "utiltime.h"
+
+CBlockImportStats importStats;
+
+void CBlockImportStats::Start()
+{
+    nBlocksRead = 0;
+    nBytesRead = 0;
+    nBlocksChecked = 0;
+    nBlocksImported = 0;
+    nReadMicros = 0;
+    nCheckMicros = 0;
+    nImportMicros = 0;
+    nStartTime = GetTimeMicros();
+}
+
+std::string CBlockImportStats::ToString() const
+{
+    int64_t nStart = nStartTime;
+    if (nStart == 0) {
+        return "";
+    }
+    double nElapsed = std::max<int64_t>(GetTimeMicros() - nStart, 1) * 0.000001;
+    return strprintf("read %.1f MB/s (%.0f blocks/s), checked %.0f blocks/s, imported %.0f blocks/s; busy read %.0fs, check %.0fs, import %.0fs",
+        nBytesRead / nElapsed / 1000000, nBlocksRead / nElapsed, nBlocksChecked / nElapsed, nBlocksImported / nElapsed,
+        nReadMicros * 0.000001, nCheckMicros * 0.000001, nImportMicros * 0.000001);
+}
+
+CBlockImportPipeline::CBlockImportPipeline(const CChainParams& chainparamsIn, const std::vector<CImportFile>& filesIn,
+                                           CheckFunction checkIn, int nReaders, int nCheckThreads) :
+    chainparams(chainparamsIn), files(filesIn), check(checkIn), vState(filesIn.size()), fCheckThreads(nCheckThreads > 0)
+{
+    for (int i = 0; i < nReaders; i++) {
+        threads.emplace_back(&CBlockImportPipeline::ThreadRead, this);
+    }
+    for (int i = 0; i < nCheckThreads; i++) {
+        threads.emplace_back(&CBlockImportPipeline::ThreadCheck, this);
+    }
+}
+
+CBlockImportPipeline::~CBlockImportPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    condReader.notify_all();
+    condChecker.notify_all();
+    condConsumer.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+std::shared_ptr<CImportedBlock> CBlockImportPipeline::Next(size_t nFileIndex)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    if (nConsumerFile != nFileIndex) {
+        nConsumerFile = nFileIndex;
+        condReader.notify_all();
+    }
+    FileState& state = vState[nFileIndex];
+    condConsumer.wait(lock, [&] {
+        return fStop || (state.queue.empty() ? state.fDone : state.queue.front()->fCheckDone);
+    });
+    if (fStop || state.queue.empty()) {
+        return nullptr;
+    }
+    std::shared_ptr<CImportedBlock> item = state.queue.front();
+    state.queue.pop_front();
+    nQueuedBytes -= item->nSize;
+    condReader.notify_all();
+    return item;
+}
+
+std::string CBlockImportPipeline::GetError(size_t nFileIndex)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return vState[nFileIndex].strError;
+}
+
+bool CBlockImportPipeline::IsOpened(size_t nFileIndex)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return vState[nFileIndex].fOpened;
+}
+
+bool CBlockImportPipeline::Push(size_t nFileIndex, std::shared_ptr<CImportedBlock> item)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        // Never hold back the file the consumer is waiting on, so that the
+        // byte limit cannot stall the pipeline.
+        condReader.wait(lock, [&] {
+            return fStop || nFileIndex == nConsumerFile || nQueuedBytes < MAX_IMPORT_QUEUE_BYTES;
+        });
+        if (fStop) {
+            return false;
+        }
+        item->fCheckDone = !fCheckThreads;
+        nQueuedBytes += item->nSize;
+        vState[nFileIndex].queue.push_back(item);
+        if (fCheckThreads) {
+            checkQueue.push_back(item);
+        }
+    }
+    if (fCheckThreads) {
+        condChecker.notify_one();
+    } else {
+        condConsumer.notify_all();
+    }
+    return true;
+}
+
+void CBlockImportPipeline::ThreadRead()
+{
+    RenameThread("bitcoinz-loadblk-read");
+    while (true) {
+        size_t nFileIndex;
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            if (fStop || nNextFile >= files.size()) {
+                return;
+            }
+            nFileIndex = nNextFile++;
+        }
+        std::string strError;
+        try {
+            ReadFile(nFileIndex);
+        } catch (const std::exception& e) {
+            strError = e.what();
+        }
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            vState[nFileIndex].fDone = true;
+            vState[nFileIndex].strError = strError;
+        }
+        condConsumer.notify_all();
+    }
+}
+
+void CBlockImportPipeline::ReadFile(size_t nFileIndex)
+{
+    const CImportFile& import = files[nFileIndex];
+    FILE* fileIn = fsbridge::fopen(import.path, "rb");
+    if (!fileIn) {
+        LogPrintf("Warning: Could not open blocks file %s\n", import.path.string());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        vState[nFileIndex].fOpened = true;
+    }
+
+    // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+    CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
+    uint64_t nRewind = blkdat.GetPos();
+    while (!blkdat.eof()) {
+        int64_t nStart = GetTimeMicros();
+        blkdat.SetPos(nRewind);
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[MESSAGE_START_SIZE];
+            blkdat.FindByte(chainparams.MessageStart()[0]);
+            nRewind = blkdat.GetPos()+1;
+            blkdat >> FLATDATA(buf);
+            if (memcmp(buf, chainparams.MessageStart(), MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            break;
+        }
+        std::shared_ptr<CImportedBlock> item = std::make_shared<CImportedBlock>();
+        try {
+            // read block
+            uint64_t nBlockPos = blkdat.GetPos();
+            item->fHavePos = import.nFile >= 0;
+            if (item->fHavePos)
+                item->pos = CDiskBlockPos(import.nFile, nBlockPos);
+            blkdat.SetLimit(nBlockPos + nSize);
+            blkdat.SetPos(nBlockPos);
+            blkdat >> item->block;
+            nRewind = blkdat.GetPos();
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            continue;
+        }
+        item->nEndPos = nRewind;
+        item->nSize = nSize;
+        importStats.nBlocksRead++;
+        importStats.nBytesRead += nSize;
+        importStats.nReadMicros += GetTimeMicros() - nStart;
+        if (!Push(nFileIndex, item)) {
+            return;
+        }
+    }
+}
+
+void CBlockImportPipeline::ThreadCheck()
+{
+    RenameThread("bitcoinz-loadblk-check");
+    while (true) {
+        std::shared_ptr<CImportedBlock> item;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            condChecker.wait(lock, [&] { return fStop || !checkQueue.empty(); });
+            if (fStop) {
+                return;
+            }
+            item = checkQueue.front();
+            checkQueue.pop_front();
+        }
+        int64_t nStart = GetTimeMicros();
+        check(item->block);
+        importStats.nBlocksChecked++;
+        importStats.nCheckMicros += GetTimeMicros() - nStart;
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            item->fCheckDone = true;
+        }
+        condConsumer.notify_all();
+    }
+}
@@ -0,0 +1,144 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_BLOCKIMPORT_H
+#define BITCOIN_BLOCKIMPORT_H
+
+#include "chain.h"
+#include "fs.h"
+#include "primitives/block.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CChainParams;
+
+/** Default number of threads scanning block files ahead of the importer */
+static const int DEFAULT_IMPORT_READERS = 2;
+/** Default number of threads running context-free block checks during import (0 = one per core) */
+static const int DEFAULT_IMPORT_CHECK_THREADS = 0;
+/** Maximum number of threads running context-free block checks during import */
+static const int MAX_IMPORT_CHECK_THREADS = 16;
+/** Maximum serialized size of blocks that have been read but not yet imported */
+static const size_t MAX_IMPORT_QUEUE_BYTES = 256 * 1024 * 1024;
+
+/** Throughput counters for each stage of the block import pipeline. */
+struct CBlockImportStats
+{
+    std::atomic<int64_t> nStartTime{0}; //!< 0 when no import is running
+    std::atomic<uint64_t> nBlocksRead{0};
+    std::atomic<uint64_t> nBytesRead{0};
+    std::atomic<uint64_t> nBlocksChecked{0};
+    std::atomic<uint64_t> nBlocksImported{0};
+    std::atomic<int64_t> nReadMicros{0};   //!< Summed over reader threads
+    std::atomic<int64_t> nCheckMicros{0};  //!< Summed over check threads
+    std::atomic<int64_t> nImportMicros{0};
+
+    void Start();
+    void Stop() { nStartTime = 0; }
+    /** One-line summary of the rate of each stage since Start(). */
+    std::string ToString() const;
+};
+
+extern CBlockImportStats importStats;
+
+/** A block file to import. */
+struct CImportFile
+{
+    fs::path path;
+    //! Number of the blk?????.dat file being reindexed, or -1 for an external file
+    int nFile;
+
+    CImportFile(const fs::path& pathIn, int nFileIn = -1) : path(pathIn), nFile(nFileIn) {}
+};
+
+/** A block read from an import file. */
+struct CImportedBlock
+{
+    CBlock block;
+    //! Position of the block, if it was read from a blk?????.dat file
+    CDiskBlockPos pos;
+    bool fHavePos;
+    //! Offset in the file just past the block
+    uint64_t nEndPos;
+    //! Serialized size of the block
+    size_t nSize;
+    //! Whether the context-free check has run (guarded by the pipeline's mutex)
+    bool fCheckDone;
+};
+
+/**
+ * Reads blocks from a list of files and runs context-free checks on them in
+ * parallel, handing them to a single consumer in file order.
+ *
+ * Reader threads each take the next unread file and scan it for blocks, so
+ * several files are read ahead of the consumer; the total size of queued
+ * blocks is bounded by MAX_IMPORT_QUEUE_BYTES, except for the file the
+ * consumer is waiting on. Each block is passed to the check function on a
+ * check thread, which is expected to leave its result in the block (see
+ * CBlock::fChecked).
+ */
+class CBlockImportPipeline
+{
+public:
+    typedef std::function<void(const CBlock&)> CheckFunction;
+
+    CBlockImportPipeline(const CChainParams& chainparams, const std::vector<CImportFile>& files,
+                         CheckFunction check, int nReaders, int nCheckThreads);
+    ~CBlockImportPipeline();
+
+    /**
+     * Return the next checked block of file nFileIndex, waiting for it if
+     * needed, or nullptr once the file has been fully read. Files must be
+     * consumed in order.
+     */
+    std::shared_ptr<CImportedBlock> Next(size_t nFileIndex);
+
+    /** Error that ended the read of file nFileIndex early, if any. */
+    std::string GetError(size_t nFileIndex);
+    /** Whether file nFileIndex could be opened, once Next() has returned a block
+     *  from it or nullptr. */
+    bool IsOpened(size_t nFileIndex);
+
+private:
+    struct FileState {
+        std::deque<std::shared_ptr<CImportedBlock>> queue;
+        bool fOpened = false;
+        bool fDone = false;
+        std::string strError;
+    };
+
+    const CChainParams& chainparams;
+    const std::vector<CImportFile> files;
+    const CheckFunction check;
+
+    std::mutex cs;
+    std::condition_variable condReader;
+    std::condition_variable condChecker;
+    std::condition_variable condConsumer;
+    std::vector<FileState> vState;
+    std::deque<std::shared_ptr<CImportedBlock>> checkQueue;
+    size_t nNextFile = 0;
+    size_t nConsumerFile = 0;
+    size_t nQueuedBytes = 0;
+    bool fCheckThreads;
+    bool fStop = false;
+
+    std::vector<std::thread> threads;
+
+    void ThreadRead();
+    void ThreadCheck();
+    void ReadFile(size_t nFileIndex);
+    /** Queue a block; returns false if the pipeline is stopping. */
+    bool Push(size_t nFileIndex, std::shared_ptr<CImportedBlock> item);
+};
+
+#endif // BITCOIN_BLOCKIMPORT_H
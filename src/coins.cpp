@@ -5,6 +5,7 @@
 #include "coins.h"
 
 #include "memusage.h"
+#include "perfstats.h"
 #include "random.h"
 #include "version.h"
 #include "policy/fees.h"
@@ -98,10 +99,18 @@ size_t CCoinsViewCache::DynamicMemoryUsage() const {
            cachedCoinsUsage;
 }
 
+static PerfCounter& perfCoinsHits = GetPerfCounter("coins_cache_lookups_total",
+    "Coin lookups in in-memory coins cache layers, by result", "result", "hit");
+static PerfCounter& perfCoinsMisses = GetPerfCounter("coins_cache_lookups_total",
+    "Coin lookups in in-memory coins cache layers, by result", "result", "miss");
+
 CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256 &txid) const {
     CCoinsMap::iterator it = cacheCoins.find(txid);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        perfCoinsHits.Add();
         return it;
+    }
+    perfCoinsMisses.Add();
     CCoins tmp;
     if (!base->GetCoins(txid, tmp))
         return cacheCoins.end();
@@ -128,16 +137,10 @@ bool CCoinsViewCache::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tre
         }
     }
 
-    if (!base->GetSproutAnchorAt(rt, tree)) {
-        return false;
-    }
-
-    CAnchorsSproutMap::iterator ret = cacheSproutAnchors.insert(std::make_pair(rt, CAnchorsSproutCacheEntry())).first;
-    ret->second.entered = true;
-    ret->second.tree = tree;
-    cachedCoinsUsage += ret->second.tree.DynamicMemoryUsage();
-
-    return true;
+    // Trees read from the base view are not cached here: CCoinsViewDB keeps
+    // a bounded cache of materialized frontiers, and copying every tree we
+    // are asked about into this map would only grow its memory usage.
+    return base->GetSproutAnchorAt(rt, tree);
 }
 
 bool CCoinsViewCache::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const {
@@ -151,16 +154,8 @@ bool CCoinsViewCache::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &t
         }
     }
 
-    if (!base->GetSaplingAnchorAt(rt, tree)) {
-        return false;
-    }
-
-    CAnchorsSaplingMap::iterator ret = cacheSaplingAnchors.insert(std::make_pair(rt, CAnchorsSaplingCacheEntry())).first;
-    ret->second.entered = true;
-    ret->second.tree = tree;
-    cachedCoinsUsage += ret->second.tree.DynamicMemoryUsage();
-
-    return true;
+    // Not cached; see GetSproutAnchorAt().
+    return base->GetSaplingAnchorAt(rt, tree);
 }
 
 bool CCoinsViewCache::GetNullifier(const uint256 &nullifier, ShieldedType type) const {
@@ -188,9 +183,10 @@ bool CCoinsViewCache::GetNullifier(const uint256 &nullifier, ShieldedType type)
     return tmp;
 }
 
-template<typename Tree, typename Cache, typename CacheIterator, typename CacheEntry>
+template<typename Tree, typename Cache, typename CacheIterator, typename CacheEntry, typename Hash>
 void CCoinsViewCache::AbstractPushAnchor(
     const Tree &tree,
+    const std::vector<Hash> *appended,
     ShieldedType type,
     Cache &cacheAnchors,
     uint256 &hash
@@ -209,23 +205,44 @@ void CCoinsViewCache::AbstractPushAnchor(
         auto insertRet = cacheAnchors.insert(std::make_pair(newrt, CacheEntry()));
         CacheIterator ret = insertRet.first;
 
+        if (!insertRet.second) {
+            // The entry is being replaced
+            cachedCoinsUsage -= ret->second.DynamicMemoryUsage();
+        }
+
         ret->second.entered = true;
         ret->second.tree = tree;
         ret->second.flags = CacheEntry::DIRTY;
-
-        if (insertRet.second) {
-            // An insert took place
-            cachedCoinsUsage += ret->second.tree.DynamicMemoryUsage();
+        if (appended) {
+            ret->second.parent = currentRoot;
+            ret->second.appended = *appended;
+        } else {
+            ret->second.parent.SetNull();
+            ret->second.appended.clear();
         }
 
+        cachedCoinsUsage += ret->second.DynamicMemoryUsage();
+
         hash = newrt;
     }
 }
 
 template<> void CCoinsViewCache::PushAnchor(const SproutMerkleTree &tree)
 {
-    AbstractPushAnchor<SproutMerkleTree, CAnchorsSproutMap, CAnchorsSproutMap::iterator, CAnchorsSproutCacheEntry>(
+    AbstractPushAnchor<SproutMerkleTree, CAnchorsSproutMap, CAnchorsSproutMap::iterator, CAnchorsSproutCacheEntry, libzcash::SHA256Compress>(
+        tree,
+        nullptr,
+        SPROUT,
+        cacheSproutAnchors,
+        hashSproutAnchor
+    );
+}
+
+void CCoinsViewCache::PushAnchor(const SproutMerkleTree &tree, const std::vector<libzcash::SHA256Compress> &appended)
+{
+    AbstractPushAnchor<SproutMerkleTree, CAnchorsSproutMap, CAnchorsSproutMap::iterator, CAnchorsSproutCacheEntry, libzcash::SHA256Compress>(
         tree,
+        &appended,
         SPROUT,
         cacheSproutAnchors,
         hashSproutAnchor
@@ -234,8 +251,20 @@ template<> void CCoinsViewCache::PushAnchor(const SproutMerkleTree &tree)
 
 template<> void CCoinsViewCache::PushAnchor(const SaplingMerkleTree &tree)
 {
-    AbstractPushAnchor<SaplingMerkleTree, CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry>(
+    AbstractPushAnchor<SaplingMerkleTree, CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, libzcash::PedersenHash>(
         tree,
+        nullptr,
+        SAPLING,
+        cacheSaplingAnchors,
+        hashSaplingAnchor
+    );
+}
+
+void CCoinsViewCache::PushAnchor(const SaplingMerkleTree &tree, const std::vector<libzcash::PedersenHash> &appended)
+{
+    AbstractPushAnchor<SaplingMerkleTree, CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, libzcash::PedersenHash>(
+        tree,
+        &appended,
         SAPLING,
         cacheSaplingAnchors,
         hashSaplingAnchor
@@ -276,16 +305,21 @@ void CCoinsViewCache::AbstractPopAnchor(
     if (currentRoot != newrt) {
         // Bring the current best anchor into our local cache
         // so that its tree exists in memory.
-        {
-            Tree tree;
-            BringBestAnchorIntoCache(currentRoot, tree);
+        Tree tree;
+        BringBestAnchorIntoCache(currentRoot, tree);
+
+        auto insertRet = cacheAnchors.insert(std::make_pair(currentRoot, CacheEntry()));
+        CacheEntry &entry = insertRet.first->second;
+        if (insertRet.second) {
+            entry.tree = tree;
+            cachedCoinsUsage += entry.DynamicMemoryUsage();
         }
 
         // Mark the anchor as unentered, removing it from view
-        cacheAnchors[currentRoot].entered = false;
+        entry.entered = false;
 
         // Mark the cache entry as dirty so it's propagated
-        cacheAnchors[currentRoot].flags = CacheEntry::DIRTY;
+        entry.flags = CacheEntry::DIRTY;
 
         // Mark the new root as the best anchor
         hash = newrt;
@@ -392,6 +426,45 @@ bool CCoinsViewCache::HaveCoinsInCache(const uint256 &txid) const {
     return it != cacheCoins.end();
 }
 
+bool CCoinsViewCache::HaveNullifierInCache(const uint256 &nullifier, ShieldedType type) const {
+    switch (type) {
+        case SPROUT:
+            return cacheSproutNullifiers.count(nullifier);
+        case SAPLING:
+            return cacheSaplingNullifiers.count(nullifier);
+        default:
+            throw std::runtime_error("Unknown shielded type");
+    }
+}
+
+void CCoinsViewCache::AddPrefetchedCoins(const uint256 &txid, CCoins &coins) {
+    std::pair<CCoinsMap::iterator, bool> ret = cacheCoins.insert(std::make_pair(txid, CCoinsCacheEntry()));
+    if (!ret.second) {
+        return;
+    }
+    coins.swap(ret.first->second.coins);
+    if (ret.first->second.coins.IsPruned()) {
+        // As in FetchCoins().
+        ret.first->second.flags = CCoinsCacheEntry::FRESH;
+    }
+    cachedCoinsUsage += ret.first->second.coins.DynamicMemoryUsage();
+}
+
+void CCoinsViewCache::AddPrefetchedNullifier(const uint256 &nullifier, ShieldedType type, bool spent) {
+    CNullifiersCacheEntry entry;
+    entry.entered = spent;
+    switch (type) {
+        case SPROUT:
+            cacheSproutNullifiers.insert(std::make_pair(nullifier, entry));
+            break;
+        case SAPLING:
+            cacheSaplingNullifiers.insert(std::make_pair(nullifier, entry));
+            break;
+        default:
+            throw std::runtime_error("Unknown shielded type");
+    }
+}
+
 uint256 CCoinsViewCache::GetBestBlock() const {
     if (hashBlock.IsNull())
         hashBlock = base->GetBestBlock();
@@ -458,15 +531,26 @@ void BatchWriteAnchors(
                 MapEntry& entry = cacheAnchors[child_it->first];
                 entry.entered = child_it->second.entered;
                 entry.tree = child_it->second.tree;
+                entry.parent = child_it->second.parent;
+                entry.appended.swap(child_it->second.appended);
                 entry.flags = MapEntry::DIRTY;
 
-                cachedCoinsUsage += entry.tree.DynamicMemoryUsage();
+                cachedCoinsUsage += entry.DynamicMemoryUsage();
             } else {
                 if (parent_it->second.entered != child_it->second.entered) {
                     // The parent may have removed the entry.
                     parent_it->second.entered = child_it->second.entered;
                     parent_it->second.flags |= MapEntry::DIRTY;
                 }
+                if (child_it->second.entered) {
+                    // Take the child's tree and delta, which may describe
+                    // an anchor that was removed and pushed back.
+                    cachedCoinsUsage -= parent_it->second.DynamicMemoryUsage();
+                    parent_it->second.tree = child_it->second.tree;
+                    parent_it->second.parent = child_it->second.parent;
+                    parent_it->second.appended.swap(child_it->second.appended);
+                    cachedCoinsUsage += parent_it->second.DynamicMemoryUsage();
+                }
             }
         }
 
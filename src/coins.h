@@ -6,6 +6,7 @@
 #ifndef BITCOIN_COINS_H
 #define BITCOIN_COINS_H
 
+#include "compacthashmap.h"
 #include "compressor.h"
 #include "core_memusage.h"
 #include "hash.h"
@@ -279,12 +280,20 @@ struct CAnchorsSproutCacheEntry
     bool entered; // This will be false if the anchor is removed from the cache
     SproutMerkleTree tree; // The tree itself
     unsigned char flags;
+    // If `parent` is set, `tree` is the tree at `parent` with `appended`
+    // commitments added, which lets the database store it as a delta.
+    uint256 parent;
+    std::vector<libzcash::SHA256Compress> appended;
 
     enum Flags {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
     };
 
     CAnchorsSproutCacheEntry() : entered(false), flags(0) {}
+
+    size_t DynamicMemoryUsage() const {
+        return tree.DynamicMemoryUsage() + memusage::DynamicUsage(appended);
+    }
 };
 
 struct CAnchorsSaplingCacheEntry
@@ -292,12 +301,20 @@ struct CAnchorsSaplingCacheEntry
     bool entered; // This will be false if the anchor is removed from the cache
     SaplingMerkleTree tree; // The tree itself
     unsigned char flags;
+    // If `parent` is set, `tree` is the tree at `parent` with `appended`
+    // commitments added, which lets the database store it as a delta.
+    uint256 parent;
+    std::vector<libzcash::PedersenHash> appended;
 
     enum Flags {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
     };
 
     CAnchorsSaplingCacheEntry() : entered(false), flags(0) {}
+
+    size_t DynamicMemoryUsage() const {
+        return tree.DynamicMemoryUsage() + memusage::DynamicUsage(appended);
+    }
 };
 
 struct CNullifiersCacheEntry
@@ -318,7 +335,7 @@ enum ShieldedType
     SAPLING,
 };
 
-typedef std::unordered_map<uint256, CCoinsCacheEntry, SaltedTxidHasher> CCoinsMap;
+typedef compacthashmap<uint256, CCoinsCacheEntry, SaltedTxidHasher> CCoinsMap;
 typedef std::unordered_map<uint256, CAnchorsSproutCacheEntry, SaltedTxidHasher> CAnchorsSproutMap;
 typedef std::unordered_map<uint256, CAnchorsSaplingCacheEntry, SaltedTxidHasher> CAnchorsSaplingMap;
 typedef std::unordered_map<uint256, CNullifiersCacheEntry, SaltedTxidHasher> CNullifiersMap;
@@ -483,6 +500,12 @@ public:
     // and sets the current commitment root to this root.
     template<typename Tree> void PushAnchor(const Tree &tree);
 
+    // As above, for a tree that is the current best tree with `appended`
+    // commitments added. This allows the anchor to be stored as a delta
+    // against its parent instead of as a full frontier.
+    void PushAnchor(const SproutMerkleTree &tree, const std::vector<libzcash::SHA256Compress> &appended);
+    void PushAnchor(const SaplingMerkleTree &tree, const std::vector<libzcash::PedersenHash> &appended);
+
     // Removes the current commitment root from mapAnchors and sets
     // the new current root.
     void PopAnchor(const uint256 &rt, ShieldedType type);
@@ -497,6 +520,19 @@ public:
      */
     bool HaveCoinsInCache(const uint256 &txid) const;
 
+    //! As HaveCoinsInCache(), for whether a nullifier is spent
+    bool HaveNullifierInCache(const uint256 &nullifier, ShieldedType type) const;
+
+    /**
+     * Add coins read from the backing CCoinsView ahead of use, unless the
+     * cache already has an entry for the txid. The backing view must not
+     * have been modified since they were read.
+     */
+    void AddPrefetchedCoins(const uint256 &txid, CCoins &coins);
+
+    //! As AddPrefetchedCoins(), for whether a nullifier is spent
+    void AddPrefetchedNullifier(const uint256 &nullifier, ShieldedType type, bool spent);
+
     /**
      * Return a pointer to CCoins in the cache, or NULL if not found. This is
      * more efficient than GetCoins. Modifications to other cache entries are
@@ -579,9 +615,10 @@ private:
     );
 
     //! Generalized interface for pushing anchors
-    template<typename Tree, typename Cache, typename CacheIterator, typename CacheEntry>
+    template<typename Tree, typename Cache, typename CacheIterator, typename CacheEntry, typename Hash>
     void AbstractPushAnchor(
         const Tree &tree,
+        const std::vector<Hash> *appended,
         ShieldedType type,
         Cache &cacheAnchors,
         uint256 &hash
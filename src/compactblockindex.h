@@ -0,0 +1,112 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_COMPACTBLOCKINDEX_H
+#define BITCOIN_COMPACTBLOCKINDEX_H
+
+#include "primitives/block.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+/** Size of the leading part of a Sapling note's encCiphertext that light
+ *  wallets trial-decrypt: lead byte, diversifier, value and rseed. */
+static const size_t COMPACT_NOTE_CIPHERTEXT_SIZE = 52;
+
+/** The parts of a Sapling output a light wallet needs to detect its notes. */
+struct CCompactSaplingOutput {
+    uint256 cmu;
+    uint256 ephemeralKey;
+    std::array<unsigned char, COMPACT_NOTE_CIPHERTEXT_SIZE> ciphertext;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(cmu);
+        READWRITE(ephemeralKey);
+        READWRITE(ciphertext);
+    }
+
+    CCompactSaplingOutput() : ciphertext() {}
+
+    explicit CCompactSaplingOutput(const OutputDescription& output) :
+        cmu(output.cmu), ephemeralKey(output.ephemeralKey)
+    {
+        std::copy(output.encCiphertext.begin(), output.encCiphertext.begin() + COMPACT_NOTE_CIPHERTEXT_SIZE, ciphertext.begin());
+    }
+};
+
+/** A transaction with Sapling spends or outputs, reduced to the nullifiers
+ *  it reveals and its compact outputs. */
+struct CCompactTx {
+    uint32_t nIndex;  //!< Position of the transaction in its block
+    uint256 txid;
+    std::vector<uint256> vNullifiers;
+    std::vector<CCompactSaplingOutput> vOutputs;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(VARINT(nIndex));
+        READWRITE(txid);
+        READWRITE(vNullifiers);
+        READWRITE(vOutputs);
+    }
+
+    CCompactTx() : nIndex(0) {}
+};
+
+/**
+ * Compact record of a block's Sapling data, as served to light wallet
+ * servers in place of the full block. Written to the block tree database at
+ * connect time when -compactblockindex is enabled, keyed by block hash.
+ */
+struct CCompactBlock {
+    int nHeight;
+    uint256 hash;
+    uint256 hashPrevBlock;
+    uint32_t nTime;
+    std::vector<CCompactTx> vtx;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nHeight);
+        READWRITE(hash);
+        READWRITE(hashPrevBlock);
+        READWRITE(nTime);
+        READWRITE(vtx);
+    }
+
+    CCompactBlock() : nHeight(0), nTime(0) {}
+
+    CCompactBlock(const CBlock& block, int nHeightIn) :
+        nHeight(nHeightIn), hash(block.GetHash()), hashPrevBlock(block.hashPrevBlock), nTime(block.nTime)
+    {
+        for (size_t i = 0; i < block.vtx.size(); i++) {
+            const CTransaction& tx = block.vtx[i];
+            if (tx.vShieldedSpend.empty() && tx.vShieldedOutput.empty())
+                continue;
+
+            vtx.emplace_back();
+            CCompactTx& ctx = vtx.back();
+            ctx.nIndex = i;
+            ctx.txid = tx.GetHash();
+            ctx.vNullifiers.reserve(tx.vShieldedSpend.size());
+            for (const SpendDescription& spend : tx.vShieldedSpend)
+                ctx.vNullifiers.push_back(spend.nullifier);
+            ctx.vOutputs.reserve(tx.vShieldedOutput.size());
+            for (const OutputDescription& output : tx.vShieldedOutput)
+                ctx.vOutputs.emplace_back(output);
+        }
+    }
+};
+
+#endif // BITCOIN_COMPACTBLOCKINDEX_H
@@ -0,0 +1,282 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_COMPACTHASHMAP_H
+#define BITCOIN_COMPACTHASHMAP_H
+
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * A hash map with the subset of the std::unordered_map interface used for
+ * coin caches, laid out to hold many entries with little overhead:
+ *
+ * - Entries are constructed in place in fixed-size chunks and never move, so
+ *   pointers and iterators to an entry stay valid until it is erased, as with
+ *   std::unordered_map, but without an allocation per entry.
+ * - Keys are found through an open-addressing (linear probing) index of 64-bit
+ *   slots holding 32 bits of the key's hash and the entry's position. Most
+ *   probes that do not match are rejected without touching the entry, and
+ *   growing the index does not rehash any key.
+ *
+ * Iteration order is unspecified. Erasing an entry does not invalidate
+ * iterators to other entries, and its position is reused by later inserts.
+ */
+template <typename K, typename T, typename Hash>
+class compacthashmap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    static const size_t CHUNK_SIZE = 64;
+    static const size_t MIN_SLOTS = 16;
+    typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage_type;
+
+    Hash hasher;
+    std::vector<uint64_t> slots; // 0 if empty, else (hash << 32) | (position + 1)
+    std::vector<std::unique_ptr<storage_type[]>> chunks;
+    std::vector<bool> used; // For each position handed out
+    std::vector<uint32_t> vFree;
+    size_t nSize;
+
+    value_type* at(size_t pos) { return reinterpret_cast<value_type*>(&chunks[pos / CHUNK_SIZE][pos % CHUNK_SIZE]); }
+    const value_type* at(size_t pos) const { return reinterpret_cast<const value_type*>(&chunks[pos / CHUNK_SIZE][pos % CHUNK_SIZE]); }
+
+    uint32_t HashKey(const K& key) const
+    {
+        uint64_t h = hasher(key);
+        return (uint32_t)(h >> 32) ^ (uint32_t)h;
+    }
+
+    size_t Mask() const { return slots.size() - 1; }
+
+    /**
+     * Find the slot of key. If it is absent, return false and set slot to the
+     * empty slot where it would be inserted.
+     */
+    bool Lookup(const K& key, uint32_t h, size_t& slot) const
+    {
+        const uint64_t tag = (uint64_t)h << 32;
+        for (slot = h & Mask(); slots[slot]; slot = (slot + 1) & Mask()) {
+            if ((slots[slot] & 0xffffffff00000000ULL) == tag && at((slots[slot] & 0xffffffff) - 1)->first == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Grow()
+    {
+        std::vector<uint64_t> old(slots.size() * 2, 0);
+        old.swap(slots);
+        for (uint64_t s : old) {
+            if (s) {
+                size_t i = (s >> 32) & Mask();
+                while (slots[i]) {
+                    i = (i + 1) & Mask();
+                }
+                slots[i] = s;
+            }
+        }
+    }
+
+    template <typename... Args>
+    size_t Construct(uint32_t h, Args&&... args)
+    {
+        if ((nSize + 1) * 4 > slots.size() * 3) {
+            Grow();
+        }
+        size_t pos;
+        if (!vFree.empty()) {
+            pos = vFree.back();
+            vFree.pop_back();
+        } else {
+            pos = used.size();
+            if (pos / CHUNK_SIZE == chunks.size()) {
+                chunks.emplace_back(new storage_type[CHUNK_SIZE]);
+            }
+            used.push_back(false);
+        }
+        new (at(pos)) value_type(std::forward<Args>(args)...);
+        used[pos] = true;
+
+        size_t i = h & Mask();
+        while (slots[i]) {
+            i = (i + 1) & Mask();
+        }
+        slots[i] = ((uint64_t)h << 32) | (pos + 1);
+        nSize++;
+        return pos;
+    }
+
+    void Destroy(size_t pos)
+    {
+        // Shift back later entries of the probe sequence so that none of them
+        // is left behind an empty slot.
+        size_t i = HashKey(at(pos)->first) & Mask();
+        while ((slots[i] & 0xffffffff) != pos + 1) {
+            i = (i + 1) & Mask();
+        }
+        for (size_t j = (i + 1) & Mask(); slots[j]; j = (j + 1) & Mask()) {
+            size_t home = (slots[j] >> 32) & Mask();
+            if (((j - home) & Mask()) >= ((j - i) & Mask())) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i] = 0;
+
+        at(pos)->~value_type();
+        used[pos] = false;
+        vFree.push_back(pos);
+        nSize--;
+    }
+
+    template <bool Const>
+    class iter
+    {
+        friend class compacthashmap;
+        typedef typename std::conditional<Const, const compacthashmap, compacthashmap>::type map_type;
+
+        map_type* map;
+        size_t pos;
+
+        iter(map_type* mapIn, size_t posIn) : map(mapIn), pos(posIn) {}
+        void SkipUnused() { while (pos < map->used.size() && !map->used[pos]) pos++; }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename compacthashmap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<Const, const value_type*, value_type*>::type pointer;
+        typedef typename std::conditional<Const, const value_type&, value_type&>::type reference;
+
+        iter() : map(nullptr), pos(0) {}
+        template <bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+        iter(const iter<OtherConst>& other) : map(other.map), pos(other.pos) {}
+
+        reference operator*() const { return *map->at(pos); }
+        pointer operator->() const { return map->at(pos); }
+        iter& operator++() { pos++; SkipUnused(); return *this; }
+        iter operator++(int) { iter copy(*this); ++(*this); return copy; }
+        template <bool OtherConst>
+        bool operator==(const iter<OtherConst>& other) const { return pos == other.pos; }
+        template <bool OtherConst>
+        bool operator!=(const iter<OtherConst>& other) const { return pos != other.pos; }
+
+        template <bool> friend class iter;
+    };
+
+public:
+    typedef iter<false> iterator;
+    typedef iter<true> const_iterator;
+
+    compacthashmap() : slots(MIN_SLOTS, 0), nSize(0) {}
+    compacthashmap(const compacthashmap&) = delete;
+    compacthashmap& operator=(const compacthashmap&) = delete;
+    ~compacthashmap() { clear(); }
+
+    iterator begin() { iterator it(this, 0); it.SkipUnused(); return it; }
+    const_iterator begin() const { const_iterator it(this, 0); it.SkipUnused(); return it; }
+    iterator end() { return iterator(this, used.size()); }
+    const_iterator end() const { return const_iterator(this, used.size()); }
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+    size_t bucket_count() const { return slots.size(); }
+
+    iterator find(const K& key)
+    {
+        size_t slot;
+        return Lookup(key, HashKey(key), slot) ? iterator(this, (slots[slot] & 0xffffffff) - 1) : end();
+    }
+
+    const_iterator find(const K& key) const
+    {
+        size_t slot;
+        return Lookup(key, HashKey(key), slot) ? const_iterator(this, (slots[slot] & 0xffffffff) - 1) : end();
+    }
+
+    size_t count(const K& key) const
+    {
+        size_t slot;
+        return Lookup(key, HashKey(key), slot) ? 1 : 0;
+    }
+
+    template <typename P>
+    std::pair<iterator, bool> insert(P&& value)
+    {
+        uint32_t h = HashKey(value.first);
+        size_t slot;
+        if (Lookup(value.first, h, slot)) {
+            return std::make_pair(iterator(this, (slots[slot] & 0xffffffff) - 1), false);
+        }
+        return std::make_pair(iterator(this, Construct(h, std::forward<P>(value))), true);
+    }
+
+    T& operator[](const K& key)
+    {
+        uint32_t h = HashKey(key);
+        size_t slot;
+        if (Lookup(key, h, slot)) {
+            return at((slots[slot] & 0xffffffff) - 1)->second;
+        }
+        return at(Construct(h, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()))->second;
+    }
+
+    iterator erase(const_iterator it)
+    {
+        iterator next(this, it.pos);
+        ++next;
+        Destroy(it.pos);
+        return next;
+    }
+
+    iterator erase(iterator it)
+    {
+        return erase(const_iterator(it));
+    }
+
+    size_t erase(const K& key)
+    {
+        iterator it = find(key);
+        if (it == end()) {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    void clear()
+    {
+        for (size_t pos = 0; pos < used.size(); pos++) {
+            if (used[pos]) {
+                at(pos)->~value_type();
+            }
+        }
+        std::vector<uint64_t>(MIN_SLOTS, 0).swap(slots);
+        chunks.clear();
+        std::vector<bool>().swap(used);
+        std::vector<uint32_t>().swap(vFree);
+        nSize = 0;
+    }
+
+    //! Allocation sizes, for memusage::DynamicUsage()
+    size_t chunk_count() const { return chunks.size(); }
+    static size_t chunk_bytes() { return sizeof(storage_type) * CHUNK_SIZE; }
+    size_t position_count() const { return used.size(); }
+    size_t free_count() const { return vFree.size(); }
+};
+
+#endif // BITCOIN_COMPACTHASHMAP_H
@@ -25,6 +25,10 @@
 #include <optional>
 #include <stdexcept>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 static EhSolverCancelledException solver_cancelled;
 
 template<unsigned int N, unsigned int K>
@@ -721,52 +725,135 @@ invalidsolution:
 }
 #endif // ENABLE_MINING
 
+// Returns whether x[2i] == x[2i+1] for all i < nPairs.
+static inline bool PairsCollide(const uint32_t* x, size_t nPairs)
+{
+    size_t i = 0;
+    uint32_t diff = 0;
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 2 <= nPairs; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(x + 2*i));
+        acc = _mm_or_si128(acc, _mm_xor_si128(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1))));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(acc, _mm_setzero_si128())) != 0xFFFF)
+        return false;
+#endif
+    for (; i < nPairs; i++)
+        diff |= x[2*i] ^ x[2*i+1];
+    return diff == 0;
+}
+
+// Sets x[i] = x[2i] ^ x[2i+1] for all i < nPairs.
+static inline void XorPairs(uint32_t* x, size_t nPairs)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= nPairs; i += 4) {
+        __m128 v0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(x + 2*i)));
+        __m128 v1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(x + 2*i + 4)));
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd = _mm_castps_si128(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_si128((__m128i*)(x + i), _mm_xor_si128(even, odd));
+    }
+#endif
+    for (; i < nPairs; i++)
+        x[i] = x[2*i] ^ x[2*i+1];
+}
+
 template<unsigned int N, unsigned int K>
-bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln)
+bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln)
 {
+    static_assert(N % (K+1) == 0);
+    enum : size_t { Leaves=1 << K };
+    const uint32_t indexMask = ((uint32_t)1 << (CollisionBitLength+1)) - 1;
+    const uint32_t digitMask = ((uint32_t)1 << CollisionBitLength) - 1;
+
     if (soln.size() != SolutionWidth) {
         LogPrint(BCLog::POW, "Invalid solution length: %d (expected %d)\n",
                  soln.size(), SolutionWidth);
         return false;
     }
 
-    std::vector<FullStepRow<FinalFullWidth>> X;
-    X.reserve(1 << K);
-    unsigned char tmpHash[HashOutput];
-    for (eh_index i : GetIndicesFromMinimal(soln, CollisionBitLength)) {
-        GenerateHash(base_state, i/IndicesPerHashOutput, tmpHash, HashOutput);
-        X.emplace_back(tmpHash+((i % IndicesPerHashOutput) * N/8),
-                       N/8, HashLength, CollisionBitLength, i);
+    // Unpack the indices of the leaves, in tree order.
+    eh_index indices[Leaves];
+    {
+        uint64_t acc = 0;
+        size_t accBits = 0;
+        size_t j = 0;
+        for (unsigned char c : soln) {
+            acc = (acc << 8) | c;
+            accBits += 8;
+            if (accBits >= CollisionBitLength+1) {
+                accBits -= CollisionBitLength+1;
+                indices[j++] = (acc >> accBits) & indexMask;
+            }
+        }
+        assert(j == Leaves);
     }
 
-    size_t hashLen = HashLength;
-    size_t lenIndices = sizeof(eh_index);
-    while (X.size() > 1) {
-        std::vector<FullStepRow<FinalFullWidth>> Xc;
-        for (int i = 0; i < X.size(); i += 2) {
-            if (!HasCollision(X[i], X[i+1], CollisionByteLength)) {
-                LogPrint(BCLog::POW, "Invalid solution: invalid collision length between StepRows\n");
-                LogPrint(BCLog::POW, "X[i]   = %s\n", X[i].GetHex(hashLen));
-                LogPrint(BCLog::POW, "X[i+1] = %s\n", X[i+1].GetHex(hashLen));
+    // Hash the leaves in index order, so that duplicate indices are adjacent
+    // and indices sharing a BLAKE2b output are hashed once. The digits of the
+    // leaves are stored digit-major, one per word: X[d][leaf].
+    uint32_t order[Leaves];
+    for (size_t j = 0; j < Leaves; j++)
+        order[j] = j;
+    std::sort(order, order+Leaves, [&indices](uint32_t a, uint32_t b) { return indices[a] < indices[b]; });
+
+    alignas(16) uint32_t X[K+1][Leaves];
+    unsigned char tmpHash[HashOutput];
+    for (size_t j = 0; j < Leaves; j++) {
+        eh_index i = indices[order[j]];
+        if (j > 0) {
+            eh_index iPrev = indices[order[j-1]];
+            if (i == iPrev) {
+                LogPrint(BCLog::POW, "Invalid solution: duplicate indices\n");
                 return false;
             }
-            if (X[i+1].IndicesBefore(X[i], hashLen, lenIndices)) {
-                LogPrint(BCLog::POW, "Invalid solution: Index tree incorrectly ordered\n");
-                return false;
+            if (i/IndicesPerHashOutput != iPrev/IndicesPerHashOutput)
+                GenerateHash(base_state, i/IndicesPerHashOutput, tmpHash, HashOutput);
+        } else {
+            GenerateHash(base_state, i/IndicesPerHashOutput, tmpHash, HashOutput);
+        }
+
+        const unsigned char* leaf = tmpHash + (i % IndicesPerHashOutput)*N/8;
+        uint64_t acc = 0;
+        size_t accBits = 0;
+        size_t d = 0;
+        for (size_t b = 0; b < N/8; b++) {
+            acc = (acc << 8) | leaf[b];
+            accBits += 8;
+            if (accBits >= CollisionBitLength) {
+                accBits -= CollisionBitLength;
+                X[d++][order[j]] = (acc >> accBits) & digitMask;
             }
-            if (!DistinctIndices(X[i], X[i+1], hashLen, lenIndices)) {
-                LogPrint(BCLog::POW, "Invalid solution: duplicate indices\n");
+        }
+    }
+
+    // Each round pairs up the subtrees of the previous one, in place: the
+    // pair must collide on digit r, the left subtree must have the smaller
+    // first index, and the remaining digits of the parent are the XOR of the
+    // pair's.
+    eh_index* first = indices;
+    size_t nPairs = Leaves;
+    for (size_t r = 0; r < K; r++) {
+        nPairs /= 2;
+        if (!PairsCollide(X[r], nPairs)) {
+            LogPrint(BCLog::POW, "Invalid solution: invalid collision length between StepRows\n");
+            return false;
+        }
+        for (size_t j = 0; j < nPairs; j++) {
+            if (first[2*j+1] < first[2*j]) {
+                LogPrint(BCLog::POW, "Invalid solution: Index tree incorrectly ordered\n");
                 return false;
             }
-            Xc.emplace_back(X[i], X[i+1], hashLen, lenIndices, CollisionByteLength);
+            first[j] = first[2*j];
         }
-        X = Xc;
-        hashLen -= CollisionByteLength;
-        lenIndices *= 2;
+        for (size_t d = r+1; d <= K; d++)
+            XorPairs(X[d], nPairs);
     }
 
-    assert(X.size() == 1);
-    return X[0].IsZero(hashLen);
+    return X[K][0] == 0;
 }
 
 // Explicit instantiations for Equihash<96,3>
@@ -779,7 +866,7 @@ template bool Equihash<96,3>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<96,3>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<96,3>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<144,5>
 template int Equihash<144,5>::InitialiseState(eh_HashState& base_state);
@@ -791,7 +878,7 @@ template bool Equihash<144,5>::OptimisedSolve(const eh_HashState& base_state,
                                               const std::function<bool(std::vector<unsigned char>)> validBlock,
                                               const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<144,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<144,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 
 // Explicit instantiations for Equihash<200,9>
@@ -804,7 +891,7 @@ template bool Equihash<200,9>::OptimisedSolve(const eh_HashState& base_state,
                                               const std::function<bool(std::vector<unsigned char>)> validBlock,
                                               const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<96,5>
 template int Equihash<96,5>::InitialiseState(eh_HashState& base_state);
@@ -816,7 +903,7 @@ template bool Equihash<96,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<96,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<96,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<48,5>
 template int Equihash<48,5>::InitialiseState(eh_HashState& base_state);
@@ -828,4 +915,4 @@ template bool Equihash<48,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
@@ -189,7 +189,11 @@ public:
                         const std::function<bool(std::vector<unsigned char>)> validBlock,
                         const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-    bool IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+    /**
+     * Check a solution without allocating: all intermediate state is in
+     * fixed-size arrays sized from N and K.
+     */
+    bool IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 };
 
 #include "equihash.tcc"
@@ -133,7 +133,11 @@ CDBWrapper::~CDBWrapper()
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
-    leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    leveldb::Status status;
+    {
+        PerfTimer timer(dbwrapper_private::histWriteBatch);
+        status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    }
     dbwrapper_private::HandleError(status);
     return true;
 }
@@ -152,6 +156,9 @@ void CDBIterator::Next() { piter->Next(); }
 
 namespace dbwrapper_private {
 
+PerfHistogram& histRead = GetPerfHistogram("leveldb_read_seconds", "Time spent reading from LevelDB databases");
+PerfHistogram& histWriteBatch = GetPerfHistogram("leveldb_write_batch_seconds", "Time spent writing batches to LevelDB databases");
+
 void HandleError(const leveldb::Status& status)
 {
     if (status.ok())
@@ -7,6 +7,7 @@
 
 #include "clientversion.h"
 #include "fs.h"
+#include "perfstats.h"
 #include "serialize.h"
 #include "streams.h"
 #include "util.h"
@@ -34,6 +35,10 @@ namespace dbwrapper_private {
  */
 void HandleError(const leveldb::Status& status);
 
+/** Time spent in LevelDB reads and batch writes, across all databases */
+extern PerfHistogram& histRead;
+extern PerfHistogram& histWriteBatch;
+
 };
 
 /** Batch of changes queued to be written to a CDBWrapper */
@@ -76,6 +81,8 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
         batch.Delete(slKey);
     }
+
+    size_t SizeEstimate() const { return batch.ApproximateSize(); }
 };
 
 class CDBIterator
@@ -179,7 +186,11 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status;
+        {
+            PerfTimer timer(dbwrapper_private::histRead);
+            status = pdb->Get(readoptions, slKey, &strValue);
+        }
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -212,7 +223,11 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status;
+        {
+            PerfTimer timer(dbwrapper_private::histRead);
+            status = pdb->Get(readoptions, slKey, &strValue);
+        }
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
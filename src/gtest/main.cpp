@@ -1,5 +1,6 @@
 #include "gmock/gmock.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "key.h"
 #include "pubkey.h"
 #include "script/sigcache.h"
@@ -18,6 +19,7 @@ ECCryptoClosure instance_of_eccryptoclosure;
 
 int main(int argc, char **argv) {
   assert(init_and_check_sodium() != -1);
+  SHA256AutoDetect();
   ECC_Start();
   InitSignatureCache();
 
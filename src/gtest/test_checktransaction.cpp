@@ -565,6 +565,32 @@ TEST(ChecktransactionTests, NonCanonicalEd25519Signature) {
     ContextualCheckTransaction(tx, state, chainparams, 0, 100, [](const CChainParams&) { return false; });
 }
 
+TEST(ChecktransactionTests, JoinSplitSignatureCache) {
+    SelectParams(CBaseChainParams::REGTEST);
+    auto chainparams = Params();
+    auto notIBD = [](const CChainParams&) { return false; };
+
+    CTransaction tx(GetValidTransaction());
+    CSignatureCacheStats before = GetSignatureCacheStats(SIGCACHE_JOINSPLIT);
+
+    // Checking the transaction for a block does not store the signature, but
+    // checking it for the mempool does, and a later check for a block hits.
+    MockCValidationState state;
+    EXPECT_TRUE(ContextualCheckTransaction(tx, state, chainparams, 0, 100, notIBD, false));
+    EXPECT_TRUE(ContextualCheckTransaction(tx, state, chainparams, 0, 100, notIBD, true));
+    EXPECT_TRUE(ContextualCheckTransaction(tx, state, chainparams, 0, 100, notIBD, false));
+    CSignatureCacheStats after = GetSignatureCacheStats(SIGCACHE_JOINSPLIT);
+    EXPECT_EQ(before.nMisses + 2, after.nMisses);
+    EXPECT_EQ(before.nHits + 1, after.nHits);
+
+    // The cached result does not cover a different signature
+    CMutableTransaction mtx(tx);
+    mtx.joinSplitSig[0] += 1;
+    CTransaction badTx(mtx);
+    EXPECT_CALL(state, DoS(100, false, REJECT_INVALID, "bad-txns-invalid-joinsplit-signature", false, "")).Times(1);
+    EXPECT_FALSE(ContextualCheckTransaction(badTx, state, chainparams, 0, 100, notIBD, true));
+}
+
 TEST(ChecktransactionTests, OverwinterConstructors) {
     CMutableTransaction mtx;
     mtx.fOverwintered = true;
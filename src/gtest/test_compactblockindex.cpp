@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include "compactblockindex.h"
+#include "random.h"
+#include "streams.h"
+#include "version.h"
+
+static CMutableTransaction SaplingTx(size_t nSpends, size_t nOutputs)
+{
+    CMutableTransaction mtx;
+    mtx.fOverwintered = true;
+    mtx.nVersion = SAPLING_TX_VERSION;
+    mtx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
+    for (size_t i = 0; i < nSpends; i++) {
+        SpendDescription spend;
+        spend.nullifier = GetRandHash();
+        mtx.vShieldedSpend.push_back(spend);
+    }
+    for (size_t i = 0; i < nOutputs; i++) {
+        OutputDescription output;
+        output.cmu = GetRandHash();
+        output.ephemeralKey = GetRandHash();
+        GetRandBytes(output.encCiphertext.data(), output.encCiphertext.size());
+        mtx.vShieldedOutput.push_back(output);
+    }
+    return mtx;
+}
+
+TEST(CompactBlockIndex, KeepsOnlySaplingData) {
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.resize(1);
+
+    CBlock block;
+    block.hashPrevBlock = GetRandHash();
+    block.nTime = 1234567890;
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(SaplingTx(2, 0));
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(SaplingTx(1, 3));
+
+    CCompactBlock compact(block, 42);
+    EXPECT_EQ(42, compact.nHeight);
+    EXPECT_EQ(block.GetHash(), compact.hash);
+    EXPECT_EQ(block.hashPrevBlock, compact.hashPrevBlock);
+    EXPECT_EQ(block.nTime, compact.nTime);
+
+    // Transactions without Sapling spends or outputs are left out
+    ASSERT_EQ(2, compact.vtx.size());
+    EXPECT_EQ(1, compact.vtx[0].nIndex);
+    EXPECT_EQ(3, compact.vtx[1].nIndex);
+
+    for (const CCompactTx& ctx : compact.vtx) {
+        const CTransaction& tx = block.vtx[ctx.nIndex];
+        EXPECT_EQ(tx.GetHash(), ctx.txid);
+        ASSERT_EQ(tx.vShieldedSpend.size(), ctx.vNullifiers.size());
+        for (size_t i = 0; i < ctx.vNullifiers.size(); i++) {
+            EXPECT_EQ(tx.vShieldedSpend[i].nullifier, ctx.vNullifiers[i]);
+        }
+        ASSERT_EQ(tx.vShieldedOutput.size(), ctx.vOutputs.size());
+        for (size_t i = 0; i < ctx.vOutputs.size(); i++) {
+            const OutputDescription& output = tx.vShieldedOutput[i];
+            EXPECT_EQ(output.cmu, ctx.vOutputs[i].cmu);
+            EXPECT_EQ(output.ephemeralKey, ctx.vOutputs[i].ephemeralKey);
+            EXPECT_TRUE(std::equal(ctx.vOutputs[i].ciphertext.begin(), ctx.vOutputs[i].ciphertext.end(),
+                                   output.encCiphertext.begin()));
+        }
+    }
+}
+
+TEST(CompactBlockIndex, SerializationRoundTrip) {
+    CBlock block;
+    block.vtx.push_back(SaplingTx(1, 2));
+    CCompactBlock compact(block, 7);
+
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << compact;
+    // 4 height + 32 hash + 32 prev + 4 time + 1 count
+    // + 1 index + 32 txid + 1 + 32 nullifier + 1 + 2 * (32 + 32 + 52)
+    EXPECT_EQ(4 + 32 + 32 + 4 + 1 + 1 + 32 + 1 + 32 + 1 + 2 * 116, ss.size());
+
+    CCompactBlock decoded;
+    ss >> decoded;
+    EXPECT_EQ(compact.nHeight, decoded.nHeight);
+    EXPECT_EQ(compact.hash, decoded.hash);
+    ASSERT_EQ(1, decoded.vtx.size());
+    EXPECT_EQ(compact.vtx[0].txid, decoded.vtx[0].txid);
+    EXPECT_EQ(compact.vtx[0].vNullifiers, decoded.vtx[0].vNullifiers);
+    ASSERT_EQ(2, decoded.vtx[0].vOutputs.size());
+    EXPECT_EQ(compact.vtx[0].vOutputs[1].cmu, decoded.vtx[0].vOutputs[1].cmu);
+    EXPECT_EQ(compact.vtx[0].vOutputs[1].ciphertext, decoded.vtx[0].vOutputs[1].ciphertext);
+}
@@ -284,3 +284,86 @@ TEST(merkletree, testZeroElements) {
         ASSERT_TRUE(newTree.root() == oldroot);
     }
 }
+
+template<typename Tree, typename Hash>
+void test_append_batch(UniValue commitment_tests, UniValue root_tests)
+{
+    // Split the test commitments into batches of every size up to the
+    // capacity of the tree, and check each batched tree against the
+    // test vectors and against the same tree built with append().
+    for (size_t batch_size = 1; batch_size <= 16; batch_size++) {
+        Tree tree;
+        Tree expected;
+
+        for (size_t i = 0; i < 16; i += batch_size) {
+            std::vector<Hash> batch;
+            for (size_t j = i; j < std::min(i + batch_size, size_t(16)); j++) {
+                batch.push_back(uint256S(commitment_tests[j].get_str()));
+                expected.append(batch.back());
+            }
+
+            tree.append_batch(batch);
+
+            ASSERT_TRUE(tree == expected);
+            ASSERT_TRUE(tree.size() == expected.size());
+            ASSERT_TRUE(tree.last() == expected.last());
+            expect_test_vector(root_tests[tree.size() - 1], tree.root());
+        }
+
+        // Appending an empty batch is a no-op
+        tree.append_batch({});
+        ASSERT_TRUE(tree == expected);
+
+        // Tree should be full now, and a failed batch must leave it untouched
+        ASSERT_THROW(tree.append_batch({uint256()}), std::runtime_error);
+        ASSERT_TRUE(tree == expected);
+    }
+
+    {
+        // A batch that does not fit is rejected as a whole
+        Tree tree;
+        tree.append(uint256S(commitment_tests[0].get_str()));
+        auto root = tree.root();
+
+        std::vector<Hash> batch(16);
+        ASSERT_THROW(tree.append_batch(batch), std::runtime_error);
+        ASSERT_TRUE(tree.size() == 1);
+        ASSERT_TRUE(tree.root() == root);
+    }
+}
+
+TEST(merkletree, AppendBatch) {
+    UniValue root_tests = read_json(MAKE_STRING(json_tests::merkle_roots));
+    UniValue commitment_tests = read_json(MAKE_STRING(json_tests::merkle_commitments));
+
+    test_append_batch<SproutTestingMerkleTree, libzcash::SHA256Compress>(commitment_tests, root_tests);
+}
+
+TEST(merkletree, AppendBatchSapling) {
+    UniValue root_tests = read_json(MAKE_STRING(json_tests::merkle_roots_sapling));
+    UniValue commitment_tests = read_json(MAKE_STRING(json_tests::merkle_commitments_sapling));
+
+    test_append_batch<SaplingTestingMerkleTree, libzcash::PedersenHash>(commitment_tests, root_tests);
+}
+
+TEST(merkletree, CachedRootInvalidation) {
+    SproutMerkleTree tree;
+    ASSERT_TRUE(tree.root() == SproutMerkleTree::empty_root());
+
+    tree.append(uint256S("54d626e08c1c802b305dad30b7e54a82f102390cc92c7d4db112048935236e9c"));
+    auto root1 = tree.root();
+    ASSERT_TRUE(root1 != SproutMerkleTree::empty_root());
+
+    // Copies carry the cached root, but diverge once appended to
+    SproutMerkleTree copy = tree;
+    ASSERT_TRUE(copy.root() == root1);
+    copy.append(uint256S("8695873d63ec0bceeadb5bf4ccc6723ac803c1826fc7cfb34fc76180305ae27d"));
+    ASSERT_TRUE(copy.root() != root1);
+    ASSERT_TRUE(tree.root() == root1);
+
+    // Deserializing over a tree with a cached root replaces it
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << copy;
+    ss >> tree;
+    ASSERT_TRUE(tree.root() == copy.root());
+}
@@ -3,6 +3,8 @@
 #include "chainparams.h"
 #include "httpserver.h"
 #include "key_io.h"
+#include "perfstats.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -179,10 +181,39 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
-
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            // Send the reply as the result is written, so that a large one
+            // starts arriving early and is never held in memory as a whole
+            bool fReplyStarted = false;
+            const bool fCBOR = jreq.fCBOR;
+            JSONTextWriter::Sink sink = [req, fCBOR, &fReplyStarted](const std::string& strPart, bool fLast) {
+                if (!fReplyStarted)
+                    req->WriteHeader("Content-Type", fCBOR ? "application/cbor" : "application/json");
+                fReplyStarted = true;
+                req->WriteReplyPart(HTTP_OK, strPart, fLast);
+            };
+            std::unique_ptr<JSONWriter> writer;
+            if (fCBOR)
+                writer.reset(new CBORWriter(sink));
+            else
+                writer.reset(new JSONTextWriter(sink));
+            writer->BeginObject();
+            writer->Key("result");
+            try {
+                tableRPC.execute(jreq.strMethod, jreq.params, *writer);
+            } catch (...) {
+                if (!fReplyStarted)
+                    throw;
+                // Part of the result is already sent, so the only way left
+                // to report the error is to cut the reply short
+                LogPrintf("JSON-RPC %s failed partway through its reply\n", SanitizeString(jreq.strMethod));
+                req->WriteReplyPart(HTTP_OK, "", true);
+                return false;
+            }
+            writer->KV("error", NullUniValue);
+            writer->KV("id", jreq.id);
+            writer->EndObject();
+            writer->Finish();
+            return true;
 
         // array of requests
         } else if (valRequest.isArray())
@@ -249,3 +280,30 @@ void StopHTTPRPC()
         httpRPCTimerInterface = 0;
     }
 }
+
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string &)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Metrics are only served to GET requests");
+        return false;
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, FormatPerfStatsPrometheus(GetPerfStats()));
+    return true;
+}
+
+bool StartHTTPMetrics()
+{
+    LogPrint(BCLog::RPC, "Starting HTTP metrics endpoint\n");
+    RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics);
+    return true;
+}
+
+void InterruptHTTPMetrics()
+{
+}
+
+void StopHTTPMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
@@ -34,4 +34,16 @@ void InterruptREST();
  */
 void StopREST();
 
+/** Start serving performance stats at /metrics.
+ * Precondition; HTTP has been started.
+ */
+bool StartHTTPMetrics();
+/** Interrupt the /metrics endpoint.
+ */
+void InterruptHTTPMetrics();
+/** Stop serving performance stats at /metrics.
+ * Precondition; HTTP has been stopped.
+ */
+void StopHTTPMetrics();
+
 #endif
@@ -533,12 +533,17 @@ void HTTPEvent::trigger(struct timeval* tv)
         evtimer_add(ev, tv); // trigger after timeval passed
 }
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
-                                                       replySent(false)
+                                                       replySent(false),
+                                                       replyStarted(false)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (replyStarted && !replySent) {
+        // Finish a chunked reply cut short, the client will see it truncated
+        LogPrintf("%s: Unfinished reply\n", __func__);
+        WriteReplyPart(HTTP_INTERNAL, "", true);
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -603,6 +608,41 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+void HTTPRequest::WriteReplyPart(int nStatus, const std::string& strPart, bool fLast)
+{
+    assert(!replySent && req);
+    if (fLast && !replyStarted) {
+        WriteReply(nStatus, strPart);
+        return;
+    }
+
+    // Send events to main http thread to start the reply, send each part
+    // as a chunk in order, and end the reply after the last
+    struct evhttp_request* r = req;
+    if (!replyStarted) {
+        HTTPEvent* ev = new HTTPEvent(eventBase, true,
+            std::bind(evhttp_send_reply_start, r, nStatus, (const char*)NULL));
+        ev->trigger(0);
+        replyStarted = true;
+    }
+    if (!strPart.empty()) {
+        struct evbuffer* evb = evbuffer_new();
+        assert(evb);
+        evbuffer_add(evb, strPart.data(), strPart.size());
+        HTTPEvent* ev = new HTTPEvent(eventBase, true, [r, evb]() {
+            evhttp_send_reply_chunk(r, evb);
+            evbuffer_free(evb);
+        });
+        ev->trigger(0);
+    }
+    if (fLast) {
+        HTTPEvent* ev = new HTTPEvent(eventBase, true, std::bind(evhttp_send_reply_end, r));
+        ev->trigger(0);
+        replySent = true;
+        req = 0; // transferred back to main thread
+    }
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
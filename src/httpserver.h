@@ -58,6 +58,7 @@ private:
     // For test access
 protected:
     bool replySent;
+    bool replyStarted;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -113,6 +114,17 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     virtual void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write part of an HTTP reply whose body is produced piece by piece.
+     * A reply written as a single, last part is sent like WriteReply; a
+     * longer one is sent chunked, starting as soon as its first part is
+     * written. nStatus is only used for the first part.
+     *
+     * @note Like WriteReply, do not call any other HTTPRequest methods after
+     * writing the last part.
+     */
+    virtual void WriteReplyPart(int nStatus, const std::string& strPart, bool fLast);
 };
 
 /** Event handler closure.
@@ -9,8 +9,10 @@
 
 #include "init.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "addrman.h"
 #include "amount.h"
+#include "blockfilterindex.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/upgrades.h"
@@ -28,6 +30,7 @@
 #include "metrics.h"
 #include "miner.h"
 #include "net.h"
+#include "perfstats.h"
 #include "policy/policy.h"
 #include "rpc/server.h"
 #include "rpc/register.h"
@@ -71,6 +74,7 @@ using namespace boost::placeholders;
 bool fFeeEstimatesInitialized = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
+static const bool DEFAULT_METRICS_ENDPOINT = false;
 static const bool DEFAULT_DISABLE_SAFEMODE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
 
@@ -159,7 +163,6 @@ public:
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 static boost::scoped_ptr<ECCVerifyHandle> globalVerifyHandle;
 
@@ -172,6 +175,7 @@ void Interrupt()
     InterruptHTTPRPC();
     InterruptRPC();
     InterruptREST();
+    InterruptHTTPMetrics();
     InterruptTorControl();
 }
 
@@ -192,6 +196,7 @@ void Shutdown()
 
     StopHTTPRPC();
     StopREST();
+    StopHTTPMetrics();
     StopRPC();
     StopHTTPServer();
 #ifdef ENABLE_WALLET
@@ -236,6 +241,8 @@ void Shutdown()
         delete pblocktree;
         pblocktree = NULL;
     }
+    delete pblockfilterindex;
+    pblockfilterindex = NULL;
 #ifdef ENABLE_WALLET
     if (pwalletMain)
         pwalletMain->Flush(true);
@@ -329,11 +336,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("Print this help message and exit"));
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain an index of BIP 158 compact block filters, used by the getblockfilter rpc call and -peerblockfilters (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to reject transactions from network peers. Automatic broadcast and rebroadcast of any transactions from inbound peers is disabled, unless '-whitelistforcerelay' is '1', in which case whitelisted peers' transactions will be relayed. RPC transactions are not affected. (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
+    strUsage += HelpMessageOpt("-compactblockindex", strprintf(_("Maintain a compact index of each block's Sapling nullifiers and outputs for light wallet servers, used by /rest/compactblocks (default: %u)"), DEFAULT_COMPACTBLOCKINDEX));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -345,10 +354,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-feefilter", strprintf(_("Tell other nodes to filter invs to us by our mempool min fee (default: %u)"), DEFAULT_FEEFILTER));
+    strUsage += HelpMessageOpt("-importthreads=<n>", strprintf(_("Set the number of threads checking blocks during -reindex and -loadblock (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        -GetNumCores(), MAX_IMPORT_CHECK_THREADS, DEFAULT_IMPORT_CHECK_THREADS));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
     strUsage += HelpMessageOpt("-debuglogfile=<file>", strprintf(_("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)"), DEFAULT_DEBUGLOGFILE));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-    strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+    strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification, header verification and input prefetch threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)"), BITCOIN_PID_FILENAME));
@@ -386,10 +397,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
     strUsage += HelpMessageOpt("-mempoolevictionmemoryminutes=<n>", strprintf(_("The number of minutes before allowing rejected transactions to re-enter the mempool. (default: %u)"), DEFAULT_MEMPOOL_EVICTION_MEMORY_MINUTES));
+    strUsage += HelpMessageOpt("-mempoolsnapshotinterval=<n>", strprintf(_("Serve mempool listings such as getrawmempool from a copy of the mempool up to <n> milliseconds older than its latest change (default: %u)"), DEFAULT_MEMPOOL_SNAPSHOT_INTERVAL));
     strUsage += HelpMessageOpt("-mempooltxcostlimit=<n>",strprintf(_("An upper bound on the maximum size in bytes of all transactions in the mempool. (default: %s)"), DEFAULT_MEMPOOL_TOTAL_COST_LIMIT));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
+    strUsage += HelpMessageOpt("-peerblockfilters", strprintf(_("Serve compact block filters to peers per BIP 157, requires -blockfilterindex (default: %u)"), DEFAULT_PEERBLOCKFILTERS));
     strUsage += HelpMessageOpt("-peerbloomfilters", strprintf(_("Support filtering of blocks and transaction with bloom filters (default: %u)"), DEFAULT_PEERBLOOMFILTERS));
     if (showDebug)
         strUsage += HelpMessageOpt("-enforcenodebloom", strprintf("Enforce minimum protocol version to limit use of bloom filters (default: %u)", DEFAULT_ENFORCENODEBLOOM));
@@ -401,6 +414,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
+    strUsage += HelpMessageOpt("-txreconciliation", strprintf(_("Reconcile transaction announcements with peers that support it instead of flooding them (default: %u)"), DEFAULT_TXRECONCILIATION));
     strUsage += HelpMessageOpt("-whitebind=<addr>", _("Bind to given address and whitelist peers connecting to it. Use [host]:port notation for IPv6"));
     strUsage += HelpMessageOpt("-whitelist=<netmask>", _("Whitelist peers connecting from the given netmask or IP address. Can be specified multiple times.") +
         " " + _("Whitelisted peers cannot be DoS banned and their transactions are always relayed, even if they are already in the mempool, useful e.g. for a gateway"));
@@ -431,6 +445,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-testsafemode", strprintf("Force safe mode (default: %u)", DEFAULT_TESTSAFEMODE));
         strUsage += HelpMessageOpt("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages");
         strUsage += HelpMessageOpt("-fuzzmessagestest=<n>", "Randomly fuzz 1 of every <n> network messages");
+        strUsage += HelpMessageOpt("-lockprofile=<n>", "Profile lock contention, timing 1 of every <n> lock acquisitions on each thread, read with getlockprofile (default: 0)");
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", DEFAULT_STOPAFTERBLOCKIMPORT));
         strUsage += HelpMessageOpt("-limitancestorcount=<n>", strprintf("Do not accept transactions if number of in-mempool ancestors is <n> or more (default: %u)", DEFAULT_ANCESTOR_LIMIT));
         strUsage += HelpMessageOpt("-limitancestorsize=<n>", strprintf("Do not accept transactions whose size with all in-mempool ancestors exceeds <n> kilobytes (default: %u)", DEFAULT_ANCESTOR_SIZE_LIMIT));
@@ -498,6 +513,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
+    strUsage += HelpMessageOpt("-metricsendpoint", strprintf(_("Serve performance stats to public requests at /metrics, in Prometheus text format (default: %u)"), DEFAULT_METRICS_ENDPOINT));
     strUsage += HelpMessageOpt("-rpcbind=<addr>", _("Bind to given address to listen for JSON-RPC connections. Use [host]:port notation for IPv6. This option can be specified multiple times (default: bind to all interfaces)"));
     strUsage += HelpMessageOpt("-rpccookiefile=<loc>", _("Location of the auth cookie. Relative paths will be prefixed by a net-specific datadir location. (default: data dir)"));
     strUsage += HelpMessageOpt("-rpcuser=<user>", _("Username for JSON-RPC connections"));
@@ -506,7 +522,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 8232, 18232));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf(_("Set the number of threads helping to execute read-only calls in JSON-RPC batches in parallel, 0 to disable (default: %d)"), DEFAULT_RPC_BATCH_THREADS));
     if (showDebug) {
+        strUsage += HelpMessageOpt("-rpcbatchconcurrency=<n>", strprintf("Set the maximum number of calls of one JSON-RPC batch executed at the same time (default: %d)", DEFAULT_RPC_BATCH_CONCURRENCY));
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
@@ -524,6 +542,25 @@ std::string HelpMessage(HelpMessageMode mode)
     return strUsage;
 }
 
+/** Stats read from state that is kept anyway, each time stats are taken */
+static void RegisterPerfCallbacks()
+{
+    RegisterPerfCallback("mempool_transactions", "Transactions in the mempool", PERF_GAUGE, "", "",
+                         [] { return (int64_t)mempool.size(); });
+    RegisterPerfCallback("mempool_bytes", "Serialized size of the transactions in the mempool", PERF_GAUGE, "", "",
+                         [] { return (int64_t)mempool.GetTotalTxSize(); });
+    RegisterPerfCallback("mempool_usage_bytes", "Memory used by the mempool", PERF_GAUGE, "", "",
+                         [] { return (int64_t)mempool.DynamicMemoryUsage(); });
+    RegisterPerfCallback("peers", "Connected peers", PERF_GAUGE, "", "", [] {
+        LOCK(cs_vNodes);
+        return (int64_t)vNodes.size();
+    });
+    RegisterPerfCallback("equihash_solver_runs_total", "Equihash solver runs by the internal miner", PERF_COUNTER, "", "",
+                         [] { return (int64_t)ehSolverRuns.get(); });
+    RegisterPerfCallback("equihash_solutions_checked_total", "Equihash solutions checked against the target", PERF_COUNTER, "", "",
+                         [] { return (int64_t)solutionTargetChecks.get(); });
+}
+
 static void BlockNotifyCallback(bool initialSync, const CBlockIndex *pBlockIndex)
 {
     if (initialSync || !pBlockIndex)
@@ -739,7 +776,7 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
 
     // -reindex
     if (fReindex) {
-        nSizeReindexed = 0;  // will be modified inside LoadExternalBlockFile
+        nSizeReindexed = 0;  // will be modified inside LoadExternalBlockFiles
         // Find the summary size of all block files first
         int nFile = 0;
         size_t fullSize = 0;
@@ -752,18 +789,11 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
             fullSize += fs::file_size(blkFile);
         }
         nFullSizeToReindex = std::max<size_t>(1, fullSize);
-        nFile = 0;
-        while (true) {
-            CDiskBlockPos pos(nFile, 0);
-            if (!fs::exists(GetBlockPosFilename(pos, "blk")))
-                break; // No block files left to reindex
-            FILE *file = OpenBlockFile(pos, true);
-            if (!file)
-                break; // This error is logged in OpenBlockFile
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadExternalBlockFile(chainparams, file, &pos);
-            nFile++;
+        std::vector<CImportFile> vReindexFiles;
+        for (int i = 0; i < nFile; i++) {
+            vReindexFiles.emplace_back(GetBlockPosFilename(CDiskBlockPos(i, 0), "blk"), i);
         }
+        LoadExternalBlockFiles(chainparams, vReindexFiles);
         pblocktree->WriteReindexing(false);
         fReindex = false;
         nSizeReindexed = 0;
@@ -776,26 +806,18 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
     // hardcoded $DATADIR/bootstrap.dat
     fs::path pathBootstrap = GetDataDir() / "bootstrap.dat";
     if (fs::exists(pathBootstrap)) {
-        FILE *file = fsbridge::fopen(pathBootstrap, "rb");
-        if (file) {
-            fs::path pathBootstrapOld = GetDataDir() / "bootstrap.dat.old";
-            LogPrintf("Importing bootstrap.dat...\n");
-            LoadExternalBlockFile(chainparams, file);
+        fs::path pathBootstrapOld = GetDataDir() / "bootstrap.dat.old";
+        LogPrintf("Importing bootstrap.dat...\n");
+        std::vector<bool> vOpened;
+        LoadExternalBlockFiles(chainparams, {CImportFile(pathBootstrap)}, &vOpened);
+        if (vOpened[0])
             RenameOver(pathBootstrap, pathBootstrapOld);
-        } else {
-            LogPrintf("Warning: Could not open bootstrap file %s\n", pathBootstrap.string());
-        }
     }
 
     // -loadblock=
-    for (const fs::path& path : vImportFiles) {
-        FILE *file = fsbridge::fopen(path, "rb");
-        if (file) {
-            LogPrintf("Importing blocks file %s...\n", path.string());
-            LoadExternalBlockFile(chainparams,file);
-        } else {
-            LogPrintf("Warning: Could not open blocks file %s\n", path.string());
-        }
+    if (!vImportFiles.empty()) {
+        std::vector<CImportFile> vLoadFiles(vImportFiles.begin(), vImportFiles.end());
+        LoadExternalBlockFiles(chainparams, vLoadFiles);
     }
 
     // scan for better chains in the block chain database, that are not yet connected in the active best chain
@@ -824,6 +846,11 @@ bool InitSanityCheck(void)
     if (!glibc_sanity_test() || !glibcxx_sanity_test())
         return false;
 
+    if (!SHA256SelfTest()) {
+        InitError("SHA-256 self-test failure. Aborting.");
+        return false;
+    }
+
     return true;
 }
 
@@ -895,6 +922,8 @@ bool AppInitServers()
         return false;
     if (GetBoolArg("-rest", DEFAULT_REST_ENABLE) && !StartREST())
         return false;
+    if (GetBoolArg("-metricsendpoint", DEFAULT_METRICS_ENDPOINT) && !StartHTTPMetrics())
+        return false;
     if (!StartHTTPServer())
         return false;
     return true;
@@ -1069,6 +1098,8 @@ bool AppInit2()
     if (GetArg("-prune", 0)) {
         if (GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Prune mode is incompatible with -blockfilterindex."));
 #ifdef ENABLE_WALLET
         if (GetBoolArg("-rescan", false)) {
            return InitError(_("Rescans are not possible in pruned mode. You will need to use -reindex which will download the whole blockchain again."));
@@ -1142,9 +1173,11 @@ bool AppInit2()
     int64_t mempoolTotalCostLimit = GetArg("-mempooltxcostlimit", DEFAULT_MEMPOOL_TOTAL_COST_LIMIT);
     int64_t mempoolEvictionMemorySeconds = GetArg("-mempoolevictionmemoryminutes", DEFAULT_MEMPOOL_EVICTION_MEMORY_MINUTES) * 60;
     mempool.SetMempoolCostLimit(mempoolTotalCostLimit, mempoolEvictionMemorySeconds);
+    mempool.SetSnapshotInterval(std::max<int64_t>(0, GetArg("-mempoolsnapshotinterval", DEFAULT_MEMPOOL_SNAPSHOT_INTERVAL)));
 
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    nLockProfileSampleRate = std::min<int64_t>(std::max<int64_t>(GetArg("-lockprofile", 0), 0), 1000000);
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -1210,6 +1243,14 @@ bool AppInit2()
     if (GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         nLocalServices |= NODE_BLOOM;
 
+    if (GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (!GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Cannot set -peerblockfilters without -blockfilterindex."));
+        nLocalServices |= NODE_COMPACT_FILTERS;
+    }
+
+    fTxReconciliation = GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION);
+
     nMaxTipAge = GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
     KeyIO keyIO(chainparams);
@@ -1307,6 +1348,10 @@ bool AppInit2()
         return false;
     }
 
+    // Select the fastest SHA-256 implementation that passes its self-test
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+
     // Initialize elliptic curve code
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1357,11 +1402,15 @@ bool AppInit2()
     std::ostringstream strErrors;
 
     InitSignatureCache();
+    RegisterPerfCallbacks();
 
-    LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for script and header verification and input prefetching\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadHeaderCheck);
+            threadGroup.create_thread(&ThreadInputPrefetch);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1561,11 +1610,18 @@ bool AppInit2()
         nBlockTreeDBCache = nTotalCache * 3 / 4;
     }
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nFilterIndexCache = 0;
+    if (GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        nFilterIndexCache = std::min(nTotalCache / 8, nMaxFilterIndexCache << 20);
+        nTotalCache -= nFilterIndexCache;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (nFilterIndexCache > 0)
+        LogPrintf("* Using %.1fMiB for block filter index database\n", nFilterIndexCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
@@ -1594,6 +1650,16 @@ bool AppInit2()
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
+                if (pcoinsdbview->IsSnapshotLoadIncomplete()) {
+                    strLoadError = _("Loading a UTXO snapshot was interrupted. You need to rebuild the database using -reindex");
+                    break;
+                }
+
+                if (!pcoinsdbview->LoadNullifierFilters()) {
+                    strLoadError = _("Error loading the nullifier filters");
+                    break;
+                }
+
                 if (fReindex) {
                     pblocktree->WriteReindexing(true);
                     //If we're reindexing in prune mode, wipe away unusable block files and all undo data files
@@ -1623,6 +1689,12 @@ bool AppInit2()
                     break;
                 }
 
+                // Check for changed -compactblockindex state
+                if (fCompactBlockIndex != GetBoolArg("-compactblockindex", DEFAULT_COMPACTBLOCKINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -compactblockindex");
+                    break;
+                }
+
                 // Check for changed -insightexplorer state
                 bool fInsightExplorerPreviouslySet = false;
                 pblocktree->ReadFlag("insightexplorer", fInsightExplorerPreviouslySet);
@@ -1712,6 +1784,21 @@ bool AppInit2()
     }
     LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
 
+    if (GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        // The filters chain from genesis, and there is no block data below a UTXO snapshot.
+        if (GetSnapshotBaseHeight() >= 0)
+            return InitError(_("-blockfilterindex cannot be used on a chainstate loaded from a UTXO snapshot. You need to rebuild the database using -reindex"));
+        try {
+            pblockfilterindex = new CBlockFilterIndex(BlockFilterType::BASIC, nFilterIndexCache, false, fReindex);
+        } catch (const std::exception& e) {
+            LogPrintf("%s\n", e.what());
+            return InitError(_("Error opening block filter index database"));
+        }
+        LOCK(cs_main);
+        if (!pblockfilterindex->Init())
+            return InitError(_("Error loading the block filter index. Restart with -reindex to rebuild it."));
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -1840,6 +1927,13 @@ bool AppInit2()
         return false;
     }
 
+    // Build the block filter index in the background, following the tip.
+    if (pblockfilterindex) {
+        threadGroup.create_thread(
+            std::bind(&TraceThread<void (*)()>, "fltrindex", &ThreadBlockFilterIndex)
+        );
+    }
+
     // ********************************************************* Step 11: start node
 
     if (!strErrors.str().empty())
@@ -10,9 +10,11 @@
 
 #include "addrman.h"
 #include "arith_uint256.h"
+#include "blockfilterindex.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "compactblockindex.h"
 #include "consensus/consensus.h"
 #include "consensus/funding.h"
 #include "consensus/merkle.h"
@@ -24,10 +26,12 @@
 #include "merkleblock.h"
 #include "metrics.h"
 #include "net.h"
+#include "perfstats.h"
 #include "policy/fees.h"
 #include "policy/policy.h"
 #include "pow.h"
 #include "random.h"
+#include "relaycache.h"
 #include "reverse_iterator.h"
 #include "txmempool.h"
 #include "ui_interface.h"
@@ -71,6 +75,7 @@ int nScriptCheckThreads = 0;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fTxIndex = false;
+bool fCompactBlockIndex = false;
 bool fAddressIndex = false;     // insightexplorer || lightwalletd
 bool fSpentIndex = false;       // insightexplorer
 bool fTimestampIndex = false;   // insightexplorer
@@ -156,6 +161,9 @@ namespace {
 
     CBlockIndex *pindexBestInvalid;
 
+    /** The block a UTXO snapshot was loaded at, if any; it and its ancestors may have no block data. */
+    CBlockIndex *pindexSnapshotBase = NULL;
+
     /**
      * The set of all CBlockIndex entries with BLOCK_VALID_TRANSACTIONS (for itself and all ancestors) and
      * as good as our current tip or better. Entries may be failed, though, and pruning nodes may be
@@ -587,6 +595,13 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
     return true;
 }
 
+/** Keep transactions leaving the mempool around for peers that may still
+ *  request them after we announced them. */
+static void CacheRemovedTransaction(const CTxMemPoolEntry& entry)
+{
+    relayCache.Insert(entry.GetTx().GetHash(), entry.GetSharedTx(), entry.GetTxSize(), entry.GetTime());
+}
+
 void RegisterNodeSignals(CNodeSignals& nodeSignals)
 {
     nodeSignals.GetHeight.connect(&GetHeight);
@@ -594,6 +609,7 @@ void RegisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.SendMessages.connect(&SendMessages);
     nodeSignals.InitializeNode.connect(&InitializeNode);
     nodeSignals.FinalizeNode.connect(&FinalizeNode);
+    mempool.NotifyEntryRemoved.connect(&CacheRemovedTransaction);
 }
 
 void UnregisterNodeSignals(CNodeSignals& nodeSignals)
@@ -603,6 +619,7 @@ void UnregisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.SendMessages.disconnect(&SendMessages);
     nodeSignals.InitializeNode.disconnect(&InitializeNode);
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
+    mempool.NotifyEntryRemoved.disconnect(&CacheRemovedTransaction);
 }
 
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
@@ -623,6 +640,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
     return chain.Genesis();
 }
 
+CCoinsViewDB *pcoinsdbview = NULL;
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
@@ -805,6 +823,9 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& in
  * 2. ProcessNewBlock calls AcceptBlock, which calls CheckBlock (which calls CheckTransaction)
  *    and ContextualCheckBlock (which calls this function).
  * 3. The isInitBlockDownload argument is only to assist with testing.
+ * 4. The joinSplitSig and Sapling checks commit to the consensus branch ID
+ *    through the signature hash, so their cached results are only reused for
+ *    the same transaction under the same consensus rules.
  */
 bool ContextualCheckTransaction(
         const CTransaction& tx,
@@ -812,7 +833,8 @@ bool ContextualCheckTransaction(
         const CChainParams& chainparams,
         const int nHeight,
         const int dosLevel,
-        bool (*isInitBlockDownload)(const CChainParams&)) {
+        bool (*isInitBlockDownload)(const CChainParams&),
+        bool cacheStore) {
 
     auto& consensus = chainparams.GetConsensus();
 
@@ -992,21 +1014,37 @@ bool ContextualCheckTransaction(
     {
         static_assert(crypto_sign_PUBLICKEYBYTES == 32);
 
-        // We rely on libsodium to check that the signature is canonical.
-        // https://github.com/jedisct1/libsodium/commit/62911edb7ff2275cccd74bf1c8aefcc4d76924e0
-        if (crypto_sign_verify_detached(&tx.joinSplitSig[0],
-                                        dataToBeSigned.begin(), 32,
-                                        tx.joinSplitPubKey.begin()
-                                        ) != 0) {
-            return state.DoS(isInitBlockDownload(chainparams) ? 0 : 100,
-                                error("ContextualCheckTransaction(): invalid joinsplit signature"),
-                                REJECT_INVALID, "bad-txns-invalid-joinsplit-signature");
+        uint256 entry = ComputeSignatureCacheEntry(SIGCACHE_JOINSPLIT, dataToBeSigned,
+                                                   tx.joinSplitPubKey.begin(), tx.joinSplitPubKey.size(),
+                                                   tx.joinSplitSig.data(), tx.joinSplitSig.size());
+        if (!GetCachedSignature(SIGCACHE_JOINSPLIT, entry, !cacheStore)) {
+            // We rely on libsodium to check that the signature is canonical.
+            // https://github.com/jedisct1/libsodium/commit/62911edb7ff2275cccd74bf1c8aefcc4d76924e0
+            if (crypto_sign_verify_detached(&tx.joinSplitSig[0],
+                                            dataToBeSigned.begin(), 32,
+                                            tx.joinSplitPubKey.begin()
+                                            ) != 0) {
+                return state.DoS(isInitBlockDownload(chainparams) ? 0 : 100,
+                                    error("ContextualCheckTransaction(): invalid joinsplit signature"),
+                                    REJECT_INVALID, "bad-txns-invalid-joinsplit-signature");
+            }
+            if (cacheStore) {
+                CacheSignature(entry);
+            }
         }
     }
 
     if (!tx.vShieldedSpend.empty() ||
         !tx.vShieldedOutput.empty())
     {
+        // The signature hash commits to the spend and output descriptions
+        // except for their signatures, and the txid to the signatures too.
+        const uint256& txid = tx.GetHash();
+        uint256 entry = ComputeSignatureCacheEntry(SIGCACHE_SAPLING, dataToBeSigned, txid.begin(), txid.size(), NULL, 0);
+        if (GetCachedSignature(SIGCACHE_SAPLING, entry, !cacheStore)) {
+            return true;
+        }
+
         auto ctx = librustzcash_sapling_verification_ctx_init();
 
         for (const SpendDescription &spend : tx.vShieldedSpend) {
@@ -1055,6 +1093,10 @@ bool ContextualCheckTransaction(
         }
 
         librustzcash_sapling_verification_ctx_free(ctx);
+
+        if (cacheStore) {
+            CacheSignature(entry);
+        }
     }
     return true;
 }
@@ -1592,6 +1634,38 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return true;
 }
 
+bool GetSpentIndex(const std::vector<CSpentIndexKey> &keys, std::vector<CSpentIndexValue> &values)
+{
+    AssertLockHeld(cs_main);
+    if (!fSpentIndex)
+        return error("Spent index not enabled");
+
+    values.assign(keys.size(), CSpentIndexValue());
+    size_t nMempool = mempool.getSpentIndex(keys, values);
+
+    std::vector<CSpentIndexKey> vRead;
+    std::vector<size_t> vReadPos;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (values[i].IsNull()) {
+            vRead.push_back(keys[i]);
+            vReadPos.push_back(i);
+        }
+    }
+
+    unsigned int nSeeks = 0;
+    if (!vRead.empty()) {
+        std::vector<CSpentIndexValue> vReadValues;
+        if (!pblocktree->ReadSpentIndex(vRead, vReadValues, nSeeks))
+            return error("Unable to get spent index information");
+        for (size_t i = 0; i < vRead.size(); i++)
+            values[vReadPos[i]] = vReadValues[i];
+    }
+    LogPrint(BCLog::DB, "%s: %u outputs, %u spent in mempool, %u read from disk with %u seeks\n",
+        __func__, keys.size(), nMempool, vRead.size(), nSeeks);
+
+    return true;
+}
+
 bool GetAddressIndex(const uint160& addressHash, int type,
                      std::vector<CAddressIndexDbEntry>& addressIndex,
                      int start, int end)
@@ -1620,8 +1694,19 @@ bool GetAddressUnspent(const uint160& addressHash, int type,
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
                         bool* pfMissingInputs, CFeeRate* txFeeRate, const CAmount nAbsurdFee)
 {
+    static PerfHistogram& perfAccept = GetPerfHistogram("mempool_accept_seconds",
+        "Time spent deciding whether to accept transactions to the mempool");
+    static PerfCounter& perfAccepted = GetPerfCounter("mempool_accept_total",
+        "Transactions offered to the mempool, by outcome", "result", "accepted");
+    static PerfCounter& perfRejected = GetPerfCounter("mempool_accept_total",
+        "Transactions offered to the mempool, by outcome", "result", "rejected");
     std::vector<uint256> vHashTxToUncache;
-    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, txFeeRate, nAbsurdFee, vHashTxToUncache);
+    bool res;
+    {
+        PerfTimer timer(perfAccept);
+        res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, txFeeRate, nAbsurdFee, vHashTxToUncache);
+    }
+    (res ? perfAccepted : perfRejected).Add();
     if (!res) {
         for (const uint256& hashTx : vHashTxToUncache)
             pcoinsTip->Uncache(hashTx);
@@ -2209,6 +2294,15 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
 
 } // anon namespace
 
+bool ReadBlockUndoFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull()) {
+        return error("%s: no undo data available for block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    return UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash());
+}
+
 
 /**
  * Apply the undo operation of a CTxInUndo to the given chain state.
@@ -2438,18 +2532,42 @@ void static FlushBlockFile(bool fFinalize = false)
 bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CHeaderCheck> headercheckqueue(16);
+static CCheckQueue<CInputPrefetch> inputprefetchqueue(8);
 
 void ThreadScriptCheck() {
     RenameThread("bitcoinz-scriptch");
     scriptcheckqueue.Thread();
 }
 
+void ThreadHeaderCheck() {
+    RenameThread("bitcoinz-headerch");
+    headercheckqueue.Thread();
+}
+
+void ThreadInputPrefetch() {
+    RenameThread("bitcoinz-prefetch");
+    inputprefetchqueue.Thread();
+}
+
 static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
+static PerfHistogram& BlockConnectHistogram(const std::string& strPhase)
+{
+    return GetPerfHistogram("block_connect_seconds", "Time spent connecting blocks to the active chain, by phase",
+                            "phase", strPhase);
+}
+
+static PerfHistogram& perfTimeVerify = BlockConnectHistogram("verify");
+static PerfHistogram& perfTimeConnect = BlockConnectHistogram("connect_transactions");
+static PerfHistogram& perfTimeIndex = BlockConnectHistogram("index");
+static PerfHistogram& perfTimeCallbacks = BlockConnectHistogram("callbacks");
+static PerfHistogram& perfTimeTotal = BlockConnectHistogram("total");
+
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
                   CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck)
 {
@@ -2487,6 +2605,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             pindex->hashSproutAnchor = tree.root();
             // The genesis block contained no JoinSplits
             pindex->hashFinalSproutRoot = pindex->hashSproutAnchor;
+            // Compact block ranges may start at height 0
+            if (fCompactBlockIndex && !pblocktree->WriteCompactBlock(CCompactBlock(block, pindex->nHeight)))
+                return AbortNode(state, "Failed to write compact block index");
         }
         return true;
     }
@@ -2570,6 +2691,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     SaplingMerkleTree sapling_tree;
     assert(view.GetSaplingAnchorAt(view.GetBestAnchor(SAPLING), sapling_tree));
 
+    // Sapling anchors always refer to previous blocks, so the block's
+    // commitments are collected and appended to the tree in one batch.
+    std::vector<libzcash::PedersenHash> sapling_commitments;
+    // The Sprout commitments are kept so the new anchor can be stored
+    // as a delta against the previous one.
+    std::vector<libzcash::SHA256Compress> sprout_commitments;
+
     // Grab the consensus branch ID for the block's height
     auto consensusBranchId = CurrentEpochBranchId(pindex->nHeight, chainparams.GetConsensus());
 
@@ -2685,19 +2813,22 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 // Insert the note commitments into our temporary tree.
 
                 sprout_tree.append(note_commitment);
+                sprout_commitments.push_back(note_commitment);
             }
         }
 
         for (const OutputDescription &outputDescription : tx.vShieldedOutput) {
-            sapling_tree.append(outputDescription.cmu);
+            sapling_commitments.push_back(outputDescription.cmu);
         }
 
         vPos.push_back(std::make_pair(tx.GetHash(), pos));
         pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
     }
 
-    view.PushAnchor(sprout_tree);
-    view.PushAnchor(sapling_tree);
+    sapling_tree.append_batch(sapling_commitments);
+
+    view.PushAnchor(sprout_tree, sprout_commitments);
+    view.PushAnchor(sapling_tree, sapling_commitments);
     if (!fJustCheck) {
         pindex->hashFinalSproutRoot = sprout_tree.root();
     }
@@ -2713,7 +2844,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
     }
 
-    int64_t nTime1 = GetTimeMicros(); nTimeConnect += nTime1 - nTimeStart;
+    int64_t nTime1 = GetTimeMicros(); nTimeConnect += nTime1 - nTimeStart; perfTimeConnect.Observe(nTime1 - nTimeStart);
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs-1), nTimeConnect * 0.000001);
 
     CAmount blockReward = nFees + GetBlockSubsidy(pindex->nHeight, chainparams.GetConsensus());
@@ -2725,7 +2856,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     if (!control.Wait())
         return state.DoS(100, false);
-    int64_t nTime2 = GetTimeMicros(); nTimeVerify += nTime2 - nTimeStart;
+    int64_t nTime2 = GetTimeMicros(); nTimeVerify += nTime2 - nTimeStart; perfTimeVerify.Observe(nTime2 - nTimeStart);
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs-1), nTimeVerify * 0.000001);
 
     if (fJustCheck)
@@ -2765,6 +2896,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
+    if (fCompactBlockIndex)
+        if (!pblocktree->WriteCompactBlock(CCompactBlock(block, pindex->nHeight)))
+            return AbortNode(state, "Failed to write compact block index");
+
     // START insightexplorer
     if (fAddressIndex) {
         if (!pblocktree->WriteAddressIndex(addressIndex)) {
@@ -2804,7 +2939,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
-    int64_t nTime3 = GetTimeMicros(); nTimeIndex += nTime3 - nTime2;
+    int64_t nTime3 = GetTimeMicros(); nTimeIndex += nTime3 - nTime2; perfTimeIndex.Observe(nTime3 - nTime2);
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeIndex * 0.000001);
 
     // Watch for changes to the previous coinbase transaction.
@@ -2812,7 +2947,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     GetMainSignals().UpdatedTransaction(hashPrevBestCoinBase);
     hashPrevBestCoinBase = block.vtx[0].GetHash();
 
-    int64_t nTime4 = GetTimeMicros(); nTimeCallbacks += nTime4 - nTime3;
+    int64_t nTime4 = GetTimeMicros(); nTimeCallbacks += nTime4 - nTime3; perfTimeCallbacks.Observe(nTime4 - nTime3);
     LogPrint(BCLog::BENCH, "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeCallbacks * 0.000001);
 
     return true;
@@ -2951,6 +3086,11 @@ void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
       DateTimeStrFormat("%Y-%m-%d %H:%M:%S", chainActive.Tip()->GetBlockTime()),
       Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip()), pcoinsTip->DynamicMemoryUsage() * (1.0 / (1<<20)), pcoinsTip->GetCacheSize());
 
+    static PerfGauge& perfHeight = GetPerfGauge("chain_height", "Height of the active chain tip");
+    static PerfGauge& perfCoinsUsage = GetPerfGauge("coins_cache_usage_bytes", "Memory used by the coins cache");
+    perfHeight.Set(chainActive.Height());
+    perfCoinsUsage.Set(pcoinsTip->DynamicMemoryUsage());
+
     cvBlockChange.notify_all();
 }
 
@@ -2962,6 +3102,10 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
 {
     CBlockIndex *pindexDelete = chainActive.Tip();
     assert(pindexDelete);
+    // Nothing below a UTXO snapshot was ever connected here, so there is no
+    // undo data to go back with.
+    if (pindexDelete == pindexSnapshotBase)
+        return error("DisconnectTip(): cannot disconnect UTXO snapshot block %s", pindexDelete->GetBlockHash().ToString());
     // Read block from disk.
     CBlock block;
     if (!ReadBlockFromDisk(block, pindexDelete, chainparams.GetConsensus()))
@@ -3023,11 +3167,145 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
     return true;
 }
 
+bool CInputPrefetch::operator()() {
+    int64_t nStart = GetTimeMicros();
+    try {
+        switch (pinput->type) {
+            case CPrefetchedInput::COINS:
+                pinput->fFound = pview->GetCoins(pinput->hash, pinput->coins);
+                break;
+            case CPrefetchedInput::SPROUT_NULLIFIER:
+                pinput->fFound = pview->GetNullifier(pinput->hash, SPROUT);
+                break;
+            case CPrefetchedInput::SAPLING_NULLIFIER:
+                pinput->fFound = pview->GetNullifier(pinput->hash, SAPLING);
+                break;
+            case CPrefetchedInput::SPROUT_ANCHOR: {
+                SproutMerkleTree tree;
+                pinput->fFound = pview->GetSproutAnchorAt(pinput->hash, tree);
+                break;
+            }
+            case CPrefetchedInput::SAPLING_ANCHOR: {
+                SaplingMerkleTree tree;
+                pinput->fFound = pview->GetSaplingAnchorAt(pinput->hash, tree);
+                break;
+            }
+        }
+    } catch (const std::exception& e) {
+        // Left for ConnectBlock to read, and report, again.
+        pinput->fError = true;
+    }
+    pinput->nTime = GetTimeMicros() - nStart;
+    return true;
+}
+
+static int64_t nTimePrefetch = 0;
+static int64_t nTimePrefetchSaved = 0;
+
+/**
+ * Read the inputs of a block that pcoinsTip does not have from the coin
+ * database, on the prefetch threads, and add them to pcoinsTip so that
+ * ConnectBlock does not wait on one database read at a time. cs_main must be
+ * held throughout, so that the database cannot change before the inputs are
+ * added.
+ */
+static void PrefetchBlockInputs(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    if (!nScriptCheckThreads) {
+        return;
+    }
+    int64_t nStart = GetTimeMicros();
+
+    // Transactions of the block itself are not in the database.
+    std::set<uint256> setSeen;
+    for (const CTransaction& tx : block.vtx) {
+        setSeen.insert(tx.GetHash());
+    }
+
+    std::vector<CPrefetchedInput> vInputs;
+    size_t nCached = 0;
+    auto addInput = [&](CPrefetchedInput::Type type, const uint256& hash, bool fCached) {
+        if (fCached) {
+            nCached++;
+        } else if (setSeen.insert(hash).second) {
+            vInputs.emplace_back(type, hash);
+        }
+    };
+    for (const CTransaction& tx : block.vtx) {
+        if (!tx.IsCoinBase()) {
+            for (const CTxIn& txin : tx.vin) {
+                addInput(CPrefetchedInput::COINS, txin.prevout.hash, pcoinsTip->HaveCoinsInCache(txin.prevout.hash));
+            }
+        }
+        for (const JSDescription& joinsplit : tx.vJoinSplit) {
+            for (const uint256& nf : joinsplit.nullifiers) {
+                addInput(CPrefetchedInput::SPROUT_NULLIFIER, nf, pcoinsTip->HaveNullifierInCache(nf, SPROUT));
+            }
+            addInput(CPrefetchedInput::SPROUT_ANCHOR, joinsplit.anchor, false);
+        }
+        for (const SpendDescription& spend : tx.vShieldedSpend) {
+            addInput(CPrefetchedInput::SAPLING_NULLIFIER, spend.nullifier, pcoinsTip->HaveNullifierInCache(spend.nullifier, SAPLING));
+            addInput(CPrefetchedInput::SAPLING_ANCHOR, spend.anchor, false);
+        }
+    }
+    if (vInputs.empty()) {
+        return;
+    }
+
+    {
+        CCheckQueueControl<CInputPrefetch> control(&inputprefetchqueue);
+        std::vector<CInputPrefetch> vChecks;
+        vChecks.reserve(vInputs.size());
+        for (CPrefetchedInput& input : vInputs) {
+            vChecks.emplace_back(*pcoinsdbview, input);
+        }
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    int64_t nTimeReads = 0;
+    for (CPrefetchedInput& input : vInputs) {
+        nTimeReads += input.nTime;
+        if (input.fError) {
+            continue;
+        }
+        switch (input.type) {
+            case CPrefetchedInput::COINS:
+                if (input.fFound) {
+                    pcoinsTip->AddPrefetchedCoins(input.hash, input.coins);
+                }
+                break;
+            case CPrefetchedInput::SPROUT_NULLIFIER:
+                pcoinsTip->AddPrefetchedNullifier(input.hash, SPROUT, input.fFound);
+                break;
+            case CPrefetchedInput::SAPLING_NULLIFIER:
+                pcoinsTip->AddPrefetchedNullifier(input.hash, SAPLING, input.fFound);
+                break;
+            default:
+                break;
+        }
+    }
+
+    int64_t nTime = GetTimeMicros() - nStart;
+    int64_t nSaved = std::max<int64_t>(nTimeReads - nTime, 0);
+    nTimePrefetch += nTime;
+    nTimePrefetchSaved += nSaved;
+    LogPrint(BCLog::BENCH, "  - Prefetch: %.2fms for %u reads (%.2f%% of inputs were cached), %.2fms saved [%.2fs, %.2fs saved]\n",
+        nTime * 0.001, (unsigned int)vInputs.size(), 100.0 * nCached / (nCached + vInputs.size()), nSaved * 0.001,
+        nTimePrefetch * 0.000001, nTimePrefetchSaved * 0.000001);
+}
+
 static int64_t nTimeReadFromDisk = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
+static PerfHistogram& perfTimeReadFromDisk = BlockConnectHistogram("load");
+static PerfHistogram& perfTimeConnectTotal = BlockConnectHistogram("connect");
+static PerfHistogram& perfTimeFlush = BlockConnectHistogram("flush");
+static PerfHistogram& perfTimeChainState = BlockConnectHistogram("chainstate");
+static PerfHistogram& perfTimePostConnect = BlockConnectHistogram("postprocess");
 
 // Protected by cs_main
 std::map<const CBlockIndex*, std::list<CTransaction>> recentlyConflictedTxs;
@@ -3051,9 +3329,11 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         pblock = &block;
     }
     // Apply the block atomically to the chain state.
-    int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
+    int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1; perfTimeReadFromDisk.Observe(nTime2 - nTime1);
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    PrefetchBlockInputs(*pblock);
+    nTime2 = GetTimeMicros();
     {
         CCoinsViewCache view(pcoinsTip);
         bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainparams);
@@ -3064,16 +3344,16 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
             return error("ConnectTip(): ConnectBlock %s failed", pindexNew->GetBlockHash().ToString());
         }
         mapBlockSource.erase(pindexNew->GetBlockHash());
-        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
+        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2; perfTimeConnectTotal.Observe(nTime3 - nTime2);
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
         assert(view.Flush());
     }
-    int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
+    int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3; perfTimeFlush.Observe(nTime4 - nTime3);
     LogPrint(BCLog::BENCH, "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
         return false;
-    int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4; perfTimeChainState.Observe(nTime5 - nTime4);
     LogPrint(BCLog::BENCH, "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
     // Remove conflicting transactions from the mempool.
     std::list<CTransaction> txConflicted;
@@ -3099,6 +3379,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     EnforceNodeDeprecation(pindexNew->nHeight);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
+    perfTimePostConnect.Observe(nTime6 - nTime5); perfTimeTotal.Observe(nTime6 - nTime1);
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
     return true;
@@ -3156,6 +3437,14 @@ static CBlockIndex* FindMostWorkChain() {
             pindexNew = *it;
         }
 
+        // A chain forking below the UTXO snapshot would need the coins of
+        // blocks that were never connected.
+        if (pindexSnapshotBase && pindexNew->GetAncestor(pindexSnapshotBase->nHeight) != pindexSnapshotBase) {
+            LogPrintf("%s: not switching to %s, which forks below the UTXO snapshot\n", __func__, pindexNew->GetBlockHash().ToString());
+            setBlockIndexCandidates.erase(pindexNew);
+            continue;
+        }
+
         // Check whether all blocks on the path between the currently active chain and the candidate are valid.
         // Just going until the active chain is an optimization, as we know all blocks in it are valid already.
         CBlockIndex *pindexTest = pindexNew;
@@ -3755,7 +4044,6 @@ bool CheckBlockHeader(
     const CChainParams& chainparams,
     bool fCheckPOW)
 {
-    unsigned int nHeight = chainActive.Height();
     auto consensusParams = chainparams.GetConsensus();
 
     // Check block version
@@ -3781,6 +4069,30 @@ bool CheckBlockHeader(
     return true;
 }
 
+bool CHeaderCheck::operator()() {
+    CValidationState state;
+    return CheckBlockHeader(*pheader, state, *pchainparams, true);
+}
+
+bool CheckBlockHeaders(std::vector<CBlockHeader>::const_iterator begin, std::vector<CBlockHeader>::const_iterator end,
+    const CChainParams& chainparams, CCheckQueue<CHeaderCheck>* pqueue)
+{
+    std::vector<CHeaderCheck> vChecks;
+    vChecks.reserve(end - begin);
+    for (std::vector<CBlockHeader>::const_iterator it = begin; it != end; ++it)
+        vChecks.push_back(CHeaderCheck(*it, chainparams));
+
+    if (pqueue == NULL) {
+        for (CHeaderCheck& check : vChecks)
+            if (!check())
+                return false;
+        return true;
+    }
+    CCheckQueueControl<CHeaderCheck> control(pqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
 bool CheckBlock(const CBlock& block, CValidationState& state,
                 const CChainParams& chainparams,
                 ProofVerifier& verifier,
@@ -3907,7 +4219,8 @@ bool ContextualCheckBlockHeader(
 
 bool ContextualCheckBlock(
     const CBlock& block, CValidationState& state,
-    const CChainParams& chainparams, CBlockIndex * const pindexPrev)
+    const CChainParams& chainparams, CBlockIndex * const pindexPrev,
+    bool fCacheResults)
 {
     const int nHeight = pindexPrev == NULL ? 0 : pindexPrev->nHeight + 1;
     const Consensus::Params& consensusParams = chainparams.GetConsensus();
@@ -3916,7 +4229,7 @@ bool ContextualCheckBlock(
     for (const CTransaction& tx : block.vtx) {
 
         // Check transaction contextually against consensus rules at block height
-        if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, 100)) {
+        if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, 100, IsInitialBlockDownload, fCacheResults)) {
             return false; // Failure reason has been set in validation state object
         }
 
@@ -3972,7 +4285,7 @@ bool ContextualCheckBlock(
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL)
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL, bool fCheckPOW=true)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -3989,7 +4302,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
         return true;
     }
 
-    if (!CheckBlockHeader(block, state, chainparams))
+    if (!CheckBlockHeader(block, state, chainparams, fCheckPOW))
         return false;
 
     // Get prev block index
@@ -4029,7 +4342,8 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, const CCha
     CBlockIndex *pindexDummy = NULL;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    if (!AcceptBlockHeader(block, state, chainparams, &pindex))
+    // A block that already passed CheckBlock() has had its proof of work checked.
+    if (!AcceptBlockHeader(block, state, chainparams, &pindex, !block.fChecked))
         return false;
 
     // Try to process all requested blocks that we don't have, but only
@@ -4057,7 +4371,7 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, const CCha
     auto verifier = ProofVerifier::Disabled();
 
     bool fCheckPOW = (pindex->nHeight != 0);
-    if ((!CheckBlock(block, state,  chainparams, verifier, fCheckPOW, true)) || !ContextualCheckBlock(block, state, chainparams, pindex->pprev)) {
+    if ((!CheckBlock(block, state,  chainparams, verifier, fCheckPOW, true)) || !ContextualCheckBlock(block, state, chainparams, pindex->pprev, false)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
             setDirtyBlockIndex.insert(pindex);
@@ -4350,13 +4664,22 @@ bool static LoadBlockIndexDB()
         vSortedByHeight.push_back(make_pair(pindex->nHeight, pindex));
     }
     sort(vSortedByHeight.begin(), vSortedByHeight.end());
+    uint256 hashSnapshotBase;
+    uint64_t nSnapshotChainTx = 0;
+    pblocktree->ReadSnapshotBase(hashSnapshotBase, nSnapshotChainTx);
     for (const std::pair<int, CBlockIndex*>& item : vSortedByHeight)
     {
         CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
         // We can link the chain of blocks for which we've received transactions at some point.
         // Pruned nodes may have deleted the block.
-        if (pindex->nTx > 0) {
+        if (!hashSnapshotBase.IsNull() && pindex->GetBlockHash() == hashSnapshotBase) {
+            // The UTXO snapshot stands in for the ancestors' transactions.
+            pindexSnapshotBase = pindex;
+            pindex->nChainTx = nSnapshotChainTx;
+            pindex->nChainSproutValue = std::nullopt;
+            pindex->nChainSaplingValue = std::nullopt;
+        } else if (pindex->nTx > 0) {
             if (pindex->pprev) {
                 if (pindex->pprev->nChainTx) {
                     pindex->nChainTx = pindex->pprev->nChainTx + pindex->nTx;
@@ -4406,7 +4729,7 @@ bool static LoadBlockIndexDB()
         } else {
             pindex->nCachedBranchId = SPROUT_BRANCH_ID;
         }
-        if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS) && (pindex->nChainTx || pindex->pprev == NULL))
+        if (pindex == pindexSnapshotBase || (pindex->IsValid(BLOCK_VALID_TRANSACTIONS) && (pindex->nChainTx || pindex->pprev == NULL)))
             setBlockIndexCandidates.insert(pindex);
         if (pindex->nStatus & BLOCK_FAILED_MASK && (!pindexBestInvalid || pindex->nChainWork > pindexBestInvalid->nChainWork))
             pindexBestInvalid = pindex;
@@ -4455,6 +4778,9 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("prunedblockfiles", fHavePruned);
     if (fHavePruned)
         LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
+    if (pindexSnapshotBase)
+        LogPrintf("LoadBlockIndexDB(): Chainstate was loaded from a UTXO snapshot at height %d, history not validated\n", pindexSnapshotBase->nHeight);
+    SetfUnvalidatedSnapshot(pindexSnapshotBase != NULL);
 
     // Check whether we need to continue reindexing
     bool fReindexing = false;
@@ -4465,6 +4791,10 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
 
+    // Check whether we have a compact block index
+    pblocktree->ReadFlag("compactblockindex", fCompactBlockIndex);
+    LogPrintf("%s: compact block index %s\n", __func__, fCompactBlockIndex ? "enabled" : "disabled");
+
     // insightexplorer and lightwalletd
     // Check whether block explorer features are enabled
     bool fInsightExplorer = false;
@@ -4552,6 +4882,9 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
         if (pindex->nHeight < chainActive.Height()-nCheckDepth)
             break;
+        // There is no block data below a UTXO snapshot
+        if (pindex == pindexSnapshotBase)
+            break;
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
@@ -4775,6 +5108,12 @@ bool RewindBlockIndex(const CChainParams& chainparams, bool& clearWitnessCaches)
     return true;
 }
 
+int GetSnapshotBaseHeight()
+{
+    LOCK(cs_main);
+    return pindexSnapshotBase ? pindexSnapshotBase->nHeight : -1;
+}
+
 void UnloadBlockIndex()
 {
     LOCK(cs_main);
@@ -4782,6 +5121,7 @@ void UnloadBlockIndex()
     chainActive.SetTip(NULL);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
+    pindexSnapshotBase = NULL;
     mempool.clear();
     mapOrphanTransactions.clear();
     mapOrphanTransactionsByPrev.clear();
@@ -4828,6 +5168,10 @@ bool InitBlockIndex(const CChainParams& chainparams)
     fTxIndex = GetBoolArg("-txindex", DEFAULT_TXINDEX);
     pblocktree->WriteFlag("txindex", fTxIndex);
 
+    // Use the provided setting for -compactblockindex in the new database
+    fCompactBlockIndex = GetBoolArg("-compactblockindex", DEFAULT_COMPACTBLOCKINDEX);
+    pblocktree->WriteFlag("compactblockindex", fCompactBlockIndex);
+
     // Use the provided setting for -insightexplorer or -lightwalletd in the new database
     pblocktree->WriteFlag("insightexplorer", fExperimentalInsightExplorer);
     pblocktree->WriteFlag("lightwalletd", fExperimentalLightWalletd);
@@ -4872,58 +5216,66 @@ bool InitBlockIndex(const CChainParams& chainparams)
     return true;
 }
 
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
+bool LoadExternalBlockFiles(const CChainParams& chainparams, const std::vector<CImportFile>& files, std::vector<bool>* pvOpened)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
     static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
+    int nCheckThreads = GetArg("-importthreads", DEFAULT_IMPORT_CHECK_THREADS);
+    if (nCheckThreads <= 0)
+        nCheckThreads += GetNumCores();
+    nCheckThreads = std::max(0, std::min(nCheckThreads, MAX_IMPORT_CHECK_THREADS));
+
+    // Context-free checks run ahead on the pipeline's threads. A block that
+    // passes is marked fChecked, so AcceptBlock() skips them; a block that
+    // fails is checked again by AcceptBlock(), which records the failure.
+    auto check = [&chainparams](const CBlock& block) {
+        CValidationState state;
+        auto verifier = ProofVerifier::Disabled();
+        bool fCheckPOW = block.GetHash() != chainparams.GetConsensus().hashGenesisBlock;
+        CheckBlock(block, state, chainparams, verifier, fCheckPOW, true);
+    };
+
     int nLoaded = 0;
+    if (pvOpened)
+        pvOpened->assign(files.size(), false);
+    importStats.Start();
+    int64_t nLastLog = GetTimeMillis();
     try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
+        CBlockImportPipeline pipeline(chainparams, files, check, DEFAULT_IMPORT_READERS, nCheckThreads);
         size_t initialSize = nSizeReindexed;
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
+        // Set when a block cannot be stored or activated, which ends the import
+        bool fFailed = false;
+        for (size_t nFileIndex = 0; nFileIndex < files.size(); nFileIndex++) {
+            if (files[nFileIndex].nFile >= 0)
+                LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)files[nFileIndex].nFile);
+            else
+                LogPrintf("Importing blocks file %s...\n", files[nFileIndex].path.string());
 
-            if (fReindex)
-               nSizeReindexed = initialSize + nRewind;
+            while (std::shared_ptr<CImportedBlock> item = pipeline.Next(nFileIndex)) {
+                boost::this_thread::interruption_point();
+                int64_t nImportStart = GetTimeMicros();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, chainparams.MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
+                if (fReindex)
+                    nSizeReindexed = initialSize + item->nEndPos;
+
+                const CBlock& block = item->block;
+                const CDiskBlockPos* dbp = item->fHavePos ? &item->pos : NULL;
 
                 // detect out of order blocks, and store them for later
                 uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                bool fHaveParent, fHaveData;
+                {
+                    LOCK(cs_main);
+                    fHaveParent = mapBlockIndex.count(block.hashPrevBlock) > 0;
+                    BlockMap::iterator mi = mapBlockIndex.find(hash);
+                    fHaveData = mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA);
+                    if (fHaveData && hash != chainparams.GetConsensus().hashGenesisBlock && mi->second->nHeight % 1000 == 0) {
+                        LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mi->second->nHeight);
+                    }
+                }
+                if (hash != chainparams.GetConsensus().hashGenesisBlock && !fHaveParent) {
                     LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
                             block.hashPrevBlock.ToString());
                     if (dbp)
@@ -4932,21 +5284,22 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                 }
 
                 // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+                if (!fHaveData) {
                     LOCK(cs_main);
                     CValidationState state;
                     if (AcceptBlock(block, state, chainparams, NULL, true, dbp))
                         nLoaded++;
-                    if (state.IsError())
+                    if (state.IsError()) {
+                        fFailed = true;
                         break;
-                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+                    }
                 }
 
                 // Activate the genesis block so normal node progress can continue
                 if (hash == chainparams.GetConsensus().hashGenesisBlock) {
                     CValidationState state;
                     if (!ActivateBestChain(state, chainparams)) {
+                        fFailed = true;
                         break;
                     }
                 }
@@ -4961,34 +5314,231 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                     queue.pop_front();
                     std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
                     while (range.first != range.second) {
-                        if (ReadBlockFromDisk(block, range.first->second, chainparams.GetConsensus()))
+                        CBlock child;
+                        if (ReadBlockFromDisk(child, range.first->second, chainparams.GetConsensus()))
                         {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
+                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, child.GetHash().ToString(),
                                     head.ToString());
                             LOCK(cs_main);
                             CValidationState dummy;
-                            if (AcceptBlock(block, dummy, chainparams, NULL, true, &(range.first->second)))
+                            if (AcceptBlock(child, dummy, chainparams, NULL, true, &(range.first->second)))
                             {
                                 nLoaded++;
-                                queue.push_back(block.GetHash());
+                                queue.push_back(child.GetHash());
                             }
                         }
                         range.first = mapBlocksUnknownParent.erase(range.first);
                         NotifyHeaderTip(chainparams);
                     }
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+
+                importStats.nBlocksImported++;
+                importStats.nImportMicros += GetTimeMicros() - nImportStart;
+                if (GetTimeMillis() - nLastLog > 30 * 1000) {
+                    nLastLog = GetTimeMillis();
+                    LogPrintf("Block import: %s\n", importStats.ToString());
+                }
+            }
+
+            if (pvOpened)
+                (*pvOpened)[nFileIndex] = pipeline.IsOpened(nFileIndex);
+            if (fFailed)
+                break;
+            std::string strError = pipeline.GetError(nFileIndex);
+            if (!strError.empty()) {
+                AbortNode(std::string("System error: ") + strError);
+                break;
             }
+            initialSize = nSizeReindexed;
         }
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
     if (nLoaded > 0)
-        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+        LogPrintf("Loaded %i blocks from external files in %dms\n", nLoaded, GetTimeMillis() - nStart);
+    LogPrintf("Block import: %s\n", importStats.ToString());
+    importStats.Stop();
     return nLoaded > 0;
 }
 
+bool DumpUTXOSnapshot(CValidationState& state, const CChainParams& chainparams, const fs::path& path,
+                      CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats)
+{
+    LOCK(cs_main);
+    if (pindexSnapshotBase) {
+        return state.Error("the anchors before the loaded UTXO snapshot are not available");
+    }
+    if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS)) {
+        return false;
+    }
+
+    CBlockIndex* pindex = chainActive.Tip();
+    assert(pindex->GetBlockHash() == pcoinsdbview->GetBestBlock());
+    memcpy(metadata.pchMessageStart, chainparams.MessageStart(), sizeof(metadata.pchMessageStart));
+    metadata.hashBlock = pindex->GetBlockHash();
+    metadata.nHeight = pindex->nHeight;
+    metadata.nChainTx = pindex->nChainTx;
+    metadata.hashSproutAnchor = pcoinsdbview->GetBestAnchor(SPROUT);
+    metadata.hashSaplingAnchor = pcoinsdbview->GetBestAnchor(SAPLING);
+
+    // The anchors left by each block, in chain order
+    std::vector<uint256> vSproutRoots;
+    std::vector<uint256> vSaplingRoots;
+    for (CBlockIndex* pindexWalk = chainActive.Genesis(); pindexWalk; pindexWalk = chainActive.Next(pindexWalk)) {
+        const uint256& sproutRoot = pindexWalk->hashFinalSproutRoot;
+        if (!sproutRoot.IsNull() && (vSproutRoots.empty() || vSproutRoots.back() != sproutRoot)) {
+            vSproutRoots.push_back(sproutRoot);
+        }
+        const uint256& saplingRoot = pindexWalk->hashFinalSaplingRoot;
+        if (chainparams.GetConsensus().NetworkUpgradeActive(pindexWalk->nHeight, Consensus::UPGRADE_SAPLING) &&
+            (vSaplingRoots.empty() || vSaplingRoots.back() != saplingRoot)) {
+            vSaplingRoots.push_back(saplingRoot);
+        }
+    }
+
+    fs::path pathTemp = path;
+    pathTemp += ".incomplete";
+    try {
+        CAutoFile file(fsbridge::fopen(pathTemp, "wb"), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull()) {
+            return state.Error("could not open " + pathTemp.string() + " for writing");
+        }
+        if (!pcoinsdbview->DumpSnapshot(file, metadata, vSproutRoots, vSaplingRoots, stats)) {
+            return state.Error("failed to read the chainstate, see debug.log");
+        }
+        FileCommit(file.Get());
+    } catch (const std::exception& e) {
+        return state.Error(strprintf("failed to write UTXO snapshot: %s", e.what()));
+    }
+    if (!RenameOver(pathTemp, path)) {
+        return state.Error("could not rename " + pathTemp.string());
+    }
+
+    LogPrintf("Wrote UTXO snapshot of block %s (height %d, %u transactions) to %s, hash %s\n",
+        metadata.hashBlock.ToString(), metadata.nHeight, stats.nTransactions, path.string(), stats.hashSnapshot.ToString());
+    return true;
+}
+
+bool LoadUTXOSnapshot(CValidationState& state, const CChainParams& chainparams, const fs::path& path,
+                      const uint256& hashExpected, CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats)
+{
+    LOCK(cs_main);
+    // The snapshot's own hash can be recomputed by whoever made it, so only
+    // a hash obtained from a trusted node vouches for its contents.
+    if (hashExpected.IsNull()) {
+        return state.Error("the hash of the UTXO snapshot must be given");
+    }
+    try {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull()) {
+            return state.Error("could not open " + path.string());
+        }
+        file >> metadata;
+    } catch (const std::exception& e) {
+        return state.Error(strprintf("failed to read UTXO snapshot: %s", e.what()));
+    }
+    if (!metadata.IsValid()) {
+        return state.Error("not a UTXO snapshot, or an unsupported version");
+    }
+    if (memcmp(metadata.pchMessageStart, chainparams.MessageStart(), sizeof(metadata.pchMessageStart)) != 0) {
+        return state.Error("the UTXO snapshot is for a different network");
+    }
+    if (fTxIndex || fCompactBlockIndex || fAddressIndex || fSpentIndex || fTimestampIndex || pblockfilterindex) {
+        return state.Error("a UTXO snapshot cannot be loaded with -txindex, -compactblockindex, -blockfilterindex, -insightexplorer or -lightwalletd");
+    }
+
+    BlockMap::iterator mi = mapBlockIndex.find(metadata.hashBlock);
+    if (mi == mapBlockIndex.end()) {
+        return state.Error("the header of block " + metadata.hashBlock.GetHex() + " is not known yet");
+    }
+    CBlockIndex* pindex = mi->second;
+    if (pindex->nHeight != metadata.nHeight || metadata.nChainTx == 0 || (pindex->nStatus & BLOCK_FAILED_MASK) ||
+        pindexBestHeader == NULL || pindexBestHeader->GetAncestor(pindex->nHeight) != pindex) {
+        return state.Error("block " + metadata.hashBlock.GetHex() + " is not in the best header chain");
+    }
+    if (pindex->nHeight <= chainActive.Height() || pindex->GetAncestor(chainActive.Height()) != chainActive.Tip()) {
+        return state.Error("the active chain is not behind block " + metadata.hashBlock.GetHex());
+    }
+
+    if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS)) {
+        return false;
+    }
+
+    // Check the whole snapshot before touching the chainstate.
+    try {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        CUTXOSnapshotMetadata metadataCheck;
+        if (file.IsNull() || !pcoinsdbview->LoadSnapshot(file, metadataCheck, stats, false)) {
+            return state.Error("the UTXO snapshot is corrupt, see debug.log");
+        }
+    } catch (const std::exception& e) {
+        return state.Error(strprintf("failed to read UTXO snapshot: %s", e.what()));
+    }
+    if (stats.hashSnapshot != hashExpected) {
+        return state.Error(strprintf("UTXO snapshot hash %s does not match the expected %s",
+            stats.hashSnapshot.GetHex(), hashExpected.GetHex()));
+    }
+
+    LogPrintf("Loading UTXO snapshot of block %s (height %d) from %s\n", metadata.hashBlock.ToString(), metadata.nHeight, path.string());
+    // Once the block tree names the snapshot base, the chainstate must hold
+    // the snapshot or force -reindex, so it is marked as loading first.
+    if (!pcoinsdbview->MarkSnapshotLoading()) {
+        return AbortNode(state, "Failed to write to coin database");
+    }
+    if (!pblocktree->WriteSnapshotBase(metadata.hashBlock, metadata.nChainTx)) {
+        return AbortNode(state, "Failed to write to block index database");
+    }
+    try {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        CUTXOSnapshotStats statsLoad;
+        if (file.IsNull() || !pcoinsdbview->LoadSnapshot(file, metadata, statsLoad, true)) {
+            return AbortNode(state, "Failed to load UTXO snapshot, restart with -reindex");
+        }
+    } catch (const std::exception& e) {
+        return AbortNode(state, strprintf("Failed to load UTXO snapshot, restart with -reindex: %s", e.what()));
+    }
+
+    // The cache still remembers the previous best block and anchors.
+    CCoinsMap mapCoins;
+    CAnchorsSproutMap mapSproutAnchors;
+    CAnchorsSaplingMap mapSaplingAnchors;
+    CNullifiersMap mapSproutNullifiers;
+    CNullifiersMap mapSaplingNullifiers;
+    pcoinsTip->BatchWrite(mapCoins, metadata.hashBlock, metadata.hashSproutAnchor, metadata.hashSaplingAnchor,
+                          mapSproutAnchors, mapSaplingAnchors, mapSproutNullifiers, mapSaplingNullifiers);
+    mempool.clear();
+
+    pindexSnapshotBase = pindex;
+    pindex->nChainTx = metadata.nChainTx;
+    pindex->hashFinalSproutRoot = metadata.hashSproutAnchor;
+    chainActive.SetTip(pindex);
+
+    // Link any blocks already received on top of the snapshot base.
+    deque<CBlockIndex*> queue;
+    queue.push_back(pindex);
+    while (!queue.empty()) {
+        CBlockIndex* pindexLink = queue.front();
+        queue.pop_front();
+        if (pindexLink != pindex) {
+            pindexLink->nChainTx = pindexLink->pprev->nChainTx + pindexLink->nTx;
+        }
+        setBlockIndexCandidates.insert(pindexLink);
+        auto range = mapBlocksUnlinked.equal_range(pindexLink);
+        while (range.first != range.second) {
+            queue.push_back(range.first->second);
+            range.first = mapBlocksUnlinked.erase(range.first);
+        }
+    }
+    PruneBlockIndexCandidates();
+    SetfUnvalidatedSnapshot(true);
+
+    LogPrintf("Loaded UTXO snapshot: %u transactions, %u nullifiers, %u anchors; new tip %s (height %d)\n",
+        stats.nTransactions, stats.nSproutNullifiers + stats.nSaplingNullifiers, stats.nSproutAnchors + stats.nSaplingAnchors,
+        metadata.hashBlock.ToString(), metadata.nHeight);
+    uiInterface.NotifyBlockTip(false, pindex);
+    return true;
+}
+
 void static CheckBlockIndex(const Consensus::Params& consensusParams)
 {
     if (!fCheckBlockIndex) {
@@ -5030,6 +5580,13 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
     CBlockIndex* pindexFirstNotTransactionsValid = NULL; // Oldest ancestor of pindex which does not have BLOCK_VALID_TRANSACTIONS (regardless of being valid or not).
     CBlockIndex* pindexFirstNotChainValid = NULL; // Oldest ancestor of pindex which does not have BLOCK_VALID_CHAIN (regardless of being valid or not).
     CBlockIndex* pindexFirstNotScriptsValid = NULL; // Oldest ancestor of pindex which does not have BLOCK_VALID_SCRIPTS (regardless of being valid or not).
+    // The UTXO snapshot base stands in for the transactions of its ancestors,
+    // so the trackers restart there and are put back when the walk leaves it.
+    CBlockIndex* pindexSavedMissing = NULL;
+    CBlockIndex* pindexSavedNeverProcessed = NULL;
+    CBlockIndex* pindexSavedNotTransactionsValid = NULL;
+    CBlockIndex* pindexSavedNotChainValid = NULL;
+    CBlockIndex* pindexSavedNotScriptsValid = NULL;
     while (pindex != NULL) {
         nNodes++;
         if (pindexFirstInvalid == NULL && pindex->nStatus & BLOCK_FAILED_VALID) pindexFirstInvalid = pindex;
@@ -5039,6 +5596,15 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
         if (pindex->pprev != NULL && pindexFirstNotTransactionsValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_TRANSACTIONS) pindexFirstNotTransactionsValid = pindex;
         if (pindex->pprev != NULL && pindexFirstNotChainValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_CHAIN) pindexFirstNotChainValid = pindex;
         if (pindex->pprev != NULL && pindexFirstNotScriptsValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) pindexFirstNotScriptsValid = pindex;
+        if (pindex == pindexSnapshotBase) {
+            pindexSavedMissing = pindexFirstMissing;
+            pindexSavedNeverProcessed = pindexFirstNeverProcessed;
+            pindexSavedNotTransactionsValid = pindexFirstNotTransactionsValid;
+            pindexSavedNotChainValid = pindexFirstNotChainValid;
+            pindexSavedNotScriptsValid = pindexFirstNotScriptsValid;
+            pindexFirstMissing = pindexFirstNeverProcessed = pindexFirstNotTransactionsValid = NULL;
+            pindexFirstNotChainValid = pindexFirstNotScriptsValid = NULL;
+        }
 
         // Begin: actual consistency checks.
         if (pindex->pprev == NULL) {
@@ -5074,7 +5640,9 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
             assert((pindex->nStatus & BLOCK_FAILED_MASK) == 0); // The failed mask cannot be set for blocks without invalid parents.
         }
         if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && pindexFirstNeverProcessed == NULL) {
-            if (pindexFirstInvalid == NULL) {
+            // Blocks that do not descend from the UTXO snapshot are dropped
+            // from setBlockIndexCandidates by FindMostWorkChain.
+            if (pindexFirstInvalid == NULL && (!pindexSnapshotBase || pindex->GetAncestor(pindexSnapshotBase->nHeight) == pindexSnapshotBase)) {
                 // If this block sorts at least as good as the current tip and
                 // is valid and we have all data for its parents, it must be in
                 // setBlockIndexCandidates.  chainActive.Tip() must also be there
@@ -5142,6 +5710,13 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
         // Move upwards until we reach a node of which we have not yet visited the last child.
         while (pindex) {
             // We are going to either move to a parent or a sibling of pindex.
+            if (pindex == pindexSnapshotBase) {
+                pindexFirstMissing = pindexSavedMissing;
+                pindexFirstNeverProcessed = pindexSavedNeverProcessed;
+                pindexFirstNotTransactionsValid = pindexSavedNotTransactionsValid;
+                pindexFirstNotChainValid = pindexSavedNotChainValid;
+                pindexFirstNotScriptsValid = pindexSavedNotScriptsValid;
+            }
             // If pindex was the first with a certain property, unset the corresponding variable.
             if (pindex == pindexFirstInvalid) pindexFirstInvalid = NULL;
             if (pindex == pindexFirstMissing) pindexFirstMissing = NULL;
@@ -5322,33 +5897,22 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
             }
             else if (inv.IsKnownType())
             {
-                // Check the mempool to see if a transaction is expiring soon.  If so, do not send to peer.
-                // Note that a transaction enters the mempool first, before the serialized form is cached
-                // in mapRelay after a successful relay.
-                bool isExpiringSoon = false;
+                // Serve transactions from the mempool, unless they are expiring
+                // soon, and fall back to the relay cache for ones that have
+                // recently left it.
                 bool pushed = false;
-                CTransaction tx;
-                bool isInMempool = mempool.lookup(inv.hash, tx);
-                if (isInMempool) {
-                    isExpiringSoon = IsExpiringSoonTx(tx, currentHeight + 1);
-                }
-
-                if (!isExpiringSoon) {
-                    // Send stream from relay memory
-                    {
-                        LOCK(cs_mapRelay);
-                        map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
-                        if (mi != mapRelay.end()) {
-                            pfrom->PushMessage(inv.GetCommand(), (*mi).second);
+                if (inv.type == MSG_TX) {
+                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                    bool isExpiringSoon = false;
+                    if (mempool.lookupForRelay(inv.hash, currentHeight + 1, ss, isExpiringSoon)) {
+                        if (!isExpiringSoon) {
+                            pfrom->PushMessage(NetMsgType::TX, ss);
                             pushed = true;
                         }
-                    }
-                    if (!pushed && inv.type == MSG_TX) {
-                        if (isInMempool) {
-                            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                            ss.reserve(1000);
-                            ss << tx;
-                            pfrom->PushMessage(NetMsgType::TX, ss);
+                    } else {
+                        CRelayCache::TxRef tx = relayCache.Lookup(inv.hash);
+                        if (tx) {
+                            pfrom->PushMessage(NetMsgType::TX, *tx);
                             pushed = true;
                         }
                     }
@@ -5381,6 +5945,71 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
     }
 }
 
+/**
+ * Validates a getcfilters, getcfheaders or getcfcheckpt request and looks up
+ * the stop block. Disconnects the peer if the request is invalid.
+ */
+static bool PrepareBlockFilterRequest(CNode* pfrom, uint8_t filter_type, uint32_t nStartHeight,
+                                      const uint256& hashStop, uint32_t nMaxHeightDiff,
+                                      const CBlockIndex*& pindexStop)
+{
+    if (!(nLocalServices & NODE_COMPACT_FILTERS) || !pblockfilterindex ||
+        filter_type != static_cast<uint8_t>(pblockfilterindex->GetFilterType())) {
+        LogPrint(BCLog::NET, "peer %d requested unsupported block filter type: %d\n", pfrom->id, filter_type);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(hashStop);
+        // Only serve blocks that are on our chain or were fully validated.
+        if (mi == mapBlockIndex.end() ||
+            !(chainActive.Contains(mi->second) || mi->second->IsValid(BLOCK_VALID_SCRIPTS))) {
+            LogPrint(BCLog::NET, "peer %d requested invalid block hash: %s\n", pfrom->id, hashStop.ToString());
+            pfrom->fDisconnect = true;
+            return false;
+        }
+        pindexStop = mi->second;
+    }
+
+    uint32_t nStopHeight = pindexStop->nHeight;
+    if (nStartHeight > nStopHeight) {
+        LogPrint(BCLog::NET, "peer %d sent invalid getcfilters/getcfheaders with "
+                 "start height %d and stop height %d\n", pfrom->id, nStartHeight, nStopHeight);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    if (nStopHeight - nStartHeight >= nMaxHeightDiff) {
+        LogPrint(BCLog::NET, "peer %d requested too many cfilters/cfheaders: %d / %d\n",
+                 pfrom->id, nStopHeight - nStartHeight + 1, nMaxHeightDiff);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Announces the transactions of a reconciliation round the peer lacks, or
+ * the whole round if it failed. Requires pto->cs_inventory.
+ */
+static void AnnounceReconciledTxs(CNode* pto, const std::vector<uint256>& vTxid)
+{
+    std::vector<CInv> vInv;
+    for (const uint256& hash : vTxid) {
+        if (pto->filterInventoryKnown.contains(hash) || !mempool.exists(hash))
+            continue;
+        vInv.push_back(CInv(MSG_TX, hash));
+        pto->filterInventoryKnown.insert(hash);
+        if (vInv.size() == MAX_INV_SZ) {
+            pto->PushMessage(NetMsgType::INV, vInv);
+            vInv.clear();
+        }
+    }
+    if (!vInv.empty())
+        pto->PushMessage(NetMsgType::INV, vInv);
+}
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
     const CChainParams& chainparams = Params();
@@ -5487,6 +6116,22 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             UpdatePreferredDownload(pfrom, State(pfrom->GetId()));
         }
 
+        // Offer to reconcile transaction announcements with peers that
+        // want them; reconciliation starts once they offer it too.
+        bool fPeerRelayTxes;
+        {
+            LOCK(pfrom->cs_filter);
+            fPeerRelayTxes = pfrom->fRelayTxes;
+        }
+        if (fTxReconciliation && fPeerRelayTxes) {
+            uint64_t nSalt = GetRand(std::numeric_limits<uint64_t>::max());
+            {
+                LOCK(pfrom->cs_inventory);
+                pfrom->txrecon.reset(new CTxReconciliationState(nSalt));
+            }
+            pfrom->PushMessage(NetMsgType::SENDTXRCNCL, TXRECONCILIATION_VERSION, nSalt);
+        }
+
         // Change version
         pfrom->PushMessage(NetMsgType::VERACK);
         pfrom->ssSend.SetVersion(min(pfrom->nVersion, PROTOCOL_VERSION));
@@ -5847,6 +6492,94 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
+    else if (strCommand == NetMsgType::GETCFILTERS)
+    {
+        uint8_t filter_type;
+        uint32_t nStartHeight;
+        uint256 hashStop;
+        vRecv >> filter_type >> nStartHeight >> hashStop;
+
+        const CBlockIndex* pindexStop;
+        if (!PrepareBlockFilterRequest(pfrom, filter_type, nStartHeight, hashStop, MAX_GETCFILTERS_SIZE, pindexStop)) {
+            return true;
+        }
+
+        std::vector<BlockFilter> filters;
+        if (!pblockfilterindex->LookupFilterRange(nStartHeight, pindexStop, filters)) {
+            LogPrint(BCLog::NET, "Failed to find block filters in index: start_height=%d, stop_hash=%s\n",
+                     nStartHeight, hashStop.ToString());
+            return true;
+        }
+
+        for (const BlockFilter& filter : filters) {
+            pfrom->PushMessage(NetMsgType::CFILTER, filter);
+        }
+    }
+
+
+    else if (strCommand == NetMsgType::GETCFHEADERS)
+    {
+        uint8_t filter_type;
+        uint32_t nStartHeight;
+        uint256 hashStop;
+        vRecv >> filter_type >> nStartHeight >> hashStop;
+
+        const CBlockIndex* pindexStop;
+        if (!PrepareBlockFilterRequest(pfrom, filter_type, nStartHeight, hashStop, MAX_GETCFHEADERS_SIZE, pindexStop)) {
+            return true;
+        }
+
+        uint256 prevHeader;
+        if (nStartHeight > 0) {
+            const CBlockIndex* pindexPrev = pindexStop->GetAncestor(nStartHeight - 1);
+            if (!pblockfilterindex->LookupFilterHeader(pindexPrev, prevHeader)) {
+                LogPrint(BCLog::NET, "Failed to find block filter header in index: block_hash=%s\n",
+                         pindexPrev->GetBlockHash().ToString());
+                return true;
+            }
+        }
+
+        std::vector<uint256> filterHashes;
+        if (!pblockfilterindex->LookupFilterHashRange(nStartHeight, pindexStop, filterHashes)) {
+            LogPrint(BCLog::NET, "Failed to find block filter hashes in index: start_height=%d, stop_hash=%s\n",
+                     nStartHeight, hashStop.ToString());
+            return true;
+        }
+
+        pfrom->PushMessage(NetMsgType::CFHEADERS, filter_type, pindexStop->GetBlockHash(), prevHeader, filterHashes);
+    }
+
+
+    else if (strCommand == NetMsgType::GETCFCHECKPT)
+    {
+        uint8_t filter_type;
+        uint256 hashStop;
+        vRecv >> filter_type >> hashStop;
+
+        const CBlockIndex* pindexStop;
+        if (!PrepareBlockFilterRequest(pfrom, filter_type, 0, hashStop,
+                                       std::numeric_limits<uint32_t>::max(), pindexStop)) {
+            return true;
+        }
+
+        std::vector<uint256> headers(pindexStop->nHeight / CFCHECKPT_INTERVAL);
+
+        // Populate headers from the highest checkpoint down, walking back
+        // from the previous one each time.
+        const CBlockIndex* pindex = pindexStop;
+        for (int i = headers.size() - 1; i >= 0; i--) {
+            pindex = pindex->GetAncestor((i + 1) * CFCHECKPT_INTERVAL);
+            if (!pblockfilterindex->LookupFilterHeader(pindex, headers[i])) {
+                LogPrint(BCLog::NET, "Failed to find block filter header in index: block_hash=%s\n",
+                         pindex->GetBlockHash().ToString());
+                return true;
+            }
+        }
+
+        pfrom->PushMessage(NetMsgType::CFCHECKPT, filter_type, pindexStop->GetBlockHash(), headers);
+    }
+
+
     else if (strCommand == NetMsgType::TX && !IsInitialBlockDownload(chainparams))
     {
         // Stop processing the transaction early if
@@ -6008,6 +6741,20 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // Verifying the Equihash solutions is by far the most expensive part
+        // of accepting headers, so do it for the headers we don't have yet on
+        // the header check threads, before taking cs_main for the serial
+        // part. If any header fails, AcceptBlockHeader checks each one again
+        // so the offending header is rejected as before.
+        size_t nKnown = 0;
+        {
+            LOCK(cs_main);
+            while (nKnown < headers.size() && mapBlockIndex.count(headers[nKnown].GetHash()))
+                nKnown++;
+        }
+        bool fHeadersChecked = CheckBlockHeaders(headers.begin() + nKnown, headers.end(), chainparams,
+                                                 nScriptCheckThreads ? &headercheckqueue : NULL);
+
         {
         LOCK(cs_main);
 
@@ -6023,7 +6770,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 Misbehaving(pfrom->GetId(), 20);
                 return error("non-continuous headers sequence");
             }
-            if (!AcceptBlockHeader(header, state, chainparams, &pindexLast)) {
+            if (!AcceptBlockHeader(header, state, chainparams, &pindexLast, !fHeadersChecked)) {
                 int nDoS;
                 if (state.IsInvalid(nDoS)) {
                     if (nDoS > 0)
@@ -6359,6 +7106,151 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         }
     }
 
+    else if (strCommand == NetMsgType::SENDTXRCNCL)
+    {
+        uint32_t nReconVersion;
+        uint64_t nRemoteSalt;
+        vRecv >> nReconVersion >> nRemoteSalt;
+
+        {
+            LOCK(pfrom->cs_inventory);
+            // Ignore the offer unless we made one too, and once the peer let
+            // a round time out
+            if (!pfrom->txrecon || pfrom->txrecon->fRegistered || pfrom->txrecon->fTimedOut)
+                return true;
+        }
+        if (nReconVersion < 1) {
+            LogPrint(BCLog::NET, "peer=%d sent sendtxrcncl with invalid version %d\n", pfrom->id, nReconVersion);
+            pfrom->fDisconnect = true;
+            return false;
+        }
+
+        // The side that made the connection starts the rounds. We keep
+        // flooding to a few outbound peers so that transactions still
+        // propagate quickly; reconciliation then fills in the gaps.
+        bool fFlood = false;
+        if (!pfrom->fInbound) {
+            unsigned int nFlooding = 0;
+            LOCK(cs_vNodes);
+            for (CNode* pnode : vNodes) {
+                LOCK(pnode->cs_inventory);
+                if (!pnode->fInbound && pnode->txrecon && pnode->txrecon->fRegistered && pnode->txrecon->fFlood)
+                    nFlooding++;
+            }
+            fFlood = nFlooding < OUTBOUND_FANOUT_DESTINATIONS;
+        }
+
+        LOCK(pfrom->cs_inventory);
+        pfrom->txrecon->Register(nRemoteSalt, !pfrom->fInbound, fFlood);
+        pfrom->txrecon->nNextRequest = GetTimeMicros() + RECON_REQUEST_INTERVAL * 1000000LL;
+        LogPrint(BCLog::NET, "reconciling transactions with peer=%d%s\n", pfrom->id, fFlood ? " (flooding)" : "");
+    }
+
+    else if (strCommand == NetMsgType::REQRECON)
+    {
+        uint16_t nRemoteSetSize, nQ;
+        vRecv >> nRemoteSetSize >> nQ;
+
+        LOCK(pfrom->cs_inventory);
+        CTxReconciliationState* recon = pfrom->txrecon.get();
+        // A late answer to a round we gave up on
+        if (recon && recon->fTimedOut)
+            return true;
+        if (!recon || !recon->fRegistered || recon->fInitiator || recon->fRoundInFlight) {
+            LogPrint(BCLog::NET, "peer=%d sent unexpected reqrecon\n", pfrom->id);
+            pfrom->fDisconnect = true;
+            return false;
+        }
+
+        // An empty sketch tells the initiator we have nothing to announce,
+        // so the difference is simply its own set.
+        recon->Snapshot(GetTimeMicros());
+        size_t nCells = 0;
+        if (!recon->mapSnapshot.empty()) {
+            size_t nDiff = EstimateReconDifference(recon->mapSnapshot.size(), nRemoteSetSize, (double)nQ / RECON_Q_SCALE);
+            nCells = CReconSketch::CellsForDifference(nDiff);
+        }
+        pfrom->PushMessage(NetMsgType::SKETCH, recon->GetSketch(nCells));
+    }
+
+    else if (strCommand == NetMsgType::SKETCH)
+    {
+        CReconSketch sketch;
+        vRecv >> sketch;
+
+        LOCK(pfrom->cs_inventory);
+        CTxReconciliationState* recon = pfrom->txrecon.get();
+        // A late answer to a round we gave up on
+        if (recon && recon->fTimedOut)
+            return true;
+        if (!recon || !recon->fRegistered || !recon->fInitiator || !recon->fRoundInFlight || !sketch.IsValid()) {
+            LogPrint(BCLog::NET, "peer=%d sent unexpected or invalid sketch\n", pfrom->id);
+            pfrom->fDisconnect = true;
+            return false;
+        }
+
+        // Split the difference into transactions the peer lacks, which we
+        // announce, and short IDs of ones we lack, which we ask it for.
+        std::vector<uint256> vAnnounce;
+        std::vector<uint32_t> vRequest;
+        bool fSuccess = true;
+        if (sketch.GetCells() == 0) {
+            for (const std::pair<uint32_t, uint256>& item : recon->mapSnapshot)
+                vAnnounce.push_back(item.second);
+        } else {
+            CReconSketch localSketch = recon->GetSketch(sketch.GetCells());
+            std::vector<uint32_t> vDiff;
+            fSuccess = localSketch.Merge(sketch) && localSketch.Decode(vDiff);
+            for (size_t i = 0; fSuccess && i < vDiff.size(); i++) {
+                std::map<uint32_t, uint256>::const_iterator it = recon->mapSnapshot.find(vDiff[i]);
+                if (it != recon->mapSnapshot.end())
+                    vAnnounce.push_back(it->second);
+                else
+                    vRequest.push_back(vDiff[i]);
+            }
+        }
+
+        LogPrint(BCLog::NET, "reconciliation with peer=%d %s: %u cells, %u local, %u to announce, %u to request\n",
+            pfrom->id, fSuccess ? "succeeded" : "failed", sketch.GetCells(), recon->mapSnapshot.size(),
+            vAnnounce.size(), vRequest.size());
+        if (fSuccess)
+            recon->UpdateQ(vAnnounce.size(), vRequest.size());
+        else
+            vRequest.clear();
+        pfrom->PushMessage(NetMsgType::RECONCILDIFF, fSuccess, vRequest);
+
+        // On failure both sides fall back to flooding their whole round
+        std::vector<uint256> vRound = recon->EndRound();
+        AnnounceReconciledTxs(pfrom, fSuccess ? vAnnounce : vRound);
+    }
+
+    else if (strCommand == NetMsgType::RECONCILDIFF)
+    {
+        bool fSuccess;
+        std::vector<uint32_t> vShortIDs;
+        vRecv >> fSuccess >> vShortIDs;
+
+        LOCK(pfrom->cs_inventory);
+        CTxReconciliationState* recon = pfrom->txrecon.get();
+        // A late answer to a round we gave up on
+        if (recon && recon->fTimedOut)
+            return true;
+        if (!recon || !recon->fRegistered || recon->fInitiator || !recon->fRoundInFlight) {
+            LogPrint(BCLog::NET, "peer=%d sent unexpected reconcildiff\n", pfrom->id);
+            pfrom->fDisconnect = true;
+            return false;
+        }
+
+        std::vector<uint256> vAnnounce;
+        for (uint32_t nShortID : vShortIDs) {
+            std::map<uint32_t, uint256>::const_iterator it = recon->mapSnapshot.find(nShortID);
+            if (it != recon->mapSnapshot.end())
+                vAnnounce.push_back(it->second);
+        }
+        std::vector<uint256> vRound = recon->EndRound();
+        AnnounceReconciledTxs(pfrom, fSuccess ? vAnnounce : vRound);
+    }
+
     else {
         // Ignore unknown commands for extensibility
         LogPrint(BCLog::NET, "Unknown command \"%s\" from peer=%d\n", SanitizeString(strCommand), pfrom->id);
@@ -6367,6 +7259,22 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     return true;
 }
 
+/** Time spent handling a kind of P2P message; unknown commands share one */
+static PerfHistogram& MessageHistogram(const std::string& strCommand)
+{
+    static const std::string strName = "p2p_message_seconds";
+    static const std::string strHelp = "Time spent handling P2P messages, by command";
+    static const std::map<std::string, PerfHistogram*> mapHistograms = [] {
+        std::map<std::string, PerfHistogram*> mapOut;
+        for (const std::string& strType : getAllNetMessageTypes())
+            mapOut[strType] = &GetPerfHistogram(strName, strHelp, "command", strType);
+        return mapOut;
+    }();
+    static PerfHistogram& histOther = GetPerfHistogram(strName, strHelp, "command", "other");
+    std::map<std::string, PerfHistogram*>::const_iterator it = mapHistograms.find(strCommand);
+    return it == mapHistograms.end() ? histOther : *it->second;
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool ProcessMessages(CNode* pfrom)
 {
@@ -6447,6 +7355,7 @@ bool ProcessMessages(CNode* pfrom)
         bool fRet = false;
         try
         {
+            PerfTimer timer(MessageHistogram(strCommand));
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
             boost::this_thread::interruption_point();
         }
@@ -6839,6 +7748,24 @@ bool SendMessages(CNode* pto)
         if (!vInv.empty())
             pto->PushMessage(NetMsgType::INV, vInv);
 
+        //
+        // Message: reqrecon
+        //
+        {
+            LOCK(pto->cs_inventory);
+            CTxReconciliationState* recon = pto->txrecon.get();
+            if (recon && recon->fRegistered && recon->fRoundInFlight && recon->nRoundTimeout < nNow) {
+                LogPrint(BCLog::NET, "reconciliation with peer=%d timed out, flooding to it instead\n", pto->id);
+                AnnounceReconciledTxs(pto, recon->TimeOut());
+            }
+            if (recon && recon->fRegistered && recon->fInitiator && !recon->fRoundInFlight && recon->nNextRequest < nNow) {
+                recon->Snapshot(nNow);
+                uint16_t nQ = (uint16_t)(recon->dQ * RECON_Q_SCALE);
+                pto->PushMessage(NetMsgType::REQRECON, (uint16_t)recon->mapSnapshot.size(), nQ);
+                recon->nNextRequest = nNow + RECON_REQUEST_INTERVAL * 1000000LL;
+            }
+        }
+
         // Detect whether we're stalling
         nNow = GetTimeMicros();
         if (!pto->fDisconnect && state.nStallingSince && state.nStallingSince < nNow - 1000000 * BLOCK_STALLING_TIMEOUT) {
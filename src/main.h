@@ -11,6 +11,7 @@
 #endif
 
 #include "amount.h"
+#include "blockimport.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "coins.h"
@@ -45,9 +46,12 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CBloomFilter;
 class CChainParams;
 class CInv;
+class CHeaderCheck;
+class CInputPrefetch;
 class CScriptCheck;
 class CValidationInterface;
 class CValidationState;
@@ -55,6 +59,9 @@ class PrecomputedTransactionData;
 
 struct CNodeStateStats;
 
+template <typename T>
+class CCheckQueue;
+
 /** Maximum reorg length we will accept before we shut down and alert the user. */
 static const unsigned int MAX_REORG_LENGTH = COINBASE_MATURITY - 1;
 /** Default for DEFAULT_WHITELISTRELAY. */
@@ -90,7 +97,7 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 
-/** Maximum number of script-checking threads allowed */
+/** Maximum number of script-checking threads allowed (also used for header checks and input prefetching) */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
@@ -101,6 +108,12 @@ static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 160;
+/** Maximum number of compact filters that may be requested with one getcfilters. See BIP 157. */
+static const uint32_t MAX_GETCFILTERS_SIZE = 1000;
+/** Maximum number of cf hashes that may be requested with one getcfheaders. See BIP 157. */
+static const uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+/** Interval between compact filter checkpoints. See BIP 157. */
+static const int CFCHECKPT_INTERVAL = 1000;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
@@ -141,6 +154,7 @@ static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
+static const bool DEFAULT_COMPACTBLOCKINDEX = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 
 static const unsigned int DEFAULT_REORG_CHECK = 6;
@@ -178,6 +192,8 @@ extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+/** Store a compact record of each block's Sapling data, served by /rest/compactblocks */
+extern bool fCompactBlockIndex;
 
 // The following flags enable specific indices (DB tables), but are not exposed as
 // separate command-line options; instead they are enabled by experimental feature "-insightexplorer"
@@ -262,8 +278,25 @@ FILE* OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
 fs::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
-/** Import blocks from an external file */
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp = NULL);
+/** Write the chainstate at the active chain tip to a UTXO snapshot file (see dumptxoutset) */
+bool DumpUTXOSnapshot(CValidationState& state, const CChainParams& chainparams, const fs::path& path,
+                      CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats);
+/**
+ * Replace the chainstate with a UTXO snapshot and make its block, which must
+ * be ahead of the active chain in the best header chain, the tip. The
+ * snapshot hash must match hashExpected (see loadtxoutset). The blocks before
+ * it stay unvalidated until -reindex.
+ */
+bool LoadUTXOSnapshot(CValidationState& state, const CChainParams& chainparams, const fs::path& path,
+                      const uint256& hashExpected, CUTXOSnapshotMetadata& metadata, CUTXOSnapshotStats& stats);
+/** Height of the block the chainstate was loaded from a UTXO snapshot at, or -1 if it was not */
+int GetSnapshotBaseHeight();
+/**
+ * Import blocks from block files, reading and checking them in parallel (see
+ * CBlockImportPipeline). If pvOpened is given, it is set to whether each file
+ * could be opened.
+ */
+bool LoadExternalBlockFiles(const CChainParams& chainparams, const std::vector<CImportFile>& files, std::vector<bool>* pvOpened = NULL);
 /** Initialize a new block tree database + block data on disk */
 bool InitBlockIndex(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk */
@@ -280,6 +313,10 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header checking thread */
+void ThreadHeaderCheck();
+/** Run an instance of the block input prefetching thread */
+void ThreadInputPrefetch();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload(const CChainParams& chainParams);
 /** Format a string that describes several potential problems detected by the core.
@@ -372,10 +409,15 @@ bool ContextualCheckInputs(const CTransaction& tx, CValidationState &state, cons
                            const Consensus::Params& consensusParams, uint32_t consensusBranchId,
                            std::vector<CScriptCheck> *pvChecks = NULL);
 
-/** Check a transaction contextually against a set of consensus rules */
+/**
+ * Check a transaction contextually against a set of consensus rules. Valid
+ * joinSplitSig and Sapling verifications are looked up in the signature cache,
+ * and recorded there if cacheStore is set; otherwise cache hits may be evicted.
+ */
 bool ContextualCheckTransaction(const CTransaction& tx, CValidationState &state,
                                 const CChainParams& chainparams, int nHeight, int dosLevel,
-                                bool (*isInitBlockDownload)(const CChainParams&) = IsInitialBlockDownload);
+                                bool (*isInitBlockDownload)(const CChainParams&) = IsInitialBlockDownload,
+                                bool cacheStore = true);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
@@ -464,7 +506,74 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the context-independent checks of one block header
+ * (Equihash solution and proof of work).
+ */
+class CHeaderCheck
+{
+private:
+    const CBlockHeader *pheader;
+    const CChainParams *pchainparams;
+
+public:
+    CHeaderCheck(): pheader(NULL), pchainparams(NULL) {}
+    CHeaderCheck(const CBlockHeader& headerIn, const CChainParams& chainparamsIn) :
+        pheader(&headerIn), pchainparams(&chainparamsIn) { }
+
+    bool operator()();
+
+    void swap(CHeaderCheck &check) {
+        std::swap(pheader, check.pheader);
+        std::swap(pchainparams, check.pchainparams);
+    }
+};
+
+/** A block input, read from the coin database ahead of ConnectBlock. */
+struct CPrefetchedInput
+{
+    enum Type { COINS, SPROUT_NULLIFIER, SAPLING_NULLIFIER, SPROUT_ANCHOR, SAPLING_ANCHOR };
+
+    Type type;
+    uint256 hash;
+    //! Whether the read failed, leaving fFound and coins meaningless
+    bool fError;
+    bool fFound;
+    CCoins coins;
+    //! Time taken by the read, in microseconds
+    int64_t nTime;
+
+    CPrefetchedInput(Type typeIn, const uint256 &hashIn) : type(typeIn), hash(hashIn), fError(false), fFound(false), nTime(0) {}
+};
+
+/**
+ * Closure representing one read of a block input from a CCoinsView. Anchors
+ * are read only to warm the view's cache of commitment trees.
+ */
+class CInputPrefetch
+{
+private:
+    const CCoinsView *pview;
+    CPrefetchedInput *pinput;
+
+public:
+    CInputPrefetch(): pview(NULL), pinput(NULL) {}
+    CInputPrefetch(const CCoinsView& viewIn, CPrefetchedInput& inputIn) :
+        pview(&viewIn), pinput(&inputIn) { }
+
+    bool operator()();
+
+    void swap(CInputPrefetch &check) {
+        std::swap(pview, check.pview);
+        std::swap(pinput, check.pinput);
+    }
+};
+
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+/** Look up where each of keys is spent, in the mempool or the spent index,
+ *  reading the index with a single sweep. values receives a null entry for
+ *  each unspent output. */
+bool GetSpentIndex(const std::vector<CSpentIndexKey> &keys, std::vector<CSpentIndexValue> &values);
 bool GetAddressIndex(const uint160& addressHash, int type,
         std::vector<CAddressIndexDbEntry> &addressIndex,
         int start = 0, int end = 0);
@@ -477,6 +586,8 @@ bool GetTimestampIndex(unsigned int high, unsigned int low, bool fActiveOnly,
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the undo data of a block other than the genesis block. */
+bool ReadBlockUndoFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -484,6 +595,14 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     const CChainParams& chainparams,
     bool fCheckPOW = true);
+/**
+ * Run the context-independent checks of CheckBlockHeader on a batch of
+ * headers, on the threads of pqueue if it is not NULL, without holding
+ * cs_main. Returns false if any header fails; the headers must then be
+ * accepted with fCheckPOW set to find out which one.
+ */
+bool CheckBlockHeaders(std::vector<CBlockHeader>::const_iterator begin, std::vector<CBlockHeader>::const_iterator end,
+    const CChainParams& chainparams, CCheckQueue<CHeaderCheck>* pqueue);
 bool CheckBlock(const CBlock& block, CValidationState& state,
                 const CChainParams& chainparams,
                 ProofVerifier& verifier,
@@ -495,7 +614,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state,
  bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& state,
                                  const CChainParams& chainparams, CBlockIndex *pindexPrev, bool fCheckPOW = true);
  bool ContextualCheckBlock(const CBlock& block, CValidationState& state,
-                           const CChainParams& chainparams, CBlockIndex *pindexPrev);
+                           const CChainParams& chainparams, CBlockIndex *pindexPrev,
+                           bool fCacheResults = true);
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
@@ -537,6 +657,9 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex);
 /** The currently-connected chain of blocks (protected by cs_main). */
 extern CChain chainActive;
 
+/** Global variable that points to the coins database (protected by cs_main) */
+extern CCoinsViewDB *pcoinsdbview;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
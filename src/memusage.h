@@ -5,9 +5,14 @@
 #ifndef BITCOIN_MEMUSAGE_H
 #define BITCOIN_MEMUSAGE_H
 
+#include "compacthashmap.h"
+#include "prevector.h"
+
+#include <assert.h>
 #include <stdlib.h>
 
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 #include <unordered_map>
@@ -104,6 +109,21 @@ static inline size_t IncrementalDynamicUsage(const std::map<X, Y, Z>& m)
     return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y> >));
 }
 
+// Control block of a std::shared_ptr; platforms differ in its exact layout
+struct stl_shared_counter
+{
+    size_t class_type;
+    size_t use_count;
+    size_t weak_count;
+};
+
+template<typename X>
+static inline size_t DynamicUsage(const std::shared_ptr<X>& p)
+{
+    // A shared object is counted in full by each of its owners
+    return p ? MallocUsage(sizeof(X)) + MallocUsage(sizeof(stl_shared_counter)) : 0;
+}
+
 template<typename X>
 struct unordered_node : private X
 {
@@ -123,6 +143,16 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const compacthashmap<X, Y, Z>& m)
+{
+    return MallocUsage(sizeof(uint64_t) * m.bucket_count()) +
+           MallocUsage(m.chunk_bytes()) * m.chunk_count() +
+           MallocUsage(sizeof(void*) * m.chunk_count()) +
+           MallocUsage(m.position_count() / 8) +
+           MallocUsage(sizeof(uint32_t) * m.free_count());
+}
+
 }
 
 #endif // BITCOIN_MEMUSAGE_H
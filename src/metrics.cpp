@@ -5,6 +5,7 @@
 
 #include "metrics.h"
 
+#include "blockimport.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "main.h"
@@ -277,6 +278,10 @@ int printStats(bool mining)
         if (fReindex) {
             int downloadPercent = nSizeReindexed * 100 / nFullSizeToReindex;
             std::cout << "      " << _("Reindexing blocks") << " | " << DisplaySize(nSizeReindexed) << " / " << DisplaySize(nFullSizeToReindex) << " (" << downloadPercent << "%, " << height << " " << _("blocks") << ")" << std::endl;
+            if (importStats.nStartTime != 0) {
+                std::cout << "        " << _("Import pipeline") << " | " << importStats.ToString() << std::endl;
+                lines++;
+            }
         } else {
             int netheight = currentHeadersHeight == -1 || currentHeadersTime == 0 ?
             0 : EstimateNetHeight(params, currentHeadersHeight, currentHeadersTime);
@@ -235,11 +235,13 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn)
     pblocktemplate->vTxFees[0] = -nFees;
 
     // Update the Sapling commitment tree.
+    std::vector<libzcash::PedersenHash> sapling_commitments;
     for (const CTransaction& tx : pblock->vtx) {
         for (const OutputDescription& odesc : tx.vShieldedOutput) {
-            sapling_tree.append(odesc.cmu);
+            sapling_commitments.push_back(odesc.cmu);
         }
     }
+    sapling_tree.append_batch(sapling_commitments);
 
     // Randomise nonce
     arith_uint256 nonce = UintToArith256(GetRandHash());
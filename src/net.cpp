@@ -55,9 +55,11 @@ namespace {
 //
 bool fDiscover = true;
 bool fListen = true;
+bool fTxReconciliation = DEFAULT_TXRECONCILIATION;
 uint64_t nLocalServices = NODE_NETWORK;
 CCriticalSection cs_mapLocalHost;
 map<CNetAddr, LocalServiceInfo> mapLocalHost;
+const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 static bool vfLimited[NET_MAX] = {};
 static CNode* pnodeLocalHost = NULL;
 uint64_t nLocalHostNonce = 0;
@@ -69,9 +71,6 @@ std::string strSubVersion;
 
 vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
-map<CInv, CDataStream> mapRelay;
-deque<pair<int64_t, CInv> > vRelayExpiration;
-CCriticalSection cs_mapRelay;
 limitedmap<CInv, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
 
 static deque<string> vOneShots;
@@ -677,13 +676,22 @@ void CNode::copyStats(CNodeStats &stats)
     stats.nStartingHeight = nStartingHeight;
     {
         LOCK(cs_vSend);
+        stats.mapSendBytesPerMsg = mapSendBytesPerMsg;
         stats.nSendBytes = nSendBytes;
     }
     {
         LOCK(cs_vRecv);
         stats.nRecvBytes = nRecvBytes;
     }
+    {
+        LOCK(cs_vRecvMsg);
+        stats.mapRecvBytesPerMsg = mapRecvBytesPerMsg;
+    }
     stats.fWhitelisted = fWhitelisted;
+    {
+        LOCK(cs_inventory);
+        stats.fTxReconciliation = txrecon && txrecon->fRegistered;
+    }
 
     // It is common for nodes with good ping times to suddenly become lagged,
     // due to a new block arriving or other large transfer.
@@ -736,6 +744,14 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
         nBytes -= handled;
 
         if (msg.complete()) {
+            // Store received bytes per message command; only known commands
+            // get their own entry so peers cannot grow the map
+            mapMsgCmdSize::iterator i = mapRecvBytesPerMsg.find(msg.hdr.GetCommand());
+            if (i == mapRecvBytesPerMsg.end())
+                i = mapRecvBytesPerMsg.find(NET_MESSAGE_COMMAND_OTHER);
+            assert(i != mapRecvBytesPerMsg.end());
+            i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+
             msg.nTime = GetTimeMicros();
             messageHandlerCondition.notify_one();
         }
@@ -2032,28 +2048,9 @@ instance_of_cnetcleanup;
 
 void RelayTransaction(const CTransaction& tx, CFeeRate feerate)
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(10000);
-    ss << tx;
-    RelayTransaction(tx, feerate, ss);
-}
-
-void RelayTransaction(const CTransaction& tx, CFeeRate feerate, const CDataStream& ss)
-{
+    // Peers fetch the transaction from the mempool, or from the relay
+    // cache once it has left it
     CInv inv(MSG_TX, tx.GetHash());
-    {
-        LOCK(cs_mapRelay);
-        // Expire old relay messages
-        while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime())
-        {
-            mapRelay.erase(vRelayExpiration.front().second);
-            vRelayExpiration.pop_front();
-        }
-
-        // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
-        vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
-    }
     LOCK(cs_vNodes);
     for (CNode* pnode : vNodes)
     {
@@ -2258,6 +2255,10 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     lastSentFeeFilter = 0;
     nextSendTimeFeeFilter = 0;
 
+    for (const std::string &msg : getAllNetMessageTypes())
+        mapRecvBytesPerMsg[msg] = 0;
+    mapRecvBytesPerMsg[NET_MESSAGE_COMMAND_OTHER] = 0;
+
     {
         LOCK(cs_nLastNodeId);
         id = nLastNodeId++;
@@ -2367,6 +2368,9 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
 
     LogPrint(BCLog::NET, "(%d bytes) peer=%d\n", nSize, id);
 
+    const char* pszCommand = &ssSend[MESSAGE_START_SIZE];
+    mapSendBytesPerMsg[std::string(pszCommand, strnlen(pszCommand, CMessageHeader::COMMAND_SIZE))] += ssSend.size();
+
     std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
     ssSend.GetAndClear(*it);
     nSendSize += (*it).size();
@@ -17,10 +17,12 @@
 #include "random.h"
 #include "streams.h"
 #include "sync.h"
+#include "txreconciliation.h"
 #include "uint256.h"
 #include "utilstrencodings.h"
 
 #include <deque>
+#include <memory>
 #include <stdint.h>
 #include <atomic>
 
@@ -150,6 +152,8 @@ CAddress GetLocalAddress(const CNetAddr *paddrPeer = NULL);
 
 extern bool fDiscover;
 extern bool fListen;
+/** Reconcile transaction announcements with peers that support it (-txreconciliation) */
+extern bool fTxReconciliation;
 extern uint64_t nLocalServices;
 extern uint64_t nLocalHostNonce;
 extern CAddrMan addrman;
@@ -159,9 +163,6 @@ extern int nMaxConnections;
 
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
-extern std::map<CInv, CDataStream> mapRelay;
-extern std::deque<std::pair<int64_t, CInv> > vRelayExpiration;
-extern CCriticalSection cs_mapRelay;
 extern limitedmap<CInv, int64_t> mapAlreadyAskedFor;
 
 extern std::vector<std::string> vAddedNodes;
@@ -181,6 +182,10 @@ struct LocalServiceInfo {
 extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
+/** Bytes received of unknown message types are counted under this command */
+extern const std::string NET_MESSAGE_COMMAND_OTHER;
+typedef std::map<std::string, uint64_t> mapMsgCmdSize; //command, total bytes
+
 class CNodeStats
 {
 public:
@@ -197,8 +202,11 @@ public:
     bool fInbound;
     int nStartingHeight;
     uint64_t nSendBytes;
+    mapMsgCmdSize mapSendBytesPerMsg;
     uint64_t nRecvBytes;
+    mapMsgCmdSize mapRecvBytesPerMsg;
     bool fWhitelisted;
+    bool fTxReconciliation;
     double dPingTime;
     double dPingWait;
     std::string addrLocal;
@@ -305,6 +313,9 @@ public:
 
 protected:
 
+    mapMsgCmdSize mapSendBytesPerMsg; // protected by cs_vSend
+    mapMsgCmdSize mapRecvBytesPerMsg; // protected by cs_vRecvMsg
+
     // Denial-of-service detection/prevention
     // Key is IP address, value is banned-until-time
     static banmap_t setBanned;
@@ -349,6 +360,9 @@ public:
     // Used for headers announcements - unfiltered blocks to relay
     // Also protected by cs_inventory
     std::vector<uint256> vBlockHashesToAnnounce;
+    // Transaction reconciliation state, set when we offer reconciliation
+    // to the peer. Also protected by cs_inventory
+    std::unique_ptr<CTxReconciliationState> txrecon;
 
     // Ping time measurement:
     // The pong reply we're expecting, or 0 if no pong expected.
@@ -467,6 +481,8 @@ public:
         {
             LOCK(cs_inventory);
             filterInventoryKnown.insert(inv.hash);
+            if (inv.type == MSG_TX && txrecon && txrecon->fRegistered)
+                txrecon->RemoveTx(inv.hash);
         }
     }
 
@@ -475,7 +491,10 @@ public:
         LOCK(cs_inventory);
         if (inv.type == MSG_TX) {
             if (!filterInventoryKnown.contains(inv.hash)) {
-                setInventoryTxToSend.insert(inv.hash);
+                // Reconciling peers learn about transactions in the next
+                // round, unless we flood to them or the round is full.
+                if (!txrecon || !txrecon->fRegistered || txrecon->fFlood || !txrecon->AddTx(inv.hash))
+                    setInventoryTxToSend.insert(inv.hash);
             }
         } else if (inv.type == MSG_BLOCK) {
             vInventoryBlockToSend.push_back(inv.hash);
@@ -735,7 +754,6 @@ public:
 
 class CTransaction;
 void RelayTransaction(const CTransaction& tx, CFeeRate feerate);
-void RelayTransaction(const CTransaction& tx, CFeeRate feerate, const CDataStream& ss);
 
 /** Return a timestamp in the future (in microseconds) for exponentially distributed events. */
 int64_t PoissonNextSend(int64_t nNow, int average_interval_seconds);
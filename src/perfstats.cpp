@@ -0,0 +1,267 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "perfstats.h"
+
+#include "tinyformat.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+PerfHistogram::PerfHistogram() : nSumMicros(0), nMaxMicros(0)
+{
+    for (int i = 0; i < BUCKETS; i++)
+        vBuckets[i] = 0;
+}
+
+int PerfHistogram::BucketIndex(uint64_t nMicros)
+{
+    // The number of bits in nMicros - 1 is the smallest i with 2^i >= nMicros
+    int i = 0;
+    for (uint64_t n = nMicros > 0 ? nMicros - 1 : 0; n != 0 && i + 1 < BUCKETS; n >>= 1)
+        i++;
+    return i;
+}
+
+void PerfHistogram::Observe(int64_t nMicros)
+{
+    // The clock can step back
+    uint64_t n = nMicros > 0 ? nMicros : 0;
+    vBuckets[BucketIndex(n)].fetch_add(1, std::memory_order_relaxed);
+    nSumMicros.fetch_add(n, std::memory_order_relaxed);
+    uint64_t nMax = nMaxMicros.load(std::memory_order_relaxed);
+    while (n > nMax && !nMaxMicros.compare_exchange_weak(nMax, n, std::memory_order_relaxed)) {
+    }
+}
+
+PerfHistogram::Snapshot PerfHistogram::Get() const
+{
+    // Each field is read on its own, so a snapshot taken while durations
+    // are added may be off by those few
+    Snapshot snap;
+    snap.nCount = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        snap.vBuckets[i] = vBuckets[i].load(std::memory_order_relaxed);
+        snap.nCount += snap.vBuckets[i];
+    }
+    snap.nSumMicros = nSumMicros.load(std::memory_order_relaxed);
+    snap.nMaxMicros = nMaxMicros.load(std::memory_order_relaxed);
+    return snap;
+}
+
+uint64_t PerfHistogram::Snapshot::QuantileMicros(double q) const
+{
+    if (nCount == 0)
+        return 0;
+    uint64_t nRank = q * nCount;
+    if (nRank >= nCount)
+        nRank = nCount - 1;
+    uint64_t nSeen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        nSeen += vBuckets[i];
+        if (nSeen > nRank) {
+            // No bound is tighter than the largest duration seen
+            uint64_t nBound = BucketBound(i);
+            return nBound == 0 || nBound > nMaxMicros ? nMaxMicros : nBound;
+        }
+    }
+    return nMaxMicros;
+}
+
+namespace {
+
+struct Family {
+    PerfMetricType type;
+    std::string strHelp;
+    std::string strLabel;
+    std::map<std::string, std::unique_ptr<PerfCounter> > mapCounters;
+    std::map<std::string, std::unique_ptr<PerfGauge> > mapGauges;
+    std::map<std::string, std::unique_ptr<PerfHistogram> > mapHistograms;
+    std::map<std::string, std::function<int64_t()> > mapCallbacks;
+};
+
+struct Registry {
+    std::mutex cs;
+    std::map<std::string, Family> mapFamilies;
+};
+
+Registry& GetRegistry()
+{
+    // Never destroyed, as threads may still update metrics during shutdown
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+Family& GetFamily(Registry& registry, PerfMetricType type, const std::string& strName,
+                  const std::string& strHelp, const std::string& strLabel)
+{
+    auto it = registry.mapFamilies.find(strName);
+    if (it == registry.mapFamilies.end()) {
+        Family& family = registry.mapFamilies[strName];
+        family.type = type;
+        family.strHelp = strHelp;
+        family.strLabel = strLabel;
+        return family;
+    }
+    assert(it->second.type == type && it->second.strLabel == strLabel);
+    return it->second;
+}
+
+template <typename T>
+T& GetMetric(std::map<std::string, std::unique_ptr<T> >& mapMetrics, const std::string& strLabelValue)
+{
+    std::unique_ptr<T>& metric = mapMetrics[strLabelValue];
+    if (!metric)
+        metric.reset(new T());
+    return *metric;
+}
+
+} // namespace
+
+PerfCounter& GetPerfCounter(const std::string& strName, const std::string& strHelp,
+                            const std::string& strLabel, const std::string& strLabelValue)
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.cs);
+    Family& family = GetFamily(registry, PERF_COUNTER, strName, strHelp, strLabel);
+    assert(!family.mapCallbacks.count(strLabelValue));
+    return GetMetric(family.mapCounters, strLabelValue);
+}
+
+PerfGauge& GetPerfGauge(const std::string& strName, const std::string& strHelp,
+                        const std::string& strLabel, const std::string& strLabelValue)
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.cs);
+    Family& family = GetFamily(registry, PERF_GAUGE, strName, strHelp, strLabel);
+    assert(!family.mapCallbacks.count(strLabelValue));
+    return GetMetric(family.mapGauges, strLabelValue);
+}
+
+PerfHistogram& GetPerfHistogram(const std::string& strName, const std::string& strHelp,
+                                const std::string& strLabel, const std::string& strLabelValue)
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.cs);
+    Family& family = GetFamily(registry, PERF_HISTOGRAM, strName, strHelp, strLabel);
+    return GetMetric(family.mapHistograms, strLabelValue);
+}
+
+void RegisterPerfCallback(const std::string& strName, const std::string& strHelp, PerfMetricType type,
+                          const std::string& strLabel, const std::string& strLabelValue,
+                          const std::function<int64_t()>& fn)
+{
+    assert(type != PERF_HISTOGRAM);
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.cs);
+    Family& family = GetFamily(registry, type, strName, strHelp, strLabel);
+    assert(!family.mapCounters.count(strLabelValue) && !family.mapGauges.count(strLabelValue));
+    family.mapCallbacks[strLabelValue] = fn;
+}
+
+std::vector<PerfFamily> GetPerfStats()
+{
+    std::vector<PerfFamily> vFamilies;
+    //! Family index, label value and callback
+    std::vector<std::tuple<size_t, std::string, std::function<int64_t()> > > vCallbacks;
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.cs);
+        for (const auto& item : registry.mapFamilies) {
+            const Family& family = item.second;
+            PerfFamily out;
+            out.strName = item.first;
+            out.strHelp = family.strHelp;
+            out.type = family.type;
+            out.strLabel = family.strLabel;
+            for (const auto& metric : family.mapCounters) {
+                PerfSample sample;
+                sample.strLabelValue = metric.first;
+                sample.nValue = metric.second->Get();
+                out.vSamples.push_back(sample);
+            }
+            for (const auto& metric : family.mapGauges) {
+                PerfSample sample;
+                sample.strLabelValue = metric.first;
+                sample.nValue = metric.second->Get();
+                out.vSamples.push_back(sample);
+            }
+            for (const auto& metric : family.mapHistograms) {
+                PerfSample sample;
+                sample.strLabelValue = metric.first;
+                sample.hist = metric.second->Get();
+                out.vSamples.push_back(sample);
+            }
+            for (const auto& callback : family.mapCallbacks)
+                vCallbacks.emplace_back(vFamilies.size(), callback.first, callback.second);
+            vFamilies.push_back(out);
+        }
+    }
+
+    // Callbacks may take other locks, so they run without the registry's
+    for (const auto& callback : vCallbacks) {
+        PerfSample sample;
+        sample.strLabelValue = std::get<1>(callback);
+        sample.nValue = std::get<2>(callback)();
+        std::vector<PerfSample>& vSamples = vFamilies[std::get<0>(callback)].vSamples;
+        vSamples.insert(std::upper_bound(vSamples.begin(), vSamples.end(), sample,
+            [](const PerfSample& a, const PerfSample& b) { return a.strLabelValue < b.strLabelValue; }), sample);
+    }
+    return vFamilies;
+}
+
+static std::string EscapeLabelValue(const std::string& str)
+{
+    std::string strOut;
+    for (char c : str) {
+        if (c == '\\' || c == '"')
+            strOut += '\\';
+        if (c == '\n')
+            strOut += "\\n";
+        else
+            strOut += c;
+    }
+    return strOut;
+}
+
+static std::string FormatMicros(uint64_t nMicros)
+{
+    return strprintf("%d.%06d", nMicros / 1000000, nMicros % 1000000);
+}
+
+std::string FormatPerfStatsPrometheus(const std::vector<PerfFamily>& vFamilies)
+{
+    static const char* const pszTypes[] = {"counter", "gauge", "histogram"};
+    std::string strOut;
+    for (const PerfFamily& family : vFamilies) {
+        const std::string strName = "bitcoinz_" + family.strName;
+        strOut += strprintf("# HELP %s %s\n", strName, family.strHelp);
+        strOut += strprintf("# TYPE %s %s\n", strName, pszTypes[family.type]);
+        for (const PerfSample& sample : family.vSamples) {
+            std::string strLabels;
+            if (!family.strLabel.empty())
+                strLabels = strprintf("%s=\"%s\"", family.strLabel, EscapeLabelValue(sample.strLabelValue));
+            if (family.type != PERF_HISTOGRAM) {
+                strOut += strprintf("%s%s %d\n", strName, strLabels.empty() ? "" : "{" + strLabels + "}", sample.nValue);
+                continue;
+            }
+            const std::string strSep = strLabels.empty() ? "" : ",";
+            uint64_t nCumulative = 0;
+            for (int i = 0; i < PerfHistogram::BUCKETS; i++) {
+                nCumulative += sample.hist.vBuckets[i];
+                uint64_t nBound = PerfHistogram::BucketBound(i);
+                strOut += strprintf("%s_bucket{%s%sle=\"%s\"} %d\n", strName, strLabels, strSep,
+                                    nBound ? FormatMicros(nBound) : "+Inf", nCumulative);
+            }
+            const std::string strBraced = strLabels.empty() ? "" : "{" + strLabels + "}";
+            strOut += strprintf("%s_sum%s %s\n", strName, strBraced, FormatMicros(sample.hist.nSumMicros));
+            strOut += strprintf("%s_count%s %d\n", strName, strBraced, nCumulative);
+        }
+    }
+    return strOut;
+}
@@ -0,0 +1,158 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_PERFSTATS_H
+#define BITCOIN_PERFSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Performance counters, gauges and latency histograms, registered by name
+ * and read by getperfstats and the /metrics endpoint. Updating them takes no
+ * locks; looking one up does, so hot paths look theirs up once and keep the
+ * reference, which stays valid for the life of the process.
+ */
+
+/** A count of events that only increases */
+class PerfCounter
+{
+private:
+    std::atomic<uint64_t> nValue;
+
+public:
+    PerfCounter() : nValue(0) {}
+
+    void Add(uint64_t n = 1) { nValue.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const { return nValue.load(std::memory_order_relaxed); }
+};
+
+/** A value that is set, or moves up and down */
+class PerfGauge
+{
+private:
+    std::atomic<int64_t> nValue;
+
+public:
+    PerfGauge() : nValue(0) {}
+
+    void Set(int64_t n) { nValue.store(n, std::memory_order_relaxed); }
+    void Add(int64_t n) { nValue.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Get() const { return nValue.load(std::memory_order_relaxed); }
+};
+
+/**
+ * Durations in microseconds, counted in buckets whose upper bounds are
+ * powers of two: bucket i holds durations of at most 2^i us, and the last
+ * one everything longer. Quantiles read from it are accurate to within a
+ * factor of two, which is what latency monitoring needs.
+ */
+class PerfHistogram
+{
+public:
+    static const int BUCKETS = 32;
+
+    struct Snapshot {
+        uint64_t nCount;
+        uint64_t nSumMicros;
+        uint64_t nMaxMicros;
+        uint64_t vBuckets[BUCKETS];
+
+        /** Upper bound of the bucket holding quantile q (0 to 1) */
+        uint64_t QuantileMicros(double q) const;
+    };
+
+private:
+    std::atomic<uint64_t> vBuckets[BUCKETS];
+    std::atomic<uint64_t> nSumMicros;
+    std::atomic<uint64_t> nMaxMicros;
+
+public:
+    PerfHistogram();
+
+    /** Upper bound of bucket i in microseconds, or 0 for the last, which has none */
+    static uint64_t BucketBound(int i) { return i + 1 < BUCKETS ? (uint64_t)1 << i : 0; }
+    static int BucketIndex(uint64_t nMicros);
+
+    void Observe(int64_t nMicros);
+    Snapshot Get() const;
+};
+
+/**
+ * Adds the time from its construction to its destruction to a histogram. It
+ * reads the steady clock, which is cheaper than GetTimeMicros and never
+ * steps.
+ */
+class PerfTimer
+{
+private:
+    PerfHistogram& hist;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit PerfTimer(PerfHistogram& histIn) : hist(histIn), start(std::chrono::steady_clock::now()) {}
+    ~PerfTimer()
+    {
+        hist.Observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+enum PerfMetricType {
+    PERF_COUNTER,
+    PERF_GAUGE,
+    PERF_HISTOGRAM,
+};
+
+/**
+ * Look up, or register, the metric named strName. Metrics with the same name
+ * form a family, which shares a kind, help text and label name, and holds
+ * one metric per label value. Label values must come from a small fixed set,
+ * as each is kept until shutdown.
+ */
+PerfCounter& GetPerfCounter(const std::string& strName, const std::string& strHelp,
+                            const std::string& strLabel = "", const std::string& strLabelValue = "");
+PerfGauge& GetPerfGauge(const std::string& strName, const std::string& strHelp,
+                        const std::string& strLabel = "", const std::string& strLabelValue = "");
+PerfHistogram& GetPerfHistogram(const std::string& strName, const std::string& strHelp,
+                                const std::string& strLabel = "", const std::string& strLabelValue = "");
+/**
+ * Register a counter or gauge whose value is read from fn each time stats
+ * are taken, for values that are already kept elsewhere
+ */
+void RegisterPerfCallback(const std::string& strName, const std::string& strHelp, PerfMetricType type,
+                          const std::string& strLabel, const std::string& strLabelValue,
+                          const std::function<int64_t()>& fn);
+
+struct PerfSample {
+    std::string strLabelValue;
+    //! Value of a counter or gauge
+    int64_t nValue;
+    PerfHistogram::Snapshot hist;
+
+    PerfSample() : nValue(0), hist() {}
+};
+
+struct PerfFamily {
+    std::string strName;
+    std::string strHelp;
+    PerfMetricType type;
+    std::string strLabel;
+    //! In order of label value
+    std::vector<PerfSample> vSamples;
+};
+
+/** Read every metric, in order of name */
+std::vector<PerfFamily> GetPerfStats();
+
+/**
+ * Format stats in the Prometheus text exposition format, with names
+ * prefixed "bitcoinz_" and histograms in seconds
+ */
+std::string FormatPerfStatsPrometheus(const std::vector<PerfFamily>& vFamilies);
+
+#endif // BITCOIN_PERFSTATS_H
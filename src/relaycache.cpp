@@ -0,0 +1,93 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "relaycache.h"
+
+#include "utiltime.h"
+
+#include <algorithm>
+
+CRelayCache relayCache;
+
+CRelayCache::CRelayCache(size_t nShards, size_t nMaxBytes) :
+    nMaxShardBytes(nMaxBytes / std::max<size_t>(nShards, 1))
+{
+    vShards.resize(std::max<size_t>(nShards, 1));
+    for (std::unique_ptr<Shard>& shard : vShards)
+        shard.reset(new Shard());
+}
+
+CRelayCache::Shard& CRelayCache::GetShard(const uint256& hash) const
+{
+    return *vShards[hash.GetCheapHash() % vShards.size()];
+}
+
+void CRelayCache::EraseFront(Shard& shard)
+{
+    const Record& front = shard.vInserted.front();
+    std::map<uint256, Entry>::iterator it = shard.mapTx.find(front.hash);
+    if (it != shard.mapTx.end() && it->second.nSequence == front.nSequence) {
+        shard.nBytes -= it->second.nSize;
+        shard.mapTx.erase(it);
+    }
+    shard.vInserted.pop_front();
+}
+
+void CRelayCache::Insert(const uint256& hash, const TxRef& tx, size_t nSize, int64_t nTime)
+{
+    int64_t nNow = GetTime();
+    if (nTime + RELAY_CACHE_EXPIRY < nNow || nSize > nMaxShardBytes)
+        return;
+
+    Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+
+    // Records are in insertion order, so everything inserted more than
+    // RELAY_CACHE_EXPIRY ago has expired
+    while (!shard.vInserted.empty() && shard.vInserted.front().nInserted + RELAY_CACHE_EXPIRY < nNow)
+        EraseFront(shard);
+
+    Entry& entry = shard.mapTx[hash];
+    if (entry.tx)
+        shard.nBytes -= entry.nSize;
+    entry.nSequence = shard.nSequence++;
+    entry.nExpiry = nTime + RELAY_CACHE_EXPIRY;
+    entry.nSize = nSize;
+    entry.tx = tx;
+    shard.nBytes += nSize;
+    shard.vInserted.push_back(Record{nNow, entry.nSequence, hash});
+
+    while (shard.nBytes > nMaxShardBytes)
+        EraseFront(shard);
+}
+
+CRelayCache::TxRef CRelayCache::Lookup(const uint256& hash) const
+{
+    const Shard& shard = GetShard(hash);
+    LOCK(shard.cs);
+    std::map<uint256, Entry>::const_iterator it = shard.mapTx.find(hash);
+    if (it == shard.mapTx.end() || it->second.nExpiry < GetTime())
+        return TxRef();
+    return it->second.tx;
+}
+
+size_t CRelayCache::Size() const
+{
+    size_t nSize = 0;
+    for (const std::unique_ptr<Shard>& shard : vShards) {
+        LOCK(shard->cs);
+        nSize += shard->mapTx.size();
+    }
+    return nSize;
+}
+
+size_t CRelayCache::Bytes() const
+{
+    size_t nBytes = 0;
+    for (const std::unique_ptr<Shard>& shard : vShards) {
+        LOCK(shard->cs);
+        nBytes += shard->nBytes;
+    }
+    return nBytes;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_RELAYCACHE_H
+#define BITCOIN_RELAYCACHE_H
+
+#include "primitives/transaction.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+/** Seconds after entering the mempool a transaction can still be requested
+ *  by peers we announced it to */
+static const int64_t RELAY_CACHE_EXPIRY = 15 * 60;
+/** Number of independently locked shards of the relay cache */
+static const size_t DEFAULT_RELAY_CACHE_SHARDS = 16;
+/** Maximum serialized size of the transactions held by the relay cache */
+static const size_t DEFAULT_RELAY_CACHE_BYTES = 32 * 1024 * 1024;
+
+/**
+ * Transactions that recently left the mempool, after being mined, evicted or
+ * replaced, kept so that peers we announced them to can still fetch them.
+ * Transactions in the mempool are served from it directly. The cache shares
+ * the mempool entry's transaction, so caching copies nothing; it is only
+ * serialized when a peer requests it.
+ *
+ * The cache is split into shards by transaction hash, each with its own
+ * lock, so that concurrent lookups of different transactions don't contend.
+ * Entries expire RELAY_CACHE_EXPIRY seconds after they entered the mempool,
+ * and the oldest ones are dropped first when a shard runs out of space.
+ */
+class CRelayCache
+{
+public:
+    typedef std::shared_ptr<const CTransaction> TxRef;
+
+private:
+    struct Entry {
+        uint64_t nSequence;
+        int64_t nExpiry;
+        size_t nSize;
+        TxRef tx;
+    };
+
+    struct Record {
+        int64_t nInserted;
+        uint64_t nSequence;
+        uint256 hash;
+    };
+
+    struct Shard {
+        mutable CCriticalSection cs;
+        std::map<uint256, Entry> mapTx;
+        //! Insertions, oldest first, for expiry and eviction. Hashes inserted
+        //! again keep their older record, which no longer matches the entry.
+        std::deque<Record> vInserted;
+        uint64_t nSequence;
+        size_t nBytes;
+
+        Shard() : nSequence(0), nBytes(0) {}
+    };
+
+    const size_t nMaxShardBytes;
+    std::vector<std::unique_ptr<Shard> > vShards;
+
+    Shard& GetShard(const uint256& hash) const;
+    //! Requires shard.cs
+    void EraseFront(Shard& shard);
+
+public:
+    explicit CRelayCache(size_t nShards = DEFAULT_RELAY_CACHE_SHARDS, size_t nMaxBytes = DEFAULT_RELAY_CACHE_BYTES);
+
+    /** Cache a transaction of nSize serialized bytes that entered the mempool at nTime */
+    void Insert(const uint256& hash, const TxRef& tx, size_t nSize, int64_t nTime);
+    /** Look up a cached transaction; returns NULL if absent or expired */
+    TxRef Lookup(const uint256& hash) const;
+
+    size_t Size() const;
+    size_t Bytes() const;
+};
+
+extern CRelayCache relayCache;
+
+#endif // BITCOIN_RELAYCACHE_H
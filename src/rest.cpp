@@ -4,12 +4,15 @@
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
 #include "chainparams.h"
+#include "compactblockindex.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
 #include "httpserver.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "streams.h"
+#include "txdb.h"
 #include "sync.h"
 #include "txmempool.h"
 #include "utilstrencodings.h"
@@ -23,12 +26,14 @@
 using namespace std;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const int MAX_REST_COMPACT_BLOCKS = 10000; //allow a max of 10000 compact blocks to be queried at once
 
 enum RetFormat {
     RF_UNDEF,
     RF_BINARY,
     RF_HEX,
     RF_JSON,
+    RF_CBOR,
 };
 
 static const struct {
@@ -39,6 +44,7 @@ static const struct {
       {RF_BINARY, "bin"},
       {RF_HEX, "hex"},
       {RF_JSON, "json"},
+      {RF_CBOR, "cbor"},
 };
 
 struct CCoin {
@@ -57,10 +63,10 @@ struct CCoin {
     }
 };
 
-extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
-extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern void TxToJSON(JSONWriter& writer, const CTransaction& tx, const uint256 hashBlock, bool fIncludeHex = true);
+extern void blockToJSON(JSONWriter& writer, const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
 extern UniValue mempoolInfoToJSON();
-extern UniValue mempoolToJSON(bool fVerbose = false);
+extern void mempoolToJSON(JSONWriter& writer, bool fVerbose = false);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
@@ -71,6 +77,27 @@ static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message
     return false;
 }
 
+/**
+ * Send a JSON or CBOR reply as fn writes it, rather than building it all
+ * first
+ */
+static void WriteDecodedReply(HTTPRequest* req, enum RetFormat rf, const std::function<void(JSONWriter&)>& fn)
+{
+    JSONTextWriter::Sink sink = [req](const std::string& strPart, bool fLast) {
+        req->WriteReplyPart(HTTP_OK, strPart, fLast);
+    };
+    std::unique_ptr<JSONWriter> writer;
+    if (rf == RF_CBOR) {
+        writer.reset(new CBORWriter(sink));
+        req->WriteHeader("Content-Type", "application/cbor");
+    } else {
+        writer.reset(new JSONTextWriter(sink));
+        req->WriteHeader("Content-Type", "application/json");
+    }
+    fn(*writer);
+    writer->Finish();
+}
+
 static enum RetFormat ParseDataFormat(vector<string>& params, const string& strReq)
 {
     boost::split(params, strReq, boost::is_any_of("."));
@@ -243,11 +270,11 @@ static bool rest_block(HTTPRequest* req,
         return true;
     }
 
-    case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+    case RF_JSON:
+    case RF_CBOR: {
+        WriteDecodedReply(req, rf, [&](JSONWriter& writer) {
+            blockToJSON(writer, block, pblockindex, showTxDetails);
+        });
         return true;
     }
 
@@ -270,6 +297,72 @@ static bool rest_block_notxdetails(HTTPRequest* req, const std::string& strURIPa
     return rest_block(req, strURIPart, false);
 }
 
+static bool rest_compactblocks(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block range specified. Use /rest/compactblocks/<start>/<end>.<ext>.");
+
+    if (!fCompactBlockIndex)
+        return RESTERR(req, HTTP_NOT_FOUND, "Compact block index not enabled (use -compactblockindex)");
+
+    int nStart, nEnd;
+    if (!ParseInt32(path[0], &nStart) || !ParseInt32(path[1], &nEnd) || nStart < 0 || nEnd < nStart)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid block range: " + path[0] + "/" + path[1]);
+    if (nEnd - nStart >= MAX_REST_COMPACT_BLOCKS)
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Block range too large, at most %d blocks may be requested", MAX_REST_COMPACT_BLOCKS));
+
+    // The range is cut off at the tip, so clients following the chain can
+    // ask for more blocks than there are.
+    std::vector<uint256> hashes;
+    {
+        LOCK(cs_main);
+        if (nStart > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range: " + path[0]);
+        nEnd = std::min(nEnd, chainActive.Height());
+        hashes.reserve(nEnd - nStart + 1);
+        for (int nHeight = nStart; nHeight <= nEnd; nHeight++)
+            hashes.push_back(chainActive[nHeight]->GetBlockHash());
+    }
+
+    CDataStream ssBlocks(SER_NETWORK, PROTOCOL_VERSION);
+    for (const uint256& hash : hashes) {
+        CCompactBlock block;
+        if (!pblocktree->ReadCompactBlock(hash, block))
+            return RESTERR(req, HTTP_NOT_FOUND, hash.GetHex() + " not found in the compact block index");
+        ssBlocks << block;
+    }
+
+    switch (rf) {
+    case RF_BINARY: {
+        string binaryBlocks = ssBlocks.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryBlocks);
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ssBlocks.begin(), ssBlocks.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex)");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
 // A bit of a hack - dependency on a function defined in rpc/blockchain.cpp
 UniValue getblockchaininfo(const UniValue& params, bool fHelp);
 
@@ -332,11 +425,9 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
 
     switch (rf) {
     case RF_JSON: {
-        UniValue mempoolObject = mempoolToJSON(true);
-
-        string strJSON = mempoolObject.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        WriteDecodedReply(req, rf, [](JSONWriter& writer) {
+            mempoolToJSON(writer, true);
+        });
         return true;
     }
     default: {
@@ -383,12 +474,13 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
         return true;
     }
 
-    case RF_JSON: {
-        UniValue objTx(UniValue::VOBJ);
-        TxToJSON(tx, hashBlock, objTx);
-        string strJSON = objTx.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+    case RF_JSON:
+    case RF_CBOR: {
+        WriteDecodedReply(req, rf, [&](JSONWriter& writer) {
+            writer.BeginObject();
+            TxToJSON(writer, tx, hashBlock);
+            writer.EndObject();
+        });
         return true;
     }
 
@@ -608,6 +700,7 @@ static const struct {
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
+      {"/rest/compactblocks/", rest_compactblocks},
       {"/rest/getutxos", rest_getutxos},
 };
 
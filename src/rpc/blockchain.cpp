@@ -4,6 +4,7 @@
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
 #include "amount.h"
+#include "blockfilterindex.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -14,6 +15,7 @@
 #include "key_io.h"
 #include "main.h"
 #include "primitives/transaction.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -28,7 +30,7 @@
 
 using namespace std;
 
-extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
+extern void TxToJSON(JSONWriter& writer, const CTransaction& tx, const uint256 hashBlock, bool fIncludeHex = true);
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 
 double GetDifficultyINTERNAL(const CBlockIndex* blockindex, bool networkDifficulty)
@@ -132,59 +134,77 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 }
 
 // insightexplorer
-UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
+void blockToDeltasJSON(JSONWriter& writer, const CBlock& block, const CBlockIndex* blockindex)
 {
-    UniValue result(UniValue::VOBJ);
-    result.pushKV("hash", block.GetHash().GetHex());
     // Only report confirmations if the block is on the main chain
     if (!chainActive.Contains(blockindex))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block is an orphan");
+
+    // Look up the spent outputs of all of the block's inputs at once, and
+    // fail before anything is written if any is missing
+    std::vector<CSpentIndexKey> vSpentKeys;
+    for (const CTransaction& tx : block.vtx) {
+        if (tx.IsCoinBase())
+            continue;
+        for (const CTxIn& input : tx.vin)
+            vSpentKeys.push_back(CSpentIndexKey(input.prevout.hash, input.prevout.n));
+    }
+    std::vector<CSpentIndexValue> vSpentInfo;
+    if (!vSpentKeys.empty() && !GetSpentIndex(vSpentKeys, vSpentInfo)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Spent information not available");
+    }
+    for (const CSpentIndexValue& spentInfo : vSpentInfo) {
+        if (spentInfo.IsNull()) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Spent information not available");
+        }
+    }
+    size_t nSpentInfo = 0;
+
+    writer.BeginObject();
+    writer.KVStr("hash", block.GetHash().GetHex());
     int confirmations = chainActive.Height() - blockindex->nHeight + 1;
-    result.pushKV("confirmations", confirmations);
-    result.pushKV("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
-    result.pushKV("height", blockindex->nHeight);
-    result.pushKV("version", block.nVersion);
-    result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
+    writer.KVInt("confirmations", confirmations);
+    writer.KVInt("size", ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    writer.KVInt("height", blockindex->nHeight);
+    writer.KVInt("version", block.nVersion);
+    writer.KVStr("merkleroot", block.hashMerkleRoot.GetHex());
 
     KeyIO keyIO(Params());
-    UniValue deltas(UniValue::VARR);
+    writer.Key("deltas");
+    writer.BeginArray();
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
         const CTransaction &tx = block.vtx[i];
         const uint256 txhash = tx.GetHash();
 
-        UniValue entry(UniValue::VOBJ);
-        entry.pushKV("txid", txhash.GetHex());
-        entry.pushKV("index", (int)i);
+        writer.BeginObject();
+        writer.KVStr("txid", txhash.GetHex());
+        writer.KVInt("index", i);
 
-        UniValue inputs(UniValue::VARR);
+        writer.Key("inputs");
+        writer.BeginArray();
         if (!tx.IsCoinBase()) {
             for (size_t j = 0; j < tx.vin.size(); j++) {
-                const CTxIn input = tx.vin[j];
-                UniValue delta(UniValue::VOBJ);
-                CSpentIndexValue spentInfo;
-                CSpentIndexKey spentKey(input.prevout.hash, input.prevout.n);
+                const CTxIn& input = tx.vin[j];
+                const CSpentIndexValue& spentInfo = vSpentInfo[nSpentInfo++];
 
-                if (!GetSpentIndex(spentKey, spentInfo)) {
-                    throw JSONRPCError(RPC_INTERNAL_ERROR, "Spent information not available");
-                }
+                writer.BeginObject();
                 CTxDestination dest = DestFromAddressHash(spentInfo.addressType, spentInfo.addressHash);
                 if (IsValidDestination(dest)) {
-                    delta.pushKV("address", keyIO.EncodeDestination(dest));
+                    writer.KVStr("address", keyIO.EncodeDestination(dest));
                 }
-                delta.pushKV("satoshis", -1 * spentInfo.satoshis);
-                delta.pushKV("index", (int)j);
-                delta.pushKV("prevtxid", input.prevout.hash.GetHex());
-                delta.pushKV("prevout", (int)input.prevout.n);
-
-                inputs.push_back(delta);
+                writer.KVInt("satoshis", -1 * spentInfo.satoshis);
+                writer.KVInt("index", j);
+                writer.KVStr("prevtxid", input.prevout.hash.GetHex());
+                writer.KVInt("prevout", input.prevout.n);
+                writer.EndObject();
             }
         }
-        entry.pushKV("inputs", inputs);
+        writer.EndArray();
 
-        UniValue outputs(UniValue::VARR);
+        writer.Key("outputs");
+        writer.BeginArray();
         for (unsigned int k = 0; k < tx.vout.size(); k++) {
             const CTxOut &out = tx.vout[k];
-            UniValue delta(UniValue::VOBJ);
             const uint160 addrhash = out.scriptPubKey.AddressHash();
             CTxDestination dest;
 
@@ -193,80 +213,89 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
             } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
                 dest = CKeyID(addrhash);
             }
+            writer.BeginObject();
             if (IsValidDestination(dest)) {
-                delta.pushKV("address", keyIO.EncodeDestination(dest));
+                writer.KVStr("address", keyIO.EncodeDestination(dest));
             }
-            delta.pushKV("satoshis", out.nValue);
-            delta.pushKV("index", (int)k);
-
-            outputs.push_back(delta);
+            writer.KVInt("satoshis", out.nValue);
+            writer.KVInt("index", k);
+            writer.EndObject();
         }
-        entry.pushKV("outputs", outputs);
-        deltas.push_back(entry);
+        writer.EndArray();
+        writer.EndObject();
     }
-    result.pushKV("deltas", deltas);
-    result.pushKV("time", block.GetBlockTime());
-    result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
-    result.pushKV("nonce", block.nNonce.GetHex());
-    result.pushKV("bits", strprintf("%08x", block.nBits));
-    result.pushKV("difficulty", GetDifficulty(blockindex));
-    result.pushKV("chainwork", blockindex->nChainWork.GetHex());
+    writer.EndArray();
+    writer.KVInt("time", block.GetBlockTime());
+    writer.KVInt("mediantime", blockindex->GetMedianTimePast());
+    writer.KVStr("nonce", block.nNonce.GetHex());
+    writer.KVStr("bits", strprintf("%08x", block.nBits));
+    writer.KV("difficulty", GetDifficulty(blockindex));
+    writer.KVStr("chainwork", blockindex->nChainWork.GetHex());
 
     if (blockindex->pprev)
-        result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
+        writer.KVStr("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
-        result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
-    return result;
+        writer.KVStr("nextblockhash", pnext->GetBlockHash().GetHex());
+    writer.EndObject();
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+void blockToJSON(JSONWriter& writer, const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
 {
-    UniValue result(UniValue::VOBJ);
-    result.pushKV("hash", block.GetHash().GetHex());
+    writer.BeginObject();
+    writer.KVStr("hash", block.GetHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
     if (chainActive.Contains(blockindex))
         confirmations = chainActive.Height() - blockindex->nHeight + 1;
-    result.pushKV("confirmations", confirmations);
-    result.pushKV("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
-    result.pushKV("height", blockindex->nHeight);
-    result.pushKV("version", block.nVersion);
-    result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
-    result.pushKV("finalsaplingroot", block.hashFinalSaplingRoot.GetHex());
-    UniValue txs(UniValue::VARR);
+    writer.KVInt("confirmations", confirmations);
+    writer.KVInt("size", ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    writer.KVInt("height", blockindex->nHeight);
+    writer.KVInt("version", block.nVersion);
+    writer.KVStr("merkleroot", block.hashMerkleRoot.GetHex());
+    writer.KVStr("finalsaplingroot", block.hashFinalSaplingRoot.GetHex());
+    // Write the transactions one at a time rather than holding all of them
+    writer.Key("tx");
+    writer.BeginArray();
     for (const CTransaction&tx : block.vtx)
     {
         if(txDetails)
         {
-            UniValue objTx(UniValue::VOBJ);
-            TxToJSON(tx, uint256(), objTx);
-            txs.push_back(objTx);
+            writer.BeginObject();
+            TxToJSON(writer, tx, uint256());
+            writer.EndObject();
         }
         else
-            txs.push_back(tx.GetHash().GetHex());
+            writer.Str(tx.GetHash().GetHex());
     }
-    result.pushKV("tx", txs);
-    result.pushKV("time", block.GetBlockTime());
-    result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
-    result.pushKV("nonce", block.nNonce.GetHex());
-    result.pushKV("solution", HexStr(block.nSolution));
-    result.pushKV("bits", strprintf("%08x", block.nBits));
-    result.pushKV("difficulty", GetDifficulty(blockindex));
-    result.pushKV("chainwork", blockindex->nChainWork.GetHex());
-    result.pushKV("anchor", blockindex->hashFinalSproutRoot.GetHex());
+    writer.EndArray();
+    writer.KVInt("time", block.GetBlockTime());
+    writer.KVInt("mediantime", blockindex->GetMedianTimePast());
+    writer.KVStr("nonce", block.nNonce.GetHex());
+    writer.KVStr("solution", HexStr(block.nSolution));
+    writer.KVStr("bits", strprintf("%08x", block.nBits));
+    writer.KV("difficulty", GetDifficulty(blockindex));
+    writer.KVStr("chainwork", blockindex->nChainWork.GetHex());
+    writer.KVStr("anchor", blockindex->hashFinalSproutRoot.GetHex());
 
     UniValue valuePools(UniValue::VARR);
     valuePools.push_back(ValuePoolDesc("sprout", blockindex->nChainSproutValue, blockindex->nSproutValue));
     valuePools.push_back(ValuePoolDesc("sapling", blockindex->nChainSaplingValue, blockindex->nSaplingValue));
-    result.pushKV("valuePools", valuePools);
+    writer.KV("valuePools", valuePools);
 
     if (blockindex->pprev)
-        result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
+        writer.KVStr("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
-        result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
-    return result;
+        writer.KVStr("nextblockhash", pnext->GetBlockHash().GetHex());
+    writer.EndObject();
+}
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+{
+    UniValueWriter writer;
+    blockToJSON(writer, block, blockindex, txDetails);
+    return writer.Result();
 }
 
 UniValue getblockcount(const UniValue& params, bool fHelp)
@@ -320,31 +349,28 @@ UniValue getdifficulty(const UniValue& params, bool fHelp)
     return GetNetworkDifficulty();
 }
 
-UniValue mempoolToJSON(bool fVerbose = false)
+void mempoolToJSON(JSONWriter& writer, bool fVerbose = false)
 {
+    // Write from a snapshot, so that neither the mempool lock nor cs_main is
+    // held while a large reply is produced
+    std::shared_ptr<const CTxMemPoolSnapshot> snapshot = mempool.GetSnapshot();
     if (fVerbose)
     {
-        LOCK(mempool.cs);
-        UniValue o(UniValue::VOBJ);
-        for (const CTxMemPoolEntry& e : mempool.mapTx)
+        writer.BeginObject();
+        for (const CTxMemPoolSnapshot::Entry& e : snapshot->vEntries)
         {
-            const uint256& hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
-            info.pushKV("size", (int)e.GetTxSize());
-            info.pushKV("fee", ValueFromAmount(e.GetFee()));
-            info.pushKV("modifiedfee", ValueFromAmount(e.GetModifiedFee()));
-            info.pushKV("time", e.GetTime());
-            info.pushKV("height", (int)e.GetHeight());
-            info.pushKV("descendantcount", e.GetCountWithDescendants());
-            info.pushKV("descendantsize", e.GetSizeWithDescendants());
-            info.pushKV("descendantfees", e.GetModFeesWithDescendants());
-            const CTransaction& tx = e.GetTx();
+            info.pushKV("size", (int)e.nTxSize);
+            info.pushKV("fee", ValueFromAmount(e.nFee));
+            info.pushKV("modifiedfee", ValueFromAmount(e.nModifiedFee));
+            info.pushKV("time", e.nTime);
+            info.pushKV("height", (int)e.nHeight);
+            info.pushKV("descendantcount", e.nCountWithDescendants);
+            info.pushKV("descendantsize", e.nSizeWithDescendants);
+            info.pushKV("descendantfees", e.nModFeesWithDescendants);
             set<string> setDepends;
-            for (const CTxIn& txin : tx.vin)
-            {
-                if (mempool.exists(txin.prevout.hash))
-                    setDepends.insert(txin.prevout.hash.ToString());
-            }
+            for (const uint256& dep : e.vDepends)
+                setDepends.insert(dep.ToString());
 
             UniValue depends(UniValue::VARR);
             for (const string& dep : setDepends)
@@ -353,24 +379,27 @@ UniValue mempoolToJSON(bool fVerbose = false)
             }
 
             info.pushKV("depends", depends);
-            o.pushKV(hash.ToString(), info);
+            writer.KV(e.hash.ToString(), info);
         }
-        return o;
+        writer.EndObject();
     }
     else
     {
-        vector<uint256> vtxid;
-        mempool.queryHashes(vtxid);
-
-        UniValue a(UniValue::VARR);
-        for (const uint256& hash : vtxid)
-            a.push_back(hash.ToString());
-
-        return a;
+        writer.BeginArray();
+        for (const CTxMemPoolSnapshot::Entry& e : snapshot->vEntries)
+            writer.Value(e.hash.ToString());
+        writer.EndArray();
     }
 }
 
-UniValue getrawmempool(const UniValue& params, bool fHelp)
+UniValue mempoolToJSON(bool fVerbose = false)
+{
+    UniValueWriter writer;
+    mempoolToJSON(writer, fVerbose);
+    return writer.Result();
+}
+
+void getrawmempool(const UniValue& params, bool fHelp, JSONWriter& writer)
 {
     if (fHelp || params.size() > 1)
         throw runtime_error(
@@ -404,17 +433,22 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getrawmempool", "true")
         );
 
-    LOCK(cs_main);
-
     bool fVerbose = false;
     if (params.size() > 0)
         fVerbose = params[0].get_bool();
 
-    return mempoolToJSON(fVerbose);
+    mempoolToJSON(writer, fVerbose);
+}
+
+UniValue getrawmempool(const UniValue& params, bool fHelp)
+{
+    UniValueWriter writer;
+    getrawmempool(params, fHelp, writer);
+    return writer.Result();
 }
 
 // insightexplorer
-UniValue getblockdeltas(const UniValue& params, bool fHelp)
+void getblockdeltas(const UniValue& params, bool fHelp, JSONWriter& writer)
 {
     std::string disabledMsg = "";
     if (!(fExperimentalInsightExplorer || fExperimentalLightWalletd)) {
@@ -493,7 +527,14 @@ UniValue getblockdeltas(const UniValue& params, bool fHelp)
     if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
-    return blockToDeltasJSON(block, pblockindex);
+    blockToDeltasJSON(writer, block, pblockindex);
+}
+
+UniValue getblockdeltas(const UniValue& params, bool fHelp)
+{
+    UniValueWriter writer;
+    getblockdeltas(params, fHelp, writer);
+    return writer.Result();
 }
 
 // insightexplorer
@@ -691,7 +732,65 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     }
 }
 
-UniValue getblock(const UniValue& params, bool fHelp)
+UniValue getblockfilter(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nRetrieve a BIP 157 content filter for a particular block.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The hash of the block\n"
+            "2. \"filtertype\"    (string, optional, default=basic) The type name of the filter\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"xxxx\",  (string) the hex-encoded filter data\n"
+            "  \"header\" : \"xxxx\"   (string) the hex-encoded filter header\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+        );
+
+    uint256 hash(uint256S(params[0].get_str()));
+    std::string strFilterType = "basic";
+    if (params.size() > 1)
+        strFilterType = params[1].get_str();
+
+    BlockFilterType filter_type;
+    if (!BlockFilterTypeByName(strFilterType, filter_type))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+
+    if (!pblockfilterindex || pblockfilterindex->GetFilterType() != filter_type)
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + strFilterType);
+
+    const CBlockIndex* pblockindex;
+    bool fBlockOnChain;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = mi->second;
+        fBlockOnChain = chainActive.Contains(pblockindex);
+    }
+
+    BlockFilter filter;
+    uint256 header;
+    if (!pblockfilterindex->LookupFilter(pblockindex, filter) ||
+        !pblockfilterindex->LookupFilterHeader(pblockindex, header)) {
+        const CBlockIndex* pindexBest = pblockfilterindex->GetBestBlock();
+        if (fBlockOnChain && (!pindexBest || pindexBest->nHeight < pblockindex->nHeight))
+            throw JSONRPCError(RPC_MISC_ERROR, "Filter not yet available, the index is still being built");
+        throw JSONRPCError(RPC_MISC_ERROR, "Filter not found");
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", header.GetHex());
+    return ret;
+}
+
+void getblock(const UniValue& params, bool fHelp, JSONWriter& writer)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
@@ -740,17 +839,6 @@ UniValue getblock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblock", "12800")
         );
 
-    LOCK(cs_main);
-
-    std::string strHash = params[0].get_str();
-
-    // If height is supplied, find the hash
-    if (strHash.size() < (2 * sizeof(uint256))) {
-        strHash = chainActive[parseHeightArg(strHash, chainActive.Height())]->GetBlockHash().GetHex();
-    }
-
-    uint256 hash(uint256S(strHash));
-
     int verbosity = 1;
     if (params.size() > 1) {
         if(params[1].isNum()) {
@@ -764,16 +852,36 @@ UniValue getblock(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
     }
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    CBlockIndex* pblockindex;
+    CDiskBlockPos blockPos;
+    {
+        LOCK(cs_main);
 
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+        std::string strHash = params[0].get_str();
 
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        // If height is supplied, find the hash
+        if (strHash.size() < (2 * sizeof(uint256))) {
+            strHash = chainActive[parseHeightArg(strHash, chainActive.Height())]->GetBlockHash().GetHex();
+        }
+
+        uint256 hash(uint256S(strHash));
+
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        pblockindex = mapBlockIndex[hash];
+
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+
+        blockPos = pblockindex->GetBlockPos();
+    }
+
+    // Read and decode the block without cs_main, so that requests for
+    // several blocks, such as the elements of a batch, read them in parallel
+    CBlock block;
+    if (!ReadBlockFromDisk(block, blockPos, Params().GetConsensus()) ||
+        block.GetHash() != pblockindex->GetBlockHash())
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
     if (verbosity == 0)
@@ -781,10 +889,19 @@ UniValue getblock(const UniValue& params, bool fHelp)
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
         ssBlock << block;
         std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        writer.Value(strHex);
+        return;
     }
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
+    LOCK(cs_main);
+    blockToJSON(writer, block, pblockindex, verbosity >= 2);
+}
+
+UniValue getblock(const UniValue& params, bool fHelp)
+{
+    UniValueWriter writer;
+    getblock(params, fHelp, writer);
+    return writer.Result();
 }
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
@@ -994,6 +1111,28 @@ void NetworkUpgradeDescPushBack(
     }
 }
 
+void NullifierFilterDescPushBack(UniValue& nullifierFilters, const std::string& name, const CNullifierFilterStats& stats)
+{
+    UniValue rv(UniValue::VOBJ);
+    rv.pushKV("loaded", stats.fLoaded);
+    rv.pushKV("entries", (uint64_t)stats.nEntries);
+    rv.pushKV("usage", (uint64_t)stats.nMemoryUsage);
+    rv.pushKV("lookups", stats.nQueries);
+    rv.pushKV("notspent", stats.nNegatives);
+    rv.pushKV("falsepositives", stats.nFalsePositives);
+    rv.pushKV("hitrate", stats.nQueries ? (double)stats.nNegatives / stats.nQueries : 0.0);
+    nullifierFilters.pushKV(name, rv);
+}
+
+void SignatureCacheDescPushBack(UniValue& sigCache, const std::string& name, SignatureCacheType type)
+{
+    CSignatureCacheStats stats = GetSignatureCacheStats(type);
+    UniValue rv(UniValue::VOBJ);
+    rv.pushKV("hits", stats.nHits);
+    rv.pushKV("misses", stats.nMisses);
+    sigCache.pushKV(name, rv);
+}
+
 
 UniValue getblockchaininfo(const UniValue& params, bool fHelp)
 {
@@ -1014,6 +1153,8 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
             "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1]\n"
             "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
             "  \"size_on_disk\": xxxxxx,       (numeric) the estimated size of the block and undo files on disk\n"
+            "  \"snapshotheight\": xxxxxx,     (numeric, optional) height of the UTXO snapshot the chainstate was loaded from, only present\n"
+            "                                 until -reindex validates the blocks before it\n"
             "  \"commitments\": xxxxxx,    (numeric) the current number of note commitments in the commitment tree\n"
             "  \"softforks\": [            (array) status of softforks in progress\n"
             "     {\n"
@@ -1039,6 +1180,23 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
             "  \"consensus\": {               (object) branch IDs of the current and upcoming consensus rules\n"
             "     \"chaintip\": \"xxxxxxxx\",   (string) branch ID used to validate the current chain tip\n"
             "     \"nextblock\": \"xxxxxxxx\"   (string) branch ID that the next block will be validated under\n"
+            "  },\n"
+            "  \"nullifierfilters\": {        (object) in-memory filters of the spent nullifiers in the coin database\n"
+            "     \"xxxx\" : {                (string) shielded pool (sprout, sapling)\n"
+            "        \"loaded\": xx,           (boolean) whether the filter is in use\n"
+            "        \"entries\": xxxxxx,      (numeric) number of nullifier fingerprints in the filter\n"
+            "        \"usage\": xxxxxx,        (numeric) memory used by the filter, in bytes\n"
+            "        \"lookups\": xxxxxx,      (numeric) number of nullifiers looked up since startup\n"
+            "        \"notspent\": xxxxxx,     (numeric) lookups answered as not spent without reading the database\n"
+            "        \"falsepositives\": xx,   (numeric) lookups that read the database and found the nullifier unspent\n"
+            "        \"hitrate\": x.xxx        (numeric) fraction of lookups answered without reading the database\n"
+            "     }, ...\n"
+            "  },\n"
+            "  \"sigcache\": {                (object) lookups in the cache of verified signatures since startup\n"
+            "     \"xxxx\" : {                (string) signature type (ecdsa, joinsplit, sapling)\n"
+            "        \"hits\": xxxxxx,         (numeric) verifications answered from the cache\n"
+            "        \"misses\": xxxxxx        (numeric) verifications not found in the cache\n"
+            "     }, ...\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -1059,6 +1217,10 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     obj.pushKV("chainwork",             chainActive.Tip()->nChainWork.GetHex());
     obj.pushKV("pruned",                fPruneMode);
     obj.pushKV("size_on_disk",          CalculateCurrentUsage());
+    int nSnapshotHeight = GetSnapshotBaseHeight();
+    if (nSnapshotHeight >= 0) {
+        obj.pushKV("snapshotheight",    nSnapshotHeight);
+    }
 
     SproutMerkleTree tree;
     pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), tree);
@@ -1088,6 +1250,17 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     consensus.pushKV("nextblock", HexInt(CurrentEpochBranchId(tip->nHeight + 1, consensusParams)));
     obj.pushKV("consensus", consensus);
 
+    UniValue nullifierFilters(UniValue::VOBJ);
+    NullifierFilterDescPushBack(nullifierFilters, "sprout", pcoinsdbview->GetNullifierFilterStats(SPROUT));
+    NullifierFilterDescPushBack(nullifierFilters, "sapling", pcoinsdbview->GetNullifierFilterStats(SAPLING));
+    obj.pushKV("nullifierfilters", nullifierFilters);
+
+    UniValue sigCache(UniValue::VOBJ);
+    SignatureCacheDescPushBack(sigCache, "ecdsa", SIGCACHE_ECDSA);
+    SignatureCacheDescPushBack(sigCache, "joinsplit", SIGCACHE_JOINSPLIT);
+    SignatureCacheDescPushBack(sigCache, "sapling", SIGCACHE_SAPLING);
+    obj.pushKV("sigcache", sigCache);
+
     if (fPruneMode)
     {
         CBlockIndex *block = chainActive.Tip();
@@ -1499,6 +1672,109 @@ UniValue dumpbootstrap(const UniValue& params, bool fHelp)
     return strprintf("dumped %d blocks from %d to %d into %s", nEndBlock - nStartBlock + 1, nStartBlock, nEndBlock, pathDest);
 }
 
+static UniValue SnapshotStatsToJSON(const CUTXOSnapshotMetadata& metadata, const CUTXOSnapshotStats& stats, const fs::path& path)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("path", path.string());
+    ret.pushKV("base_hash", metadata.hashBlock.GetHex());
+    ret.pushKV("base_height", metadata.nHeight);
+    ret.pushKV("transactions", (uint64_t)stats.nTransactions);
+    ret.pushKV("txouts", (uint64_t)stats.nTransactionOutputs);
+    ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+    ret.pushKV("sprout_nullifiers", (uint64_t)stats.nSproutNullifiers);
+    ret.pushKV("sapling_nullifiers", (uint64_t)stats.nSaplingNullifiers);
+    ret.pushKV("sprout_anchors", (uint64_t)stats.nSproutAnchors);
+    ret.pushKV("sapling_anchors", (uint64_t)stats.nSaplingAnchors);
+    ret.pushKV("snapshot_hash", stats.hashSnapshot.GetHex());
+    return ret;
+}
+
+static const std::string SnapshotResultHelp =
+    "{\n"
+    "  \"path\": \"path\",             (string) the snapshot file\n"
+    "  \"base_hash\": \"hash\",        (string) the block whose chainstate the snapshot contains\n"
+    "  \"base_height\": n,           (numeric) the height of that block\n"
+    "  \"transactions\": n,          (numeric) the number of transactions with unspent outputs\n"
+    "  \"txouts\": n,                (numeric) the number of unspent transaction outputs\n"
+    "  \"total_amount\": x.xxx,      (numeric) the total amount\n"
+    "  \"sprout_nullifiers\": n,     (numeric) the number of Sprout nullifiers\n"
+    "  \"sapling_nullifiers\": n,    (numeric) the number of Sapling nullifiers\n"
+    "  \"sprout_anchors\": n,        (numeric) the number of Sprout anchors\n"
+    "  \"sapling_anchors\": n,       (numeric) the number of Sapling anchors\n"
+    "  \"snapshot_hash\": \"hash\"     (string) the hash of the snapshot's contents, to be compared with a trusted source\n"
+    "}\n";
+
+UniValue dumptxoutset(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw std::runtime_error(
+            "dumptxoutset \"destination\"\n"
+            "\nWrites the unspent transaction outputs, nullifiers and commitment tree anchors at the current tip to a UTXO snapshot\n"
+            "that a new node can start from with loadtxoutset.\n"
+            "Note this call may take some time, during which block processing is paused.\n"
+            "\nArguments:\n"
+            "1. \"destination\"  (string, required) Pathname of the file to write to. If a directory is used, 'txoutset.dat' is created in that directory.\n"
+            "\nResult:\n"
+            + SnapshotResultHelp +
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"/tmp\"")
+            + HelpExampleRpc("dumptxoutset", "\"/tmp\"")
+        );
+
+    fs::path pathDest = fs::system_complete(params[0].get_str());
+    if (fs::exists(pathDest) && fs::is_directory(pathDest)) {
+        pathDest /= "txoutset.dat";
+    }
+    if (fs::exists(pathDest)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, pathDest.string() + " already exists");
+    }
+
+    CValidationState state;
+    CUTXOSnapshotMetadata metadata;
+    CUTXOSnapshotStats stats;
+    if (!DumpUTXOSnapshot(state, Params(), pathDest, metadata, stats)) {
+        throw JSONRPCError(RPC_MISC_ERROR, state.GetRejectReason());
+    }
+    return SnapshotStatsToJSON(metadata, stats, pathDest);
+}
+
+UniValue loadtxoutset(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 2)
+        throw std::runtime_error(
+            "loadtxoutset \"path\" \"snapshot_hash\"\n"
+            "\nReplaces the chainstate with a UTXO snapshot written by dumptxoutset and makes its block the tip, so that the node\n"
+            "only has to download and validate the blocks after it. The block header must already be in the best header chain.\n"
+            "Blocks before the snapshot are not validated or stored: until -reindex validates the full history, a warning is\n"
+            "shown and getblockchaininfo reports the snapshot height.\n"
+            "\nArguments:\n"
+            "1. \"path\"           (string, required) The snapshot file\n"
+            "2. \"snapshot_hash\"  (string, required) The snapshot_hash reported by dumptxoutset on a trusted node. The load fails if the\n"
+            "                     snapshot does not match it; the hash the file itself records is not enough, as its maker can recompute it.\n"
+            "\nResult:\n"
+            + SnapshotResultHelp +
+            "\nExamples:\n"
+            + HelpExampleCli("loadtxoutset", "\"/tmp/txoutset.dat\" \"0000...\"")
+            + HelpExampleRpc("loadtxoutset", "\"/tmp/txoutset.dat\", \"0000...\"")
+        );
+
+    fs::path path = fs::system_complete(params[0].get_str());
+    uint256 hashExpected = ParseHashV(params[1], "snapshot_hash");
+
+    CValidationState state;
+    CUTXOSnapshotMetadata metadata;
+    CUTXOSnapshotStats stats;
+    if (!LoadUTXOSnapshot(state, Params(), path, hashExpected, metadata, stats)) {
+        throw JSONRPCError(RPC_MISC_ERROR, state.GetRejectReason());
+    }
+
+    // Connect any blocks already received on top of the snapshot.
+    if (!ActivateBestChain(state, Params())) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, state.GetRejectReason());
+    }
+    return SnapshotStatsToJSON(metadata, stats, path);
+}
+
 static UniValue getchaintxstats(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 2)
@@ -1585,21 +1861,24 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        true  },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
     { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
+    { "blockchain",         "getblock",               &getblock,               true,  &getblock },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
     { "blockchain",         "getblockheader",         &getblockheader,         true  },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
     { "blockchain",         "z_gettreestate",         &z_gettreestate,         true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  &getrawmempool },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
     { "blockchain",         "dumpbootstrap",          &dumpbootstrap,          true  },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true  },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           true  },
 
     // insightexplorer
-    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
+    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false, &getblockdeltas },
     { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
 
     /* Not shown in help */
@@ -0,0 +1,322 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "rpc/jsonwriter.h"
+
+#include "rpc/server.h"
+#include "tinyformat.h"
+#include "utilstrencodings.h"
+
+#include <assert.h>
+#include <string.h>
+
+void JSONWriter::Int(int64_t n)
+{
+    Value(UniValue(n));
+}
+
+void JSONWriter::Amount(CAmount amount)
+{
+    Value(ValueFromAmount(amount));
+}
+
+void JSONWriter::Str(const std::string& str)
+{
+    Value(UniValue(str));
+}
+
+void UniValueWriter::Add(UniValue value)
+{
+    if (vStack.empty()) {
+        result = std::move(value);
+        return;
+    }
+    UniValue& parent = vStack.back().second;
+    if (parent.isObject())
+        parent.pushKVEnd(std::move(strKey), std::move(value));
+    else
+        parent.push_back(std::move(value));
+    strKey.clear();
+}
+
+void UniValueWriter::BeginObject()
+{
+    vStack.emplace_back(std::move(strKey), UniValue(UniValue::VOBJ));
+    strKey.clear();
+}
+
+void UniValueWriter::EndObject()
+{
+    assert(!vStack.empty() && vStack.back().second.isObject());
+    std::pair<std::string, UniValue> top = std::move(vStack.back());
+    vStack.pop_back();
+    strKey = std::move(top.first);
+    Add(std::move(top.second));
+}
+
+void UniValueWriter::BeginArray()
+{
+    vStack.emplace_back(std::move(strKey), UniValue(UniValue::VARR));
+    strKey.clear();
+}
+
+void UniValueWriter::EndArray()
+{
+    assert(!vStack.empty() && vStack.back().second.isArray());
+    std::pair<std::string, UniValue> top = std::move(vStack.back());
+    vStack.pop_back();
+    strKey = std::move(top.first);
+    Add(std::move(top.second));
+}
+
+void UniValueWriter::Key(const std::string& key)
+{
+    strKey = key;
+}
+
+void UniValueWriter::Value(const UniValue& value)
+{
+    Add(value);
+}
+
+JSONTextWriter::JSONTextWriter(const Sink& sinkIn, size_t nChunkSizeIn) :
+    sink(sinkIn), nChunkSize(nChunkSizeIn), fAfterKey(false)
+{
+    strBuffer.reserve(nChunkSize);
+}
+
+void JSONTextWriter::Separate()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (!vEmpty.empty()) {
+        if (!vEmpty.back())
+            strBuffer += ',';
+        vEmpty.back() = false;
+    }
+}
+
+void JSONTextWriter::Emit()
+{
+    if (strBuffer.size() < nChunkSize)
+        return;
+    sink(strBuffer, false);
+    strBuffer.clear();
+}
+
+void JSONTextWriter::BeginObject()
+{
+    Separate();
+    strBuffer += '{';
+    vEmpty.push_back(true);
+}
+
+void JSONTextWriter::EndObject()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    strBuffer += '}';
+    Emit();
+}
+
+void JSONTextWriter::BeginArray()
+{
+    Separate();
+    strBuffer += '[';
+    vEmpty.push_back(true);
+}
+
+void JSONTextWriter::EndArray()
+{
+    assert(!vEmpty.empty() && !fAfterKey);
+    vEmpty.pop_back();
+    strBuffer += ']';
+    Emit();
+}
+
+void JSONTextWriter::Key(const std::string& key)
+{
+    Separate();
+    strBuffer += UniValue(key).write();
+    strBuffer += ':';
+    fAfterKey = true;
+}
+
+void JSONTextWriter::Value(const UniValue& value)
+{
+    Separate();
+    strBuffer += value.write();
+    Emit();
+}
+
+void JSONTextWriter::Int(int64_t n)
+{
+    Separate();
+    strBuffer += i64tostr(n);
+    Emit();
+}
+
+void JSONTextWriter::Amount(CAmount amount)
+{
+    // As ValueFromAmount formats it
+    Separate();
+    bool sign = amount < 0;
+    int64_t n_abs = (sign ? -amount : amount);
+    strBuffer += strprintf("%s%d.%08d", sign ? "-" : "", n_abs / COIN, n_abs % COIN);
+    Emit();
+}
+
+void JSONTextWriter::Finish()
+{
+    assert(vEmpty.empty());
+    strBuffer += '\n';
+    sink(strBuffer, true);
+    strBuffer.clear();
+}
+
+CBORWriter::CBORWriter(const Sink& sinkIn, size_t nChunkSizeIn) :
+    sink(sinkIn), nChunkSize(nChunkSizeIn)
+{
+    strBuffer.reserve(nChunkSize);
+}
+
+void CBORWriter::Head(uint8_t nMajor, uint64_t n)
+{
+    const char nType = nMajor << 5;
+    if (n < 24) {
+        strBuffer += (char)(nType | n);
+        return;
+    }
+    int nBytes = n <= 0xff ? 1 : n <= 0xffff ? 2 : n <= 0xffffffff ? 4 : 8;
+    strBuffer += (char)(nType | (nBytes == 1 ? 24 : nBytes == 2 ? 25 : nBytes == 4 ? 26 : 27));
+    for (int i = nBytes - 1; i >= 0; i--)
+        strBuffer += (char)(n >> (8 * i));
+}
+
+void CBORWriter::Emit()
+{
+    if (strBuffer.size() < nChunkSize)
+        return;
+    sink(strBuffer, false);
+    strBuffer.clear();
+}
+
+void CBORWriter::Encode(const UniValue& value)
+{
+    switch (value.getType()) {
+    case UniValue::VNULL:
+        strBuffer += '\xf6';
+        break;
+    case UniValue::VBOOL:
+        strBuffer += value.get_bool() ? '\xf5' : '\xf4';
+        break;
+    case UniValue::VSTR:
+        Head(3, value.get_str().size());
+        strBuffer += value.get_str();
+        break;
+    case UniValue::VNUM: {
+        // Numbers are held as text: integers and amounts are encoded
+        // exactly, anything else as a double
+        const std::string& str = value.getValStr();
+        int64_t n;
+        size_t nPoint = str.find('.');
+        if (ParseInt64(str, &n)) {
+            Int(n);
+        } else if (nPoint != std::string::npos && nPoint + 9 == str.size() &&
+                   ParseInt64(str.substr(0, nPoint) + str.substr(nPoint + 1), &n)) {
+            Amount(n);
+        } else {
+            double d = 0;
+            ParseDouble(str, &d);
+            uint64_t nBits;
+            memcpy(&nBits, &d, sizeof(nBits));
+            strBuffer += '\xfb';
+            for (int i = 7; i >= 0; i--)
+                strBuffer += (char)(nBits >> (8 * i));
+        }
+        break;
+    }
+    case UniValue::VOBJ:
+        Head(5, value.size());
+        for (size_t i = 0; i < value.size(); i++) {
+            Head(3, value.getKeys()[i].size());
+            strBuffer += value.getKeys()[i];
+            Encode(value[i]);
+        }
+        break;
+    case UniValue::VARR:
+        Head(4, value.size());
+        for (size_t i = 0; i < value.size(); i++)
+            Encode(value[i]);
+        break;
+    }
+}
+
+void CBORWriter::BeginObject()
+{
+    strBuffer += '\xbf';
+}
+
+void CBORWriter::EndObject()
+{
+    strBuffer += '\xff';
+    Emit();
+}
+
+void CBORWriter::BeginArray()
+{
+    strBuffer += '\x9f';
+}
+
+void CBORWriter::EndArray()
+{
+    strBuffer += '\xff';
+    Emit();
+}
+
+void CBORWriter::Key(const std::string& key)
+{
+    Head(3, key.size());
+    strBuffer += key;
+}
+
+void CBORWriter::Value(const UniValue& value)
+{
+    Encode(value);
+    Emit();
+}
+
+void CBORWriter::Int(int64_t n)
+{
+    // Negative integers are encoded as -1 - n
+    if (n >= 0)
+        Head(0, n);
+    else
+        Head(1, ~(uint64_t)n);
+    Emit();
+}
+
+void CBORWriter::Amount(CAmount amount)
+{
+    // Tag 4, [exponent, mantissa]
+    strBuffer += '\xc4';
+    strBuffer += '\x82';
+    Head(1, 7);
+    Int(amount);
+}
+
+void CBORWriter::Str(const std::string& str)
+{
+    Head(3, str.size());
+    strBuffer += str;
+    Emit();
+}
+
+void CBORWriter::Finish()
+{
+    sink(strBuffer, true);
+    strBuffer.clear();
+}
@@ -0,0 +1,169 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_RPC_JSONWRITER_H
+#define BITCOIN_RPC_JSONWRITER_H
+
+#include "amount.h"
+
+#include <univalue.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/** Size of the pieces in which JSONTextWriter passes on its output */
+static const size_t JSON_WRITER_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * Writes a JSON document piece by piece, so that large results can be
+ * produced without first building them as one UniValue. Values written
+ * within an object must each be preceded by Key. Keys are not checked for
+ * duplicates.
+ */
+class JSONWriter
+{
+public:
+    virtual ~JSONWriter() {}
+
+    virtual void BeginObject() = 0;
+    virtual void EndObject() = 0;
+    virtual void BeginArray() = 0;
+    virtual void EndArray() = 0;
+    /** Name the next value written to the enclosing object */
+    virtual void Key(const std::string& key) = 0;
+    /** Write a complete value */
+    virtual void Value(const UniValue& value) = 0;
+
+    // Scalars, written without building a UniValue where the writer can
+    virtual void Int(int64_t n);
+    /** An amount in coins, as ValueFromAmount formats it */
+    virtual void Amount(CAmount amount);
+    virtual void Str(const std::string& str);
+
+    /** Complete the output, once the document is written */
+    virtual void Finish() {}
+
+    void KV(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+    void KVInt(const std::string& key, int64_t n)
+    {
+        Key(key);
+        Int(n);
+    }
+    void KVAmount(const std::string& key, CAmount amount)
+    {
+        Key(key);
+        Amount(amount);
+    }
+    void KVStr(const std::string& key, const std::string& str)
+    {
+        Key(key);
+        Str(str);
+    }
+};
+
+/** Builds the document as a UniValue, for callers that need one */
+class UniValueWriter : public JSONWriter
+{
+private:
+    //! Enclosing objects and arrays, outermost first, with their keys
+    std::vector<std::pair<std::string, UniValue> > vStack;
+    std::string strKey;
+    UniValue result;
+
+    void Add(UniValue value);
+
+public:
+    void BeginObject() override;
+    void EndObject() override;
+    void BeginArray() override;
+    void EndArray() override;
+    void Key(const std::string& key) override;
+    void Value(const UniValue& value) override;
+
+    /** Take the document written, once complete */
+    UniValue Result() { return std::move(result); }
+};
+
+/**
+ * Writes the document as compact JSON text, identical to UniValue::write,
+ * passing it on to a sink in pieces of about nChunkSize bytes as they fill.
+ */
+class JSONTextWriter : public JSONWriter
+{
+public:
+    /** Receives the output in order; fLast is set for the final piece */
+    typedef std::function<void(const std::string& strPart, bool fLast)> Sink;
+
+private:
+    Sink sink;
+    const size_t nChunkSize;
+    std::string strBuffer;
+    //! Whether each enclosing object or array is still empty
+    std::vector<bool> vEmpty;
+    bool fAfterKey;
+
+    void Separate();
+    void Emit();
+
+public:
+    explicit JSONTextWriter(const Sink& sinkIn, size_t nChunkSizeIn = JSON_WRITER_CHUNK_SIZE);
+
+    void BeginObject() override;
+    void EndObject() override;
+    void BeginArray() override;
+    void EndArray() override;
+    void Key(const std::string& key) override;
+    void Value(const UniValue& value) override;
+    void Int(int64_t n) override;
+    void Amount(CAmount amount) override;
+
+    /** End the document with a newline, like RPC and REST replies, and pass
+     *  the rest of the output to the sink */
+    void Finish() override;
+};
+
+/**
+ * Writes the document as CBOR (RFC 8949), with the same structure and keys
+ * as the JSON: objects and arrays written piece by piece are encoded with
+ * indefinite length, amounts as decimal fractions (tag 4) with exponent -8,
+ * other non-integer numbers as doubles, and strings, including hashes and
+ * hex data, as text. Output is passed on like JSONTextWriter's.
+ */
+class CBORWriter : public JSONWriter
+{
+public:
+    typedef JSONTextWriter::Sink Sink;
+
+private:
+    Sink sink;
+    const size_t nChunkSize;
+    std::string strBuffer;
+
+    void Head(uint8_t nMajor, uint64_t n);
+    void Encode(const UniValue& value);
+    void Emit();
+
+public:
+    explicit CBORWriter(const Sink& sinkIn, size_t nChunkSizeIn = JSON_WRITER_CHUNK_SIZE);
+
+    void BeginObject() override;
+    void EndObject() override;
+    void BeginArray() override;
+    void EndArray() override;
+    void Key(const std::string& key) override;
+    void Value(const UniValue& value) override;
+    void Int(int64_t n) override;
+    void Amount(CAmount amount) override;
+    void Str(const std::string& str) override;
+
+    /** Pass the rest of the output to the sink */
+    void Finish() override;
+};
+
+#endif // BITCOIN_RPC_JSONWRITER_H
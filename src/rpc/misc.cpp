@@ -10,6 +10,7 @@
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "perfstats.h"
 #include "rpc/server.h"
 #include "txmempool.h"
 #include "util.h"
@@ -513,6 +514,178 @@ UniValue getexperimentalfeatures(const UniValue& params, bool fHelp)
     return experimentalfeatures;
 }
 
+static UniValue PerfSampleToJSON(const PerfFamily& family, const PerfSample& sample)
+{
+    if (family.type != PERF_HISTOGRAM)
+        return sample.nValue;
+    const PerfHistogram::Snapshot& hist = sample.hist;
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("count", hist.nCount);
+    obj.pushKV("sum", hist.nSumMicros * 0.000001);
+    obj.pushKV("mean", hist.nCount ? hist.nSumMicros * 0.000001 / hist.nCount : 0.0);
+    obj.pushKV("p50", hist.QuantileMicros(0.5) * 0.000001);
+    obj.pushKV("p90", hist.QuantileMicros(0.9) * 0.000001);
+    obj.pushKV("p99", hist.QuantileMicros(0.99) * 0.000001);
+    obj.pushKV("max", hist.nMaxMicros * 0.000001);
+    return obj;
+}
+
+UniValue getperfstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getperfstats ( \"prefix\" )\n"
+            "\nReturns the node's performance counters, gauges and latency histograms.\n"
+            "Metrics with a label, such as the method of rpc_seconds, have an object with\n"
+            "a member per label value. Durations are in seconds; quantiles are estimated\n"
+            "from power-of-two buckets and are accurate to within a factor of two.\n"
+            "The same stats are served in Prometheus format at /metrics with -metricsendpoint.\n"
+            "\nArguments:\n"
+            "1. \"prefix\"    (string, optional) Only return metrics whose names start with this\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": n,                 (numeric) A counter or gauge\n"
+            "  \"name\": {                  A latency histogram\n"
+            "    \"count\": n,              (numeric) Number of durations recorded\n"
+            "    \"sum\": x.xxx,            (numeric) Their total\n"
+            "    \"mean\": x.xxx,           (numeric) Their mean\n"
+            "    \"p50\": x.xxx,            (numeric) Estimated median\n"
+            "    \"p90\": x.xxx,            (numeric) Estimated 90th percentile\n"
+            "    \"p99\": x.xxx,            (numeric) Estimated 99th percentile\n"
+            "    \"max\": x.xxx             (numeric) The longest\n"
+            "  },\n"
+            "  \"name\": {                  A labelled metric\n"
+            "    \"value\": ...             The counter, gauge or histogram for each label value\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getperfstats", "")
+            + HelpExampleCli("getperfstats", "\"rpc_\"")
+            + HelpExampleRpc("getperfstats", "\"block_connect\"")
+        );
+
+    std::string strPrefix;
+    if (params.size() > 0)
+        strPrefix = params[0].get_str();
+
+    UniValue ret(UniValue::VOBJ);
+    for (const PerfFamily& family : GetPerfStats()) {
+        if (family.strName.compare(0, strPrefix.size(), strPrefix) != 0)
+            continue;
+        if (family.strLabel.empty()) {
+            if (!family.vSamples.empty())
+                ret.pushKV(family.strName, PerfSampleToJSON(family, family.vSamples[0]));
+            continue;
+        }
+        UniValue labelled(UniValue::VOBJ);
+        for (const PerfSample& sample : family.vSamples)
+            labelled.pushKV(sample.strLabelValue, PerfSampleToJSON(family, sample));
+        ret.pushKV(family.strName, labelled);
+    }
+    return ret;
+}
+
+UniValue setlockprofiling(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "setlockprofiling samplerate ( reset )\n"
+            "\nStarts, changes or stops lock contention profiling. One in every samplerate\n"
+            "lock acquisitions on each thread is timed, and its wait and hold times are\n"
+            "added to the totals for its lock and site, scaled to estimate all acquisitions.\n"
+            "Lower rates cost less; 1 times every acquisition.\n"
+            "\nArguments:\n"
+            "1. samplerate    (numeric, required) Time 1 of every this many acquisitions, or 0 to stop\n"
+            "2. reset         (boolean, optional, default=false) Clear the totals collected so far\n"
+            "\nExamples:\n"
+            + HelpExampleCli("setlockprofiling", "100")
+            + HelpExampleCli("setlockprofiling", "0 true")
+            + HelpExampleRpc("setlockprofiling", "100, true")
+        );
+
+    int64_t nRate = params[0].getInt<int64_t>();
+    if (nRate < 0 || nRate > 1000000)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "samplerate must be between 0 and 1000000");
+    if (params.size() > 1 && params[1].get_bool())
+        ResetLockProfile();
+    nLockProfileSampleRate = nRate;
+    return NullUniValue;
+}
+
+UniValue getlockprofile(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "getlockprofile ( \"format\" \"sort\" )\n"
+            "\nReturns the lock contention profile collected since profiling was started\n"
+            "with setlockprofiling or -lockprofile, per lock and acquisition site.\n"
+            "Totals are estimated from the sampled acquisitions; times are in microseconds.\n"
+            "\nArguments:\n"
+            "1. \"format\"    (string, optional, default=\"json\") \"json\", or \"folded\" for one\n"
+            "               \"lock;file:line total\" line per site, for flame graph tools\n"
+            "2. \"sort\"      (string, optional, default=\"wait\") \"wait\" or \"hold\": the total to sort\n"
+            "               by, longest first, and the one \"folded\" reports\n"
+            "\nResult (json):\n"
+            "{\n"
+            "  \"samplerate\": n,             (numeric) The current sample rate, 0 if stopped\n"
+            "  \"sites\": [\n"
+            "    {\n"
+            "      \"lock\": \"name\",           (string) The lock, as named where it is taken\n"
+            "      \"site\": \"file:line\",      (string) Where it is taken\n"
+            "      \"samples\": n,            (numeric) Acquisitions timed\n"
+            "      \"contended\": n,          (numeric) Of those, how many waited for another thread\n"
+            "      \"acquisitions\": n,       (numeric) Estimated acquisitions\n"
+            "      \"wait_us\": n,            (numeric) Estimated total time spent waiting\n"
+            "      \"max_wait_us\": n,        (numeric) Longest wait timed\n"
+            "      \"hold_us\": n,            (numeric) Estimated total time held\n"
+            "      \"max_hold_us\": n         (numeric) Longest hold timed\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nResult (folded):\n"
+            "\"str\"      (string) The profile as folded stacks\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockprofile", "")
+            + HelpExampleCli("getlockprofile", "\"folded\" \"hold\"")
+            + HelpExampleRpc("getlockprofile", "\"json\", \"wait\"")
+        );
+
+    std::string strFormat = params.size() > 0 ? params[0].get_str() : "json";
+    std::string strSort = params.size() > 1 ? params[1].get_str() : "wait";
+    if (strFormat != "json" && strFormat != "folded")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "format must be \"json\" or \"folded\"");
+    if (strSort != "wait" && strSort != "hold")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "sort must be \"wait\" or \"hold\"");
+    const bool fHold = strSort == "hold";
+
+    std::vector<LockProfileEntry> vEntries = GetLockProfile();
+    if (strFormat == "folded")
+        return FormatLockProfileFolded(vEntries, fHold);
+
+    std::sort(vEntries.begin(), vEntries.end(), [fHold](const LockProfileEntry& a, const LockProfileEntry& b) {
+        return fHold ? a.nHoldNanos > b.nHoldNanos : a.nWaitNanos > b.nWaitNanos;
+    });
+    UniValue sites(UniValue::VARR);
+    for (const LockProfileEntry& entry : vEntries) {
+        UniValue site(UniValue::VOBJ);
+        site.pushKV("lock", entry.strName);
+        site.pushKV("site", strprintf("%s:%d", entry.strFile, entry.nLine));
+        site.pushKV("samples", entry.nSamples);
+        site.pushKV("contended", entry.nContended);
+        site.pushKV("acquisitions", entry.nAcquisitions);
+        site.pushKV("wait_us", entry.nWaitNanos / 1000);
+        site.pushKV("max_wait_us", entry.nMaxWaitNanos / 1000);
+        site.pushKV("hold_us", entry.nHoldNanos / 1000);
+        site.pushKV("max_hold_us", entry.nMaxHoldNanos / 1000);
+        sites.push_back(site);
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("samplerate", (uint64_t)nLockProfileSampleRate.load());
+    ret.pushKV("sites", sites);
+    return ret;
+}
+
 // insightexplorer
 static bool getAddressFromIndex(
     int type, const uint160 &hash, std::string &address)
@@ -1073,6 +1246,33 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
     return result;
 }
 
+// insightexplorer
+static CSpentIndexKey ParseSpentInfoKey(const UniValue& request)
+{
+    if (!request.isObject())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid request, must be an object");
+    UniValue txidValue = request.get_obj().find_value("txid");
+    UniValue indexValue = request.get_obj().find_value("index");
+
+    if (!txidValue.isStr())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid txid, must be a string");
+    if (!indexValue.isNum())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid index, must be an integer");
+    uint256 txid = ParseHashV(txidValue, "txid");
+    int outputIndex = indexValue.getInt<int>();
+
+    return CSpentIndexKey(txid, outputIndex);
+}
+
+static UniValue SpentInfoToJSON(const CSpentIndexValue& value)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("txid", value.txid.GetHex());
+    obj.pushKV("index", (int)value.inputIndex);
+    obj.pushKV("height", value.blockHeight);
+    return obj;
+}
+
 // insightexplorer
 UniValue getspentinfo(const UniValue& params, bool fHelp)
 {
@@ -1080,10 +1280,13 @@ UniValue getspentinfo(const UniValue& params, bool fHelp)
     if (!fExperimentalInsightExplorer) {
         disabledMsg = experimentalDisabledHelpMsg("getspentinfo", {"insightexplorer"});
     }
-    if (fHelp || params.size() != 1 || !params[0].isObject())
+    if (fHelp || params.size() != 1 || !(params[0].isObject() || params[0].isArray()))
         throw runtime_error(
             "getspentinfo {\"txid\": \"txidhex\", \"index\": n}\n"
+            "getspentinfo [{\"txid\": \"txidhex\", \"index\": n},...]\n"
             "\nReturns the txid and index where an output is spent.\n"
+            "Given an array of outputs, looks them all up at once and returns an\n"
+            "array with an entry for each, null for outputs that are not spent.\n"
             + disabledMsg +
             "\nArguments:\n"
             "{\n"
@@ -1098,6 +1301,7 @@ UniValue getspentinfo(const UniValue& params, bool fHelp)
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getspentinfo", "'{\"txid\": \"33990288fb116981260be1de10b8c764f997674545ab14f9240f00346333b780\", \"index\": 4}'")
+            + HelpExampleCli("getspentinfo", "'[{\"txid\": \"33990288fb116981260be1de10b8c764f997674545ab14f9240f00346333b780\", \"index\": 4}, {\"txid\": \"33990288fb116981260be1de10b8c764f997674545ab14f9240f00346333b780\", \"index\": 5}]'")
             + HelpExampleRpc("getspentinfo", "{\"txid\": \"33990288fb116981260be1de10b8c764f997674545ab14f9240f00346333b780\", \"index\": 4}")
         );
 
@@ -1106,31 +1310,36 @@ UniValue getspentinfo(const UniValue& params, bool fHelp)
             "Run './bitcoinz-cli help getspentinfo' for instructions on how to enable this feature.");
     }
 
-    UniValue txidValue = params[0].get_obj().find_value("txid");
-    UniValue indexValue = params[0].get_obj().find_value("index");
-
-    if (!txidValue.isStr())
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid txid, must be a string");
-    if (!indexValue.isNum())
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid index, must be an integer");
-    uint256 txid = ParseHashV(txidValue, "txid");
-    int outputIndex = indexValue.getInt<int>();
-
-    CSpentIndexKey key(txid, outputIndex);
-    CSpentIndexValue value;
+    std::vector<CSpentIndexKey> keys;
+    if (params[0].isArray()) {
+        for (size_t i = 0; i < params[0].size(); i++)
+            keys.push_back(ParseSpentInfoKey(params[0][i]));
+    } else {
+        keys.push_back(ParseSpentInfoKey(params[0]));
+    }
 
+    std::vector<CSpentIndexValue> values;
     {
         LOCK(cs_main);
-        if (!GetSpentIndex(key, value)) {
+        if (!GetSpentIndex(keys, values)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
         }
     }
-    UniValue obj(UniValue::VOBJ);
-    obj.pushKV("txid", value.txid.GetHex());
-    obj.pushKV("index", (int)value.inputIndex);
-    obj.pushKV("height", value.blockHeight);
 
-    return obj;
+    if (!params[0].isArray()) {
+        if (values[0].IsNull())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+        return SpentInfoToJSON(values[0]);
+    }
+
+    UniValue result(UniValue::VARR);
+    for (const CSpentIndexValue& value : values) {
+        if (value.IsNull())
+            result.push_back(NullUniValue);
+        else
+            result.push_back(SpentInfoToJSON(value));
+    }
+    return result;
 }
 
 static const CRPCCommand commands[] =
@@ -1142,6 +1351,9 @@ static const CRPCCommand commands[] =
     { "util",               "createmultisig",         &createmultisig,         true  },
     { "util",               "verifymessage",          &verifymessage,          true  },
     { "control",            "getexperimentalfeatures",&getexperimentalfeatures,true  },
+    { "control",            "getperfstats",           &getperfstats,           true  },
+    { "control",            "getlockprofile",         &getlockprofile,         true  },
+    { "control",            "setlockprofiling",       &setlockprofiling,       true  },
 
     // START insightexplorer
     /* Address index */
@@ -104,7 +104,17 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             "    \"inflight\": [\n"
             "       n,                        (numeric) The heights of blocks we're currently asking from this peer\n"
             "       ...\n"
-            "    ]\n"
+            "    ],\n"
+            "    \"whitelisted\": true|false, (boolean) Whether the peer is whitelisted\n"
+            "    \"txreconciliation\": true|false, (boolean) Whether we reconcile transaction announcements with the peer\n"
+            "    \"bytessent_per_msg\": {\n"
+            "       \"addr\": n,              (numeric) The total bytes sent aggregated by message type\n"
+            "       ...\n"
+            "    },\n"
+            "    \"bytesrecv_per_msg\": {\n"
+            "       \"addr\": n,              (numeric) The total bytes received aggregated by message type\n"
+            "       ...\n"
+            "    }\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -157,6 +167,21 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             obj.pushKV("inflight", heights);
         }
         obj.pushKV("whitelisted", stats.fWhitelisted);
+        obj.pushKV("txreconciliation", stats.fTxReconciliation);
+
+        UniValue sendPerMsgCmd(UniValue::VOBJ);
+        for (const mapMsgCmdSize::value_type &i : stats.mapSendBytesPerMsg) {
+            if (i.second > 0)
+                sendPerMsgCmd.pushKV(i.first, i.second);
+        }
+        obj.pushKV("bytessent_per_msg", sendPerMsgCmd);
+
+        UniValue recvPerMsgCmd(UniValue::VOBJ);
+        for (const mapMsgCmdSize::value_type &i : stats.mapRecvBytesPerMsg) {
+            if (i.second > 0)
+                recvPerMsgCmd.pushKV(i.first, i.second);
+        }
+        obj.pushKV("bytesrecv_per_msg", recvPerMsgCmd);
 
         ret.push_back(obj);
     }
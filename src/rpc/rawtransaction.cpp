@@ -15,6 +15,7 @@
 #include "net.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "script/script.h"
 #include "script/script_error.h"
@@ -34,30 +35,47 @@
 
 using namespace std;
 
-void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex)
+/** Add the members obj, written by a UniValueWriter, to out */
+static void AppendMembers(UniValue& out, const UniValue& obj)
+{
+    for (size_t i = 0; i < obj.size(); i++)
+        out.pushKV(obj.getKeys()[i], obj[i]);
+}
+
+void ScriptPubKeyToJSON(JSONWriter& writer, const CScript& scriptPubKey, bool fIncludeHex)
 {
     txnouttype type;
     vector<CTxDestination> addresses;
     int nRequired;
 
-    out.pushKV("asm", ScriptToAsmStr(scriptPubKey));
+    writer.KVStr("asm", ScriptToAsmStr(scriptPubKey));
     if (fIncludeHex)
-        out.pushKV("hex", HexStr(scriptPubKey.begin(), scriptPubKey.end()));
+        writer.KVStr("hex", HexStr(scriptPubKey.begin(), scriptPubKey.end()));
 
     if (!ExtractDestinations(scriptPubKey, type, addresses, nRequired)) {
-        out.pushKV("type", GetTxnOutputType(type));
+        writer.KVStr("type", GetTxnOutputType(type));
         return;
     }
 
-    out.pushKV("reqSigs", nRequired);
-    out.pushKV("type", GetTxnOutputType(type));
+    writer.KVInt("reqSigs", nRequired);
+    writer.KVStr("type", GetTxnOutputType(type));
 
     KeyIO keyIO(Params());
-    UniValue a(UniValue::VARR);
+    writer.Key("addresses");
+    writer.BeginArray();
     for (const CTxDestination& addr : addresses) {
-        a.push_back(keyIO.EncodeDestination(addr));
+        writer.Str(keyIO.EncodeDestination(addr));
     }
-    out.pushKV("addresses", a);
+    writer.EndArray();
+}
+
+void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex)
+{
+    UniValueWriter writer;
+    writer.BeginObject();
+    ScriptPubKeyToJSON(writer, scriptPubKey, fIncludeHex);
+    writer.EndObject();
+    AppendMembers(out, writer.Result());
 }
 
 
@@ -120,148 +138,181 @@ UniValue TxJoinSplitToJSON(const CTransaction& tx) {
     return vJoinSplit;
 }
 
-UniValue TxShieldedSpendsToJSON(const CTransaction& tx) {
-    UniValue vdesc(UniValue::VARR);
+static void TxShieldedSpendsToJSON(JSONWriter& writer, const CTransaction& tx) {
+    writer.BeginArray();
     for (const SpendDescription& spendDesc : tx.vShieldedSpend) {
-        UniValue obj(UniValue::VOBJ);
-        obj.pushKV("cv", spendDesc.cv.GetHex());
-        obj.pushKV("anchor", spendDesc.anchor.GetHex());
-        obj.pushKV("nullifier", spendDesc.nullifier.GetHex());
-        obj.pushKV("rk", spendDesc.rk.GetHex());
-        obj.pushKV("proof", HexStr(spendDesc.zkproof.begin(), spendDesc.zkproof.end()));
-        obj.pushKV("spendAuthSig", HexStr(spendDesc.spendAuthSig.begin(), spendDesc.spendAuthSig.end()));
-        vdesc.push_back(obj);
+        writer.BeginObject();
+        writer.KVStr("cv", spendDesc.cv.GetHex());
+        writer.KVStr("anchor", spendDesc.anchor.GetHex());
+        writer.KVStr("nullifier", spendDesc.nullifier.GetHex());
+        writer.KVStr("rk", spendDesc.rk.GetHex());
+        writer.KVStr("proof", HexStr(spendDesc.zkproof.begin(), spendDesc.zkproof.end()));
+        writer.KVStr("spendAuthSig", HexStr(spendDesc.spendAuthSig.begin(), spendDesc.spendAuthSig.end()));
+        writer.EndObject();
     }
-    return vdesc;
+    writer.EndArray();
 }
 
-UniValue TxShieldedOutputsToJSON(const CTransaction& tx) {
-    UniValue vdesc(UniValue::VARR);
+static void TxShieldedOutputsToJSON(JSONWriter& writer, const CTransaction& tx) {
+    writer.BeginArray();
     for (const OutputDescription& outputDesc : tx.vShieldedOutput) {
-        UniValue obj(UniValue::VOBJ);
-        obj.pushKV("cv", outputDesc.cv.GetHex());
-        obj.pushKV("cmu", outputDesc.cmu.GetHex());
-        obj.pushKV("ephemeralKey", outputDesc.ephemeralKey.GetHex());
-        obj.pushKV("encCiphertext", HexStr(outputDesc.encCiphertext.begin(), outputDesc.encCiphertext.end()));
-        obj.pushKV("outCiphertext", HexStr(outputDesc.outCiphertext.begin(), outputDesc.outCiphertext.end()));
-        obj.pushKV("proof", HexStr(outputDesc.zkproof.begin(), outputDesc.zkproof.end()));
-        vdesc.push_back(obj);
+        writer.BeginObject();
+        writer.KVStr("cv", outputDesc.cv.GetHex());
+        writer.KVStr("cmu", outputDesc.cmu.GetHex());
+        writer.KVStr("ephemeralKey", outputDesc.ephemeralKey.GetHex());
+        writer.KVStr("encCiphertext", HexStr(outputDesc.encCiphertext.begin(), outputDesc.encCiphertext.end()));
+        writer.KVStr("outCiphertext", HexStr(outputDesc.outCiphertext.begin(), outputDesc.outCiphertext.end()));
+        writer.KVStr("proof", HexStr(outputDesc.zkproof.begin(), outputDesc.zkproof.end()));
+        writer.EndObject();
     }
-    return vdesc;
+    writer.EndArray();
 }
 
-void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
+/**
+ * Write the members of the decoded transaction to the enclosing object.
+ * fIncludeHex leaves out the serialized transaction, for callers that
+ * write it first.
+ */
+void TxToJSON(JSONWriter& writer, const CTransaction& tx, const uint256 hashBlock, bool fIncludeHex = true)
 {
     const uint256 txid = tx.GetHash();
-    entry.pushKV("txid", txid.GetHex());
-    entry.pushKV("size", (int)::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION));
-    entry.pushKV("overwintered", tx.fOverwintered);
-    entry.pushKV("version", tx.nVersion);
+    writer.KVStr("txid", txid.GetHex());
+    writer.KVInt("size", ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION));
+    writer.KV("overwintered", tx.fOverwintered);
+    writer.KVInt("version", tx.nVersion);
     if (tx.fOverwintered) {
-        entry.pushKV("versiongroupid", HexInt(tx.nVersionGroupId));
+        writer.KVStr("versiongroupid", HexInt(tx.nVersionGroupId));
     }
-    entry.pushKV("locktime", (int64_t)tx.nLockTime);
+    writer.KVInt("locktime", tx.nLockTime);
     if (tx.fOverwintered) {
-        entry.pushKV("expiryheight", (int64_t)tx.nExpiryHeight);
+        writer.KVInt("expiryheight", tx.nExpiryHeight);
     }
 
-    entry.pushKV("hex", EncodeHexTx(tx));
+    if (fIncludeHex)
+        writer.KVStr("hex", EncodeHexTx(tx));
+
+    // Look up the spent index for all inputs and outputs at once; the inputs'
+    // entries come first, and vSpentInfo stays empty if the lookup fails
+    std::vector<CSpentIndexValue> vSpentInfo;
+    if (fSpentIndex) {
+        std::vector<CSpentIndexKey> vSpentKeys;
+        if (!tx.IsCoinBase()) {
+            for (const CTxIn& txin : tx.vin)
+                vSpentKeys.push_back(CSpentIndexKey(txin.prevout.hash, txin.prevout.n));
+        }
+        for (unsigned int i = 0; i < tx.vout.size(); i++)
+            vSpentKeys.push_back(CSpentIndexKey(txid, i));
+        if (!GetSpentIndex(vSpentKeys, vSpentInfo))
+            vSpentInfo.clear();
+    }
+    const size_t nSpentInputs = tx.IsCoinBase() ? 0 : tx.vin.size();
 
     KeyIO keyIO(Params());
-    UniValue vin(UniValue::VARR);
-    for (const CTxIn& txin : tx.vin) {
-        UniValue in(UniValue::VOBJ);
+    writer.Key("vin");
+    writer.BeginArray();
+    for (unsigned int j = 0; j < tx.vin.size(); j++) {
+        const CTxIn& txin = tx.vin[j];
+        writer.BeginObject();
         if (tx.IsCoinBase())
-            in.pushKV("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            writer.KVStr("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
         else {
-            in.pushKV("txid", txin.prevout.hash.GetHex());
-            in.pushKV("vout", (int64_t)txin.prevout.n);
-            UniValue o(UniValue::VOBJ);
-            o.pushKV("asm", ScriptToAsmStr(txin.scriptSig, true));
-            o.pushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
-            in.pushKV("scriptSig", o);
+            writer.KVStr("txid", txin.prevout.hash.GetHex());
+            writer.KVInt("vout", txin.prevout.n);
+            writer.Key("scriptSig");
+            writer.BeginObject();
+            writer.KVStr("asm", ScriptToAsmStr(txin.scriptSig, true));
+            writer.KVStr("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            writer.EndObject();
 
             // Add address and value info if spentindex enabled
-            CSpentIndexValue spentInfo;
-            CSpentIndexKey spentKey(txin.prevout.hash, txin.prevout.n);
-            if (fSpentIndex && GetSpentIndex(spentKey, spentInfo)) {
-                in.pushKV("value", ValueFromAmount(spentInfo.satoshis));
-                in.pushKV("valueSat", spentInfo.satoshis);
+            if (!vSpentInfo.empty() && !vSpentInfo[j].IsNull()) {
+                const CSpentIndexValue& spentInfo = vSpentInfo[j];
+                writer.KVAmount("value", spentInfo.satoshis);
+                writer.KVInt("valueSat", spentInfo.satoshis);
 
                 CTxDestination dest =
                     DestFromAddressHash(spentInfo.addressType, spentInfo.addressHash);
                 if (IsValidDestination(dest)) {
-                    in.pushKV("address", keyIO.EncodeDestination(dest));
+                    writer.KVStr("address", keyIO.EncodeDestination(dest));
                 }
             }
         }
-        in.pushKV("sequence", (int64_t)txin.nSequence);
-        vin.push_back(in);
+        writer.KVInt("sequence", txin.nSequence);
+        writer.EndObject();
     }
-    entry.pushKV("vin", vin);
-    UniValue vout(UniValue::VARR);
+    writer.EndArray();
+    writer.Key("vout");
+    writer.BeginArray();
     for (unsigned int i = 0; i < tx.vout.size(); i++) {
         const CTxOut& txout = tx.vout[i];
-        UniValue out(UniValue::VOBJ);
-        out.pushKV("value", ValueFromAmount(txout.nValue));
-        out.pushKV("valueZat", txout.nValue);
-        out.pushKV("valueSat", txout.nValue);
-        out.pushKV("n", (int64_t)i);
-        UniValue o(UniValue::VOBJ);
-        ScriptPubKeyToJSON(txout.scriptPubKey, o, true);
-        out.pushKV("scriptPubKey", o);
+        writer.BeginObject();
+        writer.KVAmount("value", txout.nValue);
+        writer.KVInt("valueZat", txout.nValue);
+        writer.KVInt("valueSat", txout.nValue);
+        writer.KVInt("n", i);
+        writer.Key("scriptPubKey");
+        writer.BeginObject();
+        ScriptPubKeyToJSON(writer, txout.scriptPubKey, true);
+        writer.EndObject();
 
         // Add spent information if spentindex is enabled
-        CSpentIndexValue spentInfo;
-        CSpentIndexKey spentKey(txid, i);
-        if (fSpentIndex && GetSpentIndex(spentKey, spentInfo)) {
-            out.pushKV("spentTxId", spentInfo.txid.GetHex());
-            out.pushKV("spentIndex", (int)spentInfo.inputIndex);
-            out.pushKV("spentHeight", spentInfo.blockHeight);
+        if (!vSpentInfo.empty() && !vSpentInfo[nSpentInputs + i].IsNull()) {
+            const CSpentIndexValue& spentInfo = vSpentInfo[nSpentInputs + i];
+            writer.KVStr("spentTxId", spentInfo.txid.GetHex());
+            writer.KVInt("spentIndex", spentInfo.inputIndex);
+            writer.KVInt("spentHeight", spentInfo.blockHeight);
         }
-        vout.push_back(out);
+        writer.EndObject();
     }
-    entry.pushKV("vout", vout);
+    writer.EndArray();
 
-    UniValue vJoinSplit = TxJoinSplitToJSON(tx);
-    entry.pushKV("vJoinSplit", vJoinSplit);
+    writer.KV("vJoinSplit", TxJoinSplitToJSON(tx));
 
     if (tx.fOverwintered && tx.nVersion >= SAPLING_TX_VERSION) {
-        entry.pushKV("valueBalance", ValueFromAmount(tx.valueBalance));
-        entry.pushKV("valueBalanceZat", tx.valueBalance);
-        UniValue vspenddesc = TxShieldedSpendsToJSON(tx);
-        entry.pushKV("vShieldedSpend", vspenddesc);
-        UniValue voutputdesc = TxShieldedOutputsToJSON(tx);
-        entry.pushKV("vShieldedOutput", voutputdesc);
-        if (!(vspenddesc.empty() && voutputdesc.empty())) {
-            entry.pushKV("bindingSig", HexStr(tx.bindingSig.begin(), tx.bindingSig.end()));
+        writer.KVAmount("valueBalance", tx.valueBalance);
+        writer.KVInt("valueBalanceZat", tx.valueBalance);
+        writer.Key("vShieldedSpend");
+        TxShieldedSpendsToJSON(writer, tx);
+        writer.Key("vShieldedOutput");
+        TxShieldedOutputsToJSON(writer, tx);
+        if (!(tx.vShieldedSpend.empty() && tx.vShieldedOutput.empty())) {
+            writer.KVStr("bindingSig", HexStr(tx.bindingSig.begin(), tx.bindingSig.end()));
         }
     }
 
     if (tx.nVersion >= 2 && tx.vJoinSplit.size() > 0) {
-        entry.pushKV("joinSplitPubKey", tx.joinSplitPubKey.GetHex());
-        entry.pushKV("joinSplitSig", HexStr(tx.joinSplitSig.begin(), tx.joinSplitSig.end()));
+        writer.KVStr("joinSplitPubKey", tx.joinSplitPubKey.GetHex());
+        writer.KVStr("joinSplitSig", HexStr(tx.joinSplitSig.begin(), tx.joinSplitSig.end()));
     }
 
     if (!hashBlock.IsNull()) {
-        entry.pushKV("blockhash", hashBlock.GetHex());
+        writer.KVStr("blockhash", hashBlock.GetHex());
         BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
         if (mi != mapBlockIndex.end() && (*mi).second) {
             CBlockIndex* pindex = (*mi).second;
             if (chainActive.Contains(pindex)) {
-                entry.pushKV("height", pindex->nHeight);
-                entry.pushKV("confirmations", 1 + chainActive.Height() - pindex->nHeight);
-                entry.pushKV("time", pindex->GetBlockTime());
-                entry.pushKV("blocktime", pindex->GetBlockTime());
+                writer.KVInt("height", pindex->nHeight);
+                writer.KVInt("confirmations", 1 + chainActive.Height() - pindex->nHeight);
+                writer.KVInt("time", pindex->GetBlockTime());
+                writer.KVInt("blocktime", pindex->GetBlockTime());
             } else {
-                entry.pushKV("height", -1);
-                entry.pushKV("confirmations", 0);
-          }
-      }
-  }
+                writer.KVInt("height", -1);
+                writer.KVInt("confirmations", 0);
+            }
+        }
+    }
 }
 
-UniValue getrawtransaction(const UniValue& params, bool fHelp)
+void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
+{
+    UniValueWriter writer;
+    writer.BeginObject();
+    TxToJSON(writer, tx, hashBlock);
+    writer.EndObject();
+    AppendMembers(entry, writer.Result());
+}
+
+void getrawtransaction(const UniValue& params, bool fHelp, JSONWriter& writer)
 {
     if (fHelp || params.size() < 1 || params.size() > 3)
         throw runtime_error(
@@ -363,8 +414,6 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
             + HelpExampleCli("getrawtransaction", "\"mytxid\" 1 \"myblockhash\"")
         );
 
-    LOCK(cs_main);
-
     bool in_active_chain = true;
     uint256 hash = ParseHashV(params[0], "parameter 1");
     CBlockIndex* blockindex = nullptr;
@@ -373,45 +422,59 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = (params[1].getInt<int>() != 0);
 
-    if (params.size() > 2) {
-        uint256 blockhash = ParseHashV(params[2], "parameter 3");
-        if (!blockhash.IsNull()) {
-            BlockMap::iterator it = mapBlockIndex.find(blockhash);
-            if (it == mapBlockIndex.end()) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block hash not found");
+    CTransaction tx;
+    uint256 hash_block;
+    {
+        LOCK(cs_main);
+
+        if (params.size() > 2) {
+            uint256 blockhash = ParseHashV(params[2], "parameter 3");
+            if (!blockhash.IsNull()) {
+                BlockMap::iterator it = mapBlockIndex.find(blockhash);
+                if (it == mapBlockIndex.end()) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block hash not found");
+                }
+                blockindex = it->second;
+                in_active_chain = chainActive.Contains(blockindex);
             }
-            blockindex = it->second;
-            in_active_chain = chainActive.Contains(blockindex);
         }
-    }
 
-    CTransaction tx;
-    uint256 hash_block;
-    if (!GetTransaction(hash, tx, Params().GetConsensus(), hash_block, true, blockindex)) {
-        std::string errmsg;
-        if (blockindex) {
-            if (!(blockindex->nStatus & BLOCK_HAVE_DATA)) {
-                throw JSONRPCError(RPC_MISC_ERROR, "Block not available");
+        if (!GetTransaction(hash, tx, Params().GetConsensus(), hash_block, true, blockindex)) {
+            std::string errmsg;
+            if (blockindex) {
+                if (!(blockindex->nStatus & BLOCK_HAVE_DATA)) {
+                    throw JSONRPCError(RPC_MISC_ERROR, "Block not available");
+                }
+                errmsg = "No such transaction found in the provided block";
+            } else {
+                errmsg = fTxIndex
+                  ? "No such mempool or blockchain transaction"
+                  : "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
             }
-            errmsg = "No such transaction found in the provided block";
-        } else {
-            errmsg = fTxIndex
-              ? "No such mempool or blockchain transaction"
-              : "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, errmsg + ". Use gettransaction for wallet transactions.");
         }
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, errmsg + ". Use gettransaction for wallet transactions.");
     }
 
     string strHex = EncodeHexTx(tx);
 
-    if (!fVerbose)
-        return strHex;
+    if (!fVerbose) {
+        writer.Str(strHex);
+        return;
+    }
 
-    UniValue result(UniValue::VOBJ);
-    if (blockindex) result.pushKV("in_active_chain", in_active_chain);
-    result.pushKV("hex", strHex);
-    TxToJSON(tx, hash_block, result);
-    return result;
+    LOCK(cs_main);
+    writer.BeginObject();
+    if (blockindex) writer.KV("in_active_chain", in_active_chain);
+    writer.KVStr("hex", strHex);
+    TxToJSON(writer, tx, hash_block, false);
+    writer.EndObject();
+}
+
+UniValue getrawtransaction(const UniValue& params, bool fHelp)
+{
+    UniValueWriter writer;
+    getrawtransaction(params, fHelp, writer);
+    return writer.Result();
 }
 
 UniValue gettxoutproof(const UniValue& params, bool fHelp)
@@ -1157,7 +1220,7 @@ UniValue sendrawtransaction(const UniValue& params, bool fHelp)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  &getrawtransaction },
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
     { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
     { "rawtransactions",    "decodescript",           &decodescript,           true  },
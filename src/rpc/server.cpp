@@ -8,14 +8,22 @@
 #include "fs.h"
 #include "init.h"
 #include "key_io.h"
+#include "perfstats.h"
 #include "random.h"
+#include "rpc/jsonwriter.h"
 #include "sync.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilstrencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #include <univalue.h>
 
@@ -42,6 +50,88 @@ static std::vector<RPCTimerInterface*> timerInterfaces;
 /* Map of name to timer. */
 static std::map<std::string, std::unique_ptr<RPCTimerBase> > deadlineTimers;
 
+/**
+ * Threads helping HTTP workers execute the elements of JSON-RPC batches in
+ * parallel. Work items are simply callable objects.
+ */
+class CRPCBatchThreads
+{
+private:
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<std::function<void()> > queue;
+    std::vector<std::thread> threads;
+    bool running;
+
+    void Run()
+    {
+        RenameThread("bitcoinz-rpcbatch");
+        while (true) {
+            std::function<void()> item;
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                while (running && queue.empty())
+                    cond.wait(lock);
+                if (!running)
+                    break;
+                item = std::move(queue.front());
+                queue.pop_front();
+            }
+            item();
+        }
+    }
+
+public:
+    CRPCBatchThreads() : running(false) {}
+
+    void Start(int nThreads)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        running = nThreads > 0;
+        for (int i = 0; i < nThreads; i++)
+            threads.emplace_back(&CRPCBatchThreads::Run, this);
+    }
+
+    /** Stop the threads, dropping queued items */
+    void Stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            running = false;
+            queue.clear();
+            cond.notify_all();
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        threads.clear();
+    }
+
+    /** Enqueue a work item; returns false if the threads are not running */
+    bool Enqueue(std::function<void()> item)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (!running)
+            return false;
+        queue.push_back(std::move(item));
+        cond.notify_one();
+        return true;
+    }
+};
+
+static CRPCBatchThreads rpcBatchThreads;
+static int nRPCBatchConcurrency = DEFAULT_RPC_BATCH_CONCURRENCY;
+
+/**
+ * Commands that only read state and hold cs_main briefly, if at all, whose
+ * consecutive elements in a batch may be executed in parallel.
+ */
+static const std::set<std::string> setBatchParallelCommands = {
+    "decoderawtransaction", "decodescript",
+    "getaddressbalance", "getaddressdeltas", "getaddressmempool", "getaddresstxids", "getaddressutxos",
+    "getbestblockhash", "getblock", "getblockcount", "getblockdeltas", "getblockfilter", "getblockhash",
+    "getblockhashes", "getblockheader", "getrawtransaction", "getspentinfo", "gettxout", "gettxoutproof",
+};
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -172,8 +262,8 @@ std::string CRPCTable::help(const std::string& strCommand) const
     set<rpcfn_type> setDone;
     vector<pair<string, const CRPCCommand*> > vCommands;
 
-    for (map<string, const CRPCCommand*>::const_iterator mi = mapCommands.begin(); mi != mapCommands.end(); ++mi)
-        vCommands.push_back(make_pair(mi->second->category + mi->first, mi->second));
+    for (map<string, Entry>::const_iterator mi = mapCommands.begin(); mi != mapCommands.end(); ++mi)
+        vCommands.push_back(make_pair(mi->second.pcmd->category + mi->first, mi->second.pcmd));
     sort(vCommands.begin(), vCommands.end());
 
     for (const std::pair<string, const CRPCCommand*>& command : vCommands)
@@ -272,16 +362,23 @@ CRPCTable::CRPCTable()
         const CRPCCommand *pcmd;
 
         pcmd = &vRPCCommands[vcidx];
-        mapCommands[pcmd->name] = pcmd;
+        addCommand(pcmd->name, pcmd);
     }
 }
 
+void CRPCTable::addCommand(const std::string& name, const CRPCCommand* pcmd)
+{
+    Entry& entry = mapCommands[name];
+    entry.pcmd = pcmd;
+    entry.histogram = &GetPerfHistogram("rpc_seconds", "Time spent executing RPC calls, by method", "method", pcmd->name);
+}
+
 const CRPCCommand *CRPCTable::operator[](const std::string &name) const
 {
-    map<string, const CRPCCommand*>::const_iterator it = mapCommands.find(name);
+    map<string, Entry>::const_iterator it = mapCommands.find(name);
     if (it == mapCommands.end())
         return NULL;
-    return (*it).second;
+    return (*it).second.pcmd;
 }
 
 bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
@@ -290,11 +387,11 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
         return false;
 
     // don't allow overwriting for now
-    map<string, const CRPCCommand*>::const_iterator it = mapCommands.find(name);
+    map<string, Entry>::const_iterator it = mapCommands.find(name);
     if (it != mapCommands.end())
         return false;
 
-    mapCommands[name] = pcmd;
+    addCommand(name, pcmd);
     return true;
 }
 
@@ -304,6 +401,13 @@ bool StartRPC()
     fRPCRunning = true;
     g_rpcSignals.Started();
 
+    int nBatchThreads = GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS);
+    nRPCBatchConcurrency = std::max((int)GetArg("-rpcbatchconcurrency", DEFAULT_RPC_BATCH_CONCURRENCY), 1);
+    if (nBatchThreads > 0) {
+        LogPrint(BCLog::RPC, "Starting %d RPC batch threads\n", nBatchThreads);
+        rpcBatchThreads.Start(nBatchThreads);
+    }
+
     // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
     getAsyncRPCQueue()->addWorker();
 /*
@@ -332,6 +436,7 @@ void StopRPC()
 {
     LogPrint(BCLog::RPC, "Stopping RPC\n");
     deadlineTimers.clear();
+    rpcBatchThreads.Stop();
     g_rpcSignals.Stopped();
 
     // Tells async queue to cancel all operations and shutdown.
@@ -392,6 +497,15 @@ void JSONRequest::parse(const UniValue& valRequest)
         params = UniValue(UniValue::VARR);
     else
         throw JSONRPCError(RPC_INVALID_REQUEST, "Params must be an array");
+
+    // Parse reply format, an extension to JSON-RPC
+    UniValue valFormat = request.find_value("format");
+    if (valFormat.isNull() || (valFormat.isStr() && valFormat.get_str() == "json"))
+        fCBOR = false;
+    else if (valFormat.isStr() && valFormat.get_str() == "cbor")
+        fCBOR = true;
+    else
+        throw JSONRPCError(RPC_INVALID_REQUEST, "Format must be \"json\" or \"cbor\"");
 }
 
 static UniValue JSONRPCExecOne(const UniValue& req)
@@ -401,6 +515,8 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     JSONRequest jreq;
     try {
         jreq.parse(req);
+        if (jreq.fCBOR)
+            throw JSONRPCError(RPC_INVALID_REQUEST, "CBOR replies are only available for single requests");
 
         UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
         rpc_result = JSONRPCReplyObj(result, NullUniValue, jreq.id);
@@ -418,16 +534,93 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
+static bool IsBatchParallelSafe(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    const UniValue& method = req.find_value("method");
+    return method.isStr() && setBatchParallelCommands.count(method.get_str());
+}
+
+/**
+ * A run of batch elements executed in parallel. The thread executing the
+ * batch and the helpers it enqueues each claim the next unexecuted element
+ * until none are left, and the batch thread waits for all of them to finish.
+ * Helpers dequeued after that find nothing left to claim and exit, so never
+ * touch the requests once the batch has moved on.
+ */
+struct CRPCBatchRun
+{
+    const UniValue& vReq;
+    const size_t nBegin;
+    const size_t nEnd;
+    std::atomic<size_t> nNext;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    std::vector<UniValue> vReply;
+    size_t nDone;
+
+    CRPCBatchRun(const UniValue& vReqIn, size_t nBeginIn, size_t nEndIn) :
+        vReq(vReqIn), nBegin(nBeginIn), nEnd(nEndIn), nNext(nBeginIn),
+        vReply(nEndIn - nBeginIn), nDone(0) {}
+
+    void Work()
+    {
+        for (size_t i = nNext++; i < nEnd; i = nNext++) {
+            UniValue reply = JSONRPCExecOne(vReq[i]);
+            std::unique_lock<std::mutex> lock(cs);
+            vReply[i - nBegin] = std::move(reply);
+            if (++nDone == vReply.size())
+                cond.notify_all();
+        }
+    }
+
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        while (nDone < vReply.size())
+            cond.wait(lock);
+    }
+};
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
     UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    size_t reqIdx = 0;
+    while (reqIdx < vReq.size()) {
+        // Execute runs of parallel safe elements concurrently, and anything
+        // else in order by itself, so that the batch behaves as if executed
+        // one element after another
+        size_t reqEnd = reqIdx;
+        while (reqEnd < vReq.size() && IsBatchParallelSafe(vReq[reqEnd]))
+            reqEnd++;
+        if (reqEnd - reqIdx < 2 || nRPCBatchConcurrency < 2) {
+            ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+            reqIdx++;
+            continue;
+        }
+
+        auto run = std::make_shared<CRPCBatchRun>(vReq, reqIdx, reqEnd);
+        size_t nHelpers = std::min<size_t>(nRPCBatchConcurrency - 1, reqEnd - reqIdx - 1);
+        for (size_t i = 0; i < nHelpers; i++) {
+            if (!rpcBatchThreads.Enqueue([run] { run->Work(); }))
+                break;
+        }
+        run->Work();
+        run->Wait();
+        LogPrint(BCLog::RPC, "Executed %u batch elements with up to %u helper threads\n",
+            reqEnd - reqIdx, nHelpers);
+
+        for (UniValue& reply : run->vReply)
+            ret.push_back(std::move(reply));
+        reqIdx = reqEnd;
+    }
 
     return ret.write() + "\n";
 }
 
-UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
+const CRPCTable::Entry& CRPCTable::findCommand(const std::string &strMethod) const
 {
     // Return immediately if in warmup
     {
@@ -437,15 +630,23 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     }
 
     // Find method
-    const CRPCCommand *pcmd = tableRPC[strMethod];
-    if (!pcmd)
+    map<string, Entry>::const_iterator it = mapCommands.find(strMethod);
+    if (it == mapCommands.end())
         throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found");
+    return it->second;
+}
+
+UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
+{
+    const Entry& entry = findCommand(strMethod);
+    const CRPCCommand *pcmd = entry.pcmd;
 
     g_rpcSignals.PreCommand(*pcmd);
 
     try
     {
         // Execute
+        PerfTimer timer(*entry.histogram);
         return pcmd->actor(params, false);
     }
     catch (const std::exception& e)
@@ -456,6 +657,30 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     g_rpcSignals.PostCommand(*pcmd);
 }
 
+void CRPCTable::execute(const std::string &strMethod, const UniValue &params, JSONWriter& writer) const
+{
+    const Entry& entry = findCommand(strMethod);
+    const CRPCCommand *pcmd = entry.pcmd;
+
+    g_rpcSignals.PreCommand(*pcmd);
+
+    try
+    {
+        // Execute
+        PerfTimer timer(*entry.histogram);
+        if (pcmd->streamActor)
+            pcmd->streamActor(params, false, writer);
+        else
+            writer.Value(pcmd->actor(params, false));
+    }
+    catch (const std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+
+    g_rpcSignals.PostCommand(*pcmd);
+}
+
 std::string HelpExampleCli(const std::string& methodname, const std::string& args)
 {
     return "> bitcoinz-cli " + methodname + " " + args + "\n";
@@ -18,6 +18,9 @@
 
 #include <univalue.h>
 
+class JSONWriter;
+class PerfHistogram;
+
 class AsyncRPCQueue;
 class CRPCCommand;
 
@@ -38,8 +41,10 @@ public:
     UniValue id;
     std::string strMethod;
     UniValue params;
+    //! Whether the reply is requested in CBOR rather than JSON
+    bool fCBOR;
 
-    JSONRequest() { id = NullUniValue; }
+    JSONRequest() { id = NullUniValue; fCBOR = false; }
     void parse(const UniValue& valRequest);
 };
 
@@ -116,6 +121,7 @@ void RPCUnregisterTimerInterface(RPCTimerInterface *iface);
 void RPCRunLater(const std::string& name, std::function<void(void)> func, int64_t nSeconds);
 
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
+typedef void(*rpcstreamfn_type)(const UniValue& params, bool fHelp, JSONWriter& writer);
 
 class CRPCCommand
 {
@@ -124,6 +130,9 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    //! Optional version of actor that writes its result as it goes, for
+    //! commands whose results can be large
+    rpcstreamfn_type streamActor = nullptr;
 };
 
 /**
@@ -132,7 +141,15 @@ public:
 class CRPCTable
 {
 private:
-    std::map<std::string, const CRPCCommand*> mapCommands;
+    struct Entry {
+        const CRPCCommand* pcmd;
+        //! Time spent executing the command, registered when it is added
+        PerfHistogram* histogram;
+    };
+    std::map<std::string, Entry> mapCommands;
+
+    void addCommand(const std::string& name, const CRPCCommand* pcmd);
+    const Entry& findCommand(const std::string& name) const;
 public:
     CRPCTable();
     const CRPCCommand* operator[](const std::string& name) const;
@@ -147,6 +164,13 @@ public:
      */
     UniValue execute(const std::string &method, const UniValue &params) const;
 
+    /**
+     * Execute a method, writing its result to writer. Methods with a
+     * streamActor write the result as it is produced, so an error may be
+     * thrown after part of it has been written.
+     */
+    void execute(const std::string &method, const UniValue &params, JSONWriter& writer) const;
+
 
     /**
      * Appends a CRPCCommand to the dispatch table.
@@ -178,6 +202,11 @@ extern std::string HelpExampleRpc(const std::string& methodname, const std::stri
 
 extern void EnsureWalletIsUnlocked();
 
+/** Default number of threads helping to execute JSON-RPC batches */
+static const int DEFAULT_RPC_BATCH_THREADS = 4;
+/** Default maximum number of elements of one batch executed at the same time */
+static const int DEFAULT_RPC_BATCH_CONCURRENCY = 4;
+
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
@@ -72,6 +72,23 @@ extern "C" {
         unsigned char *result
     );
 
+    /// Computes `count` merkle tree hashes for a given depth
+    /// in one call. The `depth` parameter should not be larger
+    /// than 62.
+    ///
+    /// `pairs` must be of length `64 * count`; each consecutive
+    /// 64 bytes are the left and right inputs of one hash, which
+    /// must each be scalars of BLS12-381.
+    ///
+    /// The results are placed in `result`, which must be of
+    /// length `32 * count`.
+    void librustzcash_merkle_hash_batch(
+        size_t depth,
+        const unsigned char *pairs,
+        size_t count,
+        unsigned char *result
+    );
+
     /// Computes the signature for each Spend description, given the key
     /// `ask`, the re-randomization `ar`, the 32-byte sighash `sighash`,
     /// and an output `result` buffer of 64-bytes for the signature.
@@ -290,22 +290,11 @@ pub extern "system" fn librustzcash_tree_uncommitted(result: *mut [c_uchar; 32])
     write_le(tmp, &mut result[..]);
 }
 
-#[no_mangle]
-pub extern "system" fn librustzcash_merkle_hash(
-    depth: size_t,
-    a: *const [c_uchar; 32],
-    b: *const [c_uchar; 32],
-    result: *mut [c_uchar; 32],
-) {
-    // Should be okay, because caller is responsible for ensuring
-    // the pointer is a valid pointer to 32 bytes, and that is the
-    // size of the representation
-    let a_repr = read_le(unsafe { &(&*a)[..] });
-
-    // Should be okay, because caller is responsible for ensuring
-    // the pointer is a valid pointer to 32 bytes, and that is the
-    // size of the representation
-    let b_repr = read_le(unsafe { &(&*b)[..] });
+/// Computes the Pedersen merkle tree hash of two 32-byte
+/// little-endian scalars at the given depth.
+fn merkle_hash(depth: usize, a: &[u8], b: &[u8]) -> FrRepr {
+    let a_repr = read_le(a);
+    let b_repr = read_le(b);
 
     let mut lhs = [false; 256];
     let mut rhs = [false; 256];
@@ -318,7 +307,7 @@ pub extern "system" fn librustzcash_merkle_hash(
         *a = b;
     }
 
-    let tmp = pedersen_hash::<Bls12, _>(
+    pedersen_hash::<Bls12, _>(
         Personalization::MerkleTree(depth),
         lhs.iter()
             .map(|&x| x)
@@ -327,7 +316,20 @@ pub extern "system" fn librustzcash_merkle_hash(
         &JUBJUB,
     ).into_xy()
         .0
-        .into_repr();
+        .into_repr()
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_merkle_hash(
+    depth: size_t,
+    a: *const [c_uchar; 32],
+    b: *const [c_uchar; 32],
+    result: *mut [c_uchar; 32],
+) {
+    // Should be okay, because caller is responsible for ensuring
+    // the pointers are valid pointers to 32 bytes, and that is the
+    // size of the representation
+    let tmp = merkle_hash(depth, unsafe { &(&*a)[..] }, unsafe { &(&*b)[..] });
 
     // Should be okay, caller is responsible for ensuring the pointer
     // is a valid pointer to 32 bytes that can be mutated.
@@ -336,6 +338,25 @@ pub extern "system" fn librustzcash_merkle_hash(
     write_le(tmp, &mut result[..]);
 }
 
+#[no_mangle]
+pub extern "system" fn librustzcash_merkle_hash_batch(
+    depth: size_t,
+    pairs: *const c_uchar,
+    count: size_t,
+    result: *mut c_uchar,
+) {
+    // Should be okay, because caller is responsible for ensuring
+    // `pairs` points to `64 * count` bytes and `result` to
+    // `32 * count` bytes that can be mutated.
+    let pairs = unsafe { slice::from_raw_parts(pairs, 64 * count) };
+    let result = unsafe { slice::from_raw_parts_mut(result, 32 * count) };
+
+    for (pair, out) in pairs.chunks(64).zip(result.chunks_mut(32)) {
+        let tmp = merkle_hash(depth, &pair[..32], &pair[32..]);
+        write_le(tmp, out);
+    }
+}
+
 #[no_mangle] // ToScalar
 pub extern "system" fn librustzcash_to_scalar(
     input: *const [c_uchar; 64],
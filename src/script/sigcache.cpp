@@ -6,50 +6,65 @@
 #include "sigcache.h"
 
 #include "memusage.h"
+#include "perfstats.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
 #include "util.h"
 
 #include "cuckoocache.h"
+#include <atomic>
 #include <boost/thread.hpp>
 
 namespace {
 
 /**
- * Valid signature cache, to avoid doing expensive ECDSA signature checking
- * twice for every transaction (once when accepted into memory pool, and
- * again when accepted into the block chain)
+ * Valid signature cache, to avoid doing expensive signature checking twice
+ * for every transaction (once when accepted into memory pool, and again when
+ * accepted into the block chain). It holds ECDSA, joinSplitSig and Sapling
+ * verification results, told apart by a type byte in the entry.
  */
 class CSignatureCache
 {
 private:
-     //! Entries are SHA256(nonce || signature hash || public key || signature):
+     //! Entries are SHA256(nonce || type || hash || public key || signature):
     uint256 nonce;
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
     map_type setValid;
     boost::shared_mutex cs_sigcache;
+    std::atomic<uint64_t> nHits[SIGCACHE_TYPE_COUNT];
+    std::atomic<uint64_t> nMisses[SIGCACHE_TYPE_COUNT];
 
 public:
     CSignatureCache()
     {
         GetRandBytes(nonce.begin(), 32);
+        for (int i = 0; i < SIGCACHE_TYPE_COUNT; i++) {
+            nHits[i] = 0;
+            nMisses[i] = 0;
+        }
     }
 
     void
-    ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
+    ComputeEntry(uint256& entry, SignatureCacheType type, const uint256 &hash, const unsigned char* pubkey, size_t nPubKey, const unsigned char* sig, size_t nSig)
     {
-        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(&pubkey[0], pubkey.size()).Write(&vchSig[0], vchSig.size()).Finalize(entry.begin());
+        const unsigned char chType = type;
+        CSHA256().Write(nonce.begin(), 32).Write(&chType, 1).Write(hash.begin(), 32).Write(pubkey, nPubKey).Write(sig, nSig).Finalize(entry.begin());
     }
 
     bool
-    Get(const uint256& entry, const bool erase)
+    Get(SignatureCacheType type, const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        bool fFound;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+            fFound = setValid.contains(entry, erase);
+        }
+        (fFound ? nHits : nMisses)[type]++;
+        return fFound;
     }
 
-    void Set(uint256& entry)
+    void Set(const uint256& entry)
     {
         boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
         setValid.insert(entry);
@@ -59,6 +74,14 @@ public:
     {
         return setValid.setup_bytes(n);
     }
+
+    CSignatureCacheStats GetStats(SignatureCacheType type)
+    {
+        CSignatureCacheStats stats;
+        stats.nHits = nHits[type];
+        stats.nMisses = nMisses[type];
+        return stats;
+    }
 };
 
 /* In previous versions of this code, signatureCache was a local static variable
@@ -73,6 +96,16 @@ static CSignatureCache signatureCache;
 // To be called once in AppInit2/TestingSetup to initialize the signatureCache
 void InitSignatureCache()
 {
+    static const char* const pszTypes[SIGCACHE_TYPE_COUNT] = {"ecdsa", "joinsplit", "sapling"};
+    for (int type = 0; type < SIGCACHE_TYPE_COUNT; type++) {
+        RegisterPerfCallback("signature_cache_hits_total", "Signature checks answered from the signature cache, by type",
+                             PERF_COUNTER, "type", pszTypes[type],
+                             [type] { return GetSignatureCacheStats((SignatureCacheType)type).nHits; });
+        RegisterPerfCallback("signature_cache_misses_total", "Signature checks not found in the signature cache, by type",
+                             PERF_COUNTER, "type", pszTypes[type],
+                             [type] { return GetSignatureCacheStats((SignatureCacheType)type).nMisses; });
+    }
+
     size_t nMaxCacheSize = GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
     if (nMaxCacheSize <= 0) return;
     size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
@@ -80,15 +113,38 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
 }
 
-bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+uint256 ComputeSignatureCacheEntry(SignatureCacheType type, const uint256& hash,
+                                   const unsigned char* pubkey, size_t nPubKey,
+                                   const unsigned char* sig, size_t nSig)
 {
     uint256 entry;
-    signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
-    if (signatureCache.Get(entry, !store))
+    signatureCache.ComputeEntry(entry, type, hash, pubkey, nPubKey, sig, nSig);
+    return entry;
+}
+
+bool GetCachedSignature(SignatureCacheType type, const uint256& entry, bool erase)
+{
+    return signatureCache.Get(type, entry, erase);
+}
+
+void CacheSignature(const uint256& entry)
+{
+    signatureCache.Set(entry);
+}
+
+CSignatureCacheStats GetSignatureCacheStats(SignatureCacheType type)
+{
+    return signatureCache.GetStats(type);
+}
+
+bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
+    uint256 entry = ComputeSignatureCacheEntry(SIGCACHE_ECDSA, sighash, pubkey.begin(), pubkey.size(), vchSig.data(), vchSig.size());
+    if (GetCachedSignature(SIGCACHE_ECDSA, entry, !store))
         return true;
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
     if (store)
-        signatureCache.Set(entry);
+        CacheSignature(entry);
     return true;
 }
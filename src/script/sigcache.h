@@ -38,6 +38,42 @@ public:
     }
 };
 
+/** The kinds of verification results held in the signature cache */
+enum SignatureCacheType
+{
+    SIGCACHE_ECDSA,     //!< Transparent input signatures
+    SIGCACHE_JOINSPLIT, //!< Ed25519 joinSplitSig over a transaction's sighash
+    SIGCACHE_SAPLING,   //!< Sapling spend and output proofs, spendAuthSigs and bindingSig
+    SIGCACHE_TYPE_COUNT
+};
+
+struct CSignatureCacheStats
+{
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    CSignatureCacheStats() : nHits(0), nMisses(0) {}
+};
+
+/**
+ * Compute the signature cache entry for a verification of the given type:
+ * SHA256(nonce || type || hash || pubkey || sig), where hash is the signed
+ * message and pubkey and sig may each be empty when hash already commits to
+ * them.
+ */
+uint256 ComputeSignatureCacheEntry(SignatureCacheType type, const uint256& hash,
+                                   const unsigned char* pubkey, size_t nPubKey,
+                                   const unsigned char* sig, size_t nSig);
+
+/**
+ * Whether entry was recorded as verified. If erase is set, a hit allows the
+ * entry to be evicted: checks made while accepting a block are not expected
+ * to be repeated, unlike those made for the mempool.
+ */
+bool GetCachedSignature(SignatureCacheType type, const uint256& entry, bool erase);
+void CacheSignature(const uint256& entry);
+CSignatureCacheStats GetSignatureCacheStats(SignatureCacheType type);
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -287,7 +287,7 @@ bool IsScriptDestination(const CTxDestination& dest) {
 }
 
 // insightexplorer
-CTxDestination DestFromAddressHash(int scriptType, uint160& addressHash)
+CTxDestination DestFromAddressHash(int scriptType, const uint160& addressHash)
 {
     switch (scriptType) {
     case CScript::P2PKH:
@@ -133,6 +133,6 @@ CScript GetScriptForRawPubKey(const CPubKey& pubkey);
 CScript GetScriptForMultisig(int nRequired, const std::vector<CPubKey>& keys);
 
 // insightexplorer
-CTxDestination DestFromAddressHash(int scriptType, uint160& addressHash);
+CTxDestination DestFromAddressHash(int scriptType, const uint160& addressHash);
 
 #endif // BITCOIN_SCRIPT_STANDARD_H
@@ -10,8 +10,106 @@
 #include <stdio.h>
 
 #include <boost/thread.hpp>
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <set>
 
+PerfHistogram& LockWaitHistogram()
+{
+    static PerfHistogram& hist = GetPerfHistogram("lock_wait_seconds", "Time spent waiting for contended locks");
+    return hist;
+}
+
+std::atomic<uint32_t> nLockProfileSampleRate(0);
+
+namespace {
+
+struct LockSite {
+    // Names and files are string literals, so are compared by address
+    const char* pszName;
+    const char* pszFile;
+    int nLine;
+
+    bool operator<(const LockSite& other) const
+    {
+        if (nLine != other.nLine)
+            return nLine < other.nLine;
+        if (pszFile != other.pszFile)
+            return std::less<const char*>()(pszFile, other.pszFile);
+        return std::less<const char*>()(pszName, other.pszName);
+    }
+};
+
+struct LockProfileData {
+    std::mutex cs;
+    std::map<LockSite, LockProfileEntry> mapSites;
+};
+
+LockProfileData& GetLockProfileData()
+{
+    // Never destroyed, as locks are still taken during shutdown
+    static LockProfileData* data = new LockProfileData();
+    return *data;
+}
+
+} // namespace
+
+void RecordLockProfile(const char* pszName, const char* pszFile, int nLine, uint32_t nWeight,
+                       int64_t nWaitNanos, int64_t nHoldNanos, bool fContended)
+{
+    LockProfileData& data = GetLockProfileData();
+    std::lock_guard<std::mutex> lock(data.cs);
+    LockProfileEntry& entry = data.mapSites[LockSite{pszName, pszFile, nLine}];
+    if (entry.nSamples == 0) {
+        entry.strName = pszName;
+        entry.strFile = pszFile;
+        entry.nLine = nLine;
+    }
+    entry.nSamples++;
+    entry.nContended += fContended;
+    entry.nAcquisitions += nWeight;
+    entry.nWaitNanos += nWaitNanos * nWeight;
+    entry.nHoldNanos += nHoldNanos * nWeight;
+    entry.nMaxWaitNanos = std::max(entry.nMaxWaitNanos, nWaitNanos);
+    entry.nMaxHoldNanos = std::max(entry.nMaxHoldNanos, nHoldNanos);
+}
+
+std::vector<LockProfileEntry> GetLockProfile()
+{
+    LockProfileData& data = GetLockProfileData();
+    std::lock_guard<std::mutex> lock(data.cs);
+    std::vector<LockProfileEntry> vEntries;
+    vEntries.reserve(data.mapSites.size());
+    for (const auto& site : data.mapSites)
+        vEntries.push_back(site.second);
+    return vEntries;
+}
+
+void ResetLockProfile()
+{
+    LockProfileData& data = GetLockProfileData();
+    std::lock_guard<std::mutex> lock(data.cs);
+    data.mapSites.clear();
+}
+
+std::string FormatLockProfileFolded(const std::vector<LockProfileEntry>& vEntries, bool fHold)
+{
+    std::vector<std::pair<int64_t, std::string> > vLines;
+    for (const LockProfileEntry& entry : vEntries) {
+        int64_t nMicros = (fHold ? entry.nHoldNanos : entry.nWaitNanos) / 1000;
+        if (nMicros > 0)
+            vLines.emplace_back(nMicros, strprintf("%s;%s:%d", entry.strName, entry.strFile, entry.nLine));
+    }
+    std::sort(vLines.begin(), vLines.end(), [](const std::pair<int64_t, std::string>& a, const std::pair<int64_t, std::string>& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+    std::string strOut;
+    for (const auto& line : vLines)
+        strOut += strprintf("%s %d\n", line.second, line.first);
+    return strOut;
+}
+
 #ifdef DEBUG_LOCKCONTENTION
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 {
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_SYNC_H
 #define BITCOIN_SYNC_H
 
+#include "perfstats.h"
 #include "threadsafety.h"
 
 #include <boost/thread/condition_variable.hpp>
@@ -13,6 +14,11 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
 
 ////////////////////////////////////////////////
 //                                            //
@@ -107,6 +113,66 @@ typedef boost::condition_variable CConditionVariable;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/** Time spent waiting for locks held by other threads */
+PerfHistogram& LockWaitHistogram();
+
+/**
+ * Sampling lock profiler. While the sample rate is non-zero, one in that many
+ * lock acquisitions on each thread is timed, and its wait and hold times are
+ * added to the totals for its lock and acquisition site, weighted by the rate
+ * so that they estimate the totals for all acquisitions. Acquisitions that
+ * are not sampled cost one relaxed atomic load.
+ */
+extern std::atomic<uint32_t> nLockProfileSampleRate;
+
+/** Whether to sample this acquisition: the weight to give it, or 0 */
+inline uint32_t SampleLockProfile()
+{
+    const uint32_t nRate = nLockProfileSampleRate.load(std::memory_order_relaxed);
+    if (nRate == 0)
+        return 0;
+    static thread_local uint32_t nAcquisitions = 0;
+    return ++nAcquisitions % nRate == 0 ? nRate : 0;
+}
+
+inline int64_t LockProfileNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RecordLockProfile(const char* pszName, const char* pszFile, int nLine, uint32_t nWeight,
+                       int64_t nWaitNanos, int64_t nHoldNanos, bool fContended);
+
+/** Totals for one lock at one acquisition site */
+struct LockProfileEntry {
+    std::string strName;
+    std::string strFile;
+    int nLine;
+    uint64_t nSamples;
+    //! Sampled acquisitions that had to wait for another thread
+    uint64_t nContended;
+    //! Estimated acquisitions, and wait and hold times, of all acquisitions
+    uint64_t nAcquisitions;
+    int64_t nWaitNanos;
+    int64_t nHoldNanos;
+    //! Longest wait and hold sampled
+    int64_t nMaxWaitNanos;
+    int64_t nMaxHoldNanos;
+
+    LockProfileEntry() : nLine(0), nSamples(0), nContended(0), nAcquisitions(0), nWaitNanos(0), nHoldNanos(0),
+                         nMaxWaitNanos(0), nMaxHoldNanos(0) {}
+};
+
+/** The totals for every site sampled since the last reset */
+std::vector<LockProfileEntry> GetLockProfile();
+void ResetLockProfile();
+/**
+ * Format a profile as folded stacks, "lock;file:line value" per line, with
+ * the total wait or hold time in microseconds as the value, for flame graph
+ * tools such as flamegraph.pl
+ */
+std::string FormatLockProfileFolded(const std::vector<LockProfileEntry>& vEntries, bool fHold);
+
 /** Wrapper around boost::unique_lock<Mutex> */
 template <typename Mutex>
 class SCOPED_LOCKABLE CMutexLock
@@ -114,17 +180,47 @@ class SCOPED_LOCKABLE CMutexLock
 private:
     boost::unique_lock<Mutex> lock;
 
+    //! Set when the lock profiler samples this acquisition
+    struct Profile {
+        const char* pszName;
+        const char* pszFile;
+        int nLine;
+        uint32_t nWeight;
+        int64_t nWaitNanos;
+        int64_t nHoldStart;
+        bool fContended;
+    } profile;
+
+    void StartProfile(const char* pszName, const char* pszFile, int nLine, uint32_t nWeight,
+                      int64_t nWaitNanos, int64_t nHoldStart, bool fContended)
+    {
+        profile.pszName = pszName;
+        profile.pszFile = pszFile;
+        profile.nLine = nLine;
+        profile.nWeight = nWeight;
+        profile.nWaitNanos = nWaitNanos;
+        profile.nHoldStart = nHoldStart;
+        profile.fContended = fContended;
+    }
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
+        const uint32_t nWeight = SampleLockProfile();
+        const int64_t nWaitStart = nWeight ? LockProfileNanos() : 0;
+        const bool fContended = !lock.try_lock();
+        if (fContended) {
 #ifdef DEBUG_LOCKCONTENTION
-        if (!lock.try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
 #endif
+            // Only contended locks are timed, so the usual case costs nothing
+            PerfTimer timer(LockWaitHistogram());
             lock.lock();
-#ifdef DEBUG_LOCKCONTENTION
         }
-#endif
+        if (nWeight) {
+            const int64_t nNow = LockProfileNanos();
+            StartProfile(pszName, pszFile, nLine, nWeight, nNow - nWaitStart, nNow, fContended);
+        }
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
@@ -133,12 +229,15 @@ private:
         lock.try_lock();
         if (!lock.owns_lock())
             LeaveCritical();
+        else if (const uint32_t nWeight = SampleLockProfile())
+            StartProfile(pszName, pszFile, nLine, nWeight, 0, LockProfileNanos(), false);
         return lock.owns_lock();
     }
 
 public:
     CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(mutexIn) : lock(mutexIn, boost::defer_lock)
     {
+        profile.nWeight = 0;
         if (fTry)
             TryEnter(pszName, pszFile, nLine);
         else
@@ -147,6 +246,7 @@ public:
 
     CMutexLock(Mutex* pmutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(pmutexIn)
     {
+        profile.nWeight = 0;
         if (!pmutexIn) return;
 
         lock = boost::unique_lock<Mutex>(*pmutexIn, boost::defer_lock);
@@ -158,8 +258,15 @@ public:
 
     ~CMutexLock() UNLOCK_FUNCTION()
     {
-        if (lock.owns_lock())
-            LeaveCritical();
+        if (!lock.owns_lock())
+            return;
+        LeaveCritical();
+        if (profile.nWeight) {
+            // Release first, so that recording is not counted as holding
+            lock.unlock();
+            RecordLockProfile(profile.pszName, profile.pszFile, profile.nLine, profile.nWeight,
+                              profile.nWaitNanos, LockProfileNanos() - profile.nHoldStart, profile.fContended);
+        }
     }
 
     operator bool()
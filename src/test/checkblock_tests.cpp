@@ -2,18 +2,22 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
+#include "checkqueue.h"
 #include "clientversion.h"
 #include "consensus/validation.h"
 #include "fs.h"
 #include "main.h"
 #include "proof_verifier.h"
+#include "test/equihash_test_data.h"
 #include "test/test_bitcoin.h"
+#include "utilstrencodings.h"
 #include "utiltime.h"
 #include "zcash/Proof.hpp"
 
 #include <cstdio>
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
 
 
 BOOST_FIXTURE_TEST_SUITE(CheckBlock_tests, BasicTestingSetup)
@@ -63,4 +67,38 @@ BOOST_AUTO_TEST_CASE(May15)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(check_block_headers)
+{
+    // A regtest header with a valid Equihash 144,5 solution
+    const CChainParams& chainparams = Params(CBaseChainParams::REGTEST);
+    CBlockHeader header;
+    CDataStream ss(ParseHex(REGTEST_HEADER_144_5_HEX), SER_NETWORK, PROTOCOL_VERSION);
+    ss >> header;
+    CValidationState state;
+    BOOST_CHECK(CheckBlockHeader(header, state, chainparams, true));
+
+    CCheckQueue<CHeaderCheck> queue(16);
+    boost::thread_group tg;
+    for (int i = 0; i < 2; i++) {
+        tg.create_thread([&]{queue.Thread();});
+    }
+
+    std::vector<CBlockHeader> headers(50, header);
+    BOOST_CHECK(CheckBlockHeaders(headers.begin(), headers.end(), chainparams, NULL));
+    BOOST_CHECK(CheckBlockHeaders(headers.begin(), headers.end(), chainparams, &queue));
+
+    // A single header with an invalid solution fails the batch
+    *headers[37].nNonce.begin() ^= 1;
+    BOOST_CHECK(!CheckBlockHeaders(headers.begin(), headers.end(), chainparams, NULL));
+    BOOST_CHECK(!CheckBlockHeaders(headers.begin(), headers.end(), chainparams, &queue));
+    BOOST_CHECK(CheckBlockHeaders(headers.begin(), headers.begin() + 37, chainparams, &queue));
+
+    // The queue can be used again after a failure
+    headers[37] = header;
+    BOOST_CHECK(CheckBlockHeaders(headers.begin(), headers.end(), chainparams, &queue));
+
+    tg.interrupt_all();
+    tg.join_all();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
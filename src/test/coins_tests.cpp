@@ -11,6 +11,7 @@
 #include "consensus/validation.h"
 #include "main.h"
 #include "undo.h"
+#include "txdb.h"
 #include "primitives/transaction.h"
 #include "pubkey.h"
 
@@ -605,6 +606,314 @@ BOOST_AUTO_TEST_CASE(anchors_flush_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(anchors_delta_test)
+{
+    // Push enough anchors that the frontier cache in CCoinsViewDB evicts the
+    // early ones, forcing them to be rebuilt from their stored deltas.
+    CCoinsViewDB db(1 << 20, true);
+    std::vector<uint256> roots;
+    for (size_t i = 0; i < ANCHOR_FRONTIER_CACHE_SIZE + 2 * ANCHOR_CHECKPOINT_INTERVAL; i++) {
+        CCoinsViewCache cache(&db);
+        SproutMerkleTree tree;
+        BOOST_CHECK(cache.GetSproutAnchorAt(cache.GetBestAnchor(SPROUT), tree));
+
+        std::vector<libzcash::SHA256Compress> appended;
+        for (size_t j = 0; j <= i % 3; j++) {
+            appended.push_back(GetRandHash());
+            tree.append(appended.back());
+        }
+        cache.PushAnchor(tree, appended);
+        roots.push_back(tree.root());
+        BOOST_CHECK(cache.Flush());
+    }
+
+    for (const uint256 &rt : roots) {
+        SproutMerkleTree tree;
+        BOOST_CHECK(db.GetSproutAnchorAt(rt, tree));
+        BOOST_CHECK(tree.root() == rt);
+    }
+
+    // Popping the tip erases its delta but leaves its parent readable.
+    {
+        CCoinsViewCache cache(&db);
+        cache.PopAnchor(roots[roots.size() - 2], SPROUT);
+        BOOST_CHECK(cache.Flush());
+    }
+    SproutMerkleTree tree;
+    BOOST_CHECK(!db.GetSproutAnchorAt(roots.back(), tree));
+    BOOST_CHECK(db.GetSproutAnchorAt(roots[roots.size() - 2], tree));
+    BOOST_CHECK(tree.root() == roots[roots.size() - 2]);
+}
+
+BOOST_AUTO_TEST_CASE(anchors_delta_batch_test)
+{
+    // A long chain of anchors flushed in a single batch, as during initial
+    // block download with a large cache, is split into checkpoints.
+    CCoinsViewDB db(1 << 20, true);
+    std::vector<uint256> roots;
+    {
+        CCoinsViewCache cache(&db);
+        SproutMerkleTree tree;
+        for (size_t i = 0; i < ANCHOR_FRONTIER_CACHE_SIZE + 3 * ANCHOR_CHECKPOINT_INTERVAL; i++) {
+            std::vector<libzcash::SHA256Compress> appended{GetRandHash()};
+            tree.append(appended.back());
+            cache.PushAnchor(tree, appended);
+            roots.push_back(tree.root());
+        }
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // The early anchors are no longer in the frontier cache
+    for (const uint256 &rt : roots) {
+        SproutMerkleTree tree;
+        BOOST_CHECK(db.GetSproutAnchorAt(rt, tree));
+        BOOST_CHECK(tree.root() == rt);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(nullifier_filter_test)
+{
+    // Enough entries to grow the table several times, with erases shifting
+    // entries back along their probe sequences.
+    CNullifierFilter filter;
+    filter.SetLoaded();
+    std::vector<uint256> present;
+    for (size_t i = 0; i < 8 * NULLIFIER_FILTER_MIN_SLOTS; i++) {
+        present.push_back(GetRandHash());
+        filter.Insert(present.back());
+        if (i % 3 == 0) {
+            size_t n = insecure_rand() % present.size();
+            filter.Erase(present[n]);
+            present[n] = present.back();
+            present.pop_back();
+        }
+    }
+    BOOST_CHECK_EQUAL(filter.Size(), present.size());
+    for (const uint256 &nf : present) {
+        BOOST_CHECK(filter.MaybeContains(nf));
+    }
+
+    // The fingerprints are 64 bits, so random nullifiers are all rejected.
+    for (size_t i = 0; i < 1000; i++) {
+        BOOST_CHECK(!filter.MaybeContains(GetRandHash()));
+    }
+    CNullifierFilterStats stats = filter.GetStats();
+    BOOST_CHECK_EQUAL(stats.nQueries, present.size() + 1000);
+    BOOST_CHECK_EQUAL(stats.nNegatives, 1000);
+
+    // A duplicate is only removed once.
+    filter.Insert(present[0]);
+    filter.Erase(present[0]);
+    BOOST_CHECK(filter.MaybeContains(present[0]));
+
+    // Until it is loaded the filter cannot rule anything out.
+    filter.Clear();
+    BOOST_CHECK(filter.MaybeContains(GetRandHash()));
+}
+
+BOOST_AUTO_TEST_CASE(nullifier_filter_db_test)
+{
+    CCoinsViewDB db(1 << 20, true);
+    TxWithNullifiers spentBefore;
+    {
+        CCoinsViewCache cache(&db);
+        cache.SetNullifiers(spentBefore.tx, true);
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK(db.LoadNullifierFilters());
+    BOOST_CHECK(db.GetNullifier(spentBefore.sproutNullifier, SPROUT));
+    BOOST_CHECK(db.GetNullifier(spentBefore.saplingNullifier, SAPLING));
+
+    // Nullifiers written after loading are added to the filters, and
+    // removed again when a disconnect erases them.
+    TxWithNullifiers spentAfter;
+    {
+        CCoinsViewCache cache(&db);
+        cache.SetNullifiers(spentAfter.tx, true);
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK(db.GetNullifier(spentAfter.sproutNullifier, SPROUT));
+    BOOST_CHECK(db.GetNullifier(spentAfter.saplingNullifier, SAPLING));
+    BOOST_CHECK(!db.GetNullifier(spentAfter.sproutNullifier, SAPLING));
+    BOOST_CHECK_EQUAL(db.GetNullifierFilterStats(SAPLING).nEntries, 2);
+    {
+        CCoinsViewCache cache(&db);
+        cache.SetNullifiers(spentAfter.tx, false);
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK(!db.GetNullifier(spentAfter.sproutNullifier, SPROUT));
+    BOOST_CHECK(!db.GetNullifier(spentAfter.saplingNullifier, SAPLING));
+    BOOST_CHECK_EQUAL(db.GetNullifierFilterStats(SAPLING).nEntries, 1);
+
+    // Erasing a nullifier that was never written leaves the filters alone.
+    TxWithNullifiers neverSpent;
+    {
+        CCoinsViewCache cache(&db);
+        cache.SetNullifiers(neverSpent.tx, false);
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK_EQUAL(db.GetNullifierFilterStats(SAPLING).nEntries, 1);
+    BOOST_CHECK(db.GetNullifier(spentBefore.saplingNullifier, SAPLING));
+
+    CNullifierFilterStats stats = db.GetNullifierFilterStats(SAPLING);
+    BOOST_CHECK(stats.fLoaded);
+    BOOST_CHECK_EQUAL(stats.nQueries, 5);
+    BOOST_CHECK_EQUAL(stats.nNegatives, 2);
+    BOOST_CHECK_EQUAL(stats.nFalsePositives, 0);
+}
+
+BOOST_AUTO_TEST_CASE(prefetched_entries_test)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+
+    // A prefetched entry is found without reading the base view...
+    uint256 txid = GetRandHash();
+    CCoins coins;
+    coins.nHeight = 1;
+    coins.vout.resize(1);
+    coins.vout[0].nValue = 10;
+    CCoins prefetched = coins;
+    cache.AddPrefetchedCoins(txid, prefetched);
+    BOOST_CHECK(cache.HaveCoinsInCache(txid));
+    BOOST_CHECK_EQUAL(cache.AccessCoins(txid)->vout[0].nValue, 10);
+
+    // ...but does not replace an entry the cache already has.
+    {
+        CCoinsModifier modifier = cache.ModifyCoins(txid);
+        modifier->vout[0].nValue = 20;
+    }
+    prefetched = coins;
+    cache.AddPrefetchedCoins(txid, prefetched);
+    BOOST_CHECK_EQUAL(cache.AccessCoins(txid)->vout[0].nValue, 20);
+
+    TxWithNullifiers txWithNullifiers;
+    cache.AddPrefetchedNullifier(txWithNullifiers.saplingNullifier, SAPLING, false);
+    BOOST_CHECK(cache.HaveNullifierInCache(txWithNullifiers.saplingNullifier, SAPLING));
+    BOOST_CHECK(!cache.HaveNullifierInCache(txWithNullifiers.saplingNullifier, SPROUT));
+    BOOST_CHECK(!cache.GetNullifier(txWithNullifiers.saplingNullifier, SAPLING));
+    cache.SetNullifiers(txWithNullifiers.tx, true);
+    cache.AddPrefetchedNullifier(txWithNullifiers.saplingNullifier, SAPLING, false);
+    BOOST_CHECK(cache.GetNullifier(txWithNullifiers.saplingNullifier, SAPLING));
+}
+
+BOOST_AUTO_TEST_CASE(utxo_snapshot_test)
+{
+    CCoinsViewDB source(1 << 20, true);
+    std::vector<uint256> txids;
+    std::vector<uint256> sproutRoots;
+    std::vector<uint256> saplingRoots;
+    for (size_t i = 0; i < ANCHOR_CHECKPOINT_INTERVAL + 20; i++) {
+        CCoinsViewCache cache(&source);
+
+        txids.push_back(GetRandHash());
+        {
+            CCoinsModifier coins = cache.ModifyNewCoins(txids.back());
+            coins->nHeight = i + 1;
+            coins->vout.resize(1 + i % 3);
+            coins->vout.back().nValue = i + 1;
+            coins->vout.back().scriptPubKey = CScript() << OP_TRUE;
+        }
+
+        TxWithNullifiers txWithNullifiers;
+        cache.SetNullifiers(txWithNullifiers.tx, true);
+
+        SproutMerkleTree sproutTree;
+        BOOST_CHECK(cache.GetSproutAnchorAt(cache.GetBestAnchor(SPROUT), sproutTree));
+        std::vector<libzcash::SHA256Compress> sproutAppended{GetRandHash()};
+        sproutTree.append(sproutAppended.back());
+        cache.PushAnchor(sproutTree, sproutAppended);
+        sproutRoots.push_back(sproutTree.root());
+
+        if (i % 40 == 0) {
+            SaplingMerkleTree saplingTree;
+            BOOST_CHECK(cache.GetSaplingAnchorAt(cache.GetBestAnchor(SAPLING), saplingTree));
+            std::vector<libzcash::PedersenHash> saplingAppended{GetRandHash()};
+            saplingTree.append(saplingAppended.back());
+            cache.PushAnchor(saplingTree, saplingAppended);
+            saplingRoots.push_back(saplingTree.root());
+        }
+
+        cache.SetBestBlock(GetRandHash());
+        BOOST_CHECK(cache.Flush());
+    }
+
+    CUTXOSnapshotMetadata metadata;
+    metadata.hashBlock = source.GetBestBlock();
+    metadata.nHeight = txids.size();
+    metadata.nChainTx = txids.size();
+    metadata.hashSproutAnchor = source.GetBestAnchor(SPROUT);
+    metadata.hashSaplingAnchor = source.GetBestAnchor(SAPLING);
+
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    CUTXOSnapshotStats dumped;
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(source.DumpSnapshot(file, metadata, sproutRoots, saplingRoots, dumped));
+    }
+    BOOST_CHECK_EQUAL(dumped.nTransactions, txids.size());
+    BOOST_CHECK_EQUAL(dumped.nSproutNullifiers, txids.size());
+    BOOST_CHECK_EQUAL(dumped.nSproutAnchors, sproutRoots.size());
+    BOOST_CHECK_EQUAL(dumped.nSaplingAnchors, saplingRoots.size());
+
+    // The snapshot replaces the existing contents of the target.
+    CCoinsViewDB target(1 << 20, true);
+    uint256 staleTxid = GetRandHash();
+    {
+        CCoinsViewCache cache(&target);
+        cache.ModifyNewCoins(staleTxid)->vout.push_back(CTxOut(1, CScript() << OP_TRUE));
+        cache.SetBestBlock(GetRandHash());
+        BOOST_CHECK(cache.Flush());
+    }
+    // Marked before the snapshot is recorded elsewhere, cleared once loaded
+    BOOST_CHECK(target.MarkSnapshotLoading());
+    BOOST_CHECK(target.IsSnapshotLoadIncomplete());
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        CUTXOSnapshotMetadata loadedMetadata;
+        CUTXOSnapshotStats loaded;
+        BOOST_CHECK(target.LoadSnapshot(file, loadedMetadata, loaded, true));
+        BOOST_CHECK(loaded.hashSnapshot == dumped.hashSnapshot);
+        BOOST_CHECK(loadedMetadata.hashBlock == metadata.hashBlock);
+    }
+    BOOST_CHECK(!target.IsSnapshotLoadIncomplete());
+    BOOST_CHECK(target.GetBestBlock() == metadata.hashBlock);
+    BOOST_CHECK(target.GetBestAnchor(SPROUT) == metadata.hashSproutAnchor);
+    BOOST_CHECK(target.GetBestAnchor(SAPLING) == metadata.hashSaplingAnchor);
+    BOOST_CHECK(!target.HaveCoins(staleTxid));
+    for (const uint256 &txid : txids) {
+        CCoins expected, coins;
+        BOOST_CHECK(source.GetCoins(txid, expected));
+        BOOST_CHECK(target.GetCoins(txid, coins));
+        BOOST_CHECK(coins == expected);
+    }
+    for (const uint256 &rt : sproutRoots) {
+        SproutMerkleTree tree;
+        BOOST_CHECK(target.GetSproutAnchorAt(rt, tree));
+    }
+    for (const uint256 &rt : saplingRoots) {
+        SaplingMerkleTree tree;
+        BOOST_CHECK(target.GetSaplingAnchorAt(rt, tree));
+    }
+
+    // A modified snapshot is rejected before anything is written.
+    {
+        FILE* f = fsbridge::fopen(path, "r+b");
+        fseek(f, -40, SEEK_END);
+        int c = fgetc(f);
+        fseek(f, -40, SEEK_END);
+        fputc(c ^ 1, f);
+        fclose(f);
+    }
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        CUTXOSnapshotMetadata loadedMetadata;
+        CUTXOSnapshotStats loaded;
+        BOOST_CHECK(!target.LoadSnapshot(file, loadedMetadata, loaded, false));
+    }
+    fs::remove(path);
+}
+
 BOOST_AUTO_TEST_CASE(chained_joinsplits)
 {
     // TODO update this or add a similar test when the SaplingNote class exist
@@ -0,0 +1,136 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "compacthashmap.h"
+#include "memusage.h"
+#include "test/test_bitcoin.h"
+#include "test/test_random.h"
+
+#include <string>
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(compacthashmap_tests, BasicTestingSetup)
+
+struct MixHasher
+{
+    size_t operator()(uint64_t k) const { return k * 0x9E3779B97F4A7C15ULL; }
+};
+
+// Puts most keys on a handful of long probe sequences
+struct CollidingHasher
+{
+    size_t operator()(uint64_t k) const { return k % 7; }
+};
+
+// Applies the same random operations to a compacthashmap and an
+// std::unordered_map and checks that they agree.
+template <typename Hasher>
+static void CompareWithUnorderedMap()
+{
+    compacthashmap<uint64_t, std::string, Hasher> map;
+    std::unordered_map<uint64_t, std::string> reference;
+
+    for (int step = 0; step < 40000; step++) {
+        uint64_t key = insecure_rand() % 2000;
+        switch (insecure_rand() % 5) {
+        case 0: {
+            auto ret = map.insert(std::make_pair(key, std::to_string(step)));
+            auto ret2 = reference.insert(std::make_pair(key, std::to_string(step)));
+            BOOST_CHECK_EQUAL(ret.second, ret2.second);
+            BOOST_CHECK_EQUAL(ret.first->second, ret2.first->second);
+            break;
+        }
+        case 1:
+            map[key] += "x";
+            reference[key] += "x";
+            break;
+        case 2: {
+            auto it = map.find(key);
+            BOOST_CHECK_EQUAL(it != map.end(), reference.count(key) == 1);
+            if (it != map.end()) {
+                map.erase(it);
+                reference.erase(key);
+            }
+            break;
+        }
+        case 3: {
+            const auto& cmap = map;
+            auto it = cmap.find(key);
+            BOOST_CHECK_EQUAL(it != cmap.end(), reference.count(key) == 1);
+            if (it != cmap.end()) {
+                BOOST_CHECK_EQUAL(it->second, reference[key]);
+            }
+            break;
+        }
+        case 4:
+            BOOST_CHECK_EQUAL(map.erase(key), reference.erase(key));
+            break;
+        }
+        BOOST_CHECK_EQUAL(map.size(), reference.size());
+
+        if (step % 10000 == 9999) {
+            // Erase half of the entries while iterating
+            for (auto it = map.begin(); it != map.end();) {
+                if (it->first % 2) {
+                    reference.erase(it->first);
+                    it = map.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            BOOST_CHECK_EQUAL(map.size(), reference.size());
+        }
+    }
+
+    size_t count = 0;
+    for (const auto& entry : map) {
+        BOOST_CHECK_EQUAL(entry.second, reference.at(entry.first));
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, reference.size());
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(compacthashmap_matches_unordered_map)
+{
+    CompareWithUnorderedMap<MixHasher>();
+    CompareWithUnorderedMap<CollidingHasher>();
+}
+
+BOOST_AUTO_TEST_CASE(compacthashmap_entries_do_not_move)
+{
+    compacthashmap<uint64_t, std::string, MixHasher> map;
+    std::vector<std::string*> pointers;
+    for (uint64_t i = 0; i < 1000; i++) {
+        pointers.push_back(&map[i]);
+        *pointers.back() = std::to_string(i);
+    }
+    // Growing the index and erasing other entries leaves entries in place
+    for (uint64_t i = 1000; i < 5000; i++) {
+        map[i];
+    }
+    for (uint64_t i = 0; i < 1000; i += 2) {
+        map.erase(i);
+    }
+    for (uint64_t i = 1; i < 1000; i += 2) {
+        BOOST_CHECK_EQUAL(&map.find(i)->second, pointers[i]);
+        BOOST_CHECK_EQUAL(*pointers[i], std::to_string(i));
+    }
+    // Erased positions are reused before new chunks are allocated
+    size_t nChunks = map.chunk_count();
+    BOOST_CHECK_EQUAL(map.free_count(), 500);
+    for (uint64_t i = 5000; i < 5500; i++) {
+        map[i];
+    }
+    BOOST_CHECK_EQUAL(map.chunk_count(), nChunks);
+    BOOST_CHECK_EQUAL(map.free_count(), 0);
+    BOOST_CHECK(memusage::DynamicUsage(map) >= map.chunk_count() * map.chunk_bytes());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
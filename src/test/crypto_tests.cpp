@@ -9,6 +9,7 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
 #include "test_random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
@@ -192,6 +193,34 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    using namespace sha256_implementation;
+    for (UseImplementation use : {STANDARD, USE_SSE4, USE_AVX2, USE_SHANI, USE_ALL}) {
+        BOOST_TEST_CONTEXT(SHA256AutoDetect(use)) {
+            BOOST_CHECK(SHA256SelfTest());
+            for (int i = 0; i <= 32; ++i) {
+                unsigned char in[64 * 32];
+                unsigned char out1[32 * 32], out2[32 * 32];
+                for (int j = 0; j < 64 * i; ++j) {
+                    in[j] = insecure_rand();
+                }
+                for (int j = 0; j < i; ++j) {
+                    CHash256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+                }
+                SHA256D64(out2, in, i);
+                BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+                // Merkle computation hashes each level in place.
+                SHA256D64(in, in, i);
+                BOOST_CHECK(memcmp(out1, in, 32 * i) == 0);
+            }
+            TestSHA256(std::string(1000000, 'a'),
+                       "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+        }
+    }
+    SHA256AutoDetect();
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
@@ -0,0 +1,18 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_TEST_EQUIHASH_TEST_DATA_H
+#define BITCOIN_TEST_EQUIHASH_TEST_DATA_H
+
+// A serialized regtest block header with a valid Equihash 144,5 solution,
+// shared by the unit tests and benchmarks that verify one.
+static const char* const REGTEST_HEADER_144_5_HEX =
+    "040000000f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0fd3c4b5a6f7a6e9b8d0c2d27b"
+    "5ebdb8d85b8a1e1d9c5f4e1e5be3983be0a2e41900000000000000000000000000000000000000000000000000000000"
+    "000000000078e7680f0f0f200f0000000000000000000000000000000000000000000000000000000000000064040a53"
+    "abf7a00a3c4b13f604834030c5fa444d95a53ce6f31f2259ad6a3a3b6fbe3cdcb107479f6cce8926cf9bf30df8101516"
+    "05ba6ea295d8c9b99e2a427761b7bea9ed0e499ff32877772cefa649d31468c20fddbfba74b602b2e3ac39a827a94374"
+    "60";
+
+#endif // BITCOIN_TEST_EQUIHASH_TEST_DATA_H
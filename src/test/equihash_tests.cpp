@@ -10,8 +10,13 @@
 #include "arith_uint256.h"
 #include "crypto/sha256.h"
 #include "crypto/equihash.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "test/equihash_test_data.h"
 #include "test/test_bitcoin.h"
 #include "uint256.h"
+#include "utilstrencodings.h"
+#include "version.h"
 
 #include "sodium.h"
 
@@ -229,4 +234,30 @@ BOOST_AUTO_TEST_CASE(validator_allbitsmatter) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(validator_144_5_allbitsmatter) {
+    // A regtest block header with a valid 144,5 solution.
+    CBlockHeader header;
+    CDataStream ss(ParseHex(REGTEST_HEADER_144_5_HEX), SER_NETWORK, PROTOCOL_VERSION);
+    ss >> header;
+    BOOST_CHECK_EQUAL(header.nSolution.size(), 100);
+
+    crypto_generichash_blake2b_state state;
+    EhInitialiseState(144, 5, state);
+    CDataStream ssI(SER_NETWORK, PROTOCOL_VERSION);
+    ssI << CEquihashInput{header};
+    ssI << header.nNonce;
+    crypto_generichash_blake2b_update(&state, (unsigned char*)&ssI[0], ssI.size());
+
+    bool isValid;
+    EhIsValidSolution(144, 5, state, header.nSolution, isValid);
+    BOOST_CHECK(isValid == true);
+
+    for (size_t i = 0; i < header.nSolution.size() * 8; i++) {
+        std::vector<unsigned char> mutated = header.nSolution;
+        mutated.at(i/8) ^= (1 << (i % 8));
+        EhIsValidSolution(144, 5, state, mutated, isValid);
+        BOOST_CHECK(isValid == false);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,241 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "rpc/jsonwriter.h"
+#include "utilstrencodings.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(jsonwriter_tests, BasicTestingSetup)
+
+// Write a document with nested, empty and escaped members, as blockToJSON
+// and mempoolToJSON write theirs
+static void WriteDocument(JSONWriter& writer, int nEntries)
+{
+    writer.BeginObject();
+    writer.KV("hash", "00ff");
+    writer.KV("height", 12);
+    writer.KV("difficulty", 1.5);
+    writer.Key("tx");
+    writer.BeginArray();
+    for (int i = 0; i < nEntries; i++) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("n", i);
+        entry.pushKV("s", "quote \" and\nnewline");
+        writer.Value(entry);
+    }
+    writer.EndArray();
+    writer.Key("empty");
+    writer.BeginObject();
+    writer.EndObject();
+    writer.Key("nested");
+    writer.BeginArray();
+    writer.BeginArray();
+    writer.EndArray();
+    writer.Value(NullUniValue);
+    writer.BeginObject();
+    writer.KV("key \"quoted\"", false);
+    writer.EndObject();
+    writer.EndArray();
+    writer.EndObject();
+}
+
+static UniValue BuildDocument(int nEntries)
+{
+    UniValue tx(UniValue::VARR);
+    for (int i = 0; i < nEntries; i++) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("n", i);
+        entry.pushKV("s", "quote \" and\nnewline");
+        tx.push_back(entry);
+    }
+    UniValue quoted(UniValue::VOBJ);
+    quoted.pushKV("key \"quoted\"", false);
+    UniValue nested(UniValue::VARR);
+    nested.push_back(UniValue(UniValue::VARR));
+    nested.push_back(NullUniValue);
+    nested.push_back(quoted);
+
+    UniValue doc(UniValue::VOBJ);
+    doc.pushKV("hash", "00ff");
+    doc.pushKV("height", 12);
+    doc.pushKV("difficulty", 1.5);
+    doc.pushKV("tx", tx);
+    doc.pushKV("empty", UniValue(UniValue::VOBJ));
+    doc.pushKV("nested", nested);
+    return doc;
+}
+
+BOOST_AUTO_TEST_CASE(univalue_writer)
+{
+    UniValueWriter writer;
+    WriteDocument(writer, 3);
+    BOOST_CHECK_EQUAL(writer.Result().write(), BuildDocument(3).write());
+
+    UniValueWriter scalar;
+    scalar.Value("0011");
+    BOOST_CHECK_EQUAL(scalar.Result().get_str(), "0011");
+}
+
+BOOST_AUTO_TEST_CASE(text_writer)
+{
+    std::string strOut;
+    int nParts = 0;
+    bool fLastSeen = false;
+    JSONTextWriter writer([&](const std::string& strPart, bool fLast) {
+        BOOST_CHECK(!fLastSeen);
+        strOut += strPart;
+        nParts++;
+        fLastSeen = fLast;
+    });
+    WriteDocument(writer, 3);
+    // Small documents are passed on whole, when finished
+    BOOST_CHECK_EQUAL(nParts, 0);
+    writer.Finish();
+    BOOST_CHECK_EQUAL(nParts, 1);
+    BOOST_CHECK(fLastSeen);
+    BOOST_CHECK_EQUAL(strOut, BuildDocument(3).write() + "\n");
+}
+
+BOOST_AUTO_TEST_CASE(text_writer_chunks)
+{
+    const size_t nChunkSize = 256;
+    std::vector<std::string> vParts;
+    std::vector<bool> vLast;
+    JSONTextWriter writer([&](const std::string& strPart, bool fLast) {
+        vParts.push_back(strPart);
+        vLast.push_back(fLast);
+    }, nChunkSize);
+    WriteDocument(writer, 1000);
+    // Output is passed on while the document is still being written
+    BOOST_CHECK_GT(vParts.size(), 10U);
+    writer.Finish();
+
+    std::string strOut;
+    for (size_t i = 0; i < vParts.size(); i++) {
+        BOOST_CHECK_EQUAL(vLast[i], i + 1 == vParts.size());
+        if (i + 1 < vParts.size()) {
+            BOOST_CHECK_GE(vParts[i].size(), nChunkSize);
+            BOOST_CHECK_LT(vParts[i].size(), 2 * nChunkSize);
+        }
+        strOut += vParts[i];
+    }
+    BOOST_CHECK_EQUAL(strOut, BuildDocument(1000).write() + "\n");
+}
+
+BOOST_AUTO_TEST_CASE(text_writer_scalars)
+{
+    std::string strOut;
+    JSONTextWriter writer([&](const std::string& strPart, bool fLast) {
+        strOut += strPart;
+    });
+    writer.BeginArray();
+    writer.Int(-42);
+    writer.Amount(150000000);
+    writer.Amount(-1);
+    writer.Str("a\"b");
+    writer.EndArray();
+    writer.Finish();
+
+    UniValue expected(UniValue::VARR);
+    expected.push_back(-42);
+    expected.push_back(UniValue(UniValue::VNUM, "1.50000000"));
+    expected.push_back(UniValue(UniValue::VNUM, "-0.00000001"));
+    expected.push_back("a\"b");
+    BOOST_CHECK_EQUAL(strOut, expected.write() + "\n");
+}
+
+static std::string CBORHex(const std::function<void(JSONWriter&)>& fn)
+{
+    std::string strOut;
+    CBORWriter writer([&](const std::string& strPart, bool fLast) {
+        strOut += strPart;
+    });
+    fn(writer);
+    writer.Finish();
+    return HexStr(strOut);
+}
+
+BOOST_AUTO_TEST_CASE(cbor_writer_scalars)
+{
+    // Examples from RFC 8949 appendix A
+    const std::vector<std::pair<int64_t, std::string> > vInts = {
+        {0, "00"}, {23, "17"}, {24, "1818"}, {100, "1864"}, {1000, "1903e8"},
+        {1000000, "1a000f4240"}, {1000000000000, "1b000000e8d4a51000"},
+        {-1, "20"}, {-100, "3863"}, {-1000, "3903e7"},
+    };
+    for (const auto& item : vInts) {
+        BOOST_CHECK_EQUAL(CBORHex([&](JSONWriter& w) { w.Int(item.first); }), item.second);
+        BOOST_CHECK_EQUAL(CBORHex([&](JSONWriter& w) { w.Value(item.first); }), item.second);
+    }
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) { w.Value(false); }), "f4");
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) { w.Value(true); }), "f5");
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) { w.Value(NullUniValue); }), "f6");
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) { w.Str(""); }), "60");
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) { w.Value("a"); }), "6161");
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) { w.Value(1.5); }), "fb3ff8000000000000");
+
+    // Amounts are decimal fractions, 1.5 as 150000000e-8, whether written
+    // typed or as ValueFromAmount makes them
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) { w.Amount(150000000); }), "c482271a08f0d180");
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) { w.Value(UniValue(UniValue::VNUM, "1.50000000")); }),
+                      "c482271a08f0d180");
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) { w.Amount(-1); }), "c4822720");
+}
+
+BOOST_AUTO_TEST_CASE(cbor_writer_structure)
+{
+    // Streamed containers have indefinite length, complete values definite
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) {
+        w.BeginObject();
+        w.KVInt("a", 1);
+        w.Key("b");
+        w.BeginArray();
+        w.Int(2);
+        w.Int(3);
+        w.EndArray();
+        w.EndObject();
+    }), "bf61610161629f0203ffff");
+    BOOST_CHECK_EQUAL(CBORHex([](JSONWriter& w) {
+        UniValue obj(UniValue::VOBJ);
+        UniValue arr(UniValue::VARR);
+        arr.push_back(2);
+        arr.push_back(3);
+        obj.pushKV("a", 1);
+        obj.pushKV("b", arr);
+        w.Value(obj);
+    }), "a26161016162820203");
+}
+
+BOOST_AUTO_TEST_CASE(cbor_writer_chunks)
+{
+    const size_t nChunkSize = 256;
+    std::vector<std::string> vParts;
+    std::vector<bool> vLast;
+    CBORWriter writer([&](const std::string& strPart, bool fLast) {
+        vParts.push_back(strPart);
+        vLast.push_back(fLast);
+    }, nChunkSize);
+    WriteDocument(writer, 1000);
+    BOOST_CHECK_GT(vParts.size(), 10U);
+    writer.Finish();
+
+    std::string strOut;
+    for (size_t i = 0; i < vParts.size(); i++) {
+        BOOST_CHECK_EQUAL(vLast[i], i + 1 == vParts.size());
+        strOut += vParts[i];
+    }
+    // Same bytes however the output is split
+    std::string strWhole;
+    CBORWriter whole([&](const std::string& strPart, bool fLast) {
+        strWhole += strPart;
+    });
+    WriteDocument(whole, 1000);
+    whole.Finish();
+    BOOST_CHECK(strOut == strWhole);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -384,4 +384,75 @@ BOOST_AUTO_TEST_CASE(SetSanityCheck) {
     BOOST_CHECK_EQUAL(pool.GetCheckFrequency(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolSnapshotTest) {
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    // A parent spent twice by one child, and an unrelated transaction
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(2);
+    txParent.vout[0].nValue = 10000LL;
+    txParent.vout[1].nValue = 10000LL;
+    CMutableTransaction txChild;
+    txChild.vin.resize(2);
+    txChild.vin[0].prevout = COutPoint(txParent.GetHash(), 0);
+    txChild.vin[1].prevout = COutPoint(txParent.GetHash(), 1);
+    txChild.vout.resize(1);
+    txChild.vout[0].nValue = 15000LL;
+    CMutableTransaction txOther;
+    txOther.vin.resize(1);
+    txOther.vin[0].scriptSig = CScript() << OP_12;
+    txOther.vout.resize(1);
+    txOther.vout[0].nValue = 20000LL;
+
+    pool.addUnchecked(txParent.GetHash(), entry.Fee(1000LL).Time(1).FromTx(txParent));
+    pool.addUnchecked(txChild.GetHash(), entry.Fee(5000LL).Time(2).FromTx(txChild));
+
+    std::shared_ptr<const CTxMemPoolSnapshot> snapshot = pool.GetSnapshot();
+    std::vector<uint256> vtxid;
+    pool.queryHashes(vtxid);
+    BOOST_CHECK_EQUAL(snapshot->vEntries.size(), 2);
+    for (size_t i = 0; i < vtxid.size(); i++) {
+        BOOST_CHECK(snapshot->vEntries[i].hash == vtxid[i]);
+    }
+    for (const CTxMemPoolSnapshot::Entry& e : snapshot->vEntries) {
+        if (e.hash == txChild.GetHash()) {
+            BOOST_CHECK_EQUAL(e.nFee, 5000LL);
+            BOOST_CHECK_EQUAL(e.nTime, 2);
+            BOOST_CHECK_EQUAL(e.vDepends.size(), 1);
+            BOOST_CHECK(e.vDepends[0] == txParent.GetHash());
+        } else {
+            BOOST_CHECK_EQUAL(e.nCountWithDescendants, 2);
+            BOOST_CHECK(e.vDepends.empty());
+        }
+    }
+
+    // An unchanged mempool is served from the same snapshot
+    BOOST_CHECK(pool.GetSnapshot() == snapshot);
+
+    // Changes are seen by the next snapshot, and not by the one held
+    pool.addUnchecked(txOther.GetHash(), entry.Fee(0LL).FromTx(txOther));
+    std::shared_ptr<const CTxMemPoolSnapshot> next = pool.GetSnapshot();
+    BOOST_CHECK(next != snapshot);
+    BOOST_CHECK_EQUAL(next->vEntries.size(), 3);
+    BOOST_CHECK_EQUAL(snapshot->vEntries.size(), 2);
+
+    pool.PrioritiseTransaction(txOther.GetHash(), txOther.GetHash().ToString(), 7000LL);
+    next = pool.GetSnapshot();
+    for (const CTxMemPoolSnapshot::Entry& e : next->vEntries) {
+        if (e.hash == txOther.GetHash())
+            BOOST_CHECK_EQUAL(e.nModifiedFee, 7000LL);
+    }
+
+    // Within the snapshot interval, a snapshot is reused despite changes
+    pool.SetSnapshotInterval(60 * 60 * 1000);
+    std::list<CTransaction> removed;
+    pool.remove(txOther, removed, true);
+    BOOST_CHECK(pool.GetSnapshot() == next);
+    pool.SetSnapshotInterval(0);
+    BOOST_CHECK_EQUAL(pool.GetSnapshot()->vEntries.size(), 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,149 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "perfstats.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(perfstats_tests, BasicTestingSetup)
+
+static const PerfFamily& FindFamily(const std::vector<PerfFamily>& vFamilies, const std::string& strName)
+{
+    for (const PerfFamily& family : vFamilies)
+        if (family.strName == strName)
+            return family;
+    BOOST_FAIL("no family " + strName);
+    return vFamilies.front();
+}
+
+BOOST_AUTO_TEST_CASE(histogram_buckets)
+{
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(0), 0);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(1), 0);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(2), 1);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(3), 2);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(4), 2);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(5), 3);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(1024), 10);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(1025), 11);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex((uint64_t)1 << 30), 30);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(((uint64_t)1 << 30) + 1), PerfHistogram::BUCKETS - 1);
+    BOOST_CHECK_EQUAL(PerfHistogram::BucketIndex(UINT64_MAX), PerfHistogram::BUCKETS - 1);
+    for (uint64_t n = 1; n < 100000; n = n * 3 + 1) {
+        int i = PerfHistogram::BucketIndex(n);
+        BOOST_CHECK_LE(n, PerfHistogram::BucketBound(i));
+        BOOST_CHECK(i == 0 || n > PerfHistogram::BucketBound(i - 1));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(histogram_quantiles)
+{
+    PerfHistogram hist;
+    BOOST_CHECK_EQUAL(hist.Get().QuantileMicros(0.5), 0U);
+
+    // 90 fast and 10 slow
+    for (int i = 0; i < 90; i++)
+        hist.Observe(100);
+    for (int i = 0; i < 10; i++)
+        hist.Observe(5000);
+    hist.Observe(-3);
+
+    PerfHistogram::Snapshot snap = hist.Get();
+    BOOST_CHECK_EQUAL(snap.nCount, 101U);
+    BOOST_CHECK_EQUAL(snap.nSumMicros, 90U * 100 + 10 * 5000);
+    BOOST_CHECK_EQUAL(snap.nMaxMicros, 5000U);
+    BOOST_CHECK_EQUAL(snap.vBuckets[0], 1U);
+    BOOST_CHECK_EQUAL(snap.vBuckets[7], 90U);
+    BOOST_CHECK_EQUAL(snap.vBuckets[13], 10U);
+    BOOST_CHECK_EQUAL(snap.QuantileMicros(0.5), 128U);
+    BOOST_CHECK_EQUAL(snap.QuantileMicros(0.89), 128U);
+    // The bucket bound, 8192, is capped at the largest duration seen
+    BOOST_CHECK_EQUAL(snap.QuantileMicros(0.99), 5000U);
+    BOOST_CHECK_EQUAL(snap.QuantileMicros(1), 5000U);
+}
+
+BOOST_AUTO_TEST_CASE(registry)
+{
+    PerfCounter& hits = GetPerfCounter("test_lookups_total", "Test lookups", "result", "hit");
+    PerfCounter& misses = GetPerfCounter("test_lookups_total", "Test lookups", "result", "miss");
+    BOOST_CHECK(&hits != &misses);
+    BOOST_CHECK(&hits == &GetPerfCounter("test_lookups_total", "Test lookups", "result", "hit"));
+    hits.Add(3);
+    misses.Add();
+
+    GetPerfGauge("test_level", "Test level").Set(-7);
+    int64_t nCallbackValue = 42;
+    RegisterPerfCallback("test_callback", "Test callback", PERF_GAUGE, "source", "b", [&nCallbackValue] { return nCallbackValue; });
+    GetPerfGauge("test_callback", "Test callback", "source", "a").Set(1);
+    GetPerfGauge("test_callback", "Test callback", "source", "c").Set(2);
+    GetPerfHistogram("test_seconds", "Test durations").Observe(3);
+
+    std::vector<PerfFamily> vFamilies = GetPerfStats();
+    for (size_t i = 1; i < vFamilies.size(); i++)
+        BOOST_CHECK(vFamilies[i - 1].strName < vFamilies[i].strName);
+
+    const PerfFamily& lookups = FindFamily(vFamilies, "test_lookups_total");
+    BOOST_CHECK_EQUAL(lookups.type, PERF_COUNTER);
+    BOOST_CHECK_EQUAL(lookups.strLabel, "result");
+    BOOST_REQUIRE_EQUAL(lookups.vSamples.size(), 2U);
+    BOOST_CHECK_EQUAL(lookups.vSamples[0].strLabelValue, "hit");
+    BOOST_CHECK_EQUAL(lookups.vSamples[0].nValue, 3);
+    BOOST_CHECK_EQUAL(lookups.vSamples[1].strLabelValue, "miss");
+    BOOST_CHECK_EQUAL(lookups.vSamples[1].nValue, 1);
+    BOOST_CHECK_EQUAL(FindFamily(vFamilies, "test_level").vSamples[0].nValue, -7);
+    // Callback values are read each time, and sorted in with the others
+    const PerfFamily& callback = FindFamily(vFamilies, "test_callback");
+    BOOST_REQUIRE_EQUAL(callback.vSamples.size(), 3U);
+    BOOST_CHECK_EQUAL(callback.vSamples[0].nValue, 1);
+    BOOST_CHECK_EQUAL(callback.vSamples[1].strLabelValue, "b");
+    BOOST_CHECK_EQUAL(callback.vSamples[1].nValue, 42);
+    BOOST_CHECK_EQUAL(callback.vSamples[2].nValue, 2);
+    nCallbackValue = 43;
+    BOOST_CHECK_EQUAL(FindFamily(GetPerfStats(), "test_callback").vSamples[1].nValue, 43);
+    BOOST_CHECK_EQUAL(FindFamily(vFamilies, "test_seconds").vSamples[0].hist.nCount, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(prometheus_format)
+{
+    std::vector<PerfFamily> vFamilies(2);
+    vFamilies[0].strName = "requests_total";
+    vFamilies[0].strHelp = "Requests handled";
+    vFamilies[0].type = PERF_COUNTER;
+    vFamilies[0].strLabel = "method";
+    vFamilies[0].vSamples.resize(1);
+    vFamilies[0].vSamples[0].strLabelValue = "get\"x\"";
+    vFamilies[0].vSamples[0].nValue = 5;
+
+    PerfHistogram hist;
+    hist.Observe(1);
+    hist.Observe(3);
+    hist.Observe(2000000000);
+    vFamilies[1].strName = "wait_seconds";
+    vFamilies[1].strHelp = "Time spent waiting";
+    vFamilies[1].type = PERF_HISTOGRAM;
+    vFamilies[1].vSamples.resize(1);
+    vFamilies[1].vSamples[0].hist = hist.Get();
+
+    std::string strOut = FormatPerfStatsPrometheus(vFamilies);
+    std::string strExpected =
+        "# HELP bitcoinz_requests_total Requests handled\n"
+        "# TYPE bitcoinz_requests_total counter\n"
+        "bitcoinz_requests_total{method=\"get\\\"x\\\"\"} 5\n"
+        "# HELP bitcoinz_wait_seconds Time spent waiting\n"
+        "# TYPE bitcoinz_wait_seconds histogram\n"
+        "bitcoinz_wait_seconds_bucket{le=\"0.000001\"} 1\n"
+        "bitcoinz_wait_seconds_bucket{le=\"0.000002\"} 1\n"
+        "bitcoinz_wait_seconds_bucket{le=\"0.000004\"} 2\n";
+    BOOST_CHECK_EQUAL(strOut.substr(0, strExpected.size()), strExpected);
+    BOOST_CHECK(strOut.find("bitcoinz_wait_seconds_bucket{le=\"1073.741824\"} 2\n") != std::string::npos);
+    BOOST_CHECK(strOut.find("bitcoinz_wait_seconds_bucket{le=\"+Inf\"} 3\n") != std::string::npos);
+    std::string strTail =
+        "bitcoinz_wait_seconds_sum 2000.000004\n"
+        "bitcoinz_wait_seconds_count 3\n";
+    BOOST_CHECK_EQUAL(strOut.substr(strOut.size() - strTail.size()), strTail);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "relaycache.h"
+
+#include "utiltime.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(relaycache_tests, BasicTestingSetup)
+
+static uint256 TestHash(uint64_t n)
+{
+    uint256 hash;
+    *(uint64_t*)hash.begin() = n;
+    return hash;
+}
+
+static CRelayCache::TxRef TestTx()
+{
+    static uint32_t nLockTime = 0;
+    CMutableTransaction tx;
+    tx.nLockTime = nLockTime++;
+    return std::make_shared<const CTransaction>(tx);
+}
+
+BOOST_AUTO_TEST_CASE(insert_and_lookup)
+{
+    CRelayCache cache;
+    CRelayCache::TxRef tx = TestTx();
+    cache.Insert(TestHash(1), tx, 100, GetTime());
+    BOOST_CHECK(cache.Lookup(TestHash(1)) == tx);
+    BOOST_CHECK(!cache.Lookup(TestHash(2)));
+    BOOST_CHECK_EQUAL(cache.Size(), 1U);
+    BOOST_CHECK_EQUAL(cache.Bytes(), 100U);
+
+    // Inserting again replaces the entry
+    CRelayCache::TxRef replacement = TestTx();
+    cache.Insert(TestHash(1), replacement, 50, GetTime());
+    BOOST_CHECK(cache.Lookup(TestHash(1)) == replacement);
+    BOOST_CHECK_EQUAL(cache.Size(), 1U);
+    BOOST_CHECK_EQUAL(cache.Bytes(), 50U);
+}
+
+BOOST_AUTO_TEST_CASE(expiry)
+{
+    int64_t nStart = GetTime();
+    SetMockTime(nStart);
+    CRelayCache cache;
+
+    // Transactions that entered the mempool too long ago are not cached
+    cache.Insert(TestHash(1), TestTx(), 100, nStart - RELAY_CACHE_EXPIRY - 1);
+    BOOST_CHECK(!cache.Lookup(TestHash(1)));
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+
+    // Others expire RELAY_CACHE_EXPIRY after they entered it
+    cache.Insert(TestHash(2), TestTx(), 100, nStart - 60);
+    cache.Insert(TestHash(3), TestTx(), 100, nStart);
+    SetMockTime(nStart + RELAY_CACHE_EXPIRY - 59);
+    BOOST_CHECK(!cache.Lookup(TestHash(2)));
+    BOOST_CHECK(cache.Lookup(TestHash(3)));
+    SetMockTime(nStart + RELAY_CACHE_EXPIRY + 1);
+    BOOST_CHECK(!cache.Lookup(TestHash(3)));
+
+    // and are dropped by later insertions into their shard
+    cache.Insert(TestHash(4), TestTx(), 100, GetTime());
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(eviction)
+{
+    // A single shard holding up to 1000 bytes drops the oldest entries first
+    CRelayCache cache(1, 1000);
+    for (uint64_t i = 0; i < 10; i++)
+        cache.Insert(TestHash(i), TestTx(), 100, GetTime());
+    BOOST_CHECK_EQUAL(cache.Size(), 10U);
+
+    cache.Insert(TestHash(10), TestTx(), 250, GetTime());
+    BOOST_CHECK_EQUAL(cache.Size(), 8U);
+    BOOST_CHECK_EQUAL(cache.Bytes(), 950U);
+    for (uint64_t i = 0; i < 3; i++)
+        BOOST_CHECK(!cache.Lookup(TestHash(i)));
+    for (uint64_t i = 3; i <= 10; i++)
+        BOOST_CHECK(cache.Lookup(TestHash(i)));
+
+    // Replacing an entry makes it the newest one
+    cache.Insert(TestHash(3), TestTx(), 100, GetTime());
+    cache.Insert(TestHash(11), TestTx(), 100, GetTime());
+    BOOST_CHECK(cache.Lookup(TestHash(3)));
+    BOOST_CHECK(!cache.Lookup(TestHash(4)));
+    BOOST_CHECK_EQUAL(cache.Bytes(), 950U);
+
+    // Transactions larger than a shard are not cached at all
+    cache.Insert(TestHash(12), TestTx(), 1001, GetTime());
+    BOOST_CHECK(!cache.Lookup(TestHash(12)));
+    BOOST_CHECK_EQUAL(cache.Size(), 8U);
+}
+
+BOOST_AUTO_TEST_CASE(shards)
+{
+    CRelayCache cache(4, 4000);
+    for (uint64_t i = 0; i < 100; i++)
+        cache.Insert(TestHash(i), TestTx(), 10, GetTime());
+    BOOST_CHECK_EQUAL(cache.Size(), 100U);
+    BOOST_CHECK_EQUAL(cache.Bytes(), 1000U);
+    for (uint64_t i = 0; i < 100; i++)
+        BOOST_CHECK(cache.Lookup(TestHash(i)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -439,6 +439,16 @@ BOOST_AUTO_TEST_CASE(rpc_insightexplorer)
         "Invalid index, must be an integer");
     CheckRPCThrows("getspentinfo {\"txid\":\"hello\",\"index\":0}",
         "txid must be hexadecimal string (not 'hello')");
+    // arrays of outputs return null for those not spent
+    UniValue spentinfo;
+    BOOST_CHECK_NO_THROW(spentinfo = CallRPC("getspentinfo [{\"txid\":\"b4cc287e58f87cdae59417329f710f3ecd75a4ee1d2872b7248f50977c8493f3\",\"index\":0},{\"txid\":\"b4cc287e58f87cdae59417329f710f3ecd75a4ee1d2872b7248f50977c8493f3\",\"index\":1}]"));
+    BOOST_CHECK_EQUAL(spentinfo.size(), 2U);
+    BOOST_CHECK(spentinfo[0].isNull());
+    BOOST_CHECK(spentinfo[1].isNull());
+    CheckRPCThrows("getspentinfo [{\"txid\":\"b4cc287e58f87cdae59417329f710f3ecd75a4ee1d2872b7248f50977c8493f3\"}]",
+        "Invalid index, must be an integer");
+    CheckRPCThrows("getspentinfo [1]",
+        "Invalid request, must be an object");
 
     // only the mainnet genesis block exists
     BOOST_CHECK_NO_THROW(CallRPC("getblockdeltas \"f499ee3d498b4298ac6a64205b8addb7c43197e2a660229be65db8a4534d75c1\""));
@@ -0,0 +1,73 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "spentindex.h"
+#include "txdb.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(spentindex_tests, TestingSetup)
+
+static CSpentIndexValue SpendingInput(unsigned int n)
+{
+    return CSpentIndexValue(ArithToUint256(arith_uint256(1000 + n)), n, 100 + n, n * COIN, 1, uint160());
+}
+
+BOOST_AUTO_TEST_CASE(spentindex_batch_read)
+{
+    CBlockTreeDB db(1 << 20, true);
+
+    const uint256 txid1 = ArithToUint256(arith_uint256(1));
+    const uint256 txid2 = ArithToUint256(arith_uint256(2));
+
+    // Output indices whose little-endian serialization doesn't sort like the
+    // numbers themselves, and an output of another transaction
+    std::vector<CSpentIndexDbEntry> entries;
+    entries.push_back(std::make_pair(CSpentIndexKey(txid1, 1), SpendingInput(1)));
+    entries.push_back(std::make_pair(CSpentIndexKey(txid1, 256), SpendingInput(256)));
+    entries.push_back(std::make_pair(CSpentIndexKey(txid1, 257), SpendingInput(257)));
+    entries.push_back(std::make_pair(CSpentIndexKey(txid2, 0), SpendingInput(0)));
+    BOOST_CHECK(db.UpdateSpentIndex(entries));
+
+    std::vector<CSpentIndexKey> keys;
+    keys.push_back(CSpentIndexKey(txid2, 0));
+    keys.push_back(CSpentIndexKey(txid1, 257));
+    keys.push_back(CSpentIndexKey(txid1, 2));
+    keys.push_back(CSpentIndexKey(txid1, 1));
+    keys.push_back(CSpentIndexKey(txid1, 256));
+    keys.push_back(CSpentIndexKey(txid1, 1));
+    keys.push_back(CSpentIndexKey(txid2, 1));
+
+    std::vector<CSpentIndexValue> values;
+    unsigned int nSeeks;
+    BOOST_CHECK(db.ReadSpentIndex(keys, values, nSeeks));
+    BOOST_CHECK_EQUAL(values.size(), keys.size());
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        CSpentIndexValue expected;
+        bool fSpent = db.ReadSpentIndex(keys[i], expected);
+        BOOST_CHECK_EQUAL(!values[i].IsNull(), fSpent);
+        if (fSpent) {
+            BOOST_CHECK(values[i].txid == expected.txid);
+            BOOST_CHECK_EQUAL(values[i].inputIndex, expected.inputIndex);
+            BOOST_CHECK_EQUAL(values[i].blockHeight, expected.blockHeight);
+            BOOST_CHECK_EQUAL(values[i].satoshis, expected.satoshis);
+        }
+    }
+    BOOST_CHECK_EQUAL(values[1].inputIndex, 257U);
+    BOOST_CHECK(values[2].IsNull());
+    BOOST_CHECK(values[6].IsNull());
+
+    // Consecutive spent outputs are read by stepping the cursor, not seeking
+    BOOST_CHECK_LT(nSeeks, keys.size());
+
+    keys.clear();
+    BOOST_CHECK(db.ReadSpentIndex(keys, values, nSeeks));
+    BOOST_CHECK(values.empty());
+    BOOST_CHECK_EQUAL(nSeeks, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
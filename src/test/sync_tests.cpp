@@ -0,0 +1,129 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "sync.h"
+
+#include "test/test_bitcoin.h"
+
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(sync_tests, BasicTestingSetup)
+
+static LockProfileEntry FindSite(int nLine)
+{
+    for (const LockProfileEntry& entry : GetLockProfile())
+        if (entry.nLine == nLine && entry.strFile == __FILE__)
+            return entry;
+    return LockProfileEntry();
+}
+
+BOOST_AUTO_TEST_CASE(lock_profile_sampling)
+{
+    CCriticalSection cs;
+    ResetLockProfile();
+    {
+        LOCK(cs);
+    }
+    BOOST_CHECK(GetLockProfile().empty());
+
+    // One in four acquisitions is sampled, and weighted to estimate all
+    nLockProfileSampleRate = 4;
+    const int nLine = __LINE__ + 2;
+    for (int i = 0; i < 100; i++) {
+        LOCK(cs);
+    }
+    nLockProfileSampleRate = 0;
+    {
+        LOCK(cs);
+    }
+
+    LockProfileEntry entry = FindSite(nLine);
+    BOOST_CHECK_EQUAL(entry.strName, "cs");
+    BOOST_CHECK_EQUAL(entry.nSamples, 25U);
+    BOOST_CHECK_EQUAL(entry.nAcquisitions, 100U);
+    BOOST_CHECK_EQUAL(entry.nContended, 0U);
+    BOOST_CHECK_GE(entry.nMaxHoldNanos, 0);
+    BOOST_CHECK_LE(entry.nHoldNanos, entry.nMaxHoldNanos * 100);
+    BOOST_CHECK_EQUAL(GetLockProfile().size(), 1U);
+
+    // Successful tries are sampled too
+    nLockProfileSampleRate = 1;
+    const int nTryLine = __LINE__ + 2;
+    {
+        TRY_LOCK(cs, lockTried);
+        BOOST_CHECK(static_cast<bool>(lockTried));
+    }
+    nLockProfileSampleRate = 0;
+    entry = FindSite(nTryLine);
+    BOOST_CHECK_EQUAL(entry.nSamples, 1U);
+    BOOST_CHECK_EQUAL(entry.nWaitNanos, 0);
+}
+
+BOOST_AUTO_TEST_CASE(lock_profile_contention)
+{
+    CCriticalSection cs;
+    ResetLockProfile();
+    nLockProfileSampleRate = 1;
+
+    std::atomic<bool> fHeld(false);
+    const int nHolderLine = __LINE__ + 2;
+    std::thread holder([&] {
+        LOCK(cs);
+        fHeld = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+    while (!fHeld)
+        std::this_thread::yield();
+    const int nWaiterLine = __LINE__ + 2;
+    {
+        LOCK(cs);
+    }
+    holder.join();
+    nLockProfileSampleRate = 0;
+
+    LockProfileEntry held = FindSite(nHolderLine);
+    BOOST_CHECK_EQUAL(held.nSamples, 1U);
+    BOOST_CHECK_GE(held.nHoldNanos, 50 * 1000 * 1000);
+    BOOST_CHECK_EQUAL(held.nHoldNanos, held.nMaxHoldNanos);
+
+    LockProfileEntry waited = FindSite(nWaiterLine);
+    BOOST_CHECK_EQUAL(waited.nSamples, 1U);
+    BOOST_CHECK_EQUAL(waited.nContended, 1U);
+    BOOST_CHECK_GT(waited.nWaitNanos, 10 * 1000 * 1000);
+    BOOST_CHECK_EQUAL(waited.nWaitNanos, waited.nMaxWaitNanos);
+
+    ResetLockProfile();
+    BOOST_CHECK(GetLockProfile().empty());
+}
+
+BOOST_AUTO_TEST_CASE(lock_profile_folded)
+{
+    std::vector<LockProfileEntry> vEntries(3);
+    vEntries[0].strName = "cs_main";
+    vEntries[0].strFile = "main.cpp";
+    vEntries[0].nLine = 10;
+    vEntries[0].nWaitNanos = 2500;
+    vEntries[0].nHoldNanos = 9000000;
+    vEntries[1].strName = "mempool.cs";
+    vEntries[1].strFile = "txmempool.cpp";
+    vEntries[1].nLine = 20;
+    vEntries[1].nWaitNanos = 7000000;
+    vEntries[1].nHoldNanos = 1000;
+    // Sites with less than a microsecond are left out
+    vEntries[2].strName = "cs_vNodes";
+    vEntries[2].strFile = "net.cpp";
+    vEntries[2].nLine = 30;
+    vEntries[2].nWaitNanos = 999;
+
+    BOOST_CHECK_EQUAL(FormatLockProfileFolded(vEntries, false),
+                      "mempool.cs;txmempool.cpp:20 7000\n"
+                      "cs_main;main.cpp:10 2\n");
+    BOOST_CHECK_EQUAL(FormatLockProfileFolded(vEntries, true),
+                      "cs_main;main.cpp:10 9000\n"
+                      "mempool.cs;txmempool.cpp:20 1\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
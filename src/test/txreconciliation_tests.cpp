@@ -0,0 +1,234 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "txreconciliation.h"
+
+#include "clientversion.h"
+#include "random.h"
+#include "streams.h"
+#include "version.h"
+#include "test/test_bitcoin.h"
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+static uint32_t RandomShortID(FastRandomContext& rand)
+{
+    uint32_t key = 0;
+    while (key == 0)
+        key = rand.rand32();
+    return key;
+}
+
+static uint256 RandomTxid(FastRandomContext& rand)
+{
+    uint256 txid;
+    for (uint32_t* p = (uint32_t*)txid.begin(); p < (uint32_t*)txid.end(); p++)
+        *p = rand.rand32();
+    return txid;
+}
+
+BOOST_AUTO_TEST_CASE(sketch_decodes_difference)
+{
+    FastRandomContext rand(true);
+    for (size_t nDiff : {1, 2, 10, 100, 1000}) {
+        size_t nCells = CReconSketch::CellsForDifference(nDiff);
+        size_t nDecoded = 0;
+        for (int i = 0; i < 20; i++) {
+            CReconSketch local(nCells), remote(nCells);
+            for (int j = 0; j < 500; j++) {
+                uint32_t key = RandomShortID(rand);
+                local.Add(key);
+                remote.Add(key);
+            }
+            std::vector<uint32_t> vExpected;
+            for (size_t j = 0; j < nDiff; j++) {
+                uint32_t key = RandomShortID(rand);
+                (j % 2 ? local : remote).Add(key);
+                vExpected.push_back(key);
+            }
+
+            BOOST_CHECK(local.Merge(remote));
+            std::vector<uint32_t> vKeys;
+            if (local.Decode(vKeys)) {
+                std::sort(vKeys.begin(), vKeys.end());
+                std::sort(vExpected.begin(), vExpected.end());
+                BOOST_CHECK(vKeys == vExpected);
+                nDecoded++;
+            }
+        }
+        // Decoding is probabilistic, but should rarely fail
+        BOOST_CHECK(nDecoded >= 17);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sketch_too_small)
+{
+    FastRandomContext rand(true);
+    CReconSketch sketch(CReconSketch::CellsForDifference(10));
+    for (int i = 0; i < 100; i++)
+        sketch.Add(RandomShortID(rand));
+
+    std::vector<uint32_t> vKeys;
+    BOOST_CHECK(!sketch.Decode(vKeys));
+
+    // Sketches of different sizes cannot be combined
+    CReconSketch other(sketch.GetCells() + CReconSketch::NUM_HASHES);
+    BOOST_CHECK(!sketch.Merge(other));
+
+    // Nor can the sizes grow without bound
+    BOOST_CHECK_EQUAL(CReconSketch::CellsForDifference(MAX_RECON_SET_SIZE * 10), MAX_SKETCH_CELLS);
+}
+
+BOOST_AUTO_TEST_CASE(sketch_serialization)
+{
+    FastRandomContext rand(true);
+    CReconSketch sketch(CReconSketch::CellsForDifference(5));
+    std::vector<uint32_t> vExpected;
+    for (int i = 0; i < 5; i++) {
+        vExpected.push_back(RandomShortID(rand));
+        sketch.Add(vExpected.back());
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << sketch;
+    BOOST_CHECK_EQUAL(ss.size(), 1 + sketch.GetCells() * 8);
+
+    CReconSketch decoded;
+    ss >> decoded;
+    BOOST_CHECK(decoded.IsValid());
+    std::vector<uint32_t> vKeys;
+    BOOST_CHECK(decoded.Decode(vKeys));
+    std::sort(vKeys.begin(), vKeys.end());
+    std::sort(vExpected.begin(), vExpected.end());
+    BOOST_CHECK(vKeys == vExpected);
+
+    // A sketch that is not split evenly into sub-tables is rejected
+    CDataStream ssBad(SER_NETWORK, PROTOCOL_VERSION);
+    ssBad << std::vector<CReconSketch::Cell>(4);
+    ssBad >> decoded;
+    BOOST_CHECK(!decoded.IsValid());
+    BOOST_CHECK(!decoded.Decode(vKeys));
+}
+
+BOOST_AUTO_TEST_CASE(difference_estimate)
+{
+    BOOST_CHECK_EQUAL(EstimateReconDifference(0, 0, 0.25), 1U);
+    BOOST_CHECK_EQUAL(EstimateReconDifference(10, 30, 0.5), 26U);
+    BOOST_CHECK_EQUAL(EstimateReconDifference(30, 10, 0.5), 26U);
+}
+
+BOOST_AUTO_TEST_CASE(peers_agree_on_short_ids)
+{
+    FastRandomContext rand(true);
+    CTxReconciliationState a(1234), b(5678);
+    a.Register(5678, true, false);
+    b.Register(1234, false, false);
+    BOOST_CHECK_EQUAL(a.k0, b.k0);
+    BOOST_CHECK_EQUAL(a.k1, b.k1);
+    BOOST_CHECK(a.fInitiator && !b.fInitiator);
+
+    uint256 txid = RandomTxid(rand);
+    BOOST_CHECK_EQUAL(a.GetShortID(txid), b.GetShortID(txid));
+
+    // Other connections use other keys
+    CTxReconciliationState c(1234);
+    c.Register(9999, true, false);
+    BOOST_CHECK(a.GetShortID(txid) != c.GetShortID(txid));
+}
+
+BOOST_AUTO_TEST_CASE(reconciliation_round)
+{
+    FastRandomContext rand(true);
+    CTxReconciliationState initiator(1), responder(2);
+    initiator.Register(2, true, false);
+    responder.Register(1, false, false);
+
+    std::vector<uint256> vShared, vInitiatorOnly, vResponderOnly;
+    for (int i = 0; i < 50; i++) {
+        vShared.push_back(RandomTxid(rand));
+        BOOST_CHECK(initiator.AddTx(vShared.back()));
+        BOOST_CHECK(responder.AddTx(vShared.back()));
+    }
+    for (int i = 0; i < 3; i++) {
+        vInitiatorOnly.push_back(RandomTxid(rand));
+        BOOST_CHECK(initiator.AddTx(vInitiatorOnly.back()));
+        vResponderOnly.push_back(RandomTxid(rand));
+        BOOST_CHECK(responder.AddTx(vResponderOnly.back()));
+    }
+    // Transactions the peer announced to us need not be reconciled
+    uint256 known = RandomTxid(rand);
+    BOOST_CHECK(initiator.AddTx(known));
+    initiator.RemoveTx(known);
+
+    initiator.Snapshot(0);
+    responder.Snapshot(0);
+    BOOST_CHECK(initiator.mapSet.empty() && initiator.fRoundInFlight);
+    BOOST_CHECK_EQUAL(initiator.mapSnapshot.size(), 53U);
+
+    // Transactions arriving during the round wait for the next one
+    BOOST_CHECK(initiator.AddTx(RandomTxid(rand)));
+    BOOST_CHECK_EQUAL(initiator.mapSet.size(), 1U);
+
+    size_t nDiff = EstimateReconDifference(responder.mapSnapshot.size(), initiator.mapSnapshot.size(), 0.25);
+    CReconSketch sketch = responder.GetSketch(CReconSketch::CellsForDifference(nDiff));
+    CReconSketch localSketch = initiator.GetSketch(sketch.GetCells());
+    BOOST_CHECK(localSketch.Merge(sketch));
+    std::vector<uint32_t> vDiff;
+    BOOST_CHECK(localSketch.Decode(vDiff));
+    BOOST_CHECK_EQUAL(vDiff.size(), 6U);
+
+    size_t nLocalOnly = 0;
+    for (uint32_t nShortID : vDiff) {
+        std::map<uint32_t, uint256>::const_iterator it = initiator.mapSnapshot.find(nShortID);
+        if (it != initiator.mapSnapshot.end()) {
+            BOOST_CHECK(std::find(vInitiatorOnly.begin(), vInitiatorOnly.end(), it->second) != vInitiatorOnly.end());
+            nLocalOnly++;
+        } else {
+            it = responder.mapSnapshot.find(nShortID);
+            BOOST_CHECK(it != responder.mapSnapshot.end());
+            BOOST_CHECK(std::find(vResponderOnly.begin(), vResponderOnly.end(), it->second) != vResponderOnly.end());
+        }
+    }
+    BOOST_CHECK_EQUAL(nLocalOnly, 3U);
+
+    // Six differences between sets of 53 refine q to 6/53
+    initiator.UpdateQ(nLocalOnly, vDiff.size() - nLocalOnly);
+    BOOST_CHECK_CLOSE(initiator.dQ, 6.0 / 53, 0.001);
+
+    BOOST_CHECK_EQUAL(initiator.EndRound().size(), 53U);
+    BOOST_CHECK(initiator.mapSnapshot.empty() && !initiator.fRoundInFlight);
+}
+
+BOOST_AUTO_TEST_CASE(round_timeout)
+{
+    FastRandomContext rand(true);
+    CTxReconciliationState state(1);
+    state.Register(2, false, false);
+    BOOST_CHECK(state.AddTx(RandomTxid(rand)));
+    BOOST_CHECK(state.AddTx(RandomTxid(rand)));
+    state.Snapshot(1000);
+    BOOST_CHECK_EQUAL(state.nRoundTimeout, 1000 + RECON_RESPONSE_TIMEOUT * 1000000LL);
+    BOOST_CHECK(state.AddTx(RandomTxid(rand)));
+
+    // Both the round and what was queued for the next one get flooded
+    BOOST_CHECK_EQUAL(state.TimeOut().size(), 3U);
+    BOOST_CHECK(state.mapSet.empty() && state.mapSnapshot.empty());
+    BOOST_CHECK(!state.fRoundInFlight && !state.fRegistered && state.fTimedOut);
+}
+
+BOOST_AUTO_TEST_CASE(set_limit)
+{
+    FastRandomContext rand(true);
+    CTxReconciliationState state(1);
+    state.Register(2, true, false);
+    while (state.mapSet.size() < MAX_RECON_SET_SIZE)
+        state.AddTx(RandomTxid(rand));
+    BOOST_CHECK(!state.AddTx(RandomTxid(rand)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
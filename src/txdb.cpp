@@ -6,12 +6,19 @@
 #include "txdb.h"
 
 #include "chainparams.h"
+#include "compactblockindex.h"
+#include "crypto/common.h"
 #include "hash.h"
 #include "main.h"
+#include "memusage.h"
 #include "pow.h"
+#include "random.h"
 #include "uint256.h"
 
 #include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
 
 #include <boost/thread.hpp>
 
@@ -21,11 +28,14 @@ using namespace std;
 // previously used by DB_SAPLING_ANCHOR and DB_BEST_SAPLING_ANCHOR.
 static const char DB_SPROUT_ANCHOR = 'A';
 static const char DB_SAPLING_ANCHOR = 'Z';
+static const char DB_SPROUT_ANCHOR_DELTA = 'D';
+static const char DB_SAPLING_ANCHOR_DELTA = 'E';
 static const char DB_NULLIFIER = 's';
 static const char DB_SAPLING_NULLIFIER = 'S';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
+static const char DB_COMPACTBLOCK = 'k';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -34,6 +44,8 @@ static const char DB_BEST_SAPLING_ANCHOR = 'z';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_SNAPSHOT_LOADING = 'L';
+static const char DB_SNAPSHOT_BASE = 'U';
 
 // insightexplorer
 static const char DB_ADDRESSINDEX = 'd';
@@ -42,36 +54,209 @@ static const char DB_SPENTINDEX = 'p';
 static const char DB_TIMESTAMPINDEX = 'T';
 static const char DB_BLOCKHASHINDEX = 'h';
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
+CNullifierFilter::CNullifierFilter() :
+    k0(GetRand(std::numeric_limits<uint64_t>::max())),
+    k1(GetRand(std::numeric_limits<uint64_t>::max())),
+    table(NULLIFIER_FILTER_MIN_SLOTS, 0), nEntries(0), fLoaded(false),
+    nQueries(0), nNegatives(0), nFalsePositives(0)
+{
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+uint64_t CNullifierFilter::Fingerprint(const uint256 &nf) const
 {
+    uint64_t fingerprint = SipHashUint256(k0, k1, nf);
+    return fingerprint ? fingerprint : 1;
 }
 
+void CNullifierFilter::Grow()
+{
+    std::vector<uint64_t> old(table.size() * 2, 0);
+    old.swap(table);
+    for (uint64_t fingerprint : old) {
+        if (fingerprint) {
+            size_t i = Slot(fingerprint);
+            while (table[i]) {
+                i = (i + 1) & (table.size() - 1);
+            }
+            table[i] = fingerprint;
+        }
+    }
+}
 
-bool CCoinsViewDB::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const {
-    if (rt == SproutMerkleTree::empty_root()) {
-        SproutMerkleTree new_tree;
-        tree = new_tree;
+void CNullifierFilter::Clear()
+{
+    std::vector<uint64_t>(NULLIFIER_FILTER_MIN_SLOTS, 0).swap(table);
+    nEntries = 0;
+    fLoaded = false;
+}
+
+void CNullifierFilter::Insert(const uint256 &nf)
+{
+    // Keep the table at most three quarters full.
+    if ((nEntries + 1) * 4 > table.size() * 3) {
+        Grow();
+    }
+    uint64_t fingerprint = Fingerprint(nf);
+    size_t i = Slot(fingerprint);
+    while (table[i]) {
+        i = (i + 1) & (table.size() - 1);
+    }
+    table[i] = fingerprint;
+    nEntries++;
+}
+
+void CNullifierFilter::Erase(const uint256 &nf)
+{
+    const size_t mask = table.size() - 1;
+    uint64_t fingerprint = Fingerprint(nf);
+    size_t i = Slot(fingerprint);
+    while (table[i] != fingerprint) {
+        if (!table[i]) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+
+    // Shift back later entries of the probe sequence so that none of them
+    // is left behind an empty slot.
+    for (size_t j = (i + 1) & mask; table[j]; j = (j + 1) & mask) {
+        size_t home = Slot(table[j]);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            table[i] = table[j];
+            i = j;
+        }
+    }
+    table[i] = 0;
+    nEntries--;
+}
+
+bool CNullifierFilter::MaybeContains(const uint256 &nf)
+{
+    if (!fLoaded) {
         return true;
     }
+    nQueries++;
+    uint64_t fingerprint = Fingerprint(nf);
+    for (size_t i = Slot(fingerprint); table[i]; i = (i + 1) & (table.size() - 1)) {
+        if (table[i] == fingerprint) {
+            return true;
+        }
+    }
+    nNegatives++;
+    return false;
+}
+
+void CNullifierFilter::RecordFalsePositive()
+{
+    if (fLoaded) {
+        nFalsePositives++;
+    }
+}
 
-    bool read = db.Read(make_pair(DB_SPROUT_ANCHOR, rt), tree);
+size_t CNullifierFilter::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(table);
+}
 
-    return read;
+CNullifierFilterStats CNullifierFilter::GetStats() const
+{
+    CNullifierFilterStats stats;
+    stats.fLoaded = fLoaded;
+    stats.nEntries = nEntries;
+    stats.nMemoryUsage = DynamicMemoryUsage();
+    stats.nQueries = nQueries;
+    stats.nNegatives = nNegatives;
+    stats.nFalsePositives = nFalsePositives;
+    return stats;
 }
 
-bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const {
-    if (rt == SaplingMerkleTree::empty_root()) {
-        SaplingMerkleTree new_tree;
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe),
+    sproutFrontiers(ANCHOR_FRONTIER_CACHE_SIZE),
+    saplingFrontiers(ANCHOR_FRONTIER_CACHE_SIZE)
+{
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe),
+    sproutFrontiers(ANCHOR_FRONTIER_CACHE_SIZE),
+    saplingFrontiers(ANCHOR_FRONTIER_CACHE_SIZE)
+{
+}
+
+// Anchors are stored either as a full frontier under dbFull, or as a
+// CAnchorDelta under dbDelta. A delta is materialized by walking back to the
+// nearest tree that is cached or stored in full, and replaying the appends.
+template<typename Tree, typename Hash>
+bool CCoinsViewDB::GetAnchorAt(const uint256 &rt, Tree &tree, char dbFull, char dbDelta, CAnchorFrontierCache<Tree> &frontiers) const
+{
+    if (rt == Tree::empty_root()) {
+        Tree new_tree;
         tree = new_tree;
         return true;
     }
 
-    bool read = db.Read(make_pair(DB_SAPLING_ANCHOR, rt), tree);
+    LOCK(cs_frontiers);
+    if (frontiers.Get(rt, tree)) {
+        return true;
+    }
+
+    std::vector<std::pair<uint256, CAnchorDelta<Hash>>> deltas;
+    uint256 current = rt;
+    Tree base;
+    while (current != Tree::empty_root() && !frontiers.Get(current, base)) {
+        if (db.Read(make_pair(dbFull, current), base)) {
+            break;
+        }
+
+        CAnchorDelta<Hash> delta;
+        if (!db.Read(make_pair(dbDelta, current), delta)) {
+            return false;
+        }
+        if (deltas.size() >= ANCHOR_CHECKPOINT_INTERVAL) {
+            return error("%s: delta chain for anchor %s is too long", __func__, rt.GetHex());
+        }
+        uint256 parent = delta.parent;
+        deltas.emplace_back(current, std::move(delta));
+        current = parent;
+    }
+
+    frontiers.Put(current, base);
+    for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+        base.append_batch(it->second.commitments);
+        frontiers.Put(it->first, base);
+    }
+
+    if (base.root() != rt) {
+        for (const auto& delta : deltas) {
+            frontiers.Erase(delta.first);
+        }
+        return error("%s: anchor %s does not match its stored delta", __func__, rt.GetHex());
+    }
 
-    return read;
+    tree = base;
+    return true;
+}
+
+bool CCoinsViewDB::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const {
+    return GetAnchorAt<SproutMerkleTree, libzcash::SHA256Compress>(
+        rt, tree, DB_SPROUT_ANCHOR, DB_SPROUT_ANCHOR_DELTA, sproutFrontiers);
+}
+
+bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const {
+    return GetAnchorAt<SaplingMerkleTree, libzcash::PedersenHash>(
+        rt, tree, DB_SAPLING_ANCHOR, DB_SAPLING_ANCHOR_DELTA, saplingFrontiers);
+}
+
+CNullifierFilter &CCoinsViewDB::NullifierFilter(ShieldedType type) const {
+    switch (type) {
+        case SPROUT:
+            return sproutNullifierFilter;
+        case SAPLING:
+            return saplingNullifierFilter;
+        default:
+            throw runtime_error("Unknown shielded type");
+    }
 }
 
 bool CCoinsViewDB::GetNullifier(const uint256 &nf, ShieldedType type) const {
@@ -87,7 +272,20 @@ bool CCoinsViewDB::GetNullifier(const uint256 &nf, ShieldedType type) const {
         default:
             throw runtime_error("Unknown shielded type");
     }
-    return db.Read(make_pair(dbChar, nf), spent);
+
+    CNullifierFilter &filter = NullifierFilter(type);
+    {
+        LOCK(cs_nullifierFilters);
+        if (!filter.MaybeContains(nf)) {
+            return false;
+        }
+    }
+    if (!db.Read(make_pair(dbChar, nf), spent)) {
+        LOCK(cs_nullifierFilters);
+        filter.RecordFalsePositive();
+        return false;
+    }
+    return true;
 }
 
 bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
@@ -124,14 +322,28 @@ uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const {
     return hashBestAnchor;
 }
 
-void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char& dbChar)
+// New nullifiers are added to the filter before the batch is written, so the
+// filter never misses one that is in the database. Erased nullifiers are
+// returned in vErased, to be removed from the filter once the batch has been
+// written. Only those actually in the database are returned: removing the
+// fingerprint of one that is not could remove the copy held for another
+// nullifier with the same fingerprint.
+void CCoinsViewDB::BatchWriteNullifiers(CDBBatch &batch, CNullifiersMap &mapToUse, char dbChar, CNullifierFilter &filter, std::vector<uint256> &vErased)
 {
+    LOCK(cs_nullifierFilters);
     for (CNullifiersMap::iterator it = mapToUse.begin(); it != mapToUse.end();) {
         if (it->second.flags & CNullifiersCacheEntry::DIRTY) {
-            if (!it->second.entered)
+            if (!it->second.entered) {
                 batch.Erase(make_pair(dbChar, it->first));
-            else
+                if (filter.IsLoaded() && db.Exists(make_pair(dbChar, it->first))) {
+                    vErased.push_back(it->first);
+                }
+            } else {
                 batch.Write(make_pair(dbChar, it->first), true);
+                if (filter.IsLoaded()) {
+                    filter.Insert(it->first);
+                }
+            }
             // TODO: changed++? ... See comment in CCoinsViewDB::BatchWrite. If this is needed we could return an int
         }
         CNullifiersMap::iterator itOld = it++;
@@ -139,23 +351,93 @@ void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char&
     }
 }
 
-template<typename Map, typename MapIterator, typename MapEntry, typename Tree>
-void BatchWriteAnchors(CDBBatch& batch, Map& mapToUse, const char& dbChar)
+// Writes dirty anchors, storing a CAnchorDelta against the parent anchor
+// where the parent's delta chain is known and short enough, and a full
+// frontier (a checkpoint) otherwise.
+template<typename Tree, typename Hash, typename Map, typename MapEntry>
+void CCoinsViewDB::BatchWriteAnchors(CDBBatch &batch, Map &mapToUse, char dbFull, char dbDelta, CAnchorFrontierCache<Tree> &frontiers, size_t &nFull, size_t &nDeltas)
 {
-    for (MapIterator it = mapToUse.begin(); it != mapToUse.end();) {
-        if (it->second.flags & MapEntry::DIRTY) {
-            if (!it->second.entered)
-                batch.Erase(make_pair(dbChar, it->first));
-            else {
-                if (it->first != Tree::empty_root()) {
-                    batch.Write(make_pair(dbChar, it->first), it->second.tree);
+    // Depth of the delta chain each anchor will have once the batch is
+    // written; 0 for full frontiers, -1 if the anchor is unavailable.
+    std::unordered_map<uint256, int, SaltedTxidHasher> depths;
+    auto depthOf = [&](const uint256 &rtIn) -> int {
+        // Walk back through the dirty anchors of the batch, newest first,
+        // to one whose depth is known. A batch can hold a long chain of
+        // them, so this is a loop rather than a recursion, and stops after
+        // ANCHOR_CHECKPOINT_INTERVAL anchors: the oldest one walked then
+        // becomes a checkpoint.
+        std::vector<uint256> vChain;
+        uint256 rt = rtIn;
+        int depth = -1; // Of the parent of the oldest anchor in vChain
+        while (true) {
+            auto itDepth = depths.find(rt);
+            if (itDepth != depths.end()) {
+                depth = itDepth->second;
+                break;
+            }
+            auto it = mapToUse.find(rt);
+            if (rt != Tree::empty_root() && it != mapToUse.end() && (it->second.flags & MapEntry::DIRTY)) {
+                if (!it->second.entered) {
+                    depths[rt] = -1;
+                    break;
+                }
+                vChain.push_back(rt);
+                if (it->second.parent.IsNull() || vChain.size() >= ANCHOR_CHECKPOINT_INTERVAL) {
+                    break;
                 }
+                rt = it->second.parent;
+                continue;
             }
-            // TODO: changed++?
+
+            if (rt == Tree::empty_root() || db.Exists(make_pair(dbFull, rt))) {
+                depth = 0;
+            } else {
+                CAnchorDelta<Hash> delta;
+                if (db.Read(make_pair(dbDelta, rt), delta)) {
+                    depth = delta.nDepth;
+                }
+            }
+            depths[rt] = depth;
+            break;
         }
-        MapIterator itOld = it++;
-        mapToUse.erase(itOld);
+
+        // Fill in the chain from its oldest end
+        for (auto itChain = vChain.rbegin(); itChain != vChain.rend(); ++itChain) {
+            depth = depth >= 0 && depth + 1 < (int)ANCHOR_CHECKPOINT_INTERVAL ? depth + 1 : 0;
+            depths[*itChain] = depth;
+        }
+        return depth;
+    };
+
+    LOCK(cs_frontiers);
+    for (auto it = mapToUse.begin(); it != mapToUse.end(); ++it) {
+        if (!(it->second.flags & MapEntry::DIRTY) || it->first == Tree::empty_root()) {
+            continue;
+        }
+        if (!it->second.entered) {
+            batch.Erase(make_pair(dbFull, it->first));
+            batch.Erase(make_pair(dbDelta, it->first));
+            frontiers.Erase(it->first);
+            continue;
+        }
+
+        int depth = depthOf(it->first);
+        if (depth > 0) {
+            CAnchorDelta<Hash> delta;
+            delta.parent = it->second.parent;
+            delta.nDepth = depth;
+            delta.commitments = it->second.appended;
+            batch.Write(make_pair(dbDelta, it->first), delta);
+            batch.Erase(make_pair(dbFull, it->first));
+            nDeltas++;
+        } else {
+            batch.Write(make_pair(dbFull, it->first), it->second.tree);
+            batch.Erase(make_pair(dbDelta, it->first));
+            nFull++;
+        }
+        frontiers.Put(it->first, it->second.tree);
     }
+    mapToUse.clear();
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
@@ -182,11 +464,16 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
         mapCoins.erase(itOld);
     }
 
-    ::BatchWriteAnchors<CAnchorsSproutMap, CAnchorsSproutMap::iterator, CAnchorsSproutCacheEntry, SproutMerkleTree>(batch, mapSproutAnchors, DB_SPROUT_ANCHOR);
-    ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR);
+    size_t nFullAnchors = 0;
+    size_t nDeltaAnchors = 0;
+    BatchWriteAnchors<SproutMerkleTree, libzcash::SHA256Compress, CAnchorsSproutMap, CAnchorsSproutCacheEntry>(
+        batch, mapSproutAnchors, DB_SPROUT_ANCHOR, DB_SPROUT_ANCHOR_DELTA, sproutFrontiers, nFullAnchors, nDeltaAnchors);
+    BatchWriteAnchors<SaplingMerkleTree, libzcash::PedersenHash, CAnchorsSaplingMap, CAnchorsSaplingCacheEntry>(
+        batch, mapSaplingAnchors, DB_SAPLING_ANCHOR, DB_SAPLING_ANCHOR_DELTA, saplingFrontiers, nFullAnchors, nDeltaAnchors);
 
-    ::BatchWriteNullifiers(batch, mapSproutNullifiers, DB_NULLIFIER);
-    ::BatchWriteNullifiers(batch, mapSaplingNullifiers, DB_SAPLING_NULLIFIER);
+    std::vector<uint256> vSproutErased, vSaplingErased;
+    BatchWriteNullifiers(batch, mapSproutNullifiers, DB_NULLIFIER, sproutNullifierFilter, vSproutErased);
+    BatchWriteNullifiers(batch, mapSaplingNullifiers, DB_SAPLING_NULLIFIER, saplingNullifierFilter, vSaplingErased);
 
     if (!hashBlock.IsNull())
         batch.Write(DB_BEST_BLOCK, hashBlock);
@@ -196,7 +483,322 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
         batch.Write(DB_BEST_SAPLING_ANCHOR, hashSaplingAnchor);
 
     LogPrint(BCLog::COINDB, "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return db.WriteBatch(batch);
+    LogPrint(BCLog::COINDB, "Committing %u anchor checkpoints and %u anchor deltas to coin database...\n", (unsigned int)nFullAnchors, (unsigned int)nDeltaAnchors);
+    if (!db.WriteBatch(batch)) {
+        return false;
+    }
+
+    LOCK(cs_nullifierFilters);
+    for (const uint256 &nf : vSproutErased) {
+        sproutNullifierFilter.Erase(nf);
+    }
+    for (const uint256 &nf : vSaplingErased) {
+        saplingNullifierFilter.Erase(nf);
+    }
+    return true;
+}
+
+static void AddCoinsToStats(CUTXOSnapshotStats &stats, const CCoins &coins)
+{
+    stats.nTransactions++;
+    for (const CTxOut &out : coins.vout) {
+        if (!out.IsNull()) {
+            stats.nTransactionOutputs++;
+            stats.nTotalAmount += out.nValue;
+        }
+    }
+}
+
+// Writes each anchor as the commitments appended to the previous one where
+// the database stores it that way, and as a full frontier otherwise. Only
+// the roots are hashed, so the hash does not depend on where checkpoints
+// happen to be.
+template<typename Tree, typename Hash>
+bool CCoinsViewDB::DumpAnchors(CAutoFile &file, CHashWriter &hasher, const std::vector<uint256> &vRoots, unsigned char tag, char dbFull, char dbDelta, CAnchorFrontierCache<Tree> &frontiers, uint64_t &nCount) const
+{
+    uint256 prev = Tree::empty_root();
+    for (const uint256 &rt : vRoots) {
+        if (rt == prev) {
+            continue;
+        }
+        file << tag << rt;
+        CAnchorDelta<Hash> delta;
+        if (db.Read(make_pair(dbDelta, rt), delta) && delta.parent == prev) {
+            file << (unsigned char)1 << delta.commitments;
+        } else {
+            Tree tree;
+            if (!GetAnchorAt<Tree, Hash>(rt, tree, dbFull, dbDelta, frontiers)) {
+                return error("%s: anchor %s not found", __func__, rt.GetHex());
+            }
+            file << (unsigned char)0 << tree;
+        }
+        hasher << tag << rt;
+        prev = rt;
+        nCount++;
+    }
+    return true;
+}
+
+// Reads an anchor record, checking it against the previous anchor of the
+// pool in `tree`, and queues it with the delta depth the database expects.
+template<typename Tree, typename Hash>
+bool CCoinsViewDB::LoadAnchor(CAutoFile &file, CHashWriter &hasher, CDBBatch *batch, unsigned char tag, Tree &tree, unsigned int &nDepth, char dbFull, char dbDelta) const
+{
+    uint256 rt;
+    unsigned char fDelta;
+    file >> rt >> fDelta;
+    CAnchorDelta<Hash> delta;
+    if (fDelta) {
+        file >> delta.commitments;
+        delta.parent = tree.root();
+        tree.append_batch(delta.commitments);
+    } else {
+        file >> tree;
+    }
+    if (tree.root() != rt) {
+        return error("%s: anchor %s does not match its contents", __func__, rt.GetHex());
+    }
+    hasher << tag << rt;
+
+    if (batch) {
+        if (fDelta && nDepth + 1 < ANCHOR_CHECKPOINT_INTERVAL) {
+            delta.nDepth = ++nDepth;
+            batch->Write(make_pair(dbDelta, rt), delta);
+        } else {
+            nDepth = 0;
+            batch->Write(make_pair(dbFull, rt), tree);
+        }
+    }
+    return true;
+}
+
+bool CCoinsViewDB::DumpSnapshot(CAutoFile &file, const CUTXOSnapshotMetadata &metadata,
+                                const std::vector<uint256> &vSproutRoots, const std::vector<uint256> &vSaplingRoots,
+                                CUTXOSnapshotStats &stats) const
+{
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    file << metadata;
+    hasher << metadata;
+
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(DB_COINS);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        CCoins coins;
+        if (!pcursor->GetKey(key) || key.first != DB_COINS) {
+            break;
+        }
+        if (!pcursor->GetValue(coins)) {
+            return error("%s: unable to read coins %s", __func__, key.second.GetHex());
+        }
+        file << (unsigned char)SNAPSHOT_COINS << key.second << coins;
+        hasher << (unsigned char)SNAPSHOT_COINS << key.second << coins;
+        AddCoinsToStats(stats, coins);
+        pcursor->Next();
+    }
+
+    const std::pair<char, unsigned char> nullifierSets[] = {
+        {DB_NULLIFIER, SNAPSHOT_SPROUT_NULLIFIER},
+        {DB_SAPLING_NULLIFIER, SNAPSHOT_SAPLING_NULLIFIER},
+    };
+    for (const auto& set : nullifierSets) {
+        uint64_t &nCount = set.first == DB_NULLIFIER ? stats.nSproutNullifiers : stats.nSaplingNullifiers;
+        pcursor->Seek(set.first);
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != set.first) {
+                break;
+            }
+            file << set.second << key.second;
+            hasher << set.second << key.second;
+            nCount++;
+            pcursor->Next();
+        }
+    }
+
+    if (!DumpAnchors<SproutMerkleTree, libzcash::SHA256Compress>(file, hasher, vSproutRoots, SNAPSHOT_SPROUT_ANCHOR,
+            DB_SPROUT_ANCHOR, DB_SPROUT_ANCHOR_DELTA, sproutFrontiers, stats.nSproutAnchors) ||
+        !DumpAnchors<SaplingMerkleTree, libzcash::PedersenHash>(file, hasher, vSaplingRoots, SNAPSHOT_SAPLING_ANCHOR,
+            DB_SAPLING_ANCHOR, DB_SAPLING_ANCHOR_DELTA, saplingFrontiers, stats.nSaplingAnchors)) {
+        return false;
+    }
+
+    stats.hashSnapshot = hasher.GetHash();
+    file << (unsigned char)SNAPSHOT_END << stats.hashSnapshot;
+    return true;
+}
+
+bool CCoinsViewDB::LoadSnapshot(CAutoFile &file, CUTXOSnapshotMetadata &metadata, CUTXOSnapshotStats &stats, bool fWrite)
+{
+    int64_t nStart = GetTimeMicros();
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    file >> metadata;
+    if (!metadata.IsValid()) {
+        return error("%s: not a UTXO snapshot, or an unsupported version", __func__);
+    }
+    hasher << metadata;
+
+    std::unique_ptr<CDBBatch> batch;
+    bool fReloadNullifierFilters = false;
+    if (fWrite) {
+        if (!MarkSnapshotLoading()) {
+            return false;
+        }
+        {
+            LOCK(cs_nullifierFilters);
+            fReloadNullifierFilters = sproutNullifierFilter.IsLoaded();
+            sproutNullifierFilter.Clear();
+            saplingNullifierFilter.Clear();
+        }
+
+        // The snapshot replaces whatever chainstate there was.
+        batch.reset(new CDBBatch(db));
+        boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+        for (char prefix : {DB_COINS, DB_NULLIFIER, DB_SAPLING_NULLIFIER, DB_SPROUT_ANCHOR, DB_SAPLING_ANCHOR,
+                            DB_SPROUT_ANCHOR_DELTA, DB_SAPLING_ANCHOR_DELTA}) {
+            for (pcursor->Seek(prefix); pcursor->Valid(); pcursor->Next()) {
+                std::pair<char, uint256> key;
+                if (!pcursor->GetKey(key) || key.first != prefix) {
+                    break;
+                }
+                batch->Erase(key);
+                if (batch->SizeEstimate() > UTXO_SNAPSHOT_BATCH_SIZE) {
+                    if (!db.WriteBatch(*batch)) {
+                        return false;
+                    }
+                    batch.reset(new CDBBatch(db));
+                }
+            }
+        }
+    }
+
+    SproutMerkleTree sproutTree;
+    SaplingMerkleTree saplingTree;
+    unsigned int nSproutDepth = 0;
+    unsigned int nSaplingDepth = 0;
+    while (true) {
+        boost::this_thread::interruption_point();
+        unsigned char tag;
+        file >> tag;
+        if (tag == SNAPSHOT_END) {
+            break;
+        }
+        switch (tag) {
+            case SNAPSHOT_COINS: {
+                uint256 txid;
+                CCoins coins;
+                file >> txid >> coins;
+                hasher << tag << txid << coins;
+                AddCoinsToStats(stats, coins);
+                if (batch)
+                    batch->Write(make_pair(DB_COINS, txid), coins);
+                break;
+            }
+            case SNAPSHOT_SPROUT_NULLIFIER:
+            case SNAPSHOT_SAPLING_NULLIFIER: {
+                uint256 nf;
+                file >> nf;
+                hasher << tag << nf;
+                if (tag == SNAPSHOT_SPROUT_NULLIFIER)
+                    stats.nSproutNullifiers++;
+                else
+                    stats.nSaplingNullifiers++;
+                if (batch)
+                    batch->Write(make_pair(tag == SNAPSHOT_SPROUT_NULLIFIER ? DB_NULLIFIER : DB_SAPLING_NULLIFIER, nf), true);
+                break;
+            }
+            case SNAPSHOT_SPROUT_ANCHOR:
+                if (!LoadAnchor<SproutMerkleTree, libzcash::SHA256Compress>(file, hasher, batch.get(), tag,
+                        sproutTree, nSproutDepth, DB_SPROUT_ANCHOR, DB_SPROUT_ANCHOR_DELTA))
+                    return false;
+                stats.nSproutAnchors++;
+                break;
+            case SNAPSHOT_SAPLING_ANCHOR:
+                if (!LoadAnchor<SaplingMerkleTree, libzcash::PedersenHash>(file, hasher, batch.get(), tag,
+                        saplingTree, nSaplingDepth, DB_SAPLING_ANCHOR, DB_SAPLING_ANCHOR_DELTA))
+                    return false;
+                stats.nSaplingAnchors++;
+                break;
+            default:
+                return error("%s: unknown record type %d", __func__, (int)tag);
+        }
+        if (batch && batch->SizeEstimate() > UTXO_SNAPSHOT_BATCH_SIZE) {
+            if (!db.WriteBatch(*batch)) {
+                return false;
+            }
+            batch.reset(new CDBBatch(db));
+        }
+    }
+
+    uint256 hashSnapshot;
+    file >> hashSnapshot;
+    stats.hashSnapshot = hasher.GetHash();
+    if (hashSnapshot != stats.hashSnapshot) {
+        return error("%s: snapshot hash %s does not match its contents (%s)", __func__, hashSnapshot.GetHex(), stats.hashSnapshot.GetHex());
+    }
+    if (sproutTree.root() != metadata.hashSproutAnchor || saplingTree.root() != metadata.hashSaplingAnchor) {
+        return error("%s: the last anchors do not match the best anchors of the snapshot", __func__);
+    }
+
+    if (batch) {
+        batch->Write(DB_BEST_BLOCK, metadata.hashBlock);
+        batch->Write(DB_BEST_SPROUT_ANCHOR, metadata.hashSproutAnchor);
+        batch->Write(DB_BEST_SAPLING_ANCHOR, metadata.hashSaplingAnchor);
+        batch->Erase(DB_SNAPSHOT_LOADING);
+        if (!db.WriteBatch(*batch, true)) {
+            return false;
+        }
+        if (fReloadNullifierFilters && !LoadNullifierFilters()) {
+            return false;
+        }
+    }
+
+    double nSeconds = std::max<int64_t>(GetTimeMicros() - nStart, 1) * 0.000001;
+    LogPrint(BCLog::COINDB, "%s: %s %u transactions, %u nullifiers and %u anchors in %.2fs (%.0f transactions/s)\n", __func__,
+        fWrite ? "loaded" : "checked", stats.nTransactions, stats.nSproutNullifiers + stats.nSaplingNullifiers,
+        stats.nSproutAnchors + stats.nSaplingAnchors, nSeconds, stats.nTransactions / nSeconds);
+    return true;
+}
+
+bool CCoinsViewDB::MarkSnapshotLoading() {
+    // Erased with the last batch LoadSnapshot() writes
+    return db.Write(DB_SNAPSHOT_LOADING, '1', true);
+}
+
+bool CCoinsViewDB::IsSnapshotLoadIncomplete() const {
+    return db.Exists(DB_SNAPSHOT_LOADING);
+}
+
+bool CCoinsViewDB::LoadNullifierFilters() {
+    int64_t nStart = GetTimeMillis();
+    LOCK(cs_nullifierFilters);
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+    for (char dbChar : {DB_NULLIFIER, DB_SAPLING_NULLIFIER}) {
+        CNullifierFilter &filter = dbChar == DB_NULLIFIER ? sproutNullifierFilter : saplingNullifierFilter;
+        filter.Clear();
+        for (pcursor->Seek(dbChar); pcursor->Valid(); pcursor->Next()) {
+            boost::this_thread::interruption_point();
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != dbChar) {
+                break;
+            }
+            filter.Insert(key.second);
+        }
+        filter.SetLoaded();
+    }
+
+    LogPrintf("Loaded %u Sprout and %u Sapling nullifiers into the nullifier filters (%u kB) in %dms\n",
+        sproutNullifierFilter.Size(), saplingNullifierFilter.Size(),
+        (sproutNullifierFilter.DynamicMemoryUsage() + saplingNullifierFilter.DynamicMemoryUsage()) / 1000,
+        GetTimeMillis() - nStart);
+    return true;
+}
+
+CNullifierFilterStats CCoinsViewDB::GetNullifierFilterStats(ShieldedType type) const {
+    LOCK(cs_nullifierFilters);
+    return NullifierFilter(type).GetStats();
 }
 
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
@@ -218,6 +820,19 @@ bool CBlockTreeDB::ReadReindexing(bool &fReindexing) const {
     return true;
 }
 
+bool CBlockTreeDB::WriteSnapshotBase(const uint256 &hashBlock, uint64_t nChainTx) {
+    return Write(DB_SNAPSHOT_BASE, make_pair(hashBlock, nChainTx), true);
+}
+
+bool CBlockTreeDB::ReadSnapshotBase(uint256 &hashBlock, uint64_t &nChainTx) const {
+    std::pair<uint256, uint64_t> base;
+    if (!Read(DB_SNAPSHOT_BASE, base))
+        return false;
+    hashBlock = base.first;
+    nChainTx = base.second;
+    return true;
+}
+
 bool CBlockTreeDB::ReadLastBlockFile(int &nFile) const {
     return Read(DB_LAST_BLOCK, nFile);
 }
@@ -318,6 +933,14 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::WriteCompactBlock(const CCompactBlock &block) {
+    return Write(make_pair(DB_COMPACTBLOCK, block.hash), block);
+}
+
+bool CBlockTreeDB::ReadCompactBlock(const uint256 &hash, CCompactBlock &block) const {
+    return Read(make_pair(DB_COMPACTBLOCK, hash), block);
+}
+
 // START insightexplorer
 // https://github.com/bitpay/bitcoin/commit/017f548ea6d89423ef568117447e61dd5707ec42#diff-81e4f16a1b5d5b7ca25351a63d07cb80R183
 bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDbEntry> &vect)
@@ -400,6 +1023,64 @@ bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return Read(make_pair(DB_SPENTINDEX, key), value);
 }
 
+// Orders spent index keys as leveldb stores them: by txid bytes, then by the
+// serialized, little-endian output index.
+static bool SpentIndexKeyDiskLess(const CSpentIndexKey &a, const CSpentIndexKey &b) {
+    int c = memcmp(a.txid.begin(), b.txid.begin(), a.txid.size());
+    if (c != 0)
+        return c < 0;
+    unsigned char na[4], nb[4];
+    WriteLE32(na, a.outputIndex);
+    WriteLE32(nb, b.outputIndex);
+    return memcmp(na, nb, sizeof(na)) < 0;
+}
+
+bool CBlockTreeDB::ReadSpentIndex(const std::vector<CSpentIndexKey> &keys,
+    std::vector<CSpentIndexValue> &values, unsigned int &nSeeks)
+{
+    values.assign(keys.size(), CSpentIndexValue());
+    nSeeks = 0;
+
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) {
+        return SpentIndexKeyDiskLess(keys[a], keys[b]);
+    });
+
+    // Sweep a single cursor forward through the sorted keys. The cursor
+    // always rests on the first entry at or after the previous key, so it
+    // only needs to seek when that entry comes before the next key.
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    bool fPositioned = false;
+    for (size_t n = 0; n < order.size(); n++) {
+        boost::this_thread::interruption_point();
+        const size_t i = order[n];
+        const CSpentIndexKey &key = keys[i];
+        if (n > 0 && !SpentIndexKeyDiskLess(keys[order[n - 1]], key)) {
+            values[i] = values[order[n - 1]];
+            continue;
+        }
+        std::pair<char, CSpentIndexKey> found;
+        bool fFound = fPositioned && pcursor->Valid() && pcursor->GetKey(found) && found.first == DB_SPENTINDEX;
+        if (fPositioned && !fFound)
+            break; // no spent index entries past the previous key
+        if (!fFound || SpentIndexKeyDiskLess(found.second, key)) {
+            pcursor->Seek(make_pair(DB_SPENTINDEX, key));
+            nSeeks++;
+            fPositioned = true;
+            if (!(pcursor->Valid() && pcursor->GetKey(found) && found.first == DB_SPENTINDEX))
+                break;
+        }
+        if (SpentIndexKeyDiskLess(key, found.second))
+            continue; // not spent
+        if (!pcursor->GetValue(values[i]))
+            return error("failed to get spent index value");
+        pcursor->Next();
+    }
+    return true;
+}
+
 bool CBlockTreeDB::UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect) {
     CDBBatch batch(*this);
     for (std::vector<CSpentIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
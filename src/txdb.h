@@ -9,13 +9,20 @@
 #include "coins.h"
 #include "dbwrapper.h"
 #include "chain.h"
+#include "sync.h"
+#include "utxosnapshot.h"
 
+#include <list>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+class CAutoFile;
 class CBlockIndex;
+struct CCompactBlock;
+class CHashWriter;
 
 // START insightexplorer
 struct CAddressUnspentKey;
@@ -43,6 +50,12 @@ static const int64_t nDefaultDbCache = 450;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! Max. number of consecutive anchor deltas before a full tree frontier is stored
+static const unsigned int ANCHOR_CHECKPOINT_INTERVAL = 100;
+//! Number of materialized tree frontiers CCoinsViewDB keeps per shielded pool
+static const size_t ANCHOR_FRONTIER_CACHE_SIZE = 1000;
+//! Initial number of slots in a CNullifierFilter (a power of two)
+static const size_t NULLIFIER_FILTER_MIN_SLOTS = 1 << 12;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -69,12 +82,164 @@ struct CDiskTxPos : public CDiskBlockPos
     }
 };
 
+/**
+ * A commitment tree anchor stored relative to its parent: the tree at
+ * `parent` with `commitments` appended. nDepth counts the deltas back to the
+ * nearest full frontier, which bounds the work needed to materialize it.
+ */
+template<typename Hash>
+struct CAnchorDelta
+{
+    uint256 parent;
+    unsigned int nDepth;
+    std::vector<Hash> commitments;
+
+    CAnchorDelta() : nDepth(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(parent);
+        READWRITE(VARINT(nDepth));
+        READWRITE(commitments);
+    }
+};
+
+/** Least-recently-used cache of materialized commitment trees, keyed by root. */
+template<typename Tree>
+class CAnchorFrontierCache
+{
+private:
+    typedef std::list<std::pair<uint256, Tree>> List;
+
+    size_t nMaxSize;
+    List entries; // Most recently used first
+    std::unordered_map<uint256, typename List::iterator, SaltedTxidHasher> index;
+
+public:
+    CAnchorFrontierCache(size_t nMaxSizeIn) : nMaxSize(nMaxSizeIn) {}
+
+    bool Get(const uint256 &rt, Tree &tree) {
+        auto it = index.find(rt);
+        if (it == index.end()) {
+            return false;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        tree = it->second->second;
+        return true;
+    }
+
+    void Put(const uint256 &rt, const Tree &tree) {
+        auto it = index.find(rt);
+        if (it != index.end()) {
+            it->second->second = tree;
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        entries.emplace_front(rt, tree);
+        index.emplace(rt, entries.begin());
+        if (entries.size() > nMaxSize) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    void Erase(const uint256 &rt) {
+        auto it = index.find(rt);
+        if (it != index.end()) {
+            entries.erase(it->second);
+            index.erase(it);
+        }
+    }
+};
+
+struct CNullifierFilterStats
+{
+    bool fLoaded;
+    size_t nEntries;
+    size_t nMemoryUsage;
+    //! Lookups made while the filter was loaded
+    uint64_t nQueries;
+    //! Lookups answered as definitely not spent, without a database read
+    uint64_t nNegatives;
+    //! Lookups that read the database and did not find the nullifier
+    uint64_t nFalsePositives;
+};
+
+/**
+ * Set of 64-bit salted fingerprints of the nullifiers in the coin database,
+ * in an open-addressing table. A nullifier whose fingerprint is absent is
+ * definitely not spent, which is the answer for nearly every lookup made while
+ * validating transactions, so no database read is needed. The table may hold
+ * stale fingerprints (for instance after a nullifier is written twice) but
+ * never misses one that is in the database, so a present fingerprint is only
+ * a "maybe" and is confirmed against the database.
+ */
+class CNullifierFilter
+{
+private:
+    uint64_t k0, k1;
+    std::vector<uint64_t> table; // Linear probing; 0 marks an empty slot
+    size_t nEntries;
+    bool fLoaded;
+
+    uint64_t nQueries;
+    uint64_t nNegatives;
+    uint64_t nFalsePositives;
+
+    uint64_t Fingerprint(const uint256 &nf) const;
+    size_t Slot(uint64_t fingerprint) const { return fingerprint & (table.size() - 1); }
+    void Grow();
+
+public:
+    CNullifierFilter();
+
+    //! Remove all fingerprints and mark the filter as not loaded
+    void Clear();
+    //! Until the filter is loaded every nullifier may be in the database
+    void SetLoaded() { fLoaded = true; }
+    bool IsLoaded() const { return fLoaded; }
+
+    void Insert(const uint256 &nf);
+    //! Remove one copy of the nullifier's fingerprint, which must be present
+    void Erase(const uint256 &nf);
+    //! Return false if the nullifier is definitely not in the database
+    bool MaybeContains(const uint256 &nf);
+    //! Record that a nullifier MaybeContains() accepted was not in the database
+    void RecordFalsePositive();
+
+    size_t Size() const { return nEntries; }
+    size_t DynamicMemoryUsage() const;
+    CNullifierFilterStats GetStats() const;
+};
+
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    mutable CCriticalSection cs_frontiers;
+    mutable CAnchorFrontierCache<SproutMerkleTree> sproutFrontiers;
+    mutable CAnchorFrontierCache<SaplingMerkleTree> saplingFrontiers;
+
+    mutable CCriticalSection cs_nullifierFilters;
+    mutable CNullifierFilter sproutNullifierFilter;
+    mutable CNullifierFilter saplingNullifierFilter;
+
+    CNullifierFilter &NullifierFilter(ShieldedType type) const;
+    void BatchWriteNullifiers(CDBBatch &batch, CNullifiersMap &mapToUse, char dbChar, CNullifierFilter &filter, std::vector<uint256> &vErased);
+
+    template<typename Tree, typename Hash>
+    bool GetAnchorAt(const uint256 &rt, Tree &tree, char dbFull, char dbDelta, CAnchorFrontierCache<Tree> &frontiers) const;
+    template<typename Tree, typename Hash, typename Map, typename MapEntry>
+    void BatchWriteAnchors(CDBBatch &batch, Map &mapToUse, char dbFull, char dbDelta, CAnchorFrontierCache<Tree> &frontiers, size_t &nFull, size_t &nDeltas);
+    template<typename Tree, typename Hash>
+    bool DumpAnchors(CAutoFile &file, CHashWriter &hasher, const std::vector<uint256> &vRoots, unsigned char tag, char dbFull, char dbDelta, CAnchorFrontierCache<Tree> &frontiers, uint64_t &nCount) const;
+    template<typename Tree, typename Hash>
+    bool LoadAnchor(CAutoFile &file, CHashWriter &hasher, CDBBatch *batch, unsigned char tag, Tree &tree, unsigned int &nDepth, char dbFull, char dbDelta) const;
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
@@ -94,6 +259,36 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+
+    /**
+     * Write the coins, the nullifiers and the given anchors (each pool's
+     * distinct roots in chain order) to a UTXO snapshot. The database must
+     * not be written to meanwhile.
+     */
+    bool DumpSnapshot(CAutoFile &file, const CUTXOSnapshotMetadata &metadata,
+                      const std::vector<uint256> &vSproutRoots, const std::vector<uint256> &vSaplingRoots,
+                      CUTXOSnapshotStats &stats) const;
+    /**
+     * Read a UTXO snapshot and check its hash and anchors. If fWrite is set,
+     * its contents also replace the coins, nullifiers and anchors in the
+     * database; the best block and anchors are only written at the end.
+     */
+    bool LoadSnapshot(CAutoFile &file, CUTXOSnapshotMetadata &metadata, CUTXOSnapshotStats &stats, bool fWrite);
+    /**
+     * Mark the database unusable until a LoadSnapshot() that writes to it
+     * completes. LoadSnapshot() does this itself; callers that record the
+     * snapshot elsewhere first call it before doing so.
+     */
+    bool MarkSnapshotLoading();
+    //! Whether a LoadSnapshot() that writes to the database was interrupted
+    bool IsSnapshotLoadIncomplete() const;
+
+    /**
+     * Fill the in-memory nullifier filters from the database. Until this is
+     * called every GetNullifier() reads the database.
+     */
+    bool LoadNullifierFilters();
+    CNullifierFilterStats GetNullifierFilterStats(ShieldedType type) const;
 };
 
 /** Access to the block database (blocks/index/) */
@@ -111,9 +306,13 @@ public:
     bool ReadLastBlockFile(int &nFile) const;
     bool WriteReindexing(bool fReindexing);
     bool ReadReindexing(bool &fReindexing) const;
+    bool WriteSnapshotBase(const uint256 &hashBlock, uint64_t nChainTx);
+    bool ReadSnapshotBase(uint256 &hashBlock, uint64_t &nChainTx) const;
     bool ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex) const;
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) const;
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
+    bool WriteCompactBlock(const CCompactBlock &block);
+    bool ReadCompactBlock(const uint256 &hash, CCompactBlock &block) const;
 
     // START insightexplorer
     bool UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDbEntry> &vect);
@@ -122,6 +321,11 @@ public:
     bool EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &vect);
     bool ReadAddressIndex(uint160 addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0);
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) const;
+    /** Look up many spent index entries with one forward sweep of a single
+     *  cursor, in the database's key order. values receives a null entry for
+     *  each unspent output, and nSeeks the number of cursor seeks made. */
+    bool ReadSpentIndex(const std::vector<CSpentIndexKey> &keys,
+            std::vector<CSpentIndexValue> &values, unsigned int &nSeeks);
     bool UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(unsigned int high, unsigned int low,
@@ -24,12 +24,12 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _nHeight,
                                  bool poolHasNoInputsOf, bool _spendsCoinbase,
                                  unsigned int _sigOps, uint32_t _nBranchId):
-    tx(_tx), nFee(_nFee), nTime(_nTime), nHeight(_nHeight),
+    tx(std::make_shared<const CTransaction>(_tx)), nFee(_nFee), nTime(_nTime), nHeight(_nHeight),
     hadNoDependencies(poolHasNoInputsOf), spendsCoinbase(_spendsCoinbase),
     sigOpCount(_sigOps), nBranchId(_nBranchId)
 {
-    nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-    nUsageSize = RecursiveDynamicUsage(tx);
+    nTxSize = ::GetSerializeSize(*tx, SER_NETWORK, PROTOCOL_VERSION);
+    nUsageSize = memusage::DynamicUsage(tx) + RecursiveDynamicUsage(*tx);
 
     feeDelta = 0;
 
@@ -154,6 +154,7 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
             mapTx.modify(it, set_dirty());
         }
     }
+    nChanges++;
 }
 
 bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents /* = true */)
@@ -308,7 +309,7 @@ void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
 }
 
 CTxMemPool::CTxMemPool(const CFeeRate& _minReasonableRelayFee) :
-    nTransactionsUpdated(0)
+    nTransactionsUpdated(0), nChanges(0), nSnapshotInterval(DEFAULT_MEMPOOL_SNAPSHOT_INTERVAL)
 {
     _clear(); // unlocked clear
 
@@ -414,6 +415,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     }
 
     nTransactionsUpdated++;
+    nChanges++;
     totalTxSize += entry.GetTxSize();
     minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
 
@@ -512,6 +514,20 @@ bool CTxMemPool::getSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &valu
     return false;
 }
 
+size_t CTxMemPool::getSpentIndex(const std::vector<CSpentIndexKey> &keys, std::vector<CSpentIndexValue> &values)
+{
+    LOCK(cs);
+    size_t nFound = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare>::iterator it = mapSpent.find(keys[i]);
+        if (it != mapSpent.end()) {
+            values[i] = it->second;
+            nFound++;
+        }
+    }
+    return nFound;
+}
+
 void CTxMemPool::removeSpentIndex(const uint256 txhash)
 {
     LOCK(cs);
@@ -529,6 +545,7 @@ void CTxMemPool::removeSpentIndex(const uint256 txhash)
 
 void CTxMemPool::removeUnchecked(txiter it)
 {
+    NotifyEntryRemoved(*it);
     const uint256 hash = it->GetTx().GetHash();
     mapRecentlyAddedTx.erase(hash);
     for (const CTxIn& txin : it->GetTx().vin)
@@ -548,6 +565,7 @@ void CTxMemPool::removeUnchecked(txiter it)
     mapLinks.erase(it);
     mapTx.erase(it);
     nTransactionsUpdated++;
+    nChanges++;
     minerPolicyEstimator->removeTx(hash);
 
     // insightexplorer
@@ -814,6 +832,7 @@ void CTxMemPool::_clear()
     totalTxSize = 0;
     cachedInnerUsage = 0;
     ++nTransactionsUpdated;
+    ++nChanges;
 }
 
 void CTxMemPool::clear()
@@ -1027,6 +1046,43 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
     std::sort(vtxid.begin(), vtxid.end(), DepthAndScoreComparator(this));
 }
 
+std::shared_ptr<const CTxMemPoolSnapshot> CTxMemPool::GetSnapshot() const
+{
+    LOCK(cs_snapshot);
+    if (snapshot && (snapshot->nChanges == nChanges ||
+                     GetTimeMillis() - snapshot->nTimeMillis < nSnapshotInterval))
+        return snapshot;
+
+    std::shared_ptr<CTxMemPoolSnapshot> next = std::make_shared<CTxMemPoolSnapshot>();
+    {
+        LOCK(cs);
+        next->nChanges = nChanges;
+        next->vEntries.reserve(mapTx.size());
+        // The mining score index is in the order queryHashes sorts into
+        for (const CTxMemPoolEntry& e : mapTx.get<mining_score>()) {
+            CTxMemPoolSnapshot::Entry entry;
+            entry.hash = e.GetTx().GetHash();
+            entry.nTxSize = e.GetTxSize();
+            entry.nFee = e.GetFee();
+            entry.nModifiedFee = e.GetModifiedFee();
+            entry.nTime = e.GetTime();
+            entry.nHeight = e.GetHeight();
+            entry.nCountWithDescendants = e.GetCountWithDescendants();
+            entry.nSizeWithDescendants = e.GetSizeWithDescendants();
+            entry.nModFeesWithDescendants = e.GetModFeesWithDescendants();
+            for (const CTxIn& txin : e.GetTx().vin) {
+                if (mapTx.count(txin.prevout.hash) &&
+                    std::find(entry.vDepends.begin(), entry.vDepends.end(), txin.prevout.hash) == entry.vDepends.end())
+                    entry.vDepends.push_back(txin.prevout.hash);
+            }
+            next->vEntries.push_back(std::move(entry));
+        }
+    }
+    next->nTimeMillis = GetTimeMillis();
+    snapshot = next;
+    return snapshot;
+}
+
 bool CTxMemPool::lookup(uint256 hash, CTransaction& result) const
 {
     LOCK(cs);
@@ -1036,6 +1092,20 @@ bool CTxMemPool::lookup(uint256 hash, CTransaction& result) const
     return true;
 }
 
+bool CTxMemPool::lookupForRelay(const uint256& hash, int nNextBlockHeight, CDataStream& ss, bool& fExpiringSoon) const
+{
+    LOCK(cs);
+    indexed_transaction_set::const_iterator i = mapTx.find(hash);
+    if (i == mapTx.end())
+        return false;
+    fExpiringSoon = IsExpiringSoonTx(i->GetTx(), nNextBlockHeight);
+    if (!fExpiringSoon) {
+        ss.reserve(i->GetTxSize());
+        ss << i->GetTx();
+    }
+    return true;
+}
+
 bool CTxMemPool::lookupFeeRate(const uint256& hash, CFeeRate& feeRate) const
 {
     LOCK(cs);
@@ -1103,6 +1173,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256 hash, const std::string str
             for (txiter ancestorIt : setAncestors) {
                 mapTx.modify(ancestorIt, update_descendant_state(0, nFeeDelta, 0));
             }
+            nChanges++;
         }
     }
     LogPrintf("PrioritiseTransaction: %s feerate += %s\n", strHash, FormatMoney(nFeeDelta));
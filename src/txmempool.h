@@ -6,7 +6,9 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <atomic>
 #include <list>
+#include <memory>
 #include <set>
 
 #include "amount.h"
@@ -22,8 +24,10 @@
 #include "boost/multi_index_container.hpp"
 #include "boost/multi_index/ordered_index.hpp"
 #include "boost/multi_index/hashed_index.hpp"
+#include <boost/signals2/signal.hpp>
 
 class CAutoFile;
+class CDataStream;
 
 /** Version from which we write `fee_estimates.dat` without priority information: 5.5.0-beta1 or later */
 static const int FEE_ESTIMATES_WITHOUT_PRIORITY_VERSION = 5050000;
@@ -31,6 +35,9 @@ static const int FEE_ESTIMATES_WITHOUT_PRIORITY_VERSION = 5050000;
 /** Fake height value used in CCoins to signify they are only in the memory pool (since 0.8) */
 static const unsigned int MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
+/** Default for -mempoolsnapshotinterval, in milliseconds */
+static const int64_t DEFAULT_MEMPOOL_SNAPSHOT_INTERVAL = 0;
+
 class CTxMemPool;
 
 /** \class CTxMemPoolEntry
@@ -53,7 +60,7 @@ class CTxMemPool;
 class CTxMemPoolEntry
 {
 private:
-    CTransaction tx;
+    std::shared_ptr<const CTransaction> tx;
     CAmount nFee;              //!< Cached to avoid expensive parent-transaction lookups
     size_t nTxSize;            //!< ... and avoid recomputing tx size
     size_t nUsageSize;         //!< ... and total memory usage
@@ -81,7 +88,8 @@ public:
                     unsigned int nSigOps, uint32_t nBranchId);
     CTxMemPoolEntry(const CTxMemPoolEntry& other);
 
-    const CTransaction& GetTx() const { return this->tx; }
+    const CTransaction& GetTx() const { return *this->tx; }
+    std::shared_ptr<const CTransaction> GetSharedTx() const { return this->tx; }
     /**
      * Fast calculation of lower bound of current priority as update
      * from entry priority. Only inputs that were originally in-chain will age.
@@ -245,6 +253,37 @@ public:
     size_t DynamicMemoryUsage() const { return 0; }
 };
 
+/**
+ * An immutable copy of the state of the mempool's transactions at one
+ * moment, which RPC and REST replies listing the mempool read without
+ * holding the mempool lock. See CTxMemPool::GetSnapshot.
+ */
+class CTxMemPoolSnapshot
+{
+public:
+    struct Entry
+    {
+        uint256 hash;
+        size_t nTxSize;
+        CAmount nFee;
+        CAmount nModifiedFee;
+        int64_t nTime;
+        unsigned int nHeight;
+        uint64_t nCountWithDescendants;
+        uint64_t nSizeWithDescendants;
+        CAmount nModFeesWithDescendants;
+        //! In-mempool transactions whose outputs this one spends
+        std::vector<uint256> vDepends;
+    };
+
+    //! Entries in the order of CTxMemPool::queryHashes
+    std::vector<Entry> vEntries;
+    //! Number of changes to the mempool the snapshot includes
+    uint64_t nChanges;
+    //! When the snapshot was taken
+    int64_t nTimeMillis;
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain
  * transactions that may be included in the next block.
@@ -327,6 +366,11 @@ class CTxMemPool
 private:
     uint32_t nCheckFrequency;   //!< Value n means that n times in 2^32 we check.
     unsigned int nTransactionsUpdated;
+    //! Changes to the entries of mapTx, to tell whether a snapshot is current
+    std::atomic<uint64_t> nChanges;
+    int64_t nSnapshotInterval;
+    mutable CCriticalSection cs_snapshot;
+    mutable std::shared_ptr<const CTxMemPoolSnapshot> snapshot;
     CBlockPolicyEstimator* minerPolicyEstimator;
 
     uint64_t totalTxSize = 0;   //!< sum of all mempool tx' byte sizes
@@ -443,6 +487,8 @@ public:
 
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool getSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
+    /** Fill in values[i] for each of keys spent in the mempool; returns how many were */
+    size_t getSpentIndex(const std::vector<CSpentIndexKey> &keys, std::vector<CSpentIndexValue> &values);
     void removeSpentIndex(const uint256 txhash);
     // END insightexplorer
 
@@ -458,6 +504,15 @@ public:
     void _clear(); // unlocked
     bool CompareDepthAndScore(const uint256& hasha, const uint256& hashb);
     void queryHashes(std::vector<uint256>& vtxid);
+    /**
+     * Return a snapshot of the mempool's transactions. The last snapshot is
+     * reused while the mempool is unchanged, or while it is younger than the
+     * snapshot interval; otherwise a new one is taken, briefly holding the
+     * mempool lock to copy the entries.
+     */
+    std::shared_ptr<const CTxMemPoolSnapshot> GetSnapshot() const;
+    /** Set how long, in milliseconds, a snapshot may be reused after the mempool changes */
+    void SetSnapshotInterval(int64_t nMillis) { nSnapshotInterval = nMillis; }
     void pruneSpent(const uint256& hash, CCoins &coins);
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
@@ -527,6 +582,12 @@ public:
 
     bool lookup(uint256 hash, CTransaction& result) const;
     bool lookupFeeRate(const uint256& hash, CFeeRate& feeRate) const;
+    /** Look up a transaction to relay it to a peer, serializing it into ss
+     *  only if it isn't expiring soon at nNextBlockHeight. */
+    bool lookupForRelay(const uint256& hash, int nNextBlockHeight, CDataStream& ss, bool& fExpiringSoon) const;
+
+    /** Called with cs held whenever a transaction leaves the mempool */
+    boost::signals2::signal<void (const CTxMemPoolEntry&)> NotifyEntryRemoved;
 
     /** Estimate fee rate needed to get into the next nBlocks */
     CFeeRate estimateFee(int nBlocks) const;
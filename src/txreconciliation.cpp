@@ -0,0 +1,218 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "txreconciliation.h"
+
+#include "hash.h"
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <string>
+
+// Finalizer of MurmurHash3, spreading the bits of an already salted short
+// ID so that each sub-table and the checksum see independent values.
+static uint32_t Mix(uint32_t key, uint32_t seed)
+{
+    uint32_t h = key ^ (seed * 0x9e3779b9);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint32_t Checksum(uint32_t key)
+{
+    return Mix(key, CReconSketch::NUM_HASHES + 1);
+}
+
+CReconSketch::CReconSketch(size_t nCells) : vCells(nCells)
+{
+    assert(IsValid());
+}
+
+size_t CReconSketch::CellsForDifference(size_t nDiff)
+{
+    // With two cells per ID, plus a few so that small differences rarely
+    // collide in every sub-table, about 97% of sketches decode; the rest
+    // fall back to flooding.
+    size_t nPerTable = (nDiff * 2 + NUM_HASHES - 1) / NUM_HASHES + 3;
+    return std::min(nPerTable * NUM_HASHES, MAX_SKETCH_CELLS);
+}
+
+size_t CReconSketch::CellIndex(uint32_t key, size_t nHash) const
+{
+    size_t nPerTable = vCells.size() / NUM_HASHES;
+    return nHash * nPerTable + Mix(key, nHash) % nPerTable;
+}
+
+void CReconSketch::Toggle(uint32_t key)
+{
+    uint32_t hash = Checksum(key);
+    for (size_t i = 0; i < NUM_HASHES; i++) {
+        Cell& cell = vCells[CellIndex(key, i)];
+        cell.keySum ^= key;
+        cell.hashSum ^= hash;
+    }
+}
+
+void CReconSketch::Add(uint32_t key)
+{
+    assert(key != 0);
+    if (!vCells.empty())
+        Toggle(key);
+}
+
+bool CReconSketch::Merge(const CReconSketch& other)
+{
+    if (other.vCells.size() != vCells.size())
+        return false;
+    for (size_t i = 0; i < vCells.size(); i++) {
+        vCells[i].keySum ^= other.vCells[i].keySum;
+        vCells[i].hashSum ^= other.vCells[i].hashSum;
+    }
+    return true;
+}
+
+bool CReconSketch::Decode(std::vector<uint32_t>& vKeys) const
+{
+    vKeys.clear();
+    if (!IsValid())
+        return false;
+
+    CReconSketch sketch(*this);
+    std::set<uint32_t> setSeen;
+    std::vector<size_t> vPure;
+    for (size_t i = 0; i < sketch.vCells.size(); i++)
+        vPure.push_back(i);
+
+    while (!vPure.empty()) {
+        const Cell& cell = sketch.vCells[vPure.back()];
+        vPure.pop_back();
+        if (cell.keySum == 0 || cell.hashSum != Checksum(cell.keySum))
+            continue;
+
+        uint32_t key = cell.keySum;
+        // A cell that only looked pure can make us extract an ID twice
+        if (!setSeen.insert(key).second)
+            return false;
+        vKeys.push_back(key);
+
+        sketch.Toggle(key);
+        for (size_t i = 0; i < NUM_HASHES; i++)
+            vPure.push_back(sketch.CellIndex(key, i));
+    }
+
+    for (const Cell& cell : sketch.vCells) {
+        if (cell.keySum != 0 || cell.hashSum != 0)
+            return false;
+    }
+    return true;
+}
+
+size_t EstimateReconDifference(size_t nLocal, size_t nRemote, double q)
+{
+    size_t nMin = std::min(nLocal, nRemote);
+    size_t nMax = std::max(nLocal, nRemote);
+    return nMax - nMin + (size_t)(q * nMin) + 1;
+}
+
+void ComputeReconSalt(uint64_t nSalt1, uint64_t nSalt2, uint64_t& k0, uint64_t& k1)
+{
+    // Both sides must derive the same keys, whichever salt is theirs.
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << std::string("Tx Relay Salting") << std::min(nSalt1, nSalt2) << std::max(nSalt1, nSalt2);
+    uint256 hash = ss.GetHash();
+    k0 = hash.GetUint64(0);
+    k1 = hash.GetUint64(1);
+}
+
+CTxReconciliationState::CTxReconciliationState(uint64_t nLocalSaltIn) :
+    nLocalSalt(nLocalSaltIn), fRegistered(false), fInitiator(false), fFlood(false), k0(0), k1(0),
+    fRoundInFlight(false), nRoundTimeout(0), fTimedOut(false), nNextRequest(0), dQ(DEFAULT_RECON_Q)
+{
+}
+
+void CTxReconciliationState::Register(uint64_t nRemoteSalt, bool fInitiatorIn, bool fFloodIn)
+{
+    ComputeReconSalt(nLocalSalt, nRemoteSalt, k0, k1);
+    fInitiator = fInitiatorIn;
+    fFlood = fFloodIn;
+    fRegistered = true;
+}
+
+uint32_t CTxReconciliationState::GetShortID(const uint256& txid) const
+{
+    return (uint32_t)CSipHasher(k0, k1).Write(txid.begin(), txid.size()).Finalize();
+}
+
+bool CTxReconciliationState::AddTx(const uint256& txid)
+{
+    if (mapSet.size() >= MAX_RECON_SET_SIZE)
+        return false;
+    uint32_t nShortID = GetShortID(txid);
+    if (nShortID == 0)
+        return false;
+    std::pair<std::map<uint32_t, uint256>::iterator, bool> ret = mapSet.insert(std::make_pair(nShortID, txid));
+    return ret.second || ret.first->second == txid;
+}
+
+void CTxReconciliationState::RemoveTx(const uint256& txid)
+{
+    std::map<uint32_t, uint256>::iterator it = mapSet.find(GetShortID(txid));
+    if (it != mapSet.end() && it->second == txid)
+        mapSet.erase(it);
+}
+
+void CTxReconciliationState::Snapshot(int64_t nNow)
+{
+    assert(mapSnapshot.empty());
+    mapSnapshot.swap(mapSet);
+    fRoundInFlight = true;
+    nRoundTimeout = nNow + RECON_RESPONSE_TIMEOUT * 1000000LL;
+}
+
+CReconSketch CTxReconciliationState::GetSketch(size_t nCells) const
+{
+    CReconSketch sketch(nCells);
+    for (const std::pair<uint32_t, uint256>& item : mapSnapshot)
+        sketch.Add(item.first);
+    return sketch;
+}
+
+void CTxReconciliationState::UpdateQ(size_t nLocalOnly, size_t nRemoteOnly)
+{
+    size_t nLocal = mapSnapshot.size();
+    size_t nRemote = nLocal - nLocalOnly + nRemoteOnly;
+    size_t nMin = std::min(nLocal, nRemote);
+    if (nMin == 0)
+        return;
+    size_t nSizeDiff = std::max(nLocal, nRemote) - nMin;
+    double q = (double)(nLocalOnly + nRemoteOnly - nSizeDiff) / nMin;
+    dQ = std::min(q, (double)std::numeric_limits<uint16_t>::max() / RECON_Q_SCALE);
+}
+
+std::vector<uint256> CTxReconciliationState::EndRound()
+{
+    std::vector<uint256> vTxid;
+    vTxid.reserve(mapSnapshot.size());
+    for (const std::pair<uint32_t, uint256>& item : mapSnapshot)
+        vTxid.push_back(item.second);
+    mapSnapshot.clear();
+    fRoundInFlight = false;
+    return vTxid;
+}
+
+std::vector<uint256> CTxReconciliationState::TimeOut()
+{
+    std::vector<uint256> vTxid = EndRound();
+    for (const std::pair<uint32_t, uint256>& item : mapSet)
+        vTxid.push_back(item.second);
+    mapSet.clear();
+    fRegistered = false;
+    fTimedOut = true;
+    return vTxid;
+}
@@ -0,0 +1,159 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_TXRECONCILIATION_H
+#define BITCOIN_TXRECONCILIATION_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+/** Version of the transaction reconciliation protocol we speak */
+static const uint32_t TXRECONCILIATION_VERSION = 1;
+/** Default for -txreconciliation */
+static const bool DEFAULT_TXRECONCILIATION = false;
+/** Seconds between the reconciliation rounds an initiator starts with a peer */
+static const unsigned int RECON_REQUEST_INTERVAL = 8;
+/** Seconds a peer has to answer a reconciliation round before we flood its
+ *  transactions and stop reconciling with that peer */
+static const unsigned int RECON_RESPONSE_TIMEOUT = 20;
+/** Maximum number of transactions waiting to be reconciled with one peer;
+ *  further transactions are flooded instead. */
+static const size_t MAX_RECON_SET_SIZE = 3000;
+/** Maximum number of cells in a sketch, sized for the largest difference we
+ *  expect to decode. Larger differences fall back to flooding. */
+static const size_t MAX_SKETCH_CELLS = 3 * 2048;
+/** Number of outbound reconciling peers we keep flooding transactions to, so
+ *  they still propagate quickly across the network. */
+static const unsigned int OUTBOUND_FANOUT_DESTINATIONS = 2;
+/** Fixed point scale of the q coefficient sent with reconciliation requests */
+static const uint16_t RECON_Q_SCALE = 1 << 14;
+/** Initial estimate of q, refined after every successful round */
+static const double DEFAULT_RECON_Q = 0.25;
+
+/**
+ * An invertible Bloom lookup table over 32-bit short transaction IDs.
+ *
+ * Every ID is XORed into one cell of each of three equally sized
+ * sub-tables, together with a checksum of it. XORing the sketches of two
+ * sets cancels the IDs they share, and the symmetric difference can then
+ * be recovered by repeatedly peeling cells that hold a single ID, as long
+ * as the sketch has sufficiently more cells than the difference has IDs.
+ */
+class CReconSketch
+{
+public:
+    static const size_t NUM_HASHES = 3;
+
+    struct Cell {
+        uint32_t keySum;
+        uint32_t hashSum;
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(keySum);
+            READWRITE(hashSum);
+        }
+
+        Cell() : keySum(0), hashSum(0) {}
+    };
+
+private:
+    std::vector<Cell> vCells;
+
+    size_t CellIndex(uint32_t key, size_t nHash) const;
+    void Toggle(uint32_t key);
+
+public:
+    explicit CReconSketch(size_t nCells = 0);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(vCells);
+    }
+
+    /** Number of cells a sketch needs to decode a difference of nDiff IDs */
+    static size_t CellsForDifference(size_t nDiff);
+
+    size_t GetCells() const { return vCells.size(); }
+    /** Whether the sketch has a layout Add(), Merge() and Decode() accept */
+    bool IsValid() const { return vCells.size() % NUM_HASHES == 0 && vCells.size() <= MAX_SKETCH_CELLS; }
+
+    /** Add a non-zero short ID to the sketch */
+    void Add(uint32_t key);
+    /** XOR another sketch of the same size into this one */
+    bool Merge(const CReconSketch& other);
+    /** Recover the IDs in the sketch; fails if it cannot be fully peeled */
+    bool Decode(std::vector<uint32_t>& vKeys) const;
+};
+
+/** Estimate the size of the difference between two sets from their sizes
+ *  and the q coefficient, as in Erlay. */
+size_t EstimateReconDifference(size_t nLocal, size_t nRemote, double q);
+
+/** Derive the short ID keys of a connection from both sides' salts. */
+void ComputeReconSalt(uint64_t nSalt1, uint64_t nSalt2, uint64_t& k0, uint64_t& k1);
+
+/**
+ * Reconciliation state of a peer, protected by its cs_inventory.
+ *
+ * Transactions to announce are collected in mapSet, keyed by short ID.
+ * When a round starts they move to mapSnapshot, which is what the sketches
+ * of the round describe; transactions arriving meanwhile go to the next one.
+ */
+struct CTxReconciliationState
+{
+    //! Salt we sent in our sendtxrcncl
+    uint64_t nLocalSalt;
+    //! Whether the peer sent its sendtxrcncl too, so we reconcile with it
+    bool fRegistered;
+    //! Whether we start the rounds (we made the connection) or answer them
+    bool fInitiator;
+    //! Whether we flood to this peer instead, as one of our fanout peers
+    bool fFlood;
+    uint64_t k0, k1;
+
+    std::map<uint32_t, uint256> mapSet;
+    std::map<uint32_t, uint256> mapSnapshot;
+    //! Whether a round with mapSnapshot is in progress
+    bool fRoundInFlight;
+    //! Time by which the peer must answer the round in progress, in microseconds
+    int64_t nRoundTimeout;
+    //! Whether the peer let a round time out, so we flood to it instead
+    bool fTimedOut;
+    //! Time of the next request we initiate, in microseconds
+    int64_t nNextRequest;
+    double dQ;
+
+    explicit CTxReconciliationState(uint64_t nLocalSaltIn);
+
+    void Register(uint64_t nRemoteSalt, bool fInitiatorIn, bool fFloodIn);
+
+    uint32_t GetShortID(const uint256& txid) const;
+    /** Queue a transaction for the next round. Returns false if it should
+     *  be flooded instead, because the set is full or its short ID clashes. */
+    bool AddTx(const uint256& txid);
+    /** Forget a transaction the peer already knows about */
+    void RemoveTx(const uint256& txid);
+    /** Start a round with the transactions queued so far */
+    void Snapshot(int64_t nNow);
+    /** Sketch of the snapshot with the given number of cells */
+    CReconSketch GetSketch(size_t nCells) const;
+    /** Refine q from the difference a successful round found */
+    void UpdateQ(size_t nLocalOnly, size_t nRemoteOnly);
+    /** End the round, returning the snapshot's transactions */
+    std::vector<uint256> EndRound();
+    /** Stop reconciling after the round timed out, returning every
+     *  transaction still waiting to be announced */
+    std::vector<uint256> TimeOut();
+};
+
+#endif // BITCOIN_TXRECONCILIATION_H
@@ -0,0 +1,102 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_UTXOSNAPSHOT_H
+#define BITCOIN_UTXOSNAPSHOT_H
+
+#include "amount.h"
+#include "protocol.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * A UTXO snapshot (written by dumptxoutset, read by loadtxoutset) is a
+ * CUTXOSnapshotMetadata followed by a sequence of records, each starting with
+ * a UTXOSnapshotRecord tag:
+ *
+ * - SNAPSHOT_COINS: txid, CCoins
+ * - SNAPSHOT_SPROUT_NULLIFIER, SNAPSHOT_SAPLING_NULLIFIER: nullifier
+ * - SNAPSHOT_SPROUT_ANCHOR, SNAPSHOT_SAPLING_ANCHOR: root, then either 1 and
+ *   the commitments appended to the previous anchor of the same pool, or 0
+ *   and the full tree. Anchors are in the order they were added to the chain.
+ * - SNAPSHOT_END: the snapshot hash.
+ *
+ * Coins and nullifiers are in chainstate key order, so the snapshot hash
+ * (over the metadata, the coins and nullifier records, and the anchor roots)
+ * is the same on every node that dumps the same block.
+ */
+static const int UTXO_SNAPSHOT_VERSION = 1;
+static const unsigned char UTXO_SNAPSHOT_MAGIC[4] = {'u', 't', 'x', 'o'};
+//! Size of the database batches written while loading a snapshot
+static const size_t UTXO_SNAPSHOT_BATCH_SIZE = 16 << 20;
+
+enum UTXOSnapshotRecord : unsigned char {
+    SNAPSHOT_COINS = 'c',
+    SNAPSHOT_SPROUT_NULLIFIER = 's',
+    SNAPSHOT_SAPLING_NULLIFIER = 'S',
+    SNAPSHOT_SPROUT_ANCHOR = 'A',
+    SNAPSHOT_SAPLING_ANCHOR = 'Z',
+    SNAPSHOT_END = 'e',
+};
+
+/** Header of a UTXO snapshot: the block whose chainstate it contains. */
+class CUTXOSnapshotMetadata
+{
+public:
+    unsigned char pchMagic[4];
+    int nVersion;
+    unsigned char pchMessageStart[MESSAGE_START_SIZE];
+    uint256 hashBlock;
+    int nHeight;
+    //! nChainTx of the block, which cannot be recomputed without its ancestors
+    uint64_t nChainTx;
+    uint256 hashSproutAnchor;
+    uint256 hashSaplingAnchor;
+
+    CUTXOSnapshotMetadata() : nVersion(UTXO_SNAPSHOT_VERSION), nHeight(0), nChainTx(0)
+    {
+        memcpy(pchMagic, UTXO_SNAPSHOT_MAGIC, sizeof(pchMagic));
+        memset(pchMessageStart, 0, sizeof(pchMessageStart));
+    }
+
+    bool IsValid() const
+    {
+        return memcmp(pchMagic, UTXO_SNAPSHOT_MAGIC, sizeof(pchMagic)) == 0 && nVersion == UTXO_SNAPSHOT_VERSION;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(FLATDATA(pchMagic));
+        READWRITE(nVersion);
+        READWRITE(FLATDATA(pchMessageStart));
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(nChainTx);
+        READWRITE(hashSproutAnchor);
+        READWRITE(hashSaplingAnchor);
+    }
+};
+
+/** What a UTXO snapshot contains, as counted while writing or reading it. */
+struct CUTXOSnapshotStats
+{
+    uint64_t nTransactions;
+    uint64_t nTransactionOutputs;
+    CAmount nTotalAmount;
+    uint64_t nSproutNullifiers;
+    uint64_t nSaplingNullifiers;
+    uint64_t nSproutAnchors;
+    uint64_t nSaplingAnchors;
+    uint256 hashSnapshot;
+
+    CUTXOSnapshotStats() : nTransactions(0), nTransactionOutputs(0), nTotalAmount(0),
+                           nSproutNullifiers(0), nSaplingNullifiers(0), nSproutAnchors(0), nSaplingAnchors(0) {}
+};
+
+#endif // BITCOIN_UTXOSNAPSHOT_H
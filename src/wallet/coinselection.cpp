@@ -0,0 +1,244 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "wallet/coinselection.h"
+
+#include "random.h"
+#include "util.h"
+#include "utilmoneystr.h"
+#include "wallet/wallet.h"
+
+#include <algorithm>
+
+bool SelectCoinsBnB(const std::vector<CSelectionCoin>& vCoins, const CAmount& nTarget, const CAmount& nCostOfChange,
+                    std::vector<size_t>& vSelectedRet, CAmount& nValueRet)
+{
+    vSelectedRet.clear();
+    nValueRet = 0;
+
+    CAmount nAvailable = 0;
+    for (const CSelectionCoin& coin : vCoins)
+        nAvailable += coin.nValue;
+    if (nAvailable < nTarget)
+        return false;
+
+    // Depth first search over the coins in order, where each level decides
+    // whether to include the next coin. vCurrent holds those decisions.
+    std::vector<bool> vCurrent;
+    vCurrent.reserve(vCoins.size());
+    std::vector<bool> vBest;
+    CAmount nCurrent = 0;
+    CAmount nBestExcess = MAX_MONEY;
+
+    for (size_t nTries = 0; nTries < BNB_MAX_TRIES; nTries++) {
+        bool fBacktrack = false;
+        if (nCurrent + nAvailable < nTarget || nCurrent > nTarget + nCostOfChange) {
+            // This branch cannot reach the target, or overshoots it
+            fBacktrack = true;
+        } else if (nCurrent >= nTarget) {
+            if (nCurrent - nTarget <= nBestExcess) {
+                vBest = vCurrent;
+                nBestExcess = nCurrent - nTarget;
+                if (nBestExcess == 0)
+                    break;
+            }
+            fBacktrack = true;
+        }
+
+        if (fBacktrack) {
+            // Undo the trailing exclusions, then exclude the last included coin
+            while (!vCurrent.empty() && !vCurrent.back()) {
+                vCurrent.pop_back();
+                nAvailable += vCoins[vCurrent.size()].nValue;
+            }
+            if (vCurrent.empty())
+                break;
+            vCurrent.back() = false;
+            nCurrent -= vCoins[vCurrent.size() - 1].nValue;
+        } else {
+            const CSelectionCoin& coin = vCoins[vCurrent.size()];
+            nAvailable -= coin.nValue;
+            // Including a coin worth the same as one we just excluded would
+            // only repeat the branch we just explored
+            if (!vCurrent.empty() && !vCurrent.back() && coin.nValue == vCoins[vCurrent.size() - 1].nValue) {
+                vCurrent.push_back(false);
+            } else {
+                vCurrent.push_back(true);
+                nCurrent += coin.nValue;
+            }
+        }
+    }
+
+    if (vBest.empty())
+        return false;
+    for (size_t i = 0; i < vBest.size(); i++) {
+        if (vBest[i]) {
+            vSelectedRet.push_back(i);
+            nValueRet += vCoins[i].nValue;
+        }
+    }
+    return true;
+}
+
+static void ApproximateBestSubset(const std::vector<CAmount>& vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
+                                  std::vector<char>& vfBest, CAmount& nBest, int iterations)
+{
+    std::vector<char> vfIncluded;
+
+    vfBest.assign(vValue.size(), true);
+    nBest = nTotalLower;
+
+    FastRandomContext insecure_rand;
+
+    for (int nRep = 0; nRep < iterations && nBest != nTargetValue; nRep++)
+    {
+        vfIncluded.assign(vValue.size(), false);
+        CAmount nTotal = 0;
+        bool fReachedTarget = false;
+        for (int nPass = 0; nPass < 2 && !fReachedTarget; nPass++)
+        {
+            for (unsigned int i = 0; i < vValue.size(); i++)
+            {
+                //The solver here uses a randomized algorithm,
+                //the randomness serves no real security purpose but is just
+                //needed to prevent degenerate behavior and it is important
+                //that the rng is fast. We do not use a constant random sequence,
+                //because there may be some privacy improvement by making
+                //the selection random.
+                if (nPass == 0 ? insecure_rand.randbool() : !vfIncluded[i])
+                {
+                    nTotal += vValue[i];
+                    vfIncluded[i] = true;
+                    if (nTotal >= nTargetValue)
+                    {
+                        fReachedTarget = true;
+                        if (nTotal < nBest)
+                        {
+                            nBest = nTotal;
+                            vfBest = vfIncluded;
+                        }
+                        nTotal -= vValue[i];
+                        vfIncluded[i] = false;
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool SelectCoinsFromPool(const std::vector<CSelectionCoin>& vCoins, int nConfMine, int nConfTheirs,
+                         const CAmount& nTarget, const CAmount& nCostOfChange,
+                         std::vector<size_t>& vSelectedRet, CAmount& nValueRet)
+{
+    vSelectedRet.clear();
+    nValueRet = 0;
+
+    std::vector<size_t> vEligible;
+    vEligible.reserve(vCoins.size());
+    for (size_t i = 0; i < vCoins.size(); i++) {
+        if (vCoins[i].nDepth >= (vCoins[i].fFromMe ? nConfMine : nConfTheirs))
+            vEligible.push_back(i);
+    }
+
+    // Look for a selection that needs no change first
+    if (nCostOfChange > 0) {
+        std::vector<CSelectionCoin> vPositive;
+        for (size_t i : vEligible) {
+            if (vCoins[i].nEffectiveValue > 0)
+                vPositive.push_back(vCoins[i]);
+        }
+        std::vector<size_t> vSelected;
+        if (SelectCoinsBnB(vPositive, nTarget, nCostOfChange, vSelected, nValueRet)) {
+            for (size_t i : vSelected)
+                vSelectedRet.push_back(vPositive[i].nPos);
+            LogPrint(BCLog::SELECTCOINS, "SelectCoins() branch and bound: %u coins, total %s\n",
+                vSelected.size(), FormatMoney(nValueRet));
+            return true;
+        }
+        nValueRet = 0;
+    }
+
+    // List of values less than target, largest first
+    std::vector<size_t> vLower;
+    std::vector<CAmount> vLowerValue;
+    CAmount nTotalLower = 0;
+    const CSelectionCoin* pLowestLarger = NULL;
+
+    for (size_t i : vEligible)
+    {
+        const CSelectionCoin& coin = vCoins[i];
+        if (coin.nValue == nTarget)
+        {
+            vSelectedRet.push_back(coin.nPos);
+            nValueRet += coin.nValue;
+            return true;
+        }
+        else if (coin.nValue < nTarget + MIN_CHANGE)
+        {
+            vLower.push_back(coin.nPos);
+            vLowerValue.push_back(coin.nValue);
+            nTotalLower += coin.nValue;
+        }
+        else
+        {
+            // Coins are sorted by descending value, so the last is the smallest
+            pLowestLarger = &coin;
+        }
+    }
+
+    if (nTotalLower == nTarget)
+    {
+        vSelectedRet = vLower;
+        nValueRet = nTotalLower;
+        return true;
+    }
+
+    if (nTotalLower < nTarget)
+    {
+        if (pLowestLarger == NULL)
+            return false;
+        vSelectedRet.push_back(pLowestLarger->nPos);
+        nValueRet += pLowestLarger->nValue;
+        return true;
+    }
+
+    // Solve subset sum by stochastic approximation, within a bounded amount
+    // of work however many coins there are
+    int nIterations = std::max<size_t>(1, std::min<size_t>(KNAPSACK_ITERATIONS, KNAPSACK_MAX_WORK / vLowerValue.size()));
+    std::vector<char> vfBest;
+    CAmount nBest;
+
+    ApproximateBestSubset(vLowerValue, nTotalLower, nTarget, vfBest, nBest, nIterations);
+    if (nBest != nTarget && nTotalLower >= nTarget + MIN_CHANGE)
+        ApproximateBestSubset(vLowerValue, nTotalLower, nTarget + MIN_CHANGE, vfBest, nBest, nIterations);
+
+    // If we have a bigger coin and (either the stochastic approximation didn't find a good solution,
+    //                                   or the next bigger coin is closer), return the bigger coin
+    if (pLowestLarger &&
+        ((nBest != nTarget && nBest < nTarget + MIN_CHANGE) || pLowestLarger->nValue <= nBest))
+    {
+        vSelectedRet.push_back(pLowestLarger->nPos);
+        nValueRet += pLowestLarger->nValue;
+    }
+    else {
+        for (unsigned int i = 0; i < vLower.size(); i++)
+            if (vfBest[i])
+            {
+                vSelectedRet.push_back(vLower[i]);
+                nValueRet += vLowerValue[i];
+            }
+
+        if (LogAcceptCategory(BCLog::SELECTCOINS)) {
+            LogPrint(BCLog::SELECTCOINS, "SelectCoins() best subset: ");
+            for (unsigned int i = 0; i < vLower.size(); i++) {
+                if (vfBest[i]) {
+                    LogPrint(BCLog::SELECTCOINS, "%s ", FormatMoney(vLowerValue[i]));
+                }
+            }
+            LogPrint(BCLog::SELECTCOINS, "total %s\n", FormatMoney(nBest));
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2026 The BitcoinZ Community
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_WALLET_COINSELECTION_H
+#define BITCOIN_WALLET_COINSELECTION_H
+
+#include "amount.h"
+
+#include <stdint.h>
+#include <vector>
+
+/** Estimated size of a transparent input spending a P2PKH output */
+static const uint32_t P2PKH_INPUT_SIZE = 148;
+/** Maximum number of branches the branch and bound search explores */
+static const size_t BNB_MAX_TRIES = 100000;
+/** Rough number of coin visits the stochastic fallback may spend on its
+ *  random passes, so that selecting from very large pools stays bounded */
+static const size_t KNAPSACK_MAX_WORK = 10000000;
+/** Iterations of the stochastic fallback on pools small enough */
+static const int KNAPSACK_ITERATIONS = 1000;
+
+/**
+ * A coin available for selection, reduced to what the selection algorithms
+ * need. nPos identifies the coin in the caller's own list.
+ */
+struct CSelectionCoin
+{
+    CAmount nValue;
+    //! nValue less the fee for spending it at the wallet's minimum fee rate
+    CAmount nEffectiveValue;
+    int nDepth;
+    uint32_t nSize;
+    //! Whether the coin was created by one of our own transactions
+    bool fFromMe;
+    size_t nPos;
+};
+
+/**
+ * Search for a subset of vCoins whose value lies within [nTarget, nTarget +
+ * nCostOfChange], so that no change output is needed, preferring the least
+ * excess. vCoins must be sorted by descending value. Gives up after
+ * BNB_MAX_TRIES branches. Returns indices into vCoins.
+ */
+bool SelectCoinsBnB(const std::vector<CSelectionCoin>& vCoins, const CAmount& nTarget, const CAmount& nCostOfChange,
+                    std::vector<size_t>& vSelectedRet, CAmount& nValueRet);
+
+/**
+ * Select coins confirmed at least nConfMine times, or nConfTheirs times if not
+ * created by us, worth at least nTarget from vCoins, which must be sorted by
+ * descending value.
+ *
+ * When nCostOfChange is set, a selection that needs no change is searched for
+ * first with SelectCoinsBnB, using only coins whose effective value is
+ * positive. Otherwise coins are picked like before: an exact match, all
+ * smaller coins if they add up to the target, or the closest of a stochastic
+ * subset sum approximation and the smallest larger coin. Returns indices into
+ * vCoins.
+ */
+bool SelectCoinsFromPool(const std::vector<CSelectionCoin>& vCoins, int nConfMine, int nConfTheirs,
+                         const CAmount& nTarget, const CAmount& nCostOfChange,
+                         std::vector<size_t>& vSelectedRet, CAmount& nValueRet);
+
+#endif // BITCOIN_WALLET_COINSELECTION_H
@@ -150,6 +150,60 @@ TEST(WalletTests, SproutNoteDataSerialisation) {
 }
 
 
+TEST(WalletTests, GetFilteredNotesCachesDecryptedNotes) {
+    CWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+    auto sk = libzcash::SproutSpendingKey::random();
+    auto sk2 = libzcash::SproutSpendingKey::random();
+    wallet.AddSproutSpendingKey(sk);
+    wallet.AddSproutSpendingKey(sk2);
+
+    auto wtx = GetValidSproutReceive(sk, 10, true);
+    auto note = GetSproutNote(sk, wtx, 0, 1);
+
+    mapSproutNoteData_t noteData;
+    JSOutPoint jsoutpt {wtx.GetHash(), 0, 1};
+    SproutNoteData nd {sk.address(), note.nullifier(sk)};
+    noteData[jsoutpt] = nd;
+    wtx.SetSproutNoteData(noteData);
+    wallet.AddToWallet(wtx, true, NULL);
+
+    // The transaction is indexed under the address of its note
+    ASSERT_EQ(1, wallet.mapSproutAddressTxs.count(sk.address()));
+    EXPECT_EQ(1, wallet.mapSproutAddressTxs[sk.address()].count(wtx.GetHash()));
+    EXPECT_EQ(0, wallet.mapSproutAddressTxs.count(sk2.address()));
+    EXPECT_FALSE(wallet.mapWallet[wtx.GetHash()].mapSproutNoteData[jsoutpt].decrypted);
+
+    // Fetching the note decrypts it once and caches the plaintext
+    std::vector<SproutNoteEntry> sproutEntries;
+    std::vector<SaplingNoteEntry> saplingEntries;
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, "", -1);
+    ASSERT_EQ(1, sproutEntries.size());
+    EXPECT_EQ(note.value(), sproutEntries[0].note.value());
+    auto decrypted = wallet.mapWallet[wtx.GetHash()].mapSproutNoteData[jsoutpt].decrypted;
+    ASSERT_TRUE(decrypted);
+    EXPECT_EQ(note.value(), decrypted->note.value());
+    EXPECT_EQ(sk.address(), decrypted->address);
+    EXPECT_EQ(sproutEntries[0].memo, decrypted->memo);
+    sproutEntries.clear();
+
+    // Later calls use the cached note
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, "", -1);
+    ASSERT_EQ(1, sproutEntries.size());
+    EXPECT_EQ(note.value(), sproutEntries[0].note.value());
+    EXPECT_EQ(decrypted, wallet.mapWallet[wtx.GetHash()].mapSproutNoteData[jsoutpt].decrypted);
+    sproutEntries.clear();
+
+    // Filtering by address only finds the notes of that address
+    std::set<libzcash::PaymentAddress> filterAddresses {sk.address()};
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, filterAddresses, -1, INT_MAX, true, true, false);
+    EXPECT_EQ(1, sproutEntries.size());
+    sproutEntries.clear();
+    filterAddresses = {sk2.address()};
+    wallet.GetFilteredNotes(sproutEntries, saplingEntries, filterAddresses, -1, INT_MAX, true, true, false);
+    EXPECT_EQ(0, sproutEntries.size());
+}
+
 TEST(WalletTests, FindUnspentSproutNotes) {
     auto consensusParams = RegtestActivateSapling();
 
@@ -2142,3 +2196,70 @@ TEST(WalletTests, SaplingNoteLocking) {
     EXPECT_FALSE(wallet.IsLockedNote(sop1));
     EXPECT_FALSE(wallet.IsLockedNote(sop2));
 }
+
+TEST(WalletTests, BalanceOnlyVisitsUnsettledTransactions) {
+    SelectParams(CBaseChainParams::REGTEST);
+
+    TestWallet wallet;
+    LOCK2(cs_main, wallet.cs_wallet);
+
+    CKey tsk = AddTestCKeyToKeyStore(wallet);
+    auto scriptPubKey = GetScriptForDestination(tsk.GetPubKey().GetID());
+
+    // A transaction paying us, and one spending that output back to us
+    CMutableTransaction mtxReceive;
+    mtxReceive.vin.resize(1);
+    mtxReceive.vin[0].prevout = COutPoint(libzcash::random_uint256(), 0);
+    mtxReceive.vout.resize(1);
+    mtxReceive.vout[0].nValue = 90*CENT;
+    mtxReceive.vout[0].scriptPubKey = scriptPubKey;
+    CWalletTx wtxReceive {nullptr, mtxReceive};
+
+    CMutableTransaction mtxSpend;
+    mtxSpend.vin.resize(1);
+    mtxSpend.vin[0].prevout = COutPoint(wtxReceive.GetHash(), 0);
+    mtxSpend.vout.resize(1);
+    mtxSpend.vout[0].nValue = 80*CENT;
+    mtxSpend.vout[0].scriptPubKey = scriptPubKey;
+    CWalletTx wtxSpend {nullptr, mtxSpend};
+
+    // Fake-mine both
+    CBlock block;
+    block.vtx.push_back(wtxReceive);
+    block.vtx.push_back(wtxSpend);
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    auto blockHash = block.GetHash();
+    CBlockIndex fakeIndex {block};
+    mapBlockIndex.insert(std::make_pair(blockHash, &fakeIndex));
+    chainActive.SetTip(&fakeIndex);
+
+    wtxReceive.SetMerkleBranch(block);
+    wtxSpend.SetMerkleBranch(block);
+    wallet.AddToWallet(wtxReceive, true, NULL);
+    wallet.AddToWallet(wtxSpend, true, NULL);
+
+    // The received output is spent in the main chain, so only the spend counts
+    auto vTxs = wallet.GetUnsettledTxs();
+    ASSERT_EQ(1, vTxs.size());
+    EXPECT_EQ(wtxSpend.GetHash(), vTxs[0]->GetHash());
+    EXPECT_EQ(80*CENT, wallet.GetBalance());
+    std::vector<COutput> vCoins;
+    wallet.AvailableCoins(vCoins);
+    ASSERT_EQ(1, vCoins.size());
+    EXPECT_EQ(wtxSpend.GetHash(), vCoins[0].tx->GetHash());
+
+    // Disconnecting the block unspends the received output again once the
+    // wallet is told about the spend
+    chainActive.SetTip(NULL);
+    wallet.MarkAffectedTransactionsDirty(wtxSpend);
+    EXPECT_EQ(2, wallet.GetUnsettledTxs().size());
+    EXPECT_EQ(0, wallet.GetBalance());
+
+    chainActive.SetTip(&fakeIndex);
+    EXPECT_EQ(1, wallet.GetUnsettledTxs().size());
+    EXPECT_EQ(80*CENT, wallet.GetBalance());
+
+    // Tear down
+    chainActive.SetTip(NULL);
+    mapBlockIndex.erase(blockHash);
+}
@@ -2246,6 +2246,18 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
         } else if (benchmarktype == "incsaplingnotewitnesses") {
             int nTxs = params[2].getInt<int>();
             sample_times.push_back(benchmark_increment_sapling_note_witnesses(nTxs));
+        } else if (benchmarktype == "sprouttreeappend" || benchmarktype == "saplingtreeappend") {
+            // Number of leaves to append, and whether to use append_batch()
+            int nLeaves = 10000;
+            if (params.size() >= 3) {
+                nLeaves = params[2].getInt<int>();
+            }
+            bool fBatch = params.size() >= 4 && params[3].get_bool();
+            if (benchmarktype == "sprouttreeappend") {
+                sample_times.push_back(benchmark_sprout_tree_append(nLeaves, fBatch));
+            } else {
+                sample_times.push_back(benchmark_sapling_tree_append(nLeaves, fBatch));
+            }
         } else if (benchmarktype == "connectblockslow") {
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
@@ -2264,6 +2276,8 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             sample_times.push_back(benchmark_loadwallet());
         } else if (benchmarktype == "listunspent") {
             sample_times.push_back(benchmark_listunspent());
+        } else if (benchmarktype == "zgettotalbalance") {
+            sample_times.push_back(benchmark_z_gettotalbalance());
         } else if (benchmarktype == "createsaplingspend") {
             sample_times.push_back(benchmark_create_sapling_spend());
         } else if (benchmarktype == "createsaplingoutput") {
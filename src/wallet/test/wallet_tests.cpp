@@ -327,4 +327,72 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(coin_selection_bnb_tests)
+{
+    CoinSet setCoinsRet;
+    CAmount nValueRet;
+
+    LOCK(wallet.cs_wallet);
+
+    empty_wallet();
+    add_coin(7 * CENT);
+    add_coin(7 * CENT / 2);
+    add_coin(50 * CENT);
+
+    // without a cost of change, 10.5 cents is too little change to make,
+    // so the smallest larger coin is picked...
+    BOOST_CHECK(wallet.SelectCoinsMinConf(10 * CENT, 1, 6, vCoins, setCoinsRet, nValueRet));
+    BOOST_CHECK_EQUAL(nValueRet, 50 * CENT);
+
+    // ...while branch and bound takes the overshoot instead of any change
+    BOOST_CHECK(wallet.SelectCoinsMinConf(10 * CENT, 1, 6, vCoins, setCoinsRet, nValueRet, CENT));
+    BOOST_CHECK_EQUAL(nValueRet, 21 * CENT / 2);
+    BOOST_CHECK_EQUAL(setCoinsRet.size(), 2U);
+
+    // but not beyond the cost of change
+    BOOST_CHECK(wallet.SelectCoinsMinConf(10 * CENT, 1, 6, vCoins, setCoinsRet, nValueRet, CENT / 4));
+    BOOST_CHECK_EQUAL(nValueRet, 50 * CENT);
+
+    // coins not worth the fee to spend them are left to the fallback
+    empty_wallet();
+    add_coin(1);
+    add_coin(1);
+    BOOST_CHECK(wallet.SelectCoinsMinConf(2, 1, 6, vCoins, setCoinsRet, nValueRet, 1));
+    BOOST_CHECK_EQUAL(nValueRet, 2);
+
+    empty_wallet();
+}
+
+BOOST_AUTO_TEST_CASE(coin_selection_cost_of_change)
+{
+    CoinSet setCoinsRet;
+    CAmount nValueRet;
+
+    LOCK(wallet.cs_wallet);
+
+    CScript scriptPubKey = GetScriptForDestination(CKeyID());
+    const CAmount nDustThreshold = CTxOut(0, scriptPubKey).GetDustThreshold();
+    std::vector<CRecipient> vecSend = {{scriptPubKey, 10 * CENT, false}, {scriptPubKey, 5 * CENT, false}};
+    BOOST_CHECK_EQUAL(CWallet::GetCostOfChange(vecSend), nDustThreshold);
+
+    // a recipient paying the fee would also pay for any overshoot
+    vecSend[1].fSubtractFeeFromAmount = true;
+    BOOST_CHECK_EQUAL(CWallet::GetCostOfChange(vecSend), 0);
+
+    empty_wallet();
+    add_coin(10 * CENT);
+    add_coin(5 * CENT + nDustThreshold / 2);
+    add_coin(20 * CENT);
+
+    // the overshoot is added to the fee when the sender pays it...
+    BOOST_CHECK(wallet.SelectCoinsMinConf(15 * CENT, 1, 6, vCoins, setCoinsRet, nValueRet, nDustThreshold));
+    BOOST_CHECK_EQUAL(nValueRet, 15 * CENT + nDustThreshold / 2);
+
+    // ...but change is made when the recipients do
+    BOOST_CHECK(wallet.SelectCoinsMinConf(15 * CENT, 1, 6, vCoins, setCoinsRet, nValueRet, CWallet::GetCostOfChange(vecSend)));
+    BOOST_CHECK_EQUAL(nValueRet, 20 * CENT);
+
+    empty_wallet();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -27,6 +27,7 @@
 #include "utilmoneystr.h"
 #include "zcash/Note.hpp"
 #include "crypter.h"
+#include "wallet/coinselection.h"
 #include "wallet/asyncrpcoperation_saplingmigration.h"
 
 #include <algorithm>
@@ -60,15 +61,6 @@ CFeeRate CWallet::minTxFee = CFeeRate(DEFAULT_TRANSACTION_MINFEE);
  * @{
  */
 
-struct CompareValueOnly
-{
-    bool operator()(const pair<CAmount, pair<const CWalletTx*, unsigned int> >& t1,
-                    const pair<CAmount, pair<const CWalletTx*, unsigned int> >& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
 std::string JSOutPoint::ToString() const
 {
     return strprintf("JSOutPoint(%s, %d, %d)", hash.ToString().substr(0,10), js, n);
@@ -1649,8 +1641,10 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
-        for (std::pair<const uint256, CWalletTx>& item : mapWallet)
+        for (std::pair<const uint256, CWalletTx>& item : mapWallet) {
             item.second.MarkDirty();
+            setUnsettledTxs.insert(item.first);
+        }
     }
 }
 
@@ -1714,6 +1708,22 @@ void CWallet::UpdateNullifierNoteMapWithTx(const CWalletTx& wtx)
     }
 }
 
+/**
+ * Record the Sprout addresses and Sapling incoming viewing keys wtx holds
+ * notes for in mapSproutAddressTxs and mapSaplingIvkTxs.
+ */
+void CWallet::UpdateNoteIndexWithTx(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    uint256 hash = wtx.GetHash();
+    for (const mapSproutNoteData_t::value_type& item : wtx.mapSproutNoteData) {
+        mapSproutAddressTxs[item.second.address].insert(hash);
+    }
+    for (const mapSaplingNoteData_t::value_type& item : wtx.mapSaplingNoteData) {
+        mapSaplingIvkTxs[item.second.ivk].insert(hash);
+    }
+}
+
 /**
  * Update mapSaplingNullifiersToNotes, computing the nullifier from a cached witness if necessary.
  */
@@ -1784,7 +1794,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         wtx.BindWallet(this);
         wtxOrdered.insert(make_pair(wtx.nOrderPos, &wtx));
         UpdateNullifierNoteMapWithTx(mapWallet[hash]);
+        UpdateNoteIndexWithTx(wtx);
         AddToSpends(hash);
+        setUnsettledTxs.insert(hash);
     }
     else
     {
@@ -1865,6 +1877,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
                 fUpdated = true;
             }
         }
+        UpdateNoteIndexWithTx(wtx);
+        setUnsettledTxs.insert(hash);
 
         //// debug print
         LogPrintf("AddToWallet %s  %s%s\n", wtxIn.GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
@@ -1906,6 +1920,10 @@ bool CWallet::UpdatedNoteData(const CWalletTx& wtxIn, CWalletTx& wtx)
                             nd.second.witnesses.cbegin(), nd.second.witnesses.cend());
                 }
                 tmp.at(nd.first).witnessHeight = nd.second.witnessHeight;
+                // and the decrypted note, if the note still has the same address
+                if (tmp.at(nd.first).address == nd.second.address) {
+                    tmp.at(nd.first).decrypted = nd.second.decrypted;
+                }
             }
         }
         // Now copy over the updated note data
@@ -1924,6 +1942,10 @@ bool CWallet::UpdatedNoteData(const CWalletTx& wtxIn, CWalletTx& wtx)
                             nd.second.witnesses.cbegin(), nd.second.witnesses.cend());
                 }
                 tmp.at(nd.first).witnessHeight = nd.second.witnessHeight;
+                // and the decrypted note, if it is still ours under the same key
+                if (tmp.at(nd.first).ivk == nd.second.ivk) {
+                    tmp.at(nd.first).decrypted = nd.second.decrypted;
+                }
             }
         }
 
@@ -2003,8 +2025,10 @@ void CWallet::MarkAffectedTransactionsDirty(const CTransaction& tx)
     // recomputed, also:
     for (const CTxIn& txin : tx.vin)
     {
-        if (mapWallet.count(txin.prevout.hash))
+        if (mapWallet.count(txin.prevout.hash)) {
             mapWallet[txin.prevout.hash].MarkDirty();
+            setUnsettledTxs.insert(txin.prevout.hash);
+        }
     }
     for (const JSDescription& jsdesc : tx.vJoinSplit) {
         for (const uint256& nullifier : jsdesc.nullifiers) {
@@ -2030,8 +2054,24 @@ void CWallet::EraseFromWallet(const uint256 &hash)
         return;
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        std::map<uint256, CWalletTx>::iterator it = mapWallet.find(hash);
+        if (it != mapWallet.end()) {
+            for (const mapSproutNoteData_t::value_type& item : it->second.mapSproutNoteData) {
+                mapSproutAddressTxs[item.second.address].erase(hash);
+            }
+            for (const mapSaplingNoteData_t::value_type& item : it->second.mapSaplingNoteData) {
+                mapSaplingIvkTxs[item.second.ivk].erase(hash);
+            }
+            // The outputs it spent may be unspent again
+            for (const CTxIn& txin : it->second.vin) {
+                if (mapWallet.count(txin.prevout.hash)) {
+                    setUnsettledTxs.insert(txin.prevout.hash);
+                }
+            }
+            setUnsettledTxs.erase(hash);
+            mapWallet.erase(it);
             CWalletDB(strWalletFile).EraseTx(hash);
+        }
     }
     return;
 }
@@ -3216,14 +3256,52 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime)
  */
 
 
+bool CWallet::IsSettled(const CWalletTx& wtx) const
+{
+    uint256 hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.vout.size(); i++) {
+        if (IsMine(wtx.vout[i]) == ISMINE_NO)
+            continue;
+        bool fSpent = false;
+        std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(COutPoint(hash, i));
+        for (TxSpends::const_iterator it = range.first; it != range.second && !fSpent; ++it) {
+            std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+            fSpent = mit != mapWallet.end() && mit->second.GetDepthInMainChain() >= 1;
+        }
+        if (!fSpent)
+            return false;
+    }
+    return true;
+}
+
+std::vector<const CWalletTx*> CWallet::GetUnsettledTxs() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    // Spends in the main chain can only be undone by disconnecting blocks,
+    // after which the wallet is notified of the spending transactions and
+    // adds the transactions they spend back here.
+    std::vector<const CWalletTx*> vTxs;
+    for (std::set<uint256>::iterator it = setUnsettledTxs.begin(); it != setUnsettledTxs.end();) {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(*it);
+        if (mit == mapWallet.end() || IsSettled(mit->second)) {
+            it = setUnsettledTxs.erase(it);
+        } else {
+            vTxs.push_back(&mit->second);
+            ++it;
+        }
+    }
+    return vTxs;
+}
+
 CAmount CWallet::GetBalance(const isminefilter& filter, const int min_depth) const
 {
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
+        for (const CWalletTx* pcoin : GetUnsettledTxs())
         {
-            const CWalletTx* pcoin = &entry.second;
             if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() >= min_depth) {
                 nTotal += pcoin->GetAvailableCredit(true, filter);
             }
@@ -3238,9 +3316,8 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
+        for (const CWalletTx* pcoin : GetUnsettledTxs())
         {
-            const CWalletTx* pcoin = &entry.second;
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -3253,9 +3330,8 @@ CAmount CWallet::GetImmatureBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
+        for (const CWalletTx* pcoin : GetUnsettledTxs())
         {
-            const CWalletTx* pcoin = &entry.second;
             nTotal += pcoin->GetImmatureCredit();
         }
     }
@@ -3267,9 +3343,8 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
+        for (const CWalletTx* pcoin : GetUnsettledTxs())
         {
-            const CWalletTx* pcoin = &entry.second;
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableCredit(true, ISMINE_WATCH_ONLY);
         }
@@ -3282,9 +3357,8 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
+        for (const CWalletTx* pcoin : GetUnsettledTxs())
         {
-            const CWalletTx* pcoin = &entry.second;
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
     }
@@ -3336,10 +3410,9 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetUnsettledTxs())
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const uint256& wtxid = pcoin->GetHash();
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -3360,8 +3433,8 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
                 isminetype mine = IsMine(pcoin->vout[i]);
                 if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected((*it).first, i)))
+                    !IsLockedCoin(wtxid, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
+                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(wtxid, i)))
                     vCoins.push_back(COutput(pcoin, i, nDepth,
                                              ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
                                               (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO)));
@@ -3370,158 +3443,55 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
     }
 }
 
-static void ApproximateBestSubset(vector<pair<CAmount, pair<const CWalletTx*,unsigned int> > >vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
-                                  vector<char>& vfBest, CAmount& nBest, int iterations = 1000)
-{
-    vector<char> vfIncluded;
-
-    vfBest.assign(vValue.size(), true);
-    nBest = nTotalLower;
-
-    FastRandomContext insecure_rand;
-
-    for (int nRep = 0; nRep < iterations && nBest != nTargetValue; nRep++)
-    {
-        vfIncluded.assign(vValue.size(), false);
-        CAmount nTotal = 0;
-        bool fReachedTarget = false;
-        for (int nPass = 0; nPass < 2 && !fReachedTarget; nPass++)
-        {
-            for (unsigned int i = 0; i < vValue.size(); i++)
-            {
-                //The solver here uses a randomized algorithm,
-                //the randomness serves no real security purpose but is just
-                //needed to prevent degenerate behavior and it is important
-                //that the rng is fast. We do not use a constant random sequence,
-                //because there may be some privacy improvement by making
-                //the selection random.
-                if (nPass == 0 ? insecure_rand.randbool() : !vfIncluded[i])
-                {
-                    nTotal += vValue[i].first;
-                    vfIncluded[i] = true;
-                    if (nTotal >= nTargetValue)
-                    {
-                        fReachedTarget = true;
-                        if (nTotal < nBest)
-                        {
-                            nBest = nTotal;
-                            vfBest = vfIncluded;
-                        }
-                        nTotal -= vValue[i].first;
-                        vfIncluded[i] = false;
-                    }
-                }
-            }
-        }
-    }
-}
-
-bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, vector<COutput> vCoins,
-                                 set<pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet) const
+/**
+ * Reduce the spendable coins in vCoins to a selection pool, shuffled and then
+ * sorted by descending value so that coins of equal value come in random order.
+ */
+static void BuildSelectionPool(const vector<COutput>& vCoins, vector<CSelectionCoin>& vPoolRet)
 {
-    setCoinsRet.clear();
-    nValueRet = 0;
-
-    // List of values less than target
-    pair<CAmount, pair<const CWalletTx*,unsigned int> > coinLowestLarger;
-    coinLowestLarger.first = std::numeric_limits<CAmount>::max();
-    coinLowestLarger.second.first = NULL;
-    vector<pair<CAmount, pair<const CWalletTx*,unsigned int> > > vValue;
-    CAmount nTotalLower = 0;
-
-    std::shuffle(vCoins.begin(), vCoins.end(), ZcashRandomEngine());
-
-    for (const COutput &output : vCoins)
+    vPoolRet.clear();
+    vPoolRet.reserve(vCoins.size());
+    const CAmount nInputFee = CWallet::minTxFee.GetFee(P2PKH_INPUT_SIZE);
+    for (size_t i = 0; i < vCoins.size(); i++)
     {
+        const COutput& output = vCoins[i];
         if (!output.fSpendable)
             continue;
 
-        const CWalletTx *pcoin = output.tx;
-
-        if (output.nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs))
-            continue;
-
-        int i = output.i;
-        CAmount n = pcoin->vout[i].nValue;
-
-        pair<CAmount,pair<const CWalletTx*,unsigned int> > coin = make_pair(n,make_pair(pcoin, i));
-
-        if (n == nTargetValue)
-        {
-            setCoinsRet.insert(coin.second);
-            nValueRet += coin.first;
-            return true;
-        }
-        else if (n < nTargetValue + MIN_CHANGE)
-        {
-            vValue.push_back(coin);
-            nTotalLower += n;
-        }
-        else if (n < coinLowestLarger.first)
-        {
-            coinLowestLarger = coin;
-        }
-    }
-
-    if (nTotalLower == nTargetValue)
-    {
-        for (unsigned int i = 0; i < vValue.size(); ++i)
-        {
-            setCoinsRet.insert(vValue[i].second);
-            nValueRet += vValue[i].first;
-        }
-        return true;
+        CSelectionCoin coin;
+        coin.nValue = output.tx->vout[output.i].nValue;
+        coin.nEffectiveValue = coin.nValue - nInputFee;
+        coin.nDepth = output.nDepth;
+        coin.nSize = P2PKH_INPUT_SIZE;
+        coin.fFromMe = output.tx->IsFromMe(ISMINE_ALL);
+        coin.nPos = i;
+        vPoolRet.push_back(coin);
     }
 
-    if (nTotalLower < nTargetValue)
-    {
-        if (coinLowestLarger.second.first == NULL)
-            return false;
-        setCoinsRet.insert(coinLowestLarger.second);
-        nValueRet += coinLowestLarger.first;
-        return true;
-    }
-
-    // Solve subset sum by stochastic approximation
-    sort(vValue.rbegin(), vValue.rend(), CompareValueOnly());
-    vector<char> vfBest;
-    CAmount nBest;
-
-    ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest);
-    if (nBest != nTargetValue && nTotalLower >= nTargetValue + MIN_CHANGE)
-        ApproximateBestSubset(vValue, nTotalLower, nTargetValue + MIN_CHANGE, vfBest, nBest);
+    std::shuffle(vPoolRet.begin(), vPoolRet.end(), ZcashRandomEngine());
+    std::stable_sort(vPoolRet.begin(), vPoolRet.end(), [](const CSelectionCoin& a, const CSelectionCoin& b) {
+        return a.nValue > b.nValue;
+    });
+}
 
-    // If we have a bigger coin and (either the stochastic approximation didn't find a good solution,
-    //                                   or the next bigger coin is closer), return the bigger coin
-    if (coinLowestLarger.second.first &&
-        ((nBest != nTargetValue && nBest < nTargetValue + MIN_CHANGE) || coinLowestLarger.first <= nBest))
-    {
-        setCoinsRet.insert(coinLowestLarger.second);
-        nValueRet += coinLowestLarger.first;
-    }
-    else {
-        for (unsigned int i = 0; i < vValue.size(); i++)
-            if (vfBest[i])
-            {
-                setCoinsRet.insert(vValue[i].second);
-                nValueRet += vValue[i].first;
-            }
+bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, const vector<COutput>& vCoins,
+                                 set<pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CAmount& nCostOfChange) const
+{
+    setCoinsRet.clear();
+    nValueRet = 0;
 
-        if (LogAcceptCategory(BCLog::SELECTCOINS)) {
-            LogPrint(BCLog::SELECTCOINS, "SelectCoins() best subset: ");
-            for (unsigned int i = 0; i < vValue.size(); i++) {
-                if (vfBest[i]) {
-                    LogPrint(BCLog::SELECTCOINS, "%s ", FormatMoney(vValue[i].first));
-                }
-            }
-            LogPrint(BCLog::SELECTCOINS, "total %s\n", FormatMoney(nBest));
-        }
-    }
+    vector<CSelectionCoin> vPool;
+    BuildSelectionPool(vCoins, vPool);
 
+    vector<size_t> vSelected;
+    if (!SelectCoinsFromPool(vPool, nConfMine, nConfTheirs, nTargetValue, nCostOfChange, vSelected, nValueRet))
+        return false;
+    for (size_t nPos : vSelected)
+        setCoinsRet.insert(make_pair(vCoins[nPos].tx, vCoins[nPos].i));
     return true;
 }
 
-bool CWallet::SelectCoins(const CAmount& nTargetValue, set<pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet,  bool& fOnlyCoinbaseCoinsRet, bool& fNeedCoinbaseCoinsRet, const CCoinControl* coinControl) const
+bool CWallet::SelectCoins(const CAmount& nTargetValue, set<pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet,  bool& fOnlyCoinbaseCoinsRet, bool& fNeedCoinbaseCoinsRet, const CAmount& nCostOfChange, const CCoinControl* coinControl) const
 {
     // Output parameter fOnlyCoinbaseCoinsRet is set to true when the only available coins are coinbase utxos.
     vector<COutput> vCoinsNoCoinbase, vCoinsWithCoinbase;
@@ -3598,12 +3568,20 @@ bool CWallet::SelectCoins(const CAmount& nTargetValue, set<pair<const CWalletTx*
             ++it;
     }
 
+    // Build the selection pool once for all confirmation passes.
+    vector<CSelectionCoin> vPool;
+    BuildSelectionPool(vCoins, vPool);
+    const CAmount nTarget = nTargetValue - nValueFromPresetInputs;
+
+    vector<size_t> vSelected;
     bool res = nTargetValue <= nValueFromPresetInputs ||
-        SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 6, vCoins, setCoinsRet, nValueRet) ||
-        SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 1, vCoins, setCoinsRet, nValueRet) ||
-        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, vCoins, setCoinsRet, nValueRet));
+        SelectCoinsFromPool(vPool, 1, 6, nTarget, nCostOfChange, vSelected, nValueRet) ||
+        SelectCoinsFromPool(vPool, 1, 1, nTarget, nCostOfChange, vSelected, nValueRet) ||
+        (bSpendZeroConfChange && SelectCoinsFromPool(vPool, 0, 1, nTarget, nCostOfChange, vSelected, nValueRet));
+    for (size_t nPos : vSelected)
+        setCoinsRet.insert(make_pair(vCoins[nPos].tx, vCoins[nPos].i));
 
-    // because SelectCoinsMinConf clears the setCoinsRet, we now add the possible inputs to the coinset
+    // now add the possible preset inputs to the coinset
     setCoinsRet.insert(setPresetCoins.begin(), setPresetCoins.end());
 
     // add preset inputs to the total value selected
@@ -3612,6 +3590,16 @@ bool CWallet::SelectCoins(const CAmount& nTargetValue, set<pair<const CWalletTx*
     return res;
 }
 
+CAmount CWallet::GetCostOfChange(const vector<CRecipient>& vecSend)
+{
+    for (const CRecipient& recipient : vecSend)
+    {
+        if (recipient.fSubtractFeeFromAmount)
+            return 0;
+    }
+    return CTxOut(0, GetScriptForDestination(CKeyID())).GetDustThreshold();
+}
+
 bool CWallet::FundTransaction(CMutableTransaction& tx, CAmount &nFeeRet, int& nChangePosRet, std::string& strFailReason, bool includeWatching)
 {
     vector<CRecipient> vecSend;
@@ -3778,7 +3766,7 @@ bool CWallet::CreateTransaction(const vector<CRecipient>& vecSend, CWalletTx& wt
                 CAmount nValueIn = 0;
                 bool fOnlyCoinbaseCoins = false;
                 bool fNeedCoinbaseCoins = false;
-                if (!SelectCoins(nValueToSelect, setCoins, nValueIn, fOnlyCoinbaseCoins, fNeedCoinbaseCoins, coinControl))
+                if (!SelectCoins(nValueToSelect, setCoins, nValueIn, fOnlyCoinbaseCoins, fNeedCoinbaseCoins, GetCostOfChange(vecSend), coinControl))
                 {
                     if (fOnlyCoinbaseCoins && Params().GetConsensus().fCoinbaseMustBeShielded) {
                         strFailReason = _("Coinbase funds can only be sent to a zaddr");
@@ -5114,7 +5102,8 @@ void CWallet::GetFilteredNotes(
 /**
  * Find notes in the wallet filtered by payment addresses, min depth, max depth,
  * if the note is spent, if a spending key is required, and if the notes are locked.
- * These notes are decrypted and added to the output parameter vector, outEntries.
+ * These notes are decrypted once, cached in their note data, and added to the
+ * output parameter vector, outEntries.
  */
 void CWallet::GetFilteredNotes(
     std::vector<SproutNoteEntry>& sproutEntries,
@@ -5128,21 +5117,59 @@ void CWallet::GetFilteredNotes(
 {
     LOCK2(cs_main, cs_wallet);
 
+    // When filtering by address, only visit the transactions holding notes
+    // for those addresses
+    bool fUseIndex = !filterAddresses.empty();
+    std::set<uint256> setIndexedTxs;
+    for (const PaymentAddress& addr : filterAddresses) {
+        if (auto sproutAddr = std::get_if<SproutPaymentAddress>(&addr)) {
+            auto it = mapSproutAddressTxs.find(*sproutAddr);
+            if (it != mapSproutAddressTxs.end()) {
+                setIndexedTxs.insert(it->second.begin(), it->second.end());
+            }
+        } else if (auto saplingAddr = std::get_if<SaplingPaymentAddress>(&addr)) {
+            SaplingIncomingViewingKey ivk;
+            if (!GetSaplingIncomingViewingKey(*saplingAddr, ivk)) {
+                fUseIndex = false;
+                break;
+            }
+            auto it = mapSaplingIvkTxs.find(ivk);
+            if (it != mapSaplingIvkTxs.end()) {
+                setIndexedTxs.insert(it->second.begin(), it->second.end());
+            }
+        }
+    }
+
+    std::vector<CWalletTx*> vWtx;
+    if (fUseIndex) {
+        for (const uint256& hash : setIndexedTxs) {
+            auto it = mapWallet.find(hash);
+            if (it != mapWallet.end()) {
+                vWtx.push_back(&it->second);
+            }
+        }
+    } else {
+        for (auto & p : mapWallet) {
+            vWtx.push_back(&p.second);
+        }
+    }
+
     KeyIO keyIO(Params());
-    for (auto & p : mapWallet) {
-        CWalletTx wtx = p.second;
+    for (CWalletTx* pwtx : vWtx) {
+        CWalletTx& wtx = *pwtx;
+        int nDepth = wtx.GetDepthInMainChain();
 
         // Filter the transactions before checking for notes
         if (!CheckFinalTx(wtx) ||
             wtx.GetBlocksToMaturity() > 0 ||
-            wtx.GetDepthInMainChain() < minDepth ||
-            wtx.GetDepthInMainChain() > maxDepth) {
+            nDepth < minDepth ||
+            nDepth > maxDepth) {
             continue;
         }
 
         for (auto & pair : wtx.mapSproutNoteData) {
             JSOutPoint jsop = pair.first;
-            SproutNoteData nd = pair.second;
+            SproutNoteData& nd = pair.second;
             SproutPaymentAddress pa = nd.address;
 
             // skip notes which belong to a different payment address in the wallet
@@ -5165,41 +5192,46 @@ void CWallet::GetFilteredNotes(
                 continue;
             }
 
-            int i = jsop.js; // Index into CTransaction.vJoinSplit
-            int j = jsop.n; // Index into JSDescription.ciphertexts
+            if (!nd.decrypted) {
+                int i = jsop.js; // Index into CTransaction.vJoinSplit
+                int j = jsop.n; // Index into JSDescription.ciphertexts
 
-            // Get cached decryptor
-            ZCNoteDecryption decryptor;
-            if (!GetNoteDecryptor(pa, decryptor)) {
-                // Note decryptors are created when the wallet is loaded, so it should always exist
-                throw std::runtime_error(strprintf("Could not find note decryptor for payment address %s", keyIO.EncodePaymentAddress(pa)));
-            }
+                // Get cached decryptor
+                ZCNoteDecryption decryptor;
+                if (!GetNoteDecryptor(pa, decryptor)) {
+                    // Note decryptors are created when the wallet is loaded, so it should always exist
+                    throw std::runtime_error(strprintf("Could not find note decryptor for payment address %s", keyIO.EncodePaymentAddress(pa)));
+                }
+
+                // determine amount of funds in the note
+                auto hSig = wtx.vJoinSplit[i].h_sig(wtx.joinSplitPubKey);
+                try {
+                    SproutNotePlaintext plaintext = SproutNotePlaintext::decrypt(
+                            decryptor,
+                            wtx.vJoinSplit[i].ciphertexts[j],
+                            wtx.vJoinSplit[i].ephemeralKey,
+                            hSig,
+                            (unsigned char) j);
 
-            // determine amount of funds in the note
-            auto hSig = wtx.vJoinSplit[i].h_sig(wtx.joinSplitPubKey);
-            try {
-                SproutNotePlaintext plaintext = SproutNotePlaintext::decrypt(
-                        decryptor,
-                        wtx.vJoinSplit[i].ciphertexts[j],
-                        wtx.vJoinSplit[i].ephemeralKey,
-                        hSig,
-                        (unsigned char) j);
-
-                sproutEntries.push_back(SproutNoteEntry {
-                    jsop, pa, plaintext.note(pa), plaintext.memo(), wtx.GetDepthInMainChain() });
-
-            } catch (const note_decryption_failed &err) {
-                // Couldn't decrypt with this spending key
-                throw std::runtime_error(strprintf("Could not decrypt note for payment address %s", keyIO.EncodePaymentAddress(pa)));
-            } catch (const std::exception &exc) {
-                // Unexpected failure
-                throw std::runtime_error(strprintf("Error while decrypting note for payment address %s: %s", keyIO.EncodePaymentAddress(pa), exc.what()));
+                    nd.decrypted = std::make_shared<const DecryptedSproutNote>(
+                        DecryptedSproutNote { pa, plaintext.note(pa), plaintext.memo() });
+
+                } catch (const note_decryption_failed &err) {
+                    // Couldn't decrypt with this spending key
+                    throw std::runtime_error(strprintf("Could not decrypt note for payment address %s", keyIO.EncodePaymentAddress(pa)));
+                } catch (const std::exception &exc) {
+                    // Unexpected failure
+                    throw std::runtime_error(strprintf("Error while decrypting note for payment address %s: %s", keyIO.EncodePaymentAddress(pa), exc.what()));
+                }
             }
+
+            sproutEntries.push_back(SproutNoteEntry {
+                jsop, pa, nd.decrypted->note, nd.decrypted->memo, nDepth });
         }
 
         for (auto & pair : wtx.mapSaplingNoteData) {
             SaplingOutPoint op = pair.first;
-            SaplingNoteData nd = pair.second;
+            SaplingNoteData& nd = pair.second;
 
             // skip note which has been spent
             if (ignoreSpent && nd.nullifier && IsSaplingSpent(*nd.nullifier)) {
@@ -5211,17 +5243,22 @@ void CWallet::GetFilteredNotes(
                 continue;
             }
 
-            auto maybe_pt = SaplingNotePlaintext::decrypt(
-                wtx.vShieldedOutput[op.n].encCiphertext,
-                nd.ivk,
-                wtx.vShieldedOutput[op.n].ephemeralKey,
-                wtx.vShieldedOutput[op.n].cmu);
-            assert(static_cast<bool>(maybe_pt));
-            auto notePt = maybe_pt.value();
+            if (!nd.decrypted) {
+                auto maybe_pt = SaplingNotePlaintext::decrypt(
+                    wtx.vShieldedOutput[op.n].encCiphertext,
+                    nd.ivk,
+                    wtx.vShieldedOutput[op.n].ephemeralKey,
+                    wtx.vShieldedOutput[op.n].cmu);
+                assert(static_cast<bool>(maybe_pt));
+                auto notePt = maybe_pt.value();
 
-            auto maybe_pa = nd.ivk.address(notePt.d);
-            assert(static_cast<bool>(maybe_pa));
-            auto pa = maybe_pa.value();
+                auto maybe_pa = nd.ivk.address(notePt.d);
+                assert(static_cast<bool>(maybe_pa));
+
+                nd.decrypted = std::make_shared<const DecryptedSaplingNote>(
+                    DecryptedSaplingNote { maybe_pa.value(), notePt.note(nd.ivk).value(), notePt.memo() });
+            }
+            const SaplingPaymentAddress& pa = nd.decrypted->address;
 
             // skip notes which belong to a different payment address in the wallet
             if (!(filterAddresses.empty() || filterAddresses.count(pa))) {
@@ -5233,9 +5270,8 @@ void CWallet::GetFilteredNotes(
                 continue;
             }
 
-            auto note = notePt.note(nd.ivk).value();
             saplingEntries.push_back(SaplingNoteEntry {
-                op, pa, note, notePt.memo(), wtx.GetDepthInMainChain() });
+                op, pa, nd.decrypted->note, nd.decrypted->memo, nDepth });
         }
     }
 }
@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <optional>
 #include <set>
 #include <stdexcept>
@@ -213,6 +214,22 @@ public:
     std::string ToString() const;
 };
 
+/**
+ * A wallet note as decrypted from its transaction, together with the address
+ * it was sent to and its memo. Shared between copies of the note data, so
+ * that copying wallet transactions stays cheap.
+ */
+template <typename PaymentAddress, typename Note>
+struct DecryptedNote
+{
+    PaymentAddress address;
+    Note note;
+    std::array<unsigned char, ZC_MEMO_SIZE> memo;
+};
+
+typedef DecryptedNote<libzcash::SproutPaymentAddress, libzcash::SproutNote> DecryptedSproutNote;
+typedef DecryptedNote<libzcash::SaplingPaymentAddress, libzcash::SaplingNote> DecryptedSaplingNote;
+
 class SproutNoteData
 {
 public:
@@ -259,6 +276,12 @@ public:
      */
     std::optional<int> spentHeight;
 
+    /**
+     * (memory only) The decrypted note, set the first time the wallet needs
+     * its plaintext so that it is only trial-decrypted once.
+     */
+    std::shared_ptr<const DecryptedSproutNote> decrypted;
+
     SproutNoteData() : address(), nullifier(), witnessHeight {-1}, spentHeight() { }
     SproutNoteData(libzcash::SproutPaymentAddress a) :
             address {a}, nullifier(), witnessHeight {-1}, spentHeight() { }
@@ -324,6 +347,12 @@ public:
      */
     std::optional<int> spentHeight;
 
+    /**
+     * (memory only) The decrypted note, set the first time the wallet needs
+     * its plaintext. See SproutNoteData.
+     */
+    std::shared_ptr<const DecryptedSaplingNote> decrypted;
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -703,9 +732,10 @@ private:
     /**
      * Select a set of coins such that nValueRet >= nTargetValue and at least
      * all coins from coinControl are selected; Never select unconfirmed coins
-     * if they are not ours
+     * if they are not ours; A selection exceeding nTargetValue by at most
+     * nCostOfChange, which needs no change, is searched for first
      */
-    bool SelectCoins(const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, bool& fOnlyCoinbaseCoinsRet, bool& fNeedCoinbaseCoinsRet, const CCoinControl *coinControl = NULL) const;
+    bool SelectCoins(const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, bool& fOnlyCoinbaseCoinsRet, bool& fNeedCoinbaseCoinsRet, const CAmount& nCostOfChange, const CCoinControl *coinControl = NULL) const;
 
     CWalletDB *pwalletdbEncryption;
 
@@ -746,6 +776,18 @@ private:
     void AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Wallet transactions that may still have outputs to us that no
+     * transaction in the main chain spends, and so may count towards the
+     * balance and available coins. Transactions are added whenever they or
+     * the transactions spending them change, and dropped by GetUnsettledTxs()
+     * once all their outputs to us are spent in the main chain, so balance
+     * queries don't need to visit all of mapWallet.
+     */
+    mutable std::set<uint256> setUnsettledTxs;
+    //! Whether all outputs of wtx to us are spent in the main chain
+    bool IsSettled(const CWalletTx& wtx) const;
+
 public:
     /*
      * Size of the incremental witness cache for the notes in our wallet.
@@ -939,6 +981,17 @@ public:
 
     std::map<uint256, SaplingOutPoint> mapSaplingNullifiersToNotes;
 
+    /**
+     * Wallet transactions holding notes for each Sprout payment address and
+     * Sapling incoming viewing key, so that the notes of a few addresses can
+     * be found without walking all of mapWallet. Transactions are added
+     * whenever their note data is, and only removed when they leave the
+     * wallet, so this may also list transactions that no longer hold notes
+     * for the key.
+     */
+    std::map<libzcash::SproutPaymentAddress, std::set<uint256>> mapSproutAddressTxs;
+    std::map<libzcash::SaplingIncomingViewingKey, std::set<uint256>> mapSaplingIvkTxs;
+
     std::map<uint256, CWalletTx> mapWallet;
 
     typedef std::multimap<int64_t, CWalletTx*> TxItems;
@@ -971,9 +1024,18 @@ public:
      * Shuffle and select coins until nTargetValue is reached while avoiding
      * small change; This method is stochastic for some inputs and upon
      * completion the coin set and corresponding actual target value is
-     * assembled
+     * assembled. If nCostOfChange is set, a selection exceeding nTargetValue
+     * by at most that much, which needs no change, is searched for first.
+     */
+    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, const std::vector<COutput>& vCoins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CAmount& nCostOfChange = 0) const;
+
+    /**
+     * How much coin selection for vecSend may overshoot its target instead of
+     * making change: change below the dust threshold is added to the fee,
+     * unless the fee is subtracted from the recipients, who would pay for
+     * the overshoot.
      */
-    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
+    static CAmount GetCostOfChange(const std::vector<CRecipient>& vecSend);
 
     bool IsSpent(const uint256& hash, unsigned int n) const;
     bool IsSproutSpent(const uint256& nullifier) const;
@@ -1108,6 +1170,7 @@ public:
     void MarkDirty();
     bool UpdateNullifierNoteMap();
     void UpdateNullifierNoteMapWithTx(const CWalletTx& wtx);
+    void UpdateNoteIndexWithTx(const CWalletTx& wtx);
     void UpdateSaplingNullifierNoteMapWithTx(CWalletTx& wtx);
     void UpdateSaplingNullifierNoteMapForBlock(const CBlock* pblock);
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb);
@@ -1122,6 +1185,9 @@ public:
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime);
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime);
+    /** Wallet transactions that may have outputs to us not yet spent in the
+     *  main chain; all others have no balance left. Requires cs_main. */
+    std::vector<const CWalletTx*> GetUnsettledTxs() const;
     CAmount GetBalance(const isminefilter& filter=ISMINE_SPENDABLE, const int min_depth=0) const;
     CAmount GetUnconfirmedBalance() const;
     CAmount GetImmatureBalance() const;
@@ -12,6 +12,7 @@ CCriticalSection cs_warnings;
 std::string strMiscWarning;
 bool fLargeWorkForkFound = false;
 bool fLargeWorkInvalidChainFound = false;
+bool fUnvalidatedSnapshot = false;
 
 void SetMiscWarning(const std::string& strWarning)
 {
@@ -37,6 +38,12 @@ void SetfLargeWorkInvalidChainFound(bool flag)
     fLargeWorkInvalidChainFound = flag;
 }
 
+void SetfUnvalidatedSnapshot(bool flag)
+{
+    LOCK(cs_warnings);
+    fUnvalidatedSnapshot = flag;
+}
+
 std::string GetWarnings(const std::string& strFor)
 {
     std::string strStatusBar;
@@ -57,6 +64,11 @@ std::string GetWarnings(const std::string& strFor)
         strStatusBar = strMiscWarning;
     }
 
+    if (fUnvalidatedSnapshot)
+    {
+        strStatusBar = "Warning: The chainstate was loaded from a UTXO snapshot and the blocks before it have not been validated. Restart with -reindex to validate them.";
+    }
+
     if (fLargeWorkForkFound)
     {
         strStatusBar = strRPC = "Warning: The network does not appear to fully agree! Some miners appear to be experiencing issues.";
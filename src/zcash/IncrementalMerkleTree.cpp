@@ -25,6 +25,29 @@ PedersenHash PedersenHash::combine(
     return res;
 }
 
+std::vector<PedersenHash> PedersenHash::combine_batch(
+    const std::vector<PedersenHash>& nodes,
+    size_t depth
+)
+{
+    static_assert(sizeof(PedersenHash) == 32);
+    assert(nodes.size() % 2 == 0);
+
+    std::vector<PedersenHash> res(nodes.size() / 2);
+    if (res.empty()) {
+        return res;
+    }
+
+    librustzcash_merkle_hash_batch(
+        depth,
+        nodes.front().begin(),
+        res.size(),
+        res.front().begin()
+    );
+
+    return res;
+}
+
 PedersenHash PedersenHash::uncommitted() {
     PedersenHash res = PedersenHash();
 
@@ -434,6 +457,22 @@ SHA256Compress SHA256Compress::combine(
     return res;
 }
 
+std::vector<SHA256Compress> SHA256Compress::combine_batch(
+    const std::vector<SHA256Compress>& nodes,
+    size_t depth
+)
+{
+    assert(nodes.size() % 2 == 0);
+
+    std::vector<SHA256Compress> res;
+    res.reserve(nodes.size() / 2);
+    for (size_t i = 0; i < nodes.size(); i += 2) {
+        res.push_back(combine(nodes[i], nodes[i+1], depth));
+    }
+
+    return res;
+}
+
 static const std::array<SHA256Compress, 66> sha256_empty_roots = {
     uint256(std::vector<unsigned char>{
         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -844,7 +883,7 @@ private:
     static EmptyMerkleRoots<Depth, Hash> emptyroots;
 public:
     PathFiller() : queue() { }
-    PathFiller(std::deque<Hash> queue) : queue(queue) { }
+    PathFiller(std::deque<Hash> queue) : queue(std::move(queue)) { }
 
     Hash next(size_t depth) {
         if (queue.size() > 0) {
@@ -908,7 +947,7 @@ size_t IncrementalMerkleTree<Depth, Hash>::size() const {
     // (right-shifted by 1)
     for (size_t i = 0; i < parents.size(); i++) {
         if (parents[i]) {
-            ret += (1 << (i+1));
+            ret += (size_t(1) << (i+1));
         }
     }
     return ret;
@@ -920,6 +959,8 @@ void IncrementalMerkleTree<Depth, Hash>::append(Hash obj) {
         throw std::runtime_error("tree is full");
     }
 
+    cached_root = std::nullopt;
+
     if (!left) {
         // Set the left leaf
         left = obj;
@@ -951,6 +992,69 @@ void IncrementalMerkleTree<Depth, Hash>::append(Hash obj) {
     }
 }
 
+template<size_t Depth, typename Hash>
+void IncrementalMerkleTree<Depth, Hash>::append_batch(const std::vector<Hash>& objs) {
+    if (objs.empty()) {
+        return;
+    }
+
+    static_assert(Depth < 64);
+    if (objs.size() > (uint64_t(1) << Depth) - size()) {
+        throw std::runtime_error("tree is full");
+    }
+
+    cached_root = std::nullopt;
+
+    // The leaf level holds the existing `left`/`right` leaves followed by the
+    // new objects. The last one or two leaves stay uncombined in `left` and
+    // `right`, exactly as append() leaves them; every pair before them is
+    // complete and is hashed into the level above.
+    std::vector<Hash> level;
+    level.reserve(objs.size() + 2);
+    if (left) {
+        level.push_back(*left);
+    }
+    if (right) {
+        level.push_back(*right);
+    }
+    level.insert(level.end(), objs.begin(), objs.end());
+
+    size_t keep = (level.size() % 2 == 0) ? 2 : 1;
+    size_t npaired = level.size() - keep;
+    left = level[npaired];
+    right = (keep == 2) ? std::optional<Hash>(level[npaired + 1]) : std::nullopt;
+    level.resize(npaired);
+
+    std::vector<Hash> carries = Hash::combine_batch(level, 0);
+
+    // Each entry of `parents` is a completed left subtree waiting for its
+    // sibling. Prepend it to the nodes carried up from below, pair everything
+    // off, and leave an odd node behind as the new waiting subtree.
+    for (size_t i = 0; !carries.empty(); i++) {
+        assert(i < Depth - 1);
+
+        level.clear();
+        if (i < parents.size() && parents[i]) {
+            level.push_back(*parents[i]);
+        }
+        level.insert(level.end(), carries.begin(), carries.end());
+
+        std::optional<Hash> waiting;
+        if (level.size() % 2 == 1) {
+            waiting = level.back();
+            level.pop_back();
+        }
+
+        if (i < parents.size()) {
+            parents[i] = waiting;
+        } else {
+            parents.push_back(waiting);
+        }
+
+        carries = Hash::combine_batch(level, i+1);
+    }
+}
+
 // This is for allowing the witness to determine if a subtree has filled
 // to a particular depth, or for append() to ensure we're not appending
 // to a full tree.
@@ -4,6 +4,7 @@
 #include <array>
 #include <deque>
 #include <optional>
+#include <vector>
 
 #include "uint256.h"
 #include "serialize.h"
@@ -95,8 +96,21 @@ public:
     size_t size() const;
 
     void append(Hash obj);
+
+    // Appends all of `objs` in order, producing the same tree as calling
+    // append() on each of them. Parent nodes are computed level by level so
+    // that each level is hashed with a single Hash::combine_batch() call.
+    // Throws (leaving the tree untouched) if the leaves do not fit.
+    void append_batch(const std::vector<Hash>& objs);
+
+    // The root of the full-depth tree is memoized until the next append.
+    // Like the rest of this class, concurrent access must be synchronized
+    // by the caller.
     Hash root() const {
-        return root(Depth, std::deque<Hash>());
+        if (!cached_root) {
+            cached_root = root(Depth, std::deque<Hash>());
+        }
+        return *cached_root;
     }
     Hash last() const;
 
@@ -112,6 +126,10 @@ public:
         READWRITE(right);
         READWRITE(parents);
 
+        if (ser_action.ForRead()) {
+            cached_root = std::nullopt;
+        }
+
         wfcheck();
     }
 
@@ -130,6 +148,9 @@ private:
 
     // Collapsed "left" subtrees ordered toward the root of the tree.
     std::vector<std::optional<Hash>> parents;
+
+    // Memoized result of root(); not serialized or compared.
+    mutable std::optional<Hash> cached_root;
     MerklePath path(std::deque<Hash> filler_hashes = std::deque<Hash>()) const;
     Hash root(size_t depth, std::deque<Hash> filler_hashes = std::deque<Hash>()) const;
     bool is_complete(size_t depth = Depth) const;
@@ -218,6 +239,13 @@ public:
         size_t depth
     );
 
+    // Combines each adjacent pair (nodes[2i], nodes[2i+1]) at the given
+    // depth, returning one parent per pair.
+    static std::vector<SHA256Compress> combine_batch(
+        const std::vector<SHA256Compress>& nodes,
+        size_t depth
+    );
+
     static SHA256Compress uncommitted() {
         return SHA256Compress();
     }
@@ -235,6 +263,13 @@ public:
         size_t depth
     );
 
+    // Combines each adjacent pair (nodes[2i], nodes[2i+1]) at the given
+    // depth, returning one parent per pair.
+    static std::vector<PedersenHash> combine_batch(
+        const std::vector<PedersenHash>& nodes,
+        size_t depth
+    );
+
     static PedersenHash uncommitted();
     static PedersenHash EmptyRoot(size_t);
 };
@@ -6,6 +6,7 @@
 
 #include "coins.h"
 #include "util.h"
+#include "utilstrencodings.h"
 #include "init.h"
 #include "primitives/transaction.h"
 #include "base58.h"
@@ -23,6 +24,7 @@
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
+#include "test/equihash_test_data.h"
 #include "txdb.h"
 #include "utiltest.h"
 #include "wallet/wallet.h"
@@ -200,13 +202,18 @@ std::vector<double> benchmark_solve_equihash_threaded(int nThreads)
 
 double benchmark_verify_equihash()
 {
-    CChainParams params = Params(CBaseChainParams::MAIN);
-    CBlock genesis = params.GenesisBlock();
-    CBlockHeader genesis_header = genesis.GetBlockHeader();
+    // The mainnet genesis block has no solution, so use a regtest header
+    // with a valid 144,5 solution instead.
+    CChainParams params = Params(CBaseChainParams::REGTEST);
+    CBlockHeader header;
+    CDataStream ss(ParseHex(REGTEST_HEADER_144_5_HEX), SER_NETWORK, PROTOCOL_VERSION);
+    ss >> header;
     struct timeval tv_start;
     timer_start(tv_start);
-    CheckEquihashSolution(&genesis_header, params.GetConsensus());
-    return timer_stop(tv_start);
+    bool fValid = CheckEquihashSolution(&header, params.GetConsensus());
+    double elapsed = timer_stop(tv_start);
+    assert(fValid);
+    return elapsed;
 }
 
 double benchmark_large_tx(size_t nInputs)
@@ -433,6 +440,46 @@ double benchmark_increment_sapling_note_witnesses(size_t nTxs)
     return timer_stop(tv_start);
 }
 
+template<typename Tree>
+double benchmark_tree_append(size_t nLeaves, bool fBatch)
+{
+    typedef typename std::remove_reference<decltype(Tree().last())>::type Hash;
+
+    std::vector<Hash> leaves;
+    leaves.reserve(nLeaves);
+    for (size_t i = 0; i < nLeaves; i++) {
+        // Any 32-byte string with the top bits clear is a valid leaf
+        // for both the SHA256Compress and Pedersen trees.
+        uint256 leaf = GetRandHash();
+        *(leaf.end() - 1) &= 0x0f;
+        leaves.push_back(leaf);
+    }
+
+    Tree tree;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    if (fBatch) {
+        tree.append_batch(leaves);
+    } else {
+        for (const Hash& leaf : leaves) {
+            tree.append(leaf);
+        }
+    }
+    tree.root();
+    return timer_stop(tv_start);
+}
+
+double benchmark_sprout_tree_append(size_t nLeaves, bool fBatch)
+{
+    return benchmark_tree_append<SproutMerkleTree>(nLeaves, fBatch);
+}
+
+double benchmark_sapling_tree_append(size_t nLeaves, bool fBatch)
+{
+    return benchmark_tree_append<SaplingMerkleTree>(nLeaves, fBatch);
+}
+
 // Fake the input of a given block
 // This class is based on the class CCoinsViewDB, but with limited functionality.
 // The constructor and the functions `GetCoins` and `HaveCoins` come directly from
@@ -590,6 +637,17 @@ double benchmark_listunspent()
     return timer_stop(tv_start);
 }
 
+extern UniValue z_gettotalbalance(const UniValue& params, bool fHelp);
+
+double benchmark_z_gettotalbalance()
+{
+    UniValue params(UniValue::VARR);
+    struct timeval tv_start;
+    timer_start(tv_start);
+    auto balance = z_gettotalbalance(params, false);
+    return timer_stop(tv_start);
+}
+
 double benchmark_create_sapling_spend()
 {
     auto sk = libzcash::SaplingSpendingKey::random();